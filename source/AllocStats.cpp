@@ -0,0 +1,110 @@
+/*
+ *	AllocStats.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Replaces the global operator new and delete so every heap allocation
+	made through them is counted. Counting is two relaxed atomic adds on
+	top of malloc, cheap enough to leave on in release builds, which is
+	where steady state allocations matter. Anything linked with this file
+	is counted; memory from malloc itself isn't, so containers that want
+	to be seen (FlatArray) allocate through operator new.
+ */
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include "AllocStats.h"
+using namespace std;
+
+static atomic<long long> allocCount(0);
+static atomic<long long> allocBytes(0);
+
+AllocSnapshot getAllocSnapshot(void)
+{
+	AllocSnapshot s;
+
+	s.count = allocCount.load(memory_order_relaxed);
+	s.bytes = allocBytes.load(memory_order_relaxed);
+	return s;
+}
+
+AllocSnapshot allocsSince(const AllocSnapshot& before)
+{
+	AllocSnapshot s = getAllocSnapshot();
+
+	s.count -= before.count;
+	s.bytes -= before.bytes;
+	return s;
+}
+
+static void* countedAlloc(size_t size)
+{
+	void* p;
+
+	allocCount.fetch_add(1, memory_order_relaxed);
+	allocBytes.fetch_add(size, memory_order_relaxed);
+
+	//malloc(0) may return NULL, new may not
+	while(!(p = malloc(size ? size : 1))){
+		new_handler handler = get_new_handler();
+		if(!handler){
+			throw bad_alloc();
+		}
+		handler();
+	}
+	return p;
+}
+
+void* operator new(size_t size)
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return countedAlloc(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+	try {
+		return countedAlloc(size);
+	}
+	catch(...){
+		return NULL;
+	}
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept
+{
+	try {
+		return countedAlloc(size);
+	}
+	catch(...){
+		return NULL;
+	}
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept
+{
+	free(p);
+}
@@ -0,0 +1,25 @@
+/*
+ *	AllocStats.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef ALLOCSTATS_H_
+#define ALLOCSTATS_H_
+
+//Running totals of every operator new in the program, counted by the
+//replacement operators in AllocStats.cpp. Take a snapshot before and
+//after a frame and subtract to see what the frame allocated.
+struct AllocSnapshot
+{
+	long long count;
+	long long bytes;
+};
+
+AllocSnapshot	getAllocSnapshot(void);
+AllocSnapshot	allocsSince(const AllocSnapshot& before);
+
+#endif
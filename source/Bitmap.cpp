@@ -0,0 +1,94 @@
+/*
+ *	Bitmap.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Minimal Windows bitmap loader, standing in for GLaux's auxDIBImageLoad()
+	so textures load the same way on every platform.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Bitmap.h"
+
+static unsigned int readLE(const unsigned char* p, int bytes)
+{
+	unsigned int v = 0;
+
+	for(int i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+RGBImage* loadBitmap(const char* fileName)
+{
+	unsigned char header[54];
+	unsigned char* row;
+	RGBImage* image;
+	int width, height, bpp, stride;
+	unsigned int offset;
+	bool topDown = false;
+	FILE* fp = fopen(fileName, "rb");
+
+	if(!fp){
+		return NULL;
+	}
+
+	//file header and BITMAPINFOHEADER
+	if(fread(header, 1, 54, fp) != 54 || header[0] != 'B' || header[1] != 'M'){
+		fclose(fp);
+		return NULL;
+	}
+
+	offset = readLE(header + 10, 4);
+	width = (int)readLE(header + 18, 4);
+	height = (int)readLE(header + 22, 4);
+	bpp = readLE(header + 28, 2);
+
+	//only uncompressed true colour images
+	if((bpp != 24 && bpp != 32) || readLE(header + 30, 4) != 0 || width <= 0){
+		fclose(fp);
+		return NULL;
+	}
+	if(height < 0){
+		height = -height;
+		topDown = true;
+	}
+
+	//rows are padded to four bytes
+	stride = (width * bpp / 8 + 3) & ~3;
+
+	image = (RGBImage*)malloc(sizeof(RGBImage));
+	image->sizeX = width;
+	image->sizeY = height;
+	image->data = (unsigned char*)malloc(width * height * 3);
+	row = (unsigned char*)malloc(stride);
+
+	fseek(fp, offset, SEEK_SET);
+	for(int y = 0; y < height; y++){
+		unsigned char* dst = image->data + (topDown ? height - 1 - y : y) * width * 3;
+
+		if(fread(row, 1, stride, fp) != (size_t)stride){
+			free(row);
+			free(image->data);
+			free(image);
+			fclose(fp);
+			return NULL;
+		}
+
+		//BGR(A) to RGB
+		for(int x = 0; x < width; x++){
+			const unsigned char* src = row + x * bpp / 8;
+			dst[x*3 + 0] = src[2];
+			dst[x*3 + 1] = src[1];
+			dst[x*3 + 2] = src[0];
+		}
+	}
+
+	free(row);
+	fclose(fp);
+	return image;
+}
@@ -0,0 +1,24 @@
+/*
+ *	Bitmap.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef BITMAP_H_
+#define BITMAP_H_
+
+//RGB pixels, bottom row first, ready for glTexImage2D
+struct RGBImage
+{
+	int sizeX, sizeY;
+	unsigned char* data;
+};
+
+//Loads an uncompressed 24 or 32 bit .bmp file. Returns NULL on failure;
+//the image and its data are allocated with malloc() and freed with free().
+RGBImage*	loadBitmap(const char* fileName);
+
+#endif
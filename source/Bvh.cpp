@@ -0,0 +1,622 @@
+/*
+ *	Bvh.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Bounding volume hierarchy over the orb centres. Leaves keep their orbs
+	in fixed size buckets so a leaf can take a new orb or lose one without
+	moving anything else. The first build splits at the median of the
+	longest axis; after that a spawn walks down to the leaf whose box grows
+	least, splitting it once full, and a capture swaps the leaf's last orb
+	into its place. Empty leaves are unlinked so the tree never fills with
+	dead branches. Boxes bound centres only and queries widen them by the
+	orb radius.
+ */
+
+#include <algorithm>
+#include <float.h>
+#include "Bvh.h"
+
+static const int STACK_SIZE = 256;
+
+OrbBvh::OrbBvh(void)
+			: root(-1),
+			  count(0)
+{
+}
+
+int OrbBvh::size(void)
+{
+	return count;
+}
+
+int OrbBvh::getNodeCount(void)
+{
+	return nodes.size() - freeNodes.size();
+}
+
+int OrbBvh::getDepth(void)
+{
+	return root < 0 ? 0 : depthBelow(root);
+}
+
+int OrbBvh::depthBelow(int node)
+{
+	if(nodes[node].bucket >= 0){
+		return 1;
+	}
+	return 1 + max(depthBelow(nodes[node].left), depthBelow(nodes[node].right));
+}
+
+int OrbBvh::newNode(int parent)
+{
+	int n;
+
+	if(!freeNodes.empty()){
+		n = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else {
+		n = nodes.size();
+		nodes.resize(n + 1);
+	}
+
+	nodes[n].parent = parent;
+	nodes[n].left = nodes[n].right = -1;
+	nodes[n].bucket = -1;
+	nodes[n].count = 0;
+	return n;
+}
+
+int OrbBvh::newBucket(void)
+{
+	int b;
+
+	if(!freeBuckets.empty()){
+		b = freeBuckets.back();
+		freeBuckets.pop_back();
+	}
+	else {
+		b = owner.size();
+		owner.push_back(-1);
+		items.resize(items.size() + LEAF_SIZE);
+	}
+	return b;
+}
+
+void OrbBvh::build(World& world)
+{
+	vector<Item> list(world.size());
+
+	nodes.clear();
+	items.clear();
+	owner.clear();
+	freeNodes.clear();
+	freeBuckets.clear();
+	location.assign(world.getNextId(), -1);
+	root = -1;
+	count = world.size();
+
+	for(int i = 0; i < count; i++){
+		list[i].x = world[i].pos.x;
+		list[i].y = world[i].pos.y;
+		list[i].z = world[i].pos.z;
+		list[i].id = world[i].id;
+	}
+	if(count > 0){
+		root = buildRange(&list[0], count, -1);
+	}
+}
+
+//Top down build: split at the median along the longest side of the box
+int OrbBvh::buildRange(Item* list, int n, int parent)
+{
+	int node = newNode(parent);
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	int axis, mid, left, right;
+
+	if(n <= LEAF_SIZE){
+		int b = newBucket();
+
+		for(int i = 0; i < n; i++){
+			items[b * LEAF_SIZE + i] = list[i];
+			location[list[i].id] = b * LEAF_SIZE + i;
+		}
+		owner[b] = node;
+		nodes[node].bucket = b;
+		nodes[node].count = n;
+		fitLeaf(node);
+		return node;
+	}
+
+	for(int i = 0; i < n; i++){
+		const float* p = &list[i].x;
+		for(int k = 0; k < 3; k++){
+			lo[k] = min(lo[k], p[k]);
+			hi[k] = max(hi[k], p[k]);
+		}
+	}
+	axis = 0;
+	if(hi[1] - lo[1] > hi[axis] - lo[axis])
+		axis = 1;
+	if(hi[2] - lo[2] > hi[axis] - lo[axis])
+		axis = 2;
+
+	mid = n / 2;
+	nth_element(list, list + mid, list + n, [axis](const Item& a, const Item& b){
+		return (&a.x)[axis] < (&b.x)[axis];
+	});
+
+	//children may grow the node array, so no references across these
+	left = buildRange(list, mid, node);
+	right = buildRange(list + mid, n - mid, node);
+
+	Node& self = nodes[node];
+	self.left = left;
+	self.right = right;
+	for(int k = 0; k < 3; k++){
+		self.lo[k] = lo[k];
+		self.hi[k] = hi[k];
+	}
+	return node;
+}
+
+void OrbBvh::fitLeaf(int node)
+{
+	Node& leaf = nodes[node];
+	const Item* it = &items[leaf.bucket * LEAF_SIZE];
+
+	for(int k = 0; k < 3; k++){
+		leaf.lo[k] = FLT_MAX;
+		leaf.hi[k] = -FLT_MAX;
+	}
+	for(int i = 0; i < leaf.count; i++){
+		const float* p = &it[i].x;
+		for(int k = 0; k < 3; k++){
+			leaf.lo[k] = min(leaf.lo[k], p[k]);
+			leaf.hi[k] = max(leaf.hi[k], p[k]);
+		}
+	}
+}
+
+//Refits node and the boxes above it, stopping once nothing changes
+void OrbBvh::refit(int node)
+{
+	bool changed;
+
+	while(node >= 0){
+		Node& n = nodes[node];
+		float lo[3], hi[3];
+
+		if(n.bucket >= 0){
+			fitLeaf(node);
+			node = n.parent;
+			continue;
+		}
+
+		const Node& l = nodes[n.left];
+		const Node& r = nodes[n.right];
+		changed = false;
+		for(int k = 0; k < 3; k++){
+			lo[k] = min(l.lo[k], r.lo[k]);
+			hi[k] = max(l.hi[k], r.hi[k]);
+			changed |= lo[k] != n.lo[k] || hi[k] != n.hi[k];
+			n.lo[k] = lo[k];
+			n.hi[k] = hi[k];
+		}
+		if(!changed){
+			return;
+		}
+		node = n.parent;
+	}
+}
+
+//Surface area of a box, the usual estimate of what it costs to visit
+static float area(const float* lo, const float* hi)
+{
+	float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+	return dx*dy + dy*dz + dz*dx;
+}
+
+//Room for orbs orbs with ids below ids, so inserts up to there don't
+//reallocate. A leaf is only split when full, leaving two at least half
+//full, which bounds how many leaves and nodes that many orbs take.
+void OrbBvh::reserve(int orbs, unsigned int ids)
+{
+	int leaves = orbs / (LEAF_SIZE / 2) + 1;
+
+	nodes.reserve(2 * leaves);
+	freeNodes.reserve(2 * leaves);
+	items.reserve(leaves * LEAF_SIZE);
+	owner.reserve(leaves);
+	freeBuckets.reserve(leaves);
+	location.reserve(ids);
+}
+
+void OrbBvh::insert(unsigned int id, const Point3D& pos)
+{
+	Item item = { pos.x, pos.y, pos.z, id };
+	const float* p = &item.x;
+	int node;
+
+	if(id >= location.size()){
+		location.resize(id + 1, -1);
+	}
+	count++;
+
+	if(root < 0){
+		root = buildRange(&item, 1, -1);
+		return;
+	}
+
+	//walk down to the leaf whose box grows least
+	node = root;
+	while(nodes[node].bucket < 0){
+		float grow[2], size[2];
+		int child[2] = { nodes[node].left, nodes[node].right };
+
+		for(int c = 0; c < 2; c++){
+			const Node& n = nodes[child[c]];
+			float lo[3], hi[3];
+
+			for(int k = 0; k < 3; k++){
+				lo[k] = min(n.lo[k], p[k]);
+				hi[k] = max(n.hi[k], p[k]);
+			}
+			size[c] = area(n.lo, n.hi);
+			grow[c] = area(lo, hi) - size[c];
+		}
+		if(grow[0] < grow[1] || (grow[0] == grow[1] && size[0] <= size[1]))
+			node = child[0];
+		else
+			node = child[1];
+	}
+
+	Node& leaf = nodes[node];
+	if(leaf.count < LEAF_SIZE){
+		int slot = leaf.bucket * LEAF_SIZE + leaf.count++;
+		items[slot] = item;
+		location[id] = slot;
+		refit(node);
+	}
+	else {
+		//full: rebuild the leaf as a node over two new leaves
+		Item list[LEAF_SIZE + 1];
+		int b = leaf.bucket;
+
+		for(int i = 0; i < LEAF_SIZE; i++){
+			list[i] = items[b * LEAF_SIZE + i];
+		}
+		list[LEAF_SIZE] = item;
+		freeBuckets.push_back(b);
+		owner[b] = -1;
+
+		int parent = leaf.parent;
+		int left, right;
+		int fresh = buildRange(list, LEAF_SIZE + 1, parent);
+
+		//buildRange made a new node; move it into the old leaf's place
+		left = nodes[fresh].left;
+		right = nodes[fresh].right;
+		nodes[node] = nodes[fresh];
+		nodes[left].parent = node;
+		nodes[right].parent = node;
+		freeNodes.push_back(fresh);
+		refit(parent);
+	}
+}
+
+//Builds the orbs into a subtree and links it in beside the node it
+//grows least, walking down only while the nodes are bigger than it
+void OrbBvh::insert(const Orb* list, int n)
+{
+	int sub, node, parent, joint;
+
+	if(n <= 0){
+		return;
+	}
+	batch.clear();
+	for(int i = 0; i < n; i++){
+		Item item = { (float)list[i].pos.x, (float)list[i].pos.y, (float)list[i].pos.z, list[i].id };
+
+		if(item.id >= location.size()){
+			location.resize(item.id + 1, -1);
+		}
+		batch.push_back(item);
+	}
+	count += n;
+
+	sub = buildRange(&batch[0], n, -1);
+	if(root < 0){
+		root = sub;
+		return;
+	}
+
+	const float* lo = nodes[sub].lo;
+	const float* hi = nodes[sub].hi;
+	float subSize = area(lo, hi);
+
+	node = root;
+	while(nodes[node].bucket < 0 && area(nodes[node].lo, nodes[node].hi) > subSize){
+		float grow[2], size[2];
+		int child[2] = { nodes[node].left, nodes[node].right };
+
+		for(int c = 0; c < 2; c++){
+			const Node& m = nodes[child[c]];
+			float blo[3], bhi[3];
+
+			for(int k = 0; k < 3; k++){
+				blo[k] = min(m.lo[k], lo[k]);
+				bhi[k] = max(m.hi[k], hi[k]);
+			}
+			size[c] = area(m.lo, m.hi);
+			grow[c] = area(blo, bhi) - size[c];
+		}
+		if(grow[0] < grow[1] || (grow[0] == grow[1] && size[0] <= size[1]))
+			node = child[0];
+		else
+			node = child[1];
+	}
+
+	//a new node takes node's place, over it and the subtree
+	parent = nodes[node].parent;
+	joint = newNode(parent);
+	nodes[joint].left = node;
+	nodes[joint].right = sub;
+	nodes[node].parent = joint;
+	nodes[sub].parent = joint;
+	if(parent < 0){
+		root = joint;
+	}
+	else if(nodes[parent].left == node){
+		nodes[parent].left = joint;
+	}
+	else {
+		nodes[parent].right = joint;
+	}
+	for(int k = 0; k < 3; k++){
+		nodes[joint].lo[k] = min(nodes[node].lo[k], nodes[sub].lo[k]);
+		nodes[joint].hi[k] = max(nodes[node].hi[k], nodes[sub].hi[k]);
+	}
+	refit(parent);
+}
+
+void OrbBvh::remove(unsigned int id)
+{
+	int slot, b, node, last;
+
+	if(id >= location.size() || location[id] < 0){
+		return;
+	}
+	slot = location[id];
+	b = slot / LEAF_SIZE;
+	node = owner[b];
+	last = b * LEAF_SIZE + nodes[node].count - 1;
+
+	items[slot] = items[last];
+	location[items[slot].id] = slot;
+	location[id] = -1;
+	nodes[node].count--;
+	count--;
+
+	if(nodes[node].count == 0){
+		unlink(node);
+	}
+	else {
+		refit(node);
+	}
+}
+
+//Takes an empty leaf out of the tree, its sibling moves up a level
+void OrbBvh::unlink(int leaf)
+{
+	int parent = nodes[leaf].parent;
+	int sibling, grand;
+
+	freeBuckets.push_back(nodes[leaf].bucket);
+	owner[nodes[leaf].bucket] = -1;
+	freeNodes.push_back(leaf);
+
+	if(parent < 0){
+		root = -1;
+		return;
+	}
+
+	sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+	grand = nodes[parent].parent;
+	nodes[sibling].parent = grand;
+	if(grand < 0){
+		root = sibling;
+	}
+	else if(nodes[grand].left == parent){
+		nodes[grand].left = sibling;
+	}
+	else {
+		nodes[grand].right = sibling;
+	}
+	freeNodes.push_back(parent);
+	refit(grand);
+}
+
+//Distance along the ray to where it enters the box widened by the orb
+//radius, or -1 if it misses within range
+static double enterBox(const float* lo, const float* hi, const double* o, const double* inv, double range)
+{
+	double tMin = 0, tMax = range;
+
+	for(int k = 0; k < 3; k++){
+		double t0 = (lo[k] - ORB_RADIUS - o[k]) * inv[k];
+		double t1 = (hi[k] + ORB_RADIUS - o[k]) * inv[k];
+		if(t0 > t1)
+			swap(t0, t1);
+		if(t0 > tMin)
+			tMin = t0;
+		if(t1 < tMax)
+			tMax = t1;
+		if(tMin > tMax)
+			return -1;
+	}
+	return tMin;
+}
+
+unsigned int OrbBvh::raycast(const Point3D& origin, const Vector3D& dir, double range, double& dist)
+{
+	double o[3] = { origin.x, origin.y, origin.z };
+	double d[3] = { dir.x, dir.y, dir.z };
+	double inv[3];
+	int stack[STACK_SIZE];
+	double enter[STACK_SIZE];
+	int top = 0;
+	unsigned int hit = 0;
+	double best = range;
+
+	if(root < 0){
+		return 0;
+	}
+	for(int k = 0; k < 3; k++){
+		inv[k] = d[k] != 0 ? 1 / d[k] : 1e30;
+	}
+
+	enter[top] = enterBox(nodes[root].lo, nodes[root].hi, o, inv, best);
+	stack[top++] = root;
+
+	while(top > 0){
+		top--;
+		int node = stack[top];
+		if(enter[top] < 0 || enter[top] > best){
+			continue;
+		}
+
+		const Node& n = nodes[node];
+		if(n.bucket >= 0){
+			const Item* it = &items[n.bucket * LEAF_SIZE];
+			for(int i = 0; i < n.count; i++){
+				double cx = o[0] - it[i].x, cy = o[1] - it[i].y, cz = o[2] - it[i].z;
+				double b = cx*d[0] + cy*d[1] + cz*d[2];
+				double c = cx*cx + cy*cy + cz*cz - ORB_RADIUS*ORB_RADIUS;
+				double disc = b*b - c;
+				double t;
+
+				if(disc < 0)
+					continue;
+				t = -b - sqrt(disc);
+				if(t < 0)
+					t = c < 0 ? 0 : -1;		//inside counts as straight away
+				if(t >= 0 && t < best){
+					best = t;
+					hit = it[i].id;
+				}
+			}
+			continue;
+		}
+
+		//nearer child goes on top so it is searched first
+		double tl = enterBox(nodes[n.left].lo, nodes[n.left].hi, o, inv, best);
+		double tr = enterBox(nodes[n.right].lo, nodes[n.right].hi, o, inv, best);
+		int first = n.left, second = n.right;
+		if(tr >= 0 && (tl < 0 || tr < tl)){
+			swap(first, second);
+			swap(tl, tr);
+		}
+		if(top + 2 > STACK_SIZE){
+			continue;
+		}
+		if(tr >= 0){
+			enter[top] = tr;
+			stack[top++] = second;
+		}
+		if(tl >= 0){
+			enter[top] = tl;
+			stack[top++] = first;
+		}
+	}
+
+	dist = best;
+	return hit;
+}
+
+//Where a sphere lies against the cone: 0 outside, 1 overlapping the
+//edge, 2 wholly inside
+static int sphereInCone(double x, double y, double z, double r, const Point3D& apex,
+			const Vector3D& dir, double sinA, double cosA, double range)
+{
+	double dx = x - apex.x, dy = y - apex.y, dz = z - apex.z;
+	double dist2 = dx*dx + dy*dy + dz*dz;
+	double along, perp, edge;
+
+	if(dist2 > (range + r) * (range + r)){
+		return 0;
+	}
+	along = dx*dir.x + dy*dir.y + dz*dir.z;
+	if(along < -r){
+		return 0;
+	}
+
+	//signed distance from the sphere centre to the side of the cone
+	perp = sqrt(fabs(dist2 - along*along));
+	edge = perp*cosA - along*sinA;
+	if(edge >= r){
+		return 0;
+	}
+	if(edge <= -r && sqrt(dist2) + r <= range){
+		return 2;
+	}
+	return 1;
+}
+
+void OrbBvh::cone(const Point3D& apex, const Vector3D& dir, double halfAngle, double range, vector<unsigned int>& out)
+{
+	double sinA = sin(halfAngle * rads);
+	double cosA = cos(halfAngle * rads);
+	int stack[STACK_SIZE];
+	bool inside[STACK_SIZE];
+	int top = 0;
+
+	out.clear();
+	if(root < 0){
+		return;
+	}
+	inside[top] = false;
+	stack[top++] = root;
+
+	while(top > 0){
+		top--;
+		const Node& n = nodes[stack[top]];
+		bool all = inside[top];
+
+		if(!all){
+			//the sphere around the box, widened by the orb radius
+			double cx = (n.lo[0] + n.hi[0]) * 0.5;
+			double cy = (n.lo[1] + n.hi[1]) * 0.5;
+			double cz = (n.lo[2] + n.hi[2]) * 0.5;
+			double ex = n.hi[0] - cx, ey = n.hi[1] - cy, ez = n.hi[2] - cz;
+			double r = sqrt(ex*ex + ey*ey + ez*ez) + ORB_RADIUS;
+			int side = sphereInCone(cx, cy, cz, r, apex, dir, sinA, cosA, range);
+
+			if(side == 0){
+				continue;
+			}
+			all = side == 2;
+		}
+
+		if(n.bucket >= 0){
+			const Item* it = &items[n.bucket * LEAF_SIZE];
+			for(int i = 0; i < n.count; i++){
+				if(all || sphereInCone(it[i].x, it[i].y, it[i].z, ORB_RADIUS, apex, dir, sinA, cosA, range)){
+					out.push_back(it[i].id);
+				}
+			}
+		}
+		else if(top + 2 <= STACK_SIZE){
+			//everything below a box inside the cone is taken untested
+			inside[top] = all;
+			stack[top++] = n.left;
+			inside[top] = all;
+			stack[top++] = n.right;
+		}
+	}
+}
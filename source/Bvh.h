@@ -0,0 +1,82 @@
+/*
+ *	Bvh.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef BVH_H_
+#define BVH_H_
+#include <vector>
+#include "Camera.h"
+#include "World.h"
+using namespace std;
+
+//size of an orb as drawn
+const double ORB_RADIUS = 1.0;
+
+//Bounding volume hierarchy over the orbs, for ray and cone queries. Orbs
+//never move, so after the first build the tree is only patched: a spawn
+//is slotted into the leaf that grows least, a capture is taken out of
+//its leaf, and in both cases the boxes above are refit. A batch of orbs,
+//such as a chunk coming back into the region, is built into a subtree
+//of its own and hung in the tree whole.
+class OrbBvh
+{
+public:
+			OrbBvh(void);
+	void	build(World& world);
+	void	insert(unsigned int id, const Point3D& pos);
+	void	insert(const Orb* list, int n);
+	void	remove(unsigned int id);
+	void	reserve(int orbs, unsigned int ids);
+	int		size(void);
+	int		getNodeCount(void);
+	int		getDepth(void);
+
+	//nearest orb hit by the ray, 0 if none; dir must be unit length
+	unsigned int	raycast(const Point3D& origin, const Vector3D& dir, double range, double& dist);
+
+	//orbs at least partly inside the cone; dir must be unit length
+	void	cone(const Point3D& apex, const Vector3D& dir, double halfAngle, double range, vector<unsigned int>& out);
+
+private:
+	struct Node
+	{
+		float lo[3], hi[3];			//bounds of the orb centres below
+		int parent;
+		int left, right;			//children, -1 in a leaf
+		int bucket;					//leaf items, -1 in an inner node
+		int count;
+	};
+
+	struct Item
+	{
+		float x, y, z;
+		unsigned int id;
+	};
+
+	int		newNode(int parent);
+	int		newBucket(void);
+	int		buildRange(Item* list, int count, int parent);
+	void	fitLeaf(int node);
+	void	refit(int node);
+	void	unlink(int leaf);
+	int		depthBelow(int node);
+
+	static const int LEAF_SIZE = 8;
+
+	vector<Node> nodes;
+	vector<Item> items;				//LEAF_SIZE per bucket
+	vector<int> owner;				//leaf node of each bucket
+	vector<int> location;			//item slot of each orb id, -1 if none
+	vector<int> freeNodes;
+	vector<int> freeBuckets;
+	vector<Item> batch;				//orbs of a batch insert being built
+	int root;
+	int count;
+};
+
+#endif
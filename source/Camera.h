@@ -10,35 +10,13 @@
 #ifndef CAMERA_H_
 #define CAMERA_H_
 #include <math.h>
+#include "VecMath.h"
 
 static const double rads = 0.0174532925;
 
-//Simple datatype to store 3D coords
-struct Point3D
-{
-	double x,y,z;
-};
-
-//Simple datatype to store/manipulate vectors
-struct Vector3D
-{
-	double x,y,z;
-	double length;
-
-	inline double dot( const Vector3D& A ) const
-	{
-		return A.x*x + A.y*y + A.z*z;
-	}
-
-	void normalize(void)
-	{
-		length = sqrt(x*x+y*y+z*z);
-		x = x/length;
-		y = y/length;
-		z = z/length;
-		length = 1;
-	}
-};
+//Positions and directions; single precision, a SIMD register each
+typedef Vec3 Point3D;
+typedef Vec3 Vector3D;
 
 class Camera
 {
@@ -56,15 +34,19 @@ public:
 	Vector3D getU(void);
 	Vector3D getV(void);
 	Vector3D getN(void);
+	void	setAxes(Vector3D u, Vector3D v, Vector3D n);
+	void	setBoundary(double b);			//slide() keeps within +-b
 	double	getX(void);
 	double	getY(void);
 	double	getZ(void);
-	const	double*	getModelViewMatrix(void) const;
+	Mat4	getModelViewMatrix(void) const;
 
 private:
+	void	orthonormalize(void);
+
 	Point3D eyeLoc;
 	Vector3D U,V,N;
-	mutable double* modelViewMatrix;
+	double	boundary;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,141 @@
+/*
+ *	Checkpoint.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Saves and restores a whole session. Saving gathers the world's orbs by
+	chunk and streams them out with the header in one pass; loading maps
+	the file and hands each chunk its run of orbs as it is, so restoring
+	a world costs about the same whatever its size and orbs are only paged
+	in as the region reaches them.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Checkpoint.h"
+
+static const char MAGIC[8] = { 'A', 'O', 'T', 'O', 'S', 'A', 'V', 'E' };
+static const unsigned long long PAGE = 4096;
+
+static unsigned long long pageAlign(unsigned long long offset)
+{
+	return (offset + PAGE - 1) / PAGE * PAGE;
+}
+
+bool saveCheckpoint(const char* fileName, Session& session)
+{
+	World* world = session.world;
+	CheckpointHeader header;
+	vector<ChunkRecord> chunks;
+	vector<Orb> orbs;
+	unsigned char page[PAGE];
+	char tempName[512];
+	unsigned long long orbBytes, chunkBytes;
+	FILE* file;
+	bool ok;
+
+	world->flatten(chunks, orbs);
+	//timers belong to this run; restored orbs start without one
+	for(unsigned int i = 0; i < orbs.size(); i++){
+		orbs[i].timer = 0;
+	}
+	orbBytes = (unsigned long long)orbs.size() * sizeof(Orb);
+	chunkBytes = (unsigned long long)chunks.size() * sizeof(ChunkRecord);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = CHECKPOINT_VERSION;
+	header.orbSize = sizeof(Orb);
+	header.boundary = world->getBoundary();
+	header.nextId = world->getNextId();
+	header.orbCount = orbs.size();
+	header.orbOffset = PAGE;
+	header.chunkCount = chunks.size();
+	header.chunkOffset = pageAlign(header.orbOffset + orbBytes);
+	header.fileSize = header.chunkOffset + chunkBytes;
+	header.rngState = session.rng->getState();
+	header.eye = session.camera->getLocation();
+	header.u = session.camera->getU();
+	header.v = session.camera->getV();
+	header.n = session.camera->getN();
+	header.captured = session.captured;
+	header.released = session.released;
+
+	//write beside the old file, the world may still be using it
+	sprintf(tempName, "%.500s.tmp", fileName);
+	file = fopen(tempName, "wb");
+	if(!file){
+		return false;
+	}
+
+	//one front to back pass: header page, orbs, padding, chunks
+	memset(page, 0, sizeof(page));
+	memcpy(page, &header, sizeof(header));
+	ok = fwrite(page, PAGE, 1, file) == 1;
+	if(ok && orbBytes)
+		ok = fwrite(&orbs[0], orbBytes, 1, file) == 1;
+	memset(page, 0, sizeof(header));
+	if(ok && header.chunkOffset > header.orbOffset + orbBytes)
+		ok = fwrite(page, header.chunkOffset - header.orbOffset - orbBytes, 1, file) == 1;
+	if(ok && chunkBytes)
+		ok = fwrite(&chunks[0], chunkBytes, 1, file) == 1;
+
+	if(fclose(file) != 0){
+		ok = false;
+	}
+	if(!ok){
+		remove(tempName);
+		return false;
+	}
+
+#ifdef _WIN32
+	remove(fileName);
+#endif
+	return rename(tempName, fileName) == 0;
+}
+
+bool loadCheckpoint(const char* fileName, Session& session)
+{
+	MappedFile* file = new MappedFile;
+	CheckpointHeader header;
+	unsigned char* data;
+
+	if(!file->open(fileName) || file->getSize() < (long long)PAGE){
+		delete file;
+		return false;
+	}
+	data = file->getData();
+	memcpy(&header, data, sizeof(header));
+
+	//only take files this build wrote, and whole ones
+	if(memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+			header.version != CHECKPOINT_VERSION ||
+			header.orbSize != sizeof(Orb) ||
+			header.boundary != (unsigned int)session.world->getBoundary() ||
+			header.fileSize != (unsigned long long)file->getSize() ||
+			header.orbOffset % PAGE != 0 || header.chunkOffset % PAGE != 0 ||
+			header.orbCount > 0x7FFFFFFF || header.chunkCount > 0x7FFFFFFF ||
+			header.orbOffset + header.orbCount * sizeof(Orb) > header.chunkOffset ||
+			header.chunkOffset + header.chunkCount * sizeof(ChunkRecord) > header.fileSize){
+		delete file;
+		return false;
+	}
+
+	//the world checks the chunk table against itself
+	if(!session.world->borrow(file, (Orb*)(data + header.orbOffset),
+			(ChunkRecord*)(data + header.chunkOffset), (int)header.chunkCount,
+			(int)header.orbCount, header.nextId)){
+		delete file;
+		return false;
+	}
+	session.rng->setState(header.rngState);
+	session.camera->setLocation(header.eye);
+	session.camera->setAxes(header.u, header.v, header.n);
+	session.captured = header.captured;
+	session.released = header.released;
+
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+ *	Checkpoint.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+#include "Camera.h"
+#include "World.h"
+#include "Rng.h"
+
+const unsigned int CHECKPOINT_VERSION = 4;
+
+/*
+ *	A checkpoint is the session laid out flat, in this machine's byte
+ *	order:
+ *		header		one page, CheckpointHeader at the start
+ *		orbs		orbCount Orbs grouped by chunk, page aligned
+ *		chunks		chunkCount ChunkRecords, page aligned
+ *	so a load maps the file and points the world's chunks at their runs
+ *	of orbs in it.
+ *	Anything that changes the layout of the header or of Orb must bump
+ *	CHECKPOINT_VERSION.
+ */
+struct CheckpointHeader
+{
+	char magic[8];					//"AOTOSAVE"
+	unsigned int version;
+	unsigned int orbSize;			//sizeof(Orb), catches layout changes
+	unsigned int boundary;
+	unsigned int nextId;
+	unsigned long long orbCount;
+	unsigned long long orbOffset;
+	unsigned long long chunkCount;
+	unsigned long long chunkOffset;
+	unsigned long long fileSize;
+	unsigned long long rngState;
+	Point3D eye;
+	Vector3D u, v, n;
+	int captured;
+	int released;
+};
+
+//What besides the world makes up a session
+struct Session
+{
+	World* world;
+	Camera* camera;
+	Rng* rng;
+	int captured;
+	int released;
+};
+
+bool	saveCheckpoint(const char* fileName, Session& session);
+bool	loadCheckpoint(const char* fileName, Session& session);
+
+#endif
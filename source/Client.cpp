@@ -0,0 +1,204 @@
+/*
+ *	Client.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Keeps the last few decoded snapshots so the server can base its next
+	delta on any of them. A snapshot whose baseline has already been
+	dropped can't be decoded; it is ignored and the client's ack stays put
+	until the server sends one it can use.
+ */
+
+#include "Client.h"
+
+NetClient::NetClient(int boundary)
+			: bound(boundary),
+			  sequence(0),
+			  ack(NO_TICK),
+			  loss(0),
+			  bytesReceived(0),
+			  bytesSent(0),
+			  dropped(0)
+{
+	last.tick = NO_TICK;
+	last.pos.x = last.pos.y = last.pos.z = 0;
+	last.captured = 0;
+	last.released = 0;
+	for(int i = 0; i < HISTORY; i++){
+		states[i].tick = NO_TICK;
+	}
+}
+
+bool NetClient::connect(const NetAddress& inServer)
+{
+	unsigned char msg = MSG_CONNECT;
+
+	server = inServer;
+	if(!socket.open(0)){
+		return false;
+	}
+	bytesSent++;
+	return socket.send(server, &msg, 1);
+}
+
+void NetClient::disconnect(void)
+{
+	unsigned char msg = MSG_DISCONNECT;
+
+	socket.send(server, &msg, 1);
+	socket.close();
+}
+
+//Drops the given fraction of incoming packets, to exercise the baselines
+void NetClient::setLoss(double fraction, unsigned int seed)
+{
+	loss = fraction;
+	lossRng.setState(seed);
+}
+
+void NetClient::sendInput(const PlayerInput& input)
+{
+	unsigned char buffer[64];
+	unsigned char msg = MSG_CONNECT;
+	PacketWriter out(buffer, sizeof(buffer));
+
+	//keep knocking until the server answers
+	if(ack == NO_TICK && last.tick == NO_TICK){
+		socket.send(server, &msg, 1);
+		bytesSent++;
+	}
+
+	writeInput(out, ++sequence, ack, input);
+	socket.send(server, buffer, out.getSize());
+	bytesSent += out.getSize();
+}
+
+void NetClient::receive(void)
+{
+	unsigned char buffer[MAX_PACKET];
+	NetAddress from;
+	int got;
+
+	while((got = socket.receive(from, buffer, sizeof(buffer))) >= 0){
+		if(!(from == server)){
+			continue;
+		}
+		bytesReceived += got;
+
+		if(loss > 0 && lossRng.next() < loss * 4294967295.0){
+			dropped++;
+			continue;
+		}
+		apply(buffer, got);
+	}
+}
+
+bool NetClient::apply(const unsigned char* data, int size)
+{
+	PacketReader in(data, size);
+	SnapshotHeader header;
+	State* base = NULL;
+	unsigned int i, j, k;
+
+	if(!readSnapshot(in, header, removes, adds)){
+		return false;
+	}
+
+	//out of order, we've already moved past it
+	if(ack != NO_TICK && header.tick <= ack){
+		return false;
+	}
+	if(header.baseline != NO_TICK){
+		base = &states[header.baseline % HISTORY];
+		if(base->tick != header.baseline){
+			return false;
+		}
+	}
+
+	State& next = states[header.tick % HISTORY];
+	vector<SnapshotOrb>& orbs = merged;
+
+	//baseline minus removes plus adds, all in id order, into the vector
+	//the overwritten state gave up last time so its memory is reused
+	orbs.clear();
+	i = j = k = 0;
+	while(base && i < base->orbs.size()){
+		const SnapshotOrb& o = base->orbs[i++];
+
+		while(j < removes.size() && removes[j] < o.id)
+			j++;
+		if(j < removes.size() && removes[j] == o.id)
+			continue;
+		while(k < adds.size() && adds[k].id < o.id)
+			orbs.push_back(adds[k++]);
+		orbs.push_back(o);
+	}
+	while(k < adds.size()){
+		orbs.push_back(adds[k++]);
+	}
+
+	next.tick = header.tick;
+	next.orbs.swap(orbs);
+	last = header;
+	ack = header.tick;
+
+	return true;
+}
+
+unsigned short NetClient::getPort(void)
+{
+	return socket.getPort();
+}
+
+bool NetClient::isConnected(void)
+{
+	return ack != NO_TICK;
+}
+
+const vector<SnapshotOrb>& NetClient::getOrbs(void)
+{
+	static const vector<SnapshotOrb> none;
+
+	if(ack == NO_TICK){
+		return none;
+	}
+	return states[ack % HISTORY].orbs;
+}
+
+Point3D NetClient::getPosition(void)
+{
+	return last.pos;
+}
+
+int NetClient::getCaptured(void)
+{
+	return last.captured;
+}
+
+int NetClient::getReleased(void)
+{
+	return last.released;
+}
+
+unsigned int NetClient::getAck(void)
+{
+	return ack;
+}
+
+long long NetClient::getBytesReceived(void)
+{
+	return bytesReceived;
+}
+
+long long NetClient::getBytesSent(void)
+{
+	return bytesSent;
+}
+
+int NetClient::getDropped(void)
+{
+	return dropped;
+}
@@ -0,0 +1,74 @@
+/*
+ *	Client.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef CLIENT_H_
+#define CLIENT_H_
+#include <vector>
+#include "Camera.h"
+#include "Player.h"
+#include "Rng.h"
+#include "Net.h"
+#include "Snapshot.h"
+using namespace std;
+
+//Client end of the server connection: sends inputs, decodes snapshots
+//and keeps the client's copy of the orbs around the player
+class NetClient
+{
+public:
+			NetClient(int boundary);
+	bool	connect(const NetAddress& server);
+	void	disconnect(void);
+	void	sendInput(const PlayerInput& input);
+	void	receive(void);
+	void	setLoss(double fraction, unsigned int seed);
+
+	unsigned short	getPort(void);
+	bool	isConnected(void);
+	const vector<SnapshotOrb>&	getOrbs(void);
+	Point3D	getPosition(void);
+	int		getCaptured(void);
+	int		getReleased(void);
+	unsigned int	getAck(void);
+	long long	getBytesReceived(void);
+	long long	getBytesSent(void);
+	int		getDropped(void);
+
+private:
+	struct State
+	{
+		unsigned int tick;
+		vector<SnapshotOrb> orbs;
+	};
+
+	bool	apply(const unsigned char* data, int size);
+
+	static const int HISTORY = 16;
+
+	UdpSocket socket;
+	NetAddress server;
+	int bound;
+	unsigned int sequence;
+	unsigned int ack;
+	SnapshotHeader last;
+	State states[HISTORY];
+	vector<unsigned int> removes;
+	vector<SnapshotOrb> adds;
+	vector<SnapshotOrb> merged;		//swapped with the state it fills
+
+	//simulated packet loss
+	double loss;
+	Rng lossRng;
+
+	long long bytesReceived;
+	long long bytesSent;
+	int dropped;
+};
+
+#endif
@@ -0,0 +1,967 @@
+/*
+ *	CoreRenderer.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	The OpenGL 3.3 core profile backend. It draws the same frame as the
+	fixed function Renderer from the same state: the camera snapshot and
+	orb lists prepareFrame() fills, the room geometry, the textures and
+	the HUD values. What changes is how it reaches the GPU. Lighting is
+	the fixed function formula for the flashlight evaluated per pixel,
+	materials live in one uniform buffer indexed per draw, the orbs are a
+	single instanced draw fed from a per frame buffer of positions, and
+	the HUD, radar and profiler are collected into one vertex buffer and
+	drawn in three calls. HUD text uses the same 9x15 font as GLUT from an
+	atlas texture.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "CoreRenderer.h"
+#include "Renderer.h"
+#include "HudFont.h"
+#include "HudText.h"
+#include "Trace.h"
+
+//feature toggles and light and material settings, from Renderer.cpp
+extern bool textured, materials, lighting, blended;
+extern GLfloat globalAmbient[], light1Diffuse[], light1Specular[], light1Ambient[];
+extern GLfloat light1Attenuation[], light1Exponent;
+extern GLfloat brickAmbient[], brickDiffuse[], brickSpecular[], brickEmission[], brickShininess;
+extern GLfloat ballAmbient[], ballDiffuse[], ballSpecular[], ballShininess;
+extern GLfloat defEmission[], skyEmission[], targetEmission[], aimEmission[];
+
+//Uniform blocks, laid out as std140
+struct MaterialBlock
+{
+	GLfloat ambient[4];
+	GLfloat diffuse[4];
+	GLfloat specular[4];
+	GLfloat emission[4];
+	GLfloat shininess[4];
+};
+
+struct FrameBlock
+{
+	GLfloat projection[16];
+	GLfloat view[16];
+	GLfloat lightPosition[4];
+	GLfloat spotDirection[4];				//w is the cosine of the cutoff
+	GLfloat lightAmbient[4];
+	GLfloat lightDiffuse[4];
+	GLfloat lightSpecular[4];
+	GLfloat attenuation[4];					//constant, linear, quadratic, spot exponent
+	GLfloat globalAmbient[4];
+	GLint flags[4];							//lighting, texturing, materials
+};
+
+//slots in the material buffer; orbs take one per OrbMark
+enum MaterialSlot { MAT_DEFAULT, MAT_BRICK, MAT_SKY, MAT_ORB, MATERIAL_COUNT = MAT_ORB + 3 };
+
+static const GLuint FRAME_BINDING = 0;
+static const GLuint MATERIAL_BINDING = 1;
+
+//font atlas: glyphs in a 16 by 6 grid, the last cell solid for untextured HUD shapes
+static const int ATLAS_COLUMNS = 16;
+static const int ATLAS_ROWS = 6;
+static const int ATLAS_W = ATLAS_COLUMNS * FONT_WIDTH;
+static const int ATLAS_H = ATLAS_ROWS * FONT_HEIGHT;
+static const int SOLID_CELL = ATLAS_COLUMNS * ATLAS_ROWS - 1;
+
+static const char* shaderHeader =
+	"#version 330 core\n"
+	"struct Material { vec4 ambient; vec4 diffuse; vec4 specular; vec4 emission; vec4 shininess; };\n"
+	"layout(std140) uniform Frame {\n"
+	"	mat4 projection;\n"
+	"	mat4 view;\n"
+	"	vec4 lightPosition;\n"
+	"	vec4 spotDirection;\n"
+	"	vec4 lightAmbient;\n"
+	"	vec4 lightDiffuse;\n"
+	"	vec4 lightSpecular;\n"
+	"	vec4 attenuation;\n"
+	"	vec4 globalAmbient;\n"
+	"	ivec4 flags;\n"
+	"};\n"
+	"layout(std140) uniform Materials { Material materials[6]; };\n";
+
+//GL_LIGHT1 as the fixed function pipeline would light it, but per pixel
+static const char* shadeSource =
+	"vec4 shade(Material m, vec3 eyePos, vec3 n)\n"
+	"{\n"
+	"	vec3 toLight = lightPosition.xyz - eyePos;\n"
+	"	float d = length(toLight);\n"
+	"	vec3 l = toLight / d;\n"
+	"	float att = 1.0 / (attenuation.x + attenuation.y * d + attenuation.z * d * d);\n"
+	"	float spot = dot(-l, spotDirection.xyz);\n"
+	"	att *= spot < spotDirection.w ? 0.0 : pow(spot, attenuation.w);\n"
+	"	float diffuse = max(dot(n, l), 0.0);\n"
+	"	float specular = 0.0;\n"
+	"	if(diffuse > 0.0){\n"
+	"		float nh = max(dot(n, normalize(l + vec3(0.0, 0.0, 1.0))), 0.0);\n"
+	"		specular = m.shininess.x > 0.0 ? pow(nh, m.shininess.x) : 1.0;\n"
+	"	}\n"
+	"	vec3 c = m.emission.rgb + m.ambient.rgb * globalAmbient.rgb + att * (m.ambient.rgb * lightAmbient.rgb +\n"
+	"			diffuse * m.diffuse.rgb * lightDiffuse.rgb + specular * m.specular.rgb * lightSpecular.rgb);\n"
+	"	return vec4(clamp(c, 0.0, 1.0), m.diffuse.a);\n"
+	"}\n";
+
+static const char* roomVertexSource =
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 1) in vec3 normal;\n"
+	"layout(location = 2) in vec2 texCoord;\n"
+	"uniform vec2 offset;\n"
+	"out vec3 eyePos;\n"
+	"out vec3 eyeNormal;\n"
+	"out vec2 uv;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 p = view * vec4(position, 1.0);\n"
+	"	eyePos = p.xyz;\n"
+	"	eyeNormal = mat3(view) * normal;\n"
+	"	uv = texCoord + offset;\n"
+	"	gl_Position = projection * p;\n"
+	"}\n";
+
+static const char* roomFragmentSource =
+	"uniform int material;\n"
+	"uniform vec4 tint;\n"
+	"uniform sampler2D tex;\n"
+	"in vec3 eyePos;\n"
+	"in vec3 eyeNormal;\n"
+	"in vec2 uv;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 c = flags.x != 0 ? shade(materials[material], eyePos, normalize(eyeNormal)) : tint;\n"
+	"	if(flags.y != 0)\n"
+	"		c *= texture(tex, uv);\n"
+	"	fragColor = c;\n"
+	"}\n";
+
+//the orb mesh is a unit sphere, so positions double as normals
+static const char* orbVertexSource =
+	"layout(location = 0) in vec3 position;\n"
+	"layout(location = 3) in vec4 instance;\n"
+	"out vec3 eyePos;\n"
+	"out vec3 eyeNormal;\n"
+	"out float depth;\n"
+	"flat out int mark;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 p = view * vec4(position + instance.xyz, 1.0);\n"
+	"	eyePos = p.xyz;\n"
+	"	eyeNormal = mat3(view) * position;\n"
+	"	depth = -p.z;\n"
+	"	mark = int(instance.w);\n"
+	"	gl_Position = projection * p;\n"
+	"}\n";
+
+static const char* orbFragmentSource =
+	"const vec4 tints[3] = vec4[3](vec4(1.0, 1.0, 0.0, 0.5), vec4(1.0, 0.5, 0.0, 0.6), vec4(1.0, 0.0, 0.0, 0.7));\n"
+	"in vec3 eyePos;\n"
+	"in vec3 eyeNormal;\n"
+	"in float depth;\n"
+	"flat in int mark;\n"
+	"layout(location = 0) out vec4 fragColor;\n"
+	"#ifdef ACCUMULATE\n"
+	"layout(location = 1) out vec4 reveal;\n"
+	"#endif\n"
+	"void main()\n"
+	"{\n"
+	"	int m = flags.z != 0 ? 3 + mark : 0;\n"
+	"	vec4 c = flags.x != 0 ? shade(materials[m], eyePos, normalize(eyeNormal)) : tints[mark];\n"
+	"#ifdef ACCUMULATE\n"
+	"	float w = c.a * clamp(10.0 / (1e-5 + pow(depth / 5.0, 2.0) + pow(depth / 200.0, 6.0)), 1e-2, 3e3);\n"
+	"	fragColor = vec4(c.rgb * c.a, c.a) * w;\n"
+	"	reveal = vec4(c.a);\n"
+	"#else\n"
+	"	fragColor = c;\n"
+	"#endif\n"
+	"}\n";
+
+//debris fades out over its life, which rides in w
+static const char* particleVertexSource =
+	"layout(location = 0) in vec4 particle;\n"
+	"out float fade;\n"
+	"void main()\n"
+	"{\n"
+	"	fade = particle.w;\n"
+	"	gl_Position = projection * (view * vec4(particle.xyz, 1.0));\n"
+	"}\n";
+
+static const char* particleFragmentSource =
+	"in float fade;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColor = vec4(1.0, 0.6, 0.1, 0.8 * fade);\n"
+	"}\n";
+
+static const char* overlayVertexSource =
+	"layout(location = 0) in vec2 position;\n"
+	"layout(location = 1) in vec2 texCoord;\n"
+	"layout(location = 2) in vec4 color;\n"
+	"out vec2 uv;\n"
+	"out vec4 tint;\n"
+	"void main()\n"
+	"{\n"
+	"	uv = texCoord;\n"
+	"	tint = color;\n"
+	"	gl_Position = vec4(position, 0.0, 1.0);\n"
+	"}\n";
+
+//the font atlas is coverage only, the splash screen a full colour image
+static const char* overlayFragmentSource =
+	"uniform sampler2D tex;\n"
+	"uniform bool mask;\n"
+	"in vec2 uv;\n"
+	"in vec4 tint;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 t = texture(tex, uv);\n"
+	"	fragColor = mask ? vec4(tint.rgb, tint.a * t.r) : tint * t;\n"
+	"}\n";
+
+static void setMaterial(MaterialBlock& m, const GLfloat* ambient, const GLfloat* diffuse,
+			const GLfloat* specular, const GLfloat* emission, GLfloat shininess)
+{
+	memcpy(m.ambient, ambient, sizeof(m.ambient));
+	memcpy(m.diffuse, diffuse, sizeof(m.diffuse));
+	memcpy(m.specular, specular, sizeof(m.specular));
+	memcpy(m.emission, emission, sizeof(m.emission));
+	m.shininess[0] = shininess;
+	m.shininess[1] = m.shininess[2] = m.shininess[3] = 0;
+}
+
+CoreRenderer::CoreRenderer(Renderer* inOwner)
+			: owner(inOwner),
+			  w(inOwner->w),
+			  h(inOwner->h),
+			  hudScaleX(1),
+			  hudScaleY(1),
+			  skyScroll(0),
+			  roomProgram(0),
+			  orbProgram(0),
+			  accumProgram(0),
+			  particleProgram(0),
+			  overlayProgram(0),
+			  frameUbo(0),
+			  materialUbo(0),
+			  roomVao(0), roomVbo(0), roomIbo(0),
+			  orbVao(0), orbVbo(0), orbIbo(0), instanceVbo(0),
+			  particleVao(0), particleVbo(0),
+			  overlayVao(0), overlayVbo(0),
+			  fontTex(0),
+			  instanceCapacity(0),
+			  particleCapacity(0),
+			  roomCapacity(0)
+{
+	setColor(1, 1, 1, 1);
+}
+
+CoreRenderer::~CoreRenderer(void)
+{
+	GLuint buffers[] = { frameUbo, materialUbo, roomVbo, roomIbo, orbVbo, orbIbo, instanceVbo, particleVbo, overlayVbo };
+	GLuint arrays[] = { roomVao, orbVao, particleVao, overlayVao };
+	GLuint programs[] = { roomProgram, orbProgram, accumProgram, particleProgram, overlayProgram };
+
+	if(!deleteBuffers){
+		return;						//init() never got as far as the driver
+	}
+	for(int i = 0; i < 5; i++){
+		if(programs[i])
+			deleteProgram(programs[i]);
+	}
+	deleteBuffers(9, buffers);
+	deleteVertexArrays(4, arrays);
+	if(fontTex){
+		glDeleteTextures(1, &fontTex);
+	}
+}
+
+GLuint CoreRenderer::compile(const char* defines, const char* vertexSource, const char* fragmentSource)
+{
+	const char* sources[2][4] = {
+		{ shaderHeader, defines, vertexSource, "" },
+		{ shaderHeader, defines, shadeSource, fragmentSource } };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint program = createProgram();
+	GLint ok;
+	char log[1024];
+
+	for(int i = 0; i < 2; i++){
+		GLuint shader = createShader(types[i]);
+
+		shaderSource(shader, 4, sources[i], NULL);
+		compileShader(shader);
+		getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+		if(!ok){
+			getShaderInfoLog(shader, sizeof(log), NULL, log);
+			printf("core renderer: shader failed to compile\n%s\n", log);
+			deleteShader(shader);
+			deleteProgram(program);
+			return 0;
+		}
+		attachShader(program, shader);
+		deleteShader(shader);
+	}
+
+	linkProgram(program);
+	getProgramiv(program, GL_LINK_STATUS, &ok);
+	if(!ok){
+		getProgramInfoLog(program, sizeof(log), NULL, log);
+		printf("core renderer: shaders failed to link\n%s\n", log);
+		deleteProgram(program);
+		return 0;
+	}
+
+	//programs that don't use a block get no index for it
+	GLuint frame = getUniformBlockIndex(program, "Frame");
+	GLuint material = getUniformBlockIndex(program, "Materials");
+	if(frame != GL_INVALID_INDEX)
+		uniformBlockBinding(program, frame, FRAME_BINDING);
+	if(material != GL_INVALID_INDEX)
+		uniformBlockBinding(program, material, MATERIAL_BINDING);
+
+	return program;
+}
+
+//False if the context can't run it; the Renderer then stays fixed function
+bool CoreRenderer::init(void)
+{
+	if(!loadExtensions() || getGLVersion() < 33){
+		return false;
+	}
+
+	roomProgram = compile("", roomVertexSource, roomFragmentSource);
+	orbProgram = compile("", orbVertexSource, orbFragmentSource);
+	accumProgram = compile("#define ACCUMULATE\n", orbVertexSource, orbFragmentSource);
+	particleProgram = compile("", particleVertexSource, particleFragmentSource);
+	overlayProgram = compile("", overlayVertexSource, overlayFragmentSource);
+	if(!roomProgram || !orbProgram || !accumProgram || !particleProgram || !overlayProgram){
+		return false;
+	}
+
+	roomMaterialLoc = getUniformLocation(roomProgram, "material");
+	roomTintLoc = getUniformLocation(roomProgram, "tint");
+	roomOffsetLoc = getUniformLocation(roomProgram, "offset");
+	overlayMaskLoc = getUniformLocation(overlayProgram, "mask");
+
+	initBuffers();
+	initFont();
+
+	//enough for the HUD with the profiler up, so frames don't allocate
+	triangles.reserve(8192);
+	lines.reserve(256);
+	points.reserve(4096);
+
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glDepthFunc(GL_LEQUAL);
+	glClearColor(0,0,0,1);
+	glClearDepth(1);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	//falls back to unsorted blending if the driver can't do it
+	if(blended){
+		owner->transparency.init(w, h, true);
+	}
+	return true;
+}
+
+void CoreRenderer::initBuffers(void)
+{
+	MaterialBlock material[MATERIAL_COUNT];
+	GLfloat glAmbient[] = { 0.2, 0.2, 0.2, 1.0 };
+	GLfloat glDiffuse[] = { 0.8, 0.8, 0.8, 1.0 };
+	GLfloat glSpecular[] = { 0.0, 0.0, 0.0, 1.0 };
+
+	//GL's own default material stands in when materials are off
+	setMaterial(material[MAT_DEFAULT], glAmbient, glDiffuse, glSpecular, defEmission, 0);
+	setMaterial(material[MAT_BRICK], brickAmbient, brickDiffuse, brickSpecular, brickEmission, brickShininess);
+	setMaterial(material[MAT_SKY], brickAmbient, brickDiffuse, brickSpecular, skyEmission, brickShininess);
+	setMaterial(material[MAT_ORB + 0], ballAmbient, ballDiffuse, ballSpecular, defEmission, ballShininess);
+	setMaterial(material[MAT_ORB + 1], ballAmbient, ballDiffuse, ballSpecular, targetEmission, ballShininess);
+	setMaterial(material[MAT_ORB + 2], ballAmbient, ballDiffuse, ballSpecular, aimEmission, ballShininess);
+
+	genBuffers(1, &materialUbo);
+	bindBuffer(GL_UNIFORM_BUFFER, materialUbo);
+	bufferData(GL_UNIFORM_BUFFER, sizeof(material), material, GL_STATIC_DRAW);
+	genBuffers(1, &frameUbo);
+	bindBuffer(GL_UNIFORM_BUFFER, frameUbo);
+	bufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_DYNAMIC_DRAW);
+	bindBuffer(GL_UNIFORM_BUFFER, 0);
+	bindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, frameUbo);
+	bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, materialUbo);
+
+	//room: the Renderer's tiles, interleaved, uploaded each frame and
+	//drawn as triangles by an index buffer sized in drawRoom()
+	genVertexArrays(1, &roomVao);
+	bindVertexArray(roomVao);
+	genBuffers(1, &roomVbo);
+	bindBuffer(GL_ARRAY_BUFFER, roomVbo);
+	genBuffers(1, &roomIbo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, roomIbo);
+	enableVertexAttribArray(0);
+	vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
+	enableVertexAttribArray(1);
+	vertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+	enableVertexAttribArray(2);
+	vertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+
+	//orbs: the shared sphere plus one vec4 per orb, advanced per instance
+	genVertexArrays(1, &orbVao);
+	bindVertexArray(orbVao);
+	genBuffers(1, &orbVbo);
+	bindBuffer(GL_ARRAY_BUFFER, orbVbo);
+	bufferData(GL_ARRAY_BUFFER, (Renderer::ORB_STACKS+1) * (Renderer::ORB_SLICES+1) * 3 * sizeof(GLfloat),
+		owner->orbVertex, GL_STATIC_DRAW);
+	enableVertexAttribArray(0);
+	vertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	genBuffers(1, &orbIbo);
+	bindBuffer(GL_ELEMENT_ARRAY_BUFFER, orbIbo);
+	bufferData(GL_ELEMENT_ARRAY_BUFFER, owner->orbIndexCount * sizeof(GLuint), owner->orbIndex, GL_STATIC_DRAW);
+	genBuffers(1, &instanceVbo);
+	bindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	enableVertexAttribArray(3);
+	vertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	vertexAttribDivisor(3, 1);
+
+	//particles: the Renderer's list as it is, one point each
+	genVertexArrays(1, &particleVao);
+	bindVertexArray(particleVao);
+	genBuffers(1, &particleVbo);
+	bindBuffer(GL_ARRAY_BUFFER, particleVbo);
+	enableVertexAttribArray(0);
+	vertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	//HUD: refilled every frame
+	genVertexArrays(1, &overlayVao);
+	bindVertexArray(overlayVao);
+	genBuffers(1, &overlayVbo);
+	bindBuffer(GL_ARRAY_BUFFER, overlayVbo);
+	enableVertexAttribArray(0);
+	vertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)0);
+	enableVertexAttribArray(1);
+	vertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)(2 * sizeof(GLfloat)));
+	enableVertexAttribArray(2);
+	vertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayVertex), (void*)(4 * sizeof(GLfloat)));
+
+	bindVertexArray(0);
+	bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void CoreRenderer::initFont(void)
+{
+	vector<unsigned char> atlas(ATLAS_W * ATLAS_H, 0);
+
+	for(int c = 0; c <= SOLID_CELL; c++){
+		int x0 = (c % ATLAS_COLUMNS) * FONT_WIDTH;
+		int y0 = (c / ATLAS_COLUMNS) * FONT_HEIGHT;
+
+		for(int row = 0; row < FONT_HEIGHT; row++){
+			for(int col = 0; col < FONT_WIDTH; col++){
+				bool on = c == SOLID_CELL || (hudFont[c][row] >> (FONT_WIDTH - 1 - col)) & 1;
+				atlas[(y0 + row) * ATLAS_W + x0 + col] = on ? 255 : 0;
+			}
+		}
+	}
+
+	glGenTextures(1, &fontTex);
+	glBindTexture(GL_TEXTURE_2D, fontTex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_W, ATLAS_H, 0, GL_RED, GL_UNSIGNED_BYTE, &atlas[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+//Camera, projection and light for this frame, shared by every program
+void CoreRenderer::updateFrame(void)
+{
+	FrameBlock frame;
+	Mat4 projection = perspective(Renderer::FOV, (float)w / h, 0.1f, VIEW_DISTANCE);	//as the fixed function one
+
+	memset(&frame, 0, sizeof(frame));
+	memcpy(frame.projection, projection.m, sizeof(frame.projection));
+	memcpy(frame.view, owner->viewMatrix[owner->drawFront].m, sizeof(frame.view));
+	hudScaleX = frame.projection[0] / 2;
+	hudScaleY = frame.projection[5] / 2;
+
+	//the flashlight sits at the eye and points down the view
+	frame.lightPosition[3] = 1;
+	frame.spotDirection[2] = -1;
+	frame.spotDirection[3] = cos(Renderer::SPOT_ANGLE * rads);
+	memcpy(frame.lightAmbient, light1Ambient, sizeof(frame.lightAmbient));
+	memcpy(frame.lightDiffuse, light1Diffuse, sizeof(frame.lightDiffuse));
+	memcpy(frame.lightSpecular, light1Specular, sizeof(frame.lightSpecular));
+	memcpy(frame.attenuation, light1Attenuation, 3 * sizeof(GLfloat));
+	frame.attenuation[3] = light1Exponent;
+	memcpy(frame.globalAmbient, globalAmbient, sizeof(frame.globalAmbient));
+	frame.flags[0] = lighting;
+	frame.flags[1] = textured;
+	frame.flags[2] = materials;
+
+	bindBuffer(GL_UNIFORM_BUFFER, frameUbo);
+	bufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(frame), &frame);
+	bindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CoreRenderer::display(void)
+{
+	Transparency& transparency = owner->transparency;
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if(owner->splash){
+		drawSplash();
+		return;
+	}
+
+	owner->drawLock.lock();
+	updateFrame();
+	if(transparency.isReady()){
+		transparency.beginScene();
+	}
+	else {
+		glEnable(GL_DEPTH_TEST);
+	}
+
+	drawRoom();
+	drawParticles();
+
+	if(transparency.isReady()){
+		transparency.beginAccumulate();
+		drawOrbs(true);
+		TRACE_ZONE("resolve");
+		transparency.resolve();
+	}
+	else {
+		//unsorted, but at least tested against the room
+		glEnable(GL_BLEND);
+		glDepthMask(GL_FALSE);
+		drawOrbs(false);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+	owner->copyRadar();
+	owner->drawLock.unlock();
+
+	drawHUD();
+	if(owner->profiling && owner->profiler){
+		drawProfile();
+	}
+	drawOverlay();
+}
+
+void CoreRenderer::drawSplash(void)
+{
+	triangles.clear();
+	lines.clear();
+	points.clear();
+
+	setColor(1, 1, 1, 1);
+	addVertex(triangles, -1, 1, 0, 1);
+	addVertex(triangles, -1, -1, 0, 0);
+	addVertex(triangles, 1, -1, 1, 0);
+	addVertex(triangles, -1, 1, 0, 1);
+	addVertex(triangles, 1, -1, 1, 0);
+	addVertex(triangles, 1, 1, 1, 1);
+
+	owner->drawLock.lock();
+	updateFrame();
+	owner->drawLock.unlock();
+	for(unsigned int i = 0; i < triangles.size(); i++){
+		triangles[i].x *= hudScaleX;
+		triangles[i].y *= hudScaleY;
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	useProgram(overlayProgram);
+	uniform1i(overlayMaskLoc, 0);
+	glBindTexture(GL_TEXTURE_2D, owner->textureID[3]);
+	bindVertexArray(overlayVao);
+	bindBuffer(GL_ARRAY_BUFFER, overlayVbo);
+	bufferData(GL_ARRAY_BUFFER, triangles.size() * sizeof(OverlayVertex), &triangles[0], GL_STREAM_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, triangles.size());
+	bindVertexArray(0);
+	useProgram(0);
+	glEnable(GL_DEPTH_TEST);
+}
+
+void CoreRenderer::drawRoom(void)
+{
+	TRACE_ZONE("room");
+
+	//faces in the Renderer's order: back, front, bottom, top, left, right
+	GLfloat tints[6][4] = {
+		{ 1, 1, 0, 1 }, { 1, 0, 0, 1 }, { 1, .5, 0, 1 },
+		{ 0, 1, 0, 1 }, { 0, 0, 1, 1 }, { 1, 0, 1, 1 } };
+	int brick = materials ? MAT_BRICK : MAT_DEFAULT;
+	int sky = materials ? MAT_SKY : MAT_DEFAULT;
+	vector<GLfloat>& list = owner->roomList[owner->drawFront];
+	int* faces = owner->roomFaces[owner->drawFront];
+	int quads = faces[6];
+
+	if(quads == 0){
+		return;
+	}
+
+	useProgram(roomProgram);
+	bindVertexArray(roomVao);
+
+	//two triangles a quad; the indices only change when there are more
+	//tiles than ever before
+	if(quads > roomCapacity){
+		vector<GLuint> index;
+
+		roomCapacity = quads + quads / 2;
+		for(int q = 0; q < roomCapacity; q++){
+			GLuint quad[] = { 0, 1, 2, 0, 2, 3 };
+			for(int k = 0; k < 6; k++)
+				index.push_back(q*4 + quad[k]);
+		}
+		bufferData(GL_ELEMENT_ARRAY_BUFFER, index.size() * sizeof(GLuint), &index[0], GL_STATIC_DRAW);
+	}
+
+	//orphan last frame's tiles rather than wait for the GPU to finish with them
+	bindBuffer(GL_ARRAY_BUFFER, roomVbo);
+	bufferData(GL_ARRAY_BUFFER, roomCapacity * 32 * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+	bufferSubData(GL_ARRAY_BUFFER, 0, list.size() * sizeof(GLfloat), &list[0]);
+	bindBuffer(GL_ARRAY_BUFFER, 0);
+	uniform2f(roomOffsetLoc, 0, 0);
+
+	if(textured){
+		skyScroll += 0.0002;
+
+		//walls
+		glBindTexture(GL_TEXTURE_2D, owner->textureID[0]);
+		uniform1i(roomMaterialLoc, brick);
+		drawFaces(faces[0], faces[2]);
+		drawFaces(faces[4], faces[6]);
+
+		//sky scrolls; the grass keeps the sky's glow, as the fixed
+		//function path leaves it set
+		glBindTexture(GL_TEXTURE_2D, owner->textureID[1]);
+		uniform1i(roomMaterialLoc, sky);
+		uniform2f(roomOffsetLoc, skyScroll, 0);
+		drawFaces(faces[3], faces[4]);
+		uniform2f(roomOffsetLoc, 0, 0);
+		glBindTexture(GL_TEXTURE_2D, owner->textureID[2]);
+		drawFaces(faces[2], faces[3]);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	else {
+		uniform1i(roomMaterialLoc, brick);
+		for(int face = 0; face < 6; face++){
+			uniform4f(roomTintLoc, tints[face][0], tints[face][1], tints[face][2], tints[face][3]);
+			drawFaces(faces[face], faces[face + 1]);
+		}
+	}
+
+	bindVertexArray(0);
+	useProgram(0);
+}
+
+//Room tiles first .. last, with the room's buffers bound
+void CoreRenderer::drawFaces(int first, int last)
+{
+	if(last > first){
+		glDrawElements(GL_TRIANGLES, (last - first) * 6, GL_UNSIGNED_INT, (void*)(first * 6 * sizeof(GLuint)));
+	}
+}
+
+//Every visible orb in one draw, each instance a position and its mark
+void CoreRenderer::drawOrbs(bool accumulate)
+{
+	TRACE_ZONE("orbs");
+	vector<Point3D>& orbs = owner->drawList[owner->drawFront];
+	vector<char>& marks = owner->drawMark[owner->drawFront];
+	int count = orbs.size();
+
+	if(count == 0){
+		return;
+	}
+
+	//the draw list has room for every orb, so this never grows mid game
+	instances.reserve(orbs.capacity() * 4);
+	instances.resize(count * 4);
+	for(int i = 0; i < count; i++){
+		Vec4 instance = toVec4(orbs[i], marks[i]);
+		lanesStore(&instances[i*4], lanesOf(instance));
+	}
+
+	//orphan last frame's buffer rather than wait for the GPU to finish with it
+	bindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	if(count > instanceCapacity){
+		instanceCapacity = count + count / 2;
+	}
+	bufferData(GL_ARRAY_BUFFER, instanceCapacity * 4 * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+	bufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(GLfloat), &instances[0]);
+	bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	useProgram(accumulate ? accumProgram : orbProgram);
+	bindVertexArray(orbVao);
+	drawElementsInstanced(GL_TRIANGLES, owner->orbIndexCount, GL_UNSIGNED_INT, (void*)0, count);
+	bindVertexArray(0);
+	useProgram(0);
+}
+
+//Same look as Renderer::drawParticles(), faded by life left
+void CoreRenderer::drawParticles(void)
+{
+	TRACE_ZONE("particles");
+	vector<GLfloat>& list = owner->particleList[owner->drawFront];
+	int count = list.size() / 4;
+
+	if(count == 0){
+		return;
+	}
+
+	bindBuffer(GL_ARRAY_BUFFER, particleVbo);
+	if(count > particleCapacity){
+		particleCapacity = list.capacity() / 4;
+	}
+	bufferData(GL_ARRAY_BUFFER, particleCapacity * 4 * sizeof(GLfloat), NULL, GL_STREAM_DRAW);
+	bufferSubData(GL_ARRAY_BUFFER, 0, count * 4 * sizeof(GLfloat), &list[0]);
+	bindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDepthMask(GL_FALSE);
+	glPointSize(2);
+	useProgram(particleProgram);
+	bindVertexArray(particleVao);
+	glDrawArrays(GL_POINTS, 0, count);
+	bindVertexArray(0);
+	useProgram(0);
+	glPointSize(1);
+	glDepthMask(GL_TRUE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
+}
+
+void CoreRenderer::setColor(float r, float g, float b, float a)
+{
+	color[0] = r;
+	color[1] = g;
+	color[2] = b;
+	color[3] = a;
+}
+
+//Adds a vertex in clip space with the current colour
+void CoreRenderer::addVertex(vector<OverlayVertex>& list, float x, float y, float u, float v)
+{
+	OverlayVertex vertex = { x, y, u, v, color[0], color[1], color[2], color[3] };
+	list.push_back(vertex);
+}
+
+//HUD shapes use the atlas' solid cell so one program draws everything
+void CoreRenderer::addQuad(float x0, float y0, float x1, float y1)
+{
+	float u = ((SOLID_CELL % ATLAS_COLUMNS) * FONT_WIDTH + 0.5f) / ATLAS_W;
+	float v = ((SOLID_CELL / ATLAS_COLUMNS) * FONT_HEIGHT + 0.5f) / ATLAS_H;
+
+	x0 *= hudScaleX;	x1 *= hudScaleX;
+	y0 *= hudScaleY;	y1 *= hudScaleY;
+	addVertex(triangles, x0, y0, u, v);
+	addVertex(triangles, x1, y0, u, v);
+	addVertex(triangles, x1, y1, u, v);
+	addVertex(triangles, x0, y0, u, v);
+	addVertex(triangles, x1, y1, u, v);
+	addVertex(triangles, x0, y1, u, v);
+}
+
+void CoreRenderer::addLine(float x0, float y0, float x1, float y1)
+{
+	float u = ((SOLID_CELL % ATLAS_COLUMNS) * FONT_WIDTH + 0.5f) / ATLAS_W;
+	float v = ((SOLID_CELL / ATLAS_COLUMNS) * FONT_HEIGHT + 0.5f) / ATLAS_H;
+
+	addVertex(lines, x0 * hudScaleX, y0 * hudScaleY, u, v);
+	addVertex(lines, x1 * hudScaleX, y1 * hudScaleY, u, v);
+}
+
+void CoreRenderer::addPoint(float x, float y)
+{
+	float u = ((SOLID_CELL % ATLAS_COLUMNS) * FONT_WIDTH + 0.5f) / ATLAS_W;
+	float v = ((SOLID_CELL / ATLAS_COLUMNS) * FONT_HEIGHT + 0.5f) / ATLAS_H;
+
+	addVertex(points, x * hudScaleX, y * hudScaleY, u, v);
+}
+
+//Text starting at a HUD position, like glRasterPos and glutBitmapCharacter
+void CoreRenderer::addText(float x, float y, const char* str)
+{
+	//snap to whole pixels so the glyphs stay sharp
+	float px = floor((x * hudScaleX + 1) * w / 2 + 0.5f);
+	float py = floor((y * hudScaleY + 1) * h / 2 + 0.5f) - FONT_DESCENT;
+
+	if(!owner->text){
+		return;
+	}
+
+	for(; *str; str++, px += FONT_WIDTH){
+		int c = (unsigned char)*str - FONT_FIRST;
+		if(c <= 0 || c >= FONT_COUNT){
+			continue;						//spaces and anything unprintable
+		}
+
+		float u0 = (float)(c % ATLAS_COLUMNS) * FONT_WIDTH / ATLAS_W;
+		float u1 = u0 + (float)FONT_WIDTH / ATLAS_W;
+		float v0 = (float)(c / ATLAS_COLUMNS) * FONT_HEIGHT / ATLAS_H;		//top row
+		float v1 = v0 + (float)FONT_HEIGHT / ATLAS_H;
+		float x0 = px * 2 / w - 1, x1 = (px + FONT_WIDTH) * 2 / w - 1;
+		float y0 = py * 2 / h - 1, y1 = (py + FONT_HEIGHT) * 2 / h - 1;
+
+		addVertex(triangles, x0, y0, u0, v1);
+		addVertex(triangles, x1, y0, u1, v1);
+		addVertex(triangles, x1, y1, u1, v0);
+		addVertex(triangles, x0, y0, u0, v1);
+		addVertex(triangles, x1, y1, u1, v0);
+		addVertex(triangles, x0, y1, u0, v0);
+	}
+}
+
+//Same layout as Renderer::drawHUD()
+void CoreRenderer::drawHUD(void)
+{
+	TRACE_ZONE("hud");
+	HudText text;
+
+	formatHud(text, owner->orbsCaptured, owner->orbsReleased, owner->score, owner->getFPS());
+	triangles.clear();
+	lines.clear();
+	points.clear();
+
+	//black backgrounds
+	setColor(0,0,0,.7);
+	addQuad(-1.9, 1.185, -1.2, 1.47);
+	if(owner->paused){
+		addQuad(-.2, -.1, .2, .1);
+	}
+
+	//white text
+	setColor(1,1,1,1);
+
+	addText(-1.85, 1.4, text.captured);
+	addText(-1.85, 1.35, text.remaining);
+	addText(-1.85, 1.30, text.score);
+	addText(-1.85, 1.22, text.fps);
+
+	if(owner->paused){
+		addText(-.085, -.01, "PAUSED");
+	}
+
+	drawRadar();
+}
+
+//Same scope as Renderer::drawRadar()
+void CoreRenderer::drawRadar(void)
+{
+	char outputBuffer[30];
+	vector<GLfloat>& dots = owner->radarDots;
+	const float cx = 1.55, cy = 1.15, radius = .28;
+	const int SEGMENTS = 32;
+	float u = ((SOLID_CELL % ATLAS_COLUMNS) * FONT_WIDTH + 0.5f) / ATLAS_W;
+	float v = ((SOLID_CELL / ATLAS_COLUMNS) * FONT_HEIGHT + 0.5f) / ATLAS_H;
+
+	//black disc
+	setColor(0,0,.0,.7);
+	for(int i = 0; i < SEGMENTS; i++){
+		float a0 = i * 2 * 3.14159265f / SEGMENTS;
+		float a1 = (i + 1) * 2 * 3.14159265f / SEGMENTS;
+
+		addVertex(triangles, cx * hudScaleX, cy * hudScaleY, u, v);
+		addVertex(triangles, (cx + radius*cos(a0)) * hudScaleX, (cy + radius*sin(a0)) * hudScaleY, u, v);
+		addVertex(triangles, (cx + radius*cos(a1)) * hudScaleX, (cy + radius*sin(a1)) * hudScaleY, u, v);
+	}
+
+	//rim and crosshair
+	setColor(0,.5,1,.8);
+	for(int i = 0; i < SEGMENTS; i++){
+		float a0 = i * 2 * 3.14159265f / SEGMENTS;
+		float a1 = (i + 1) * 2 * 3.14159265f / SEGMENTS;
+		addLine(cx + radius*cos(a0), cy + radius*sin(a0), cx + radius*cos(a1), cy + radius*sin(a1));
+	}
+	addLine(cx - radius, cy, cx + radius, cy);
+	addLine(cx, cy - radius, cx, cy + radius);
+
+	//orbs in the beam
+	setColor(1,.5,0,1);
+	for(unsigned int i = 0; i + 1 < dots.size(); i += 2){
+		addPoint(cx + dots[i]*radius, cy + dots[i+1]*radius);
+	}
+
+	setColor(1,1,1,1);
+	sprintf(outputBuffer, "Targets: %i", (int)(dots.size() / 2));
+	addText(cx - radius, cy - radius - .07, outputBuffer);
+}
+
+//Same layout as Renderer::drawProfile()
+void CoreRenderer::drawProfile(void)
+{
+	TRACE_ZONE("profile");
+	char outputBuffer[64];
+	Profiler* profiler = owner->profiler;
+	int count = profiler->getCount();
+	float bottom = 1.13 - count*.05;
+
+	setColor(0,0,0,.7);
+	addQuad(-1.9, bottom, -1.0, 1.165);
+
+	setColor(1,1,1,1);
+	for(int i = 0; i < count; i++){
+		profiler->format(i, outputBuffer, sizeof(outputBuffer));
+		addText(-1.85, 1.12 - i*.05, outputBuffer);
+	}
+}
+
+//Sends the whole HUD in one upload and three draws
+void CoreRenderer::drawOverlay(void)
+{
+	TRACE_ZONE("overlay");
+	int triCount = triangles.size(), lineCount = lines.size(), pointCount = points.size();
+	int total = triCount + lineCount + pointCount;
+
+	if(total == 0){
+		return;
+	}
+
+	bindVertexArray(overlayVao);
+	bindBuffer(GL_ARRAY_BUFFER, overlayVbo);
+	bufferData(GL_ARRAY_BUFFER, total * sizeof(OverlayVertex), NULL, GL_STREAM_DRAW);
+	if(triCount)
+		bufferSubData(GL_ARRAY_BUFFER, 0, triCount * sizeof(OverlayVertex), &triangles[0]);
+	if(lineCount)
+		bufferSubData(GL_ARRAY_BUFFER, triCount * sizeof(OverlayVertex), lineCount * sizeof(OverlayVertex), &lines[0]);
+	if(pointCount)
+		bufferSubData(GL_ARRAY_BUFFER, (triCount + lineCount) * sizeof(OverlayVertex),
+			pointCount * sizeof(OverlayVertex), &points[0]);
+
+	glEnable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	useProgram(overlayProgram);
+	uniform1i(overlayMaskLoc, 1);
+	glBindTexture(GL_TEXTURE_2D, fontTex);
+
+	glDrawArrays(GL_TRIANGLES, 0, triCount);
+	glDrawArrays(GL_LINES, triCount, lineCount);
+	glPointSize(2);
+	glDrawArrays(GL_POINTS, triCount + lineCount, pointCount);
+	glPointSize(1);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	useProgram(0);
+	bindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+}
@@ -0,0 +1,92 @@
+/*
+ *	CoreRenderer.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef CORERENDERER_H_
+#define CORERENDERER_H_
+#include <vector>
+#include "GLExtensions.h"
+using namespace std;
+
+class Renderer;
+
+//Draws the Renderer's frames through an OpenGL 3.3 core profile: shaders
+//light every pixel with the flashlight, materials sit in a uniform
+//buffer, orbs go out as one instanced draw and the HUD is batched into
+//a few vertex buffers. All scene and HUD state still lives in Renderer,
+//which hands display() over to this when the core backend is chosen.
+class CoreRenderer
+{
+public:
+			CoreRenderer(Renderer* owner);
+			~CoreRenderer(void);
+	bool	init(void);
+	void	display(void);
+
+private:
+	struct OverlayVertex
+	{
+		GLfloat x, y;
+		GLfloat u, v;
+		GLfloat r, g, b, a;
+	};
+
+	GLuint	compile(const char* defines, const char* vertexSource, const char* fragmentSource);
+	void	initBuffers(void);
+	void	initFont(void);
+	void	updateFrame(void);
+	void	drawSplash(void);
+	void	drawRoom(void);
+	void	drawFaces(int first, int last);
+	void	drawOrbs(bool accumulate);
+	void	drawParticles(void);
+	void	drawHUD(void);
+	void	drawRadar(void);
+	void	drawProfile(void);
+	void	drawOverlay(void);
+
+	//HUD drawing, in the fixed function HUD's coordinates (z = -2)
+	void	setColor(float r, float g, float b, float a);
+	void	addQuad(float x0, float y0, float x1, float y1);
+	void	addLine(float x0, float y0, float x1, float y1);
+	void	addPoint(float x, float y);
+	void	addText(float x, float y, const char* str);
+	void	addVertex(vector<OverlayVertex>& list, float x, float y, float u, float v);
+
+	Renderer* owner;
+	int		w, h;
+	float	hudScaleX, hudScaleY;		//HUD units to clip space
+	float	skyScroll;
+	GLfloat	color[4];
+
+	GLuint	roomProgram;
+	GLuint	orbProgram;					//plain alpha blending
+	GLuint	accumProgram;				//weighted blended transparency
+	GLuint	particleProgram;
+	GLuint	overlayProgram;
+	GLuint	frameUbo;
+	GLuint	materialUbo;
+	GLuint	roomVao, roomVbo, roomIbo;
+	GLuint	orbVao, orbVbo, orbIbo, instanceVbo;
+	GLuint	particleVao, particleVbo;
+	GLuint	overlayVao, overlayVbo;
+	GLuint	fontTex;
+	int		instanceCapacity;
+	int		particleCapacity;
+	int		roomCapacity;				//quads the room's buffers hold
+
+	GLint	roomMaterialLoc, roomTintLoc, roomOffsetLoc;
+	GLint	overlayMaskLoc;
+
+	vector<GLfloat> instances;
+	vector<OverlayVertex> triangles;
+	vector<OverlayVertex> lines;
+	vector<OverlayVertex> points;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ *	FlatArray.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef FLATARRAY_H_
+#define FLATARRAY_H_
+#include <string.h>
+#include <new>
+
+//Growable array of plain data. It can also be pointed at memory it doesn't
+//own, such as a mapped file; the first change that needs more room than
+//that moves it onto the heap. Memory comes from operator new, not
+//malloc, so its growth shows up in AllocStats.
+template<class T>
+class FlatArray
+{
+public:
+	FlatArray(void) : items(NULL), count(0), capacity(0), owned(true) {}
+	~FlatArray(void) { release(); }
+
+	int		size(void) const			{ return count; }
+	int		getCapacity(void) const		{ return capacity; }
+	bool	empty(void) const			{ return count == 0; }
+	T*		data(void)					{ return items; }
+	T&		operator[](int i)			{ return items[i]; }
+	const T&	operator[](int i) const	{ return items[i]; }
+	T&		back(void)					{ return items[count - 1]; }
+	bool	isOwned(void) const			{ return owned; }
+
+	void push_back(const T& v)
+	{
+		if(count == capacity){
+			reserve(count + 1);
+		}
+		items[count++] = v;
+	}
+
+	void pop_back(void)
+	{
+		count--;
+	}
+
+	void resize(int n)
+	{
+		reserve(n);
+		count = n;
+	}
+
+	void assign(int n, const T& v)
+	{
+		resize(n);
+		for(int i = 0; i < n; i++){
+			items[i] = v;
+		}
+	}
+
+	//borrowed memory is let go of rather than emptied, its owner may
+	//unmap it at any point afterwards
+	void clear(void)
+	{
+		if(!owned){
+			release();
+		}
+		count = 0;
+	}
+
+	void reserve(int n)
+	{
+		T* p;
+
+		if(n <= capacity){
+			return;
+		}
+		if(n < capacity * 2)
+			n = capacity * 2;
+		if(n < 16)
+			n = 16;
+
+		p = (T*)::operator new(n * sizeof(T));
+		if(count > 0){
+			memcpy(p, items, count * sizeof(T));
+		}
+		release();
+		items = p;
+		capacity = n;
+	}
+
+	//empty, and its memory given back
+	void discard(void)
+	{
+		release();
+		count = 0;
+	}
+
+	//use n items at data in place, without copying
+	void borrow(T* data, int n)
+	{
+		release();
+		items = data;
+		count = capacity = n;
+		owned = false;
+	}
+
+private:
+	FlatArray(const FlatArray&);
+	FlatArray& operator=(const FlatArray&);
+
+	void release(void)
+	{
+		if(owned){
+			::operator delete(items);
+		}
+		items = NULL;
+		capacity = 0;
+		owned = true;
+	}
+
+	T* items;
+	int count;
+	int capacity;
+	bool owned;
+};
+
+#endif
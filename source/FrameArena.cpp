@@ -0,0 +1,102 @@
+/*
+ *	FrameArena.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Per frame scratch memory. The tick and the renderer used to keep
+	their scratch in member vectors sized to the busiest frame so far;
+	the arena does the same for anything that only needs to last until
+	the frame is done, without each user keeping its own high water mark.
+	Its own memory comes from operator new so AllocStats sees it grow.
+ */
+
+#include <new>
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t bytes)
+			: block(NULL),
+			  capacity(bytes),
+			  used(0),
+			  peak(0),
+			  spills(0)
+{
+	spillLock.clear();
+	block = (char*)::operator new(capacity);
+	spilled.reserve(16);
+}
+
+FrameArena::~FrameArena(void)
+{
+	reset();
+	::operator delete(block);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align)
+{
+	//round every request up so the next one starts aligned, then claim
+	//the range with one add; alignment above 16 pays for its own padding
+	size_t size = (bytes + align - 1 + 15) & ~(size_t)15;
+	size_t start = used.fetch_add(size, memory_order_relaxed);
+	size_t offset = (start + align - 1) & ~(align - 1);
+	void* p;
+
+	if(start + size <= capacity){
+		return block + offset;
+	}
+
+	//out of room: fall back to the heap for the rest of the frame
+	p = ::operator new(bytes);
+	while(spillLock.test_and_set(memory_order_acquire));
+	spilled.push_back(p);
+	spills++;
+	spillLock.clear(memory_order_release);
+
+	return p;
+}
+
+//Only call between frames, with nothing still using the memory
+void FrameArena::reset(void)
+{
+	size_t last = used.load(memory_order_relaxed);
+
+	if(last > peak){
+		peak = last;
+	}
+	for(unsigned int i = 0; i < spilled.size(); i++){
+		::operator delete(spilled[i]);
+	}
+	spilled.clear();
+
+	//grow to fit the frame that overflowed, with room to spare
+	if(peak > capacity){
+		capacity = peak + peak / 2;
+		::operator delete(block);
+		block = (char*)::operator new(capacity);
+	}
+	used.store(0, memory_order_relaxed);
+}
+
+size_t FrameArena::getUsed(void)
+{
+	size_t n = used.load(memory_order_relaxed);
+
+	return n < capacity ? n : capacity;
+}
+
+size_t FrameArena::getPeak(void)
+{
+	return peak;
+}
+
+size_t FrameArena::getCapacity(void)
+{
+	return capacity;
+}
+
+int FrameArena::getSpills(void)
+{
+	return spills;
+}
@@ -0,0 +1,54 @@
+/*
+ *	FrameArena.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef FRAMEARENA_H_
+#define FRAMEARENA_H_
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+using namespace std;
+
+//Bump allocator for scratch memory that lives for one frame or tick.
+//Allocating is one atomic add, so passes running in parallel can share
+//it, and nothing is freed individually: reset() at the start of the next
+//frame takes everything back at once. A frame that runs out spills onto
+//the heap and the arena grows to fit it at the next reset, so once the
+//game has seen its busiest frame it stops touching the heap altogether.
+class FrameArena
+{
+public:
+			FrameArena(size_t bytes = 1 << 20);
+			~FrameArena(void);
+	void*	allocate(size_t bytes, size_t align = 16);
+	void	reset(void);
+	size_t	getUsed(void);
+	size_t	getPeak(void);
+	size_t	getCapacity(void);
+	int		getSpills(void);
+
+	//n uninitialised Ts, good until the next reset
+	template<class T>
+	T*		alloc(size_t n)		{ return (T*)allocate(n * sizeof(T), alignof(T)); }
+
+private:
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	char*	block;
+	size_t	capacity;
+	atomic<size_t> used;			//may run past capacity, see allocate()
+	size_t	peak;
+	int		spills;					//overflow allocations since construction
+
+	//frames that overflowed keep their extra memory here until reset
+	atomic_flag spillLock;
+	vector<void*> spilled;
+};
+
+#endif
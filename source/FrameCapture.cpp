@@ -0,0 +1,451 @@
+/*
+ *	FrameCapture.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Frame readback and recording. A glReadPixels() into client memory
+	waits for the GPU to finish the frame; into a pixel buffer object it
+	only queues a copy, and mapping that buffer RING - 1 frames later
+	finds the copy done. The render thread's share is then one memcpy()
+	per frame into a spare buffer. The worker does the rest: flipping
+	GL's bottom up rows, dropping alpha, converting and writing the file.
+	Without pixel buffer objects (GL before 2.1) the readback is made
+	straight into the spare buffer, which stalls like it always did but
+	still leaves the encoding to the worker.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+#include "Timer.h"
+#include "Trace.h"
+
+FrameCapture::FrameCapture(int width, int height)
+			: w(width),
+			  h(height),
+			  ready(false),
+			  usePbo(false),
+			  inFlight(0),
+			  frame(0),
+			  grabTime(0),
+			  wantRecording(false),
+			  recording(false),
+			  wantFormat(CAPTURE_Y4M),
+			  wantFps(60),
+			  jobHead(0),
+			  jobCount(0),
+			  encoding(false),
+			  running(false),
+			  format(CAPTURE_Y4M),
+			  stream(NULL),
+			  streamFrames(0),
+			  captured(0),
+			  dropped(0)
+{
+	memset(slots, 0, sizeof(slots));
+	memset(bufferBusy, 0, sizeof(bufferBusy));
+	prefix[0] = 0;
+}
+
+FrameCapture::~FrameCapture(void)
+{
+	if(running){
+		lock.lock();
+		running = false;
+		lock.unlock();
+		wake.notify_all();
+		worker.join();
+	}
+	closeRecording();
+
+	if(ready && usePbo){
+		for(int i = 0; i < RING; i++)
+			deleteBuffers(1, &slots[i].pbo);
+	}
+}
+
+//Starts a recording with the next frame; ignored while one is running
+void FrameCapture::record(const char* inPrefix, CaptureFormat inFormat, int inFps)
+{
+	lock_guard<mutex> guard(lock);
+
+	if(!wantRecording){
+		wantRecording = true;
+		wantPrefix = inPrefix;
+		wantFormat = inFormat;
+		wantFps = inFps > 0 ? inFps : 60;
+	}
+}
+
+void FrameCapture::stop(void)
+{
+	lock_guard<mutex> guard(lock);
+
+	wantRecording = false;
+}
+
+void FrameCapture::snapshot(const char* fileName)
+{
+	lock_guard<mutex> guard(lock);
+
+	wantShot = fileName;
+}
+
+bool FrameCapture::isRecording(void)
+{
+	lock_guard<mutex> guard(lock);
+
+	return wantRecording;
+}
+
+//True once a stopped recording is closed and nothing is left to write,
+//false if that takes longer than ms
+bool FrameCapture::waitIdle(int ms)
+{
+	unique_lock<mutex> guard(lock);
+
+	return wake.wait_for(guard, chrono::milliseconds(ms), [&](){
+		return !wantRecording && !recording && jobCount == 0 && !encoding;
+	});
+}
+
+void FrameCapture::grab(void)
+{
+	step(true);
+}
+
+//Reads back everything in flight now, without waiting for later
+//frames, and waits for the worker to write it out
+void FrameCapture::flush(void)
+{
+	step(false);
+	while(inFlight > 0){
+		for(long long f = frame - RING; f < frame; f++){
+			if(f >= 0 && slots[f % RING].pending && slots[f % RING].frame == f)
+				retire(slots[f % RING]);
+		}
+	}
+
+	unique_lock<mutex> guard(lock);
+	wake.wait(guard, [&](){ return jobCount == 0 && !encoding; });
+}
+
+void FrameCapture::init(void)
+{
+	size_t size = (size_t)w * h * 4;
+
+	//the table of entry points may not have been loaded by anyone else,
+	//and only the buffer ones matter here
+	loadExtensions();
+	usePbo = genBuffers && bindBuffer && bufferData && mapBuffer && unmapBuffer &&
+		getGLVersion() >= 21;
+	if(usePbo){
+		for(int i = 0; i < RING; i++){
+			genBuffers(1, &slots[i].pbo);
+			bindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+			bufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		}
+		bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	for(int i = 0; i < BUFFERS; i++)
+		buffers[i].resize(size);
+	rgb.resize((size_t)w * h * 3);
+	yuv.resize(getY4MFrameSize(w, h));
+
+	running = true;
+	worker = thread(&FrameCapture::run, this);
+	ready = true;
+}
+
+//Picks up requests, retires readbacks old enough to be finished and,
+//if readFrame and anything wants it, starts reading back this frame
+void FrameCapture::step(bool readFrame)
+{
+	long long start = nowNanos();
+	bool startRecording, stopRecording, shot;
+	char shotName[256];
+	Job job;
+
+	lock.lock();
+	startRecording = wantRecording && !recording;
+	stopRecording = !wantRecording && recording;
+	shot = readFrame && !wantShot.empty();
+	if(startRecording){
+		snprintf(job.name, sizeof(job.name), "%s", wantPrefix.c_str());
+		job.format = wantFormat;
+		job.fps = wantFps;
+	}
+	if(shot){
+		snprintf(shotName, sizeof(shotName), "%s", wantShot.c_str());
+		wantShot.clear();
+	}
+	lock.unlock();
+
+	//nothing asked for and nothing in flight, which is nearly always
+	if(!startRecording && !stopRecording && !shot && !recording && inFlight == 0){
+		frame++;
+		grabTime = 0;
+		return;
+	}
+
+	TRACE_ZONE("capture");
+	if(!ready){
+		init();
+	}
+
+	//oldest first, so frames reach the worker in order
+	for(long long f = frame - RING; f < frame; f++){
+		if(f < 0)
+			continue;
+		Slot& slot = slots[f % RING];
+		if(slot.pending && slot.frame == f && (stopRecording || frame - f >= RING - 1))
+			retire(slot);
+	}
+
+	if(stopRecording){
+		job.kind = JOB_END;
+		queue(job);
+		lock.lock();
+		recording = false;
+		lock.unlock();
+		wake.notify_all();
+	}
+	if(startRecording){
+		job.kind = JOB_START;
+		queue(job);
+		lock.lock();
+		recording = true;
+		lock.unlock();
+	}
+
+	if(readFrame && (recording || shot)){
+		Slot& slot = slots[frame % RING];
+
+		slot.record = recording;
+		slot.shot = shot;
+		if(shot){
+			memcpy(slot.name, shotName, sizeof(slot.name));
+		}
+		slot.frame = frame;
+		slot.issued = nowNanos();
+		if(usePbo){
+			bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+			glReadPixels(0, 0, w, h, GL_BGRA, GL_UNSIGNED_BYTE, (void*)0);
+			bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot.pending = true;
+			inFlight++;
+		}
+		else {
+			slot.pending = true;
+			inFlight++;
+			retire(slot);
+		}
+	}
+
+	frame++;
+	grabTime = (nowNanos() - start) / 1000000.0;
+}
+
+//Copies a finished readback into a spare buffer for the worker, or
+//drops the frame if there is none
+void FrameCapture::retire(Slot& slot)
+{
+	int buffer = takeBuffer();
+	Job job;
+
+	slot.pending = false;
+	inFlight--;
+
+	if(buffer < 0){
+		dropped++;
+		return;
+	}
+
+	if(usePbo){
+		bindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		void* pixels = mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if(pixels){
+			memcpy(&buffers[buffer][0], pixels, buffers[buffer].size());
+		}
+		unmapBuffer(GL_PIXEL_PACK_BUFFER);
+		bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if(!pixels){
+			lock.lock();
+			bufferBusy[buffer] = false;
+			lock.unlock();
+			dropped++;
+			return;
+		}
+	}
+	else {
+		glReadPixels(0, 0, w, h, GL_BGRA, GL_UNSIGNED_BYTE, &buffers[buffer][0]);
+	}
+
+	job.kind = JOB_FRAME;
+	job.buffer = buffer;
+	job.record = slot.record;
+	job.shot = slot.shot;
+	job.issued = slot.issued;
+	memcpy(job.name, slot.name, sizeof(job.name));
+	queue(job);
+}
+
+int FrameCapture::takeBuffer(void)
+{
+	lock_guard<mutex> guard(lock);
+
+	for(int i = 0; i < BUFFERS; i++){
+		if(!bufferBusy[i]){
+			bufferBusy[i] = true;
+			return i;
+		}
+	}
+	return -1;
+}
+
+//Frames are bounded by the buffers, so only a burst of starts and stops
+//could fill the queue; then this waits for the worker
+void FrameCapture::queue(const Job& job)
+{
+	unique_lock<mutex> guard(lock);
+
+	wake.wait(guard, [&](){ return jobCount < QUEUE; });
+	jobs[(jobHead + jobCount) % QUEUE] = job;
+	jobCount++;
+	guard.unlock();
+	wake.notify_all();
+}
+
+void FrameCapture::run(void)
+{
+	unique_lock<mutex> guard(lock);
+
+	traceThreadName("capture");
+	while(true){
+		wake.wait(guard, [&](){ return jobCount > 0 || !running; });
+		if(jobCount == 0){
+			break;
+		}
+
+		Job job = jobs[jobHead];
+		jobHead = (jobHead + 1) % QUEUE;
+		jobCount--;
+		encoding = true;
+		guard.unlock();
+
+		encode(job);
+
+		guard.lock();
+		if(job.kind == JOB_FRAME){
+			bufferBusy[job.buffer] = false;
+		}
+		encoding = false;
+		wake.notify_all();
+	}
+}
+
+void FrameCapture::encode(const Job& job)
+{
+	TRACE_ZONE("encode");
+	char name[300];
+
+	if(job.kind == JOB_START){
+		closeRecording();
+		snprintf(prefix, sizeof(prefix), "%s", job.name);
+		format = job.format;
+		streamFrames = 0;
+		if(format == CAPTURE_RAW){
+			snprintf(name, sizeof(name), "%s.rgb", prefix);
+			stream = fopen(name, "wb");
+		}
+		else if(format == CAPTURE_Y4M){
+			snprintf(name, sizeof(name), "%s.y4m", prefix);
+			stream = fopen(name, "wb");
+			if(stream && !writeY4MHeader(stream, w, h, job.fps)){
+				closeRecording();
+			}
+		}
+		if(format != CAPTURE_PNG && !stream){
+			printf("unable to write %s\n", name);
+		}
+		return;
+	}
+	if(job.kind == JOB_END){
+		closeRecording();
+		return;
+	}
+
+	//BGRA bottom up to RGB top down
+	const unsigned char* src = &buffers[job.buffer][0];
+	for(int y = 0; y < h; y++){
+		const unsigned char* in = src + (size_t)(h - 1 - y) * w * 4;
+		unsigned char* out = &rgb[(size_t)y * w * 3];
+
+		for(int x = 0; x < w; x++, in += 4, out += 3){
+			out[0] = in[2];
+			out[1] = in[1];
+			out[2] = in[0];
+		}
+	}
+
+	if(job.shot && !writePNG(job.name, &rgb[0], w, h, png)){
+		printf("unable to write %s\n", job.name);
+	}
+
+	if(job.record){
+		bool ok = false;
+
+		if(format == CAPTURE_PNG){
+			snprintf(name, sizeof(name), "%s%05d.png", prefix, streamFrames);
+			ok = writePNG(name, &rgb[0], w, h, png);
+		}
+		else if(format == CAPTURE_RAW && stream){
+			ok = fwrite(&rgb[0], 1, rgb.size(), stream) == rgb.size();
+		}
+		else if(format == CAPTURE_Y4M && stream){
+			ok = writeY4MFrame(stream, &rgb[0], w, h, &yuv[0]);
+		}
+		streamFrames++;
+		if(ok)
+			captured++;
+		else
+			dropped++;
+	}
+
+	latency.record(nowNanos() - job.issued);
+}
+
+void FrameCapture::closeRecording(void)
+{
+	if(stream){
+		fclose(stream);
+		stream = NULL;
+	}
+}
+
+int		FrameCapture::getCaptured(void)		{ return captured; }
+int		FrameCapture::getDropped(void)		{ return dropped; }
+double	FrameCapture::getGrabTime(void)		{ return grabTime; }
+
+double FrameCapture::getLatency(double percentile)
+{
+	return latency.getPercentile(percentile);
+}
+
+bool FrameCapture::parseFormat(const char* name, CaptureFormat& out)
+{
+	if(!strcmp(name, "raw"))
+		out = CAPTURE_RAW;
+	else if(!strcmp(name, "png"))
+		out = CAPTURE_PNG;
+	else if(!strcmp(name, "y4m"))
+		out = CAPTURE_Y4M;
+	else
+		return false;
+	return true;
+}
@@ -0,0 +1,140 @@
+/*
+ *	FrameCapture.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef FRAMECAPTURE_H_
+#define FRAMECAPTURE_H_
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GLExtensions.h"
+#include "LatencyStats.h"
+using namespace std;
+
+//What a recording is written as:
+//	raw		<prefix>.rgb, frames of packed RGB back to back (ffmpeg -f
+//			rawvideo -pixel_format rgb24 -video_size WxH)
+//	png		<prefix>00000.png, <prefix>00001.png, ...
+//	y4m		<prefix>.y4m, 4:2:0 video
+enum CaptureFormat { CAPTURE_RAW, CAPTURE_PNG, CAPTURE_Y4M };
+
+//Records frames, or grabs a single one, without stalling the renderer.
+//grab() starts each frame's readback into the next of a ring of pixel
+//buffer objects and maps the one from two frames back, which the GPU
+//has long since filled. That frame is copied into one of a few spare
+//buffers and handed to a worker thread, which flips, converts and
+//writes it. If the worker has fallen behind and no buffer is free, the
+//frame is dropped rather than waited for. record(), stop() and
+//snapshot() may be called from any thread and take effect at the next
+//grab(); grab() and flush() need the GL context.
+class FrameCapture
+{
+public:
+			FrameCapture(int width, int height);
+			~FrameCapture(void);
+	void	record(const char* prefix, CaptureFormat format, int fps);
+	void	stop(void);
+	void	snapshot(const char* fileName);		//next frame, as PNG
+	bool	isRecording(void);
+	bool	waitIdle(int ms);					//everything asked for is written
+
+	void	grab(void);							//after the frame is drawn
+	void	flush(void);						//writes out frames still in flight
+
+	int		getCaptured(void);					//frames written
+	int		getDropped(void);					//frames the worker had no room for
+	double	getLatency(double percentile);		//ms from readback to written
+	double	getGrabTime(void);					//ms the last grab() took
+
+	static bool	parseFormat(const char* name, CaptureFormat& format);
+
+private:
+	//one readback in flight
+	struct Slot
+	{
+		GLuint	pbo;
+		bool	pending;
+		bool	record;						//part of the recording
+		bool	shot;						//the frame snapshot() asked for
+		long long frame;
+		long long issued;
+		char	name[256];					//snapshot file
+	};
+
+	//one frame handed to the worker; a START opens the recording's
+	//files, an END closes them
+	enum JobKind { JOB_FRAME, JOB_START, JOB_END };
+	struct Job
+	{
+		JobKind	kind;
+		int		buffer;
+		bool	record;
+		bool	shot;
+		long long issued;
+		CaptureFormat format;				//of a START
+		int		fps;
+		char	name[256];					//recording prefix or snapshot file
+	};
+
+	void	init(void);
+	void	step(bool readFrame);
+	void	retire(Slot& slot);
+	void	queue(const Job& job);
+	int		takeBuffer(void);
+	void	run(void);
+	void	encode(const Job& job);
+	void	closeRecording(void);
+
+	static const int RING = 3;				//readbacks in flight
+	static const int BUFFERS = 4;			//frames waiting for the worker
+	static const int QUEUE = 16;
+
+	int		w, h;
+	bool	ready;						//set up when first asked for anything
+	bool	usePbo;						//else glReadPixels() straight into a buffer
+	Slot	slots[RING];
+	int		inFlight;					//slots pending
+	long long frame;
+	double	grabTime;
+
+	//requests from other threads, under lock
+	mutex	lock;
+	condition_variable wake;			//the worker has a job, or is done with one
+	bool	wantRecording;
+	bool	recording;					//as the render thread last saw it
+	string	wantPrefix;
+	CaptureFormat wantFormat;
+	int		wantFps;
+	string	wantShot;
+
+	//render thread -> worker
+	vector<unsigned char> buffers[BUFFERS];	//BGRA, bottom row first
+	bool	bufferBusy[BUFFERS];
+	Job		jobs[QUEUE];
+	int		jobHead, jobCount;
+	bool	encoding;					//the worker is inside encode()
+	bool	running;
+	thread	worker;
+
+	//the worker's own
+	char	prefix[256];
+	CaptureFormat format;
+	FILE*	stream;						//raw and y4m recordings
+	int		streamFrames;
+	vector<unsigned char> rgb;			//the frame being written, top row first
+	vector<unsigned char> yuv;
+	vector<unsigned char> png;
+
+	atomic<int> captured, dropped;
+	LatencyStats latency;
+};
+
+#endif
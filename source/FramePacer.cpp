@@ -0,0 +1,240 @@
+/*
+ *	FramePacer.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Paces frames to the display's refresh interval. The bulk of the wait is
+	an absolute sleep on the monotonic clock; the last stretch, sized from
+	how late recent sleeps have woken up, is spent spinning so frames go out
+	on time regardless of the OS timer granularity. On Windows the system
+	timer runs at 1 ms while a pacer exists; at its default 15.6 ms tick
+	Sleep() wakes later than the spin margin can make up. When a swap
+	interval can be set the buffer swap itself waits for the display, so
+	the pacer only keeps the next frame ready in time.
+ */
+
+#include <math.h>
+#include "FramePacer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#include <gl/gl.h>
+#include "Timer.h"
+#else
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <GL/glx.h>
+#endif
+
+//bounds for the calibrated spin margin, in nanoseconds
+static const long long MIN_SPIN = 50000;
+static const long long MAX_SPIN = 4000000;
+
+//frames to measure before deciding whether vsync really works
+static const int VSYNC_CHECK_FRAMES = 120;
+
+FramePacer::FramePacer(int refreshRate)
+			: spinMargin(1000000),
+			  vsync(false),
+			  vsyncWorking(false),
+			  lastPresent(0),
+			  frames(0),
+			  mean(0),
+			  m2(0),
+			  worst(0),
+			  checkFrames(0),
+			  checkTotal(0)
+{
+	if(refreshRate <= 0){
+		refreshRate = 60;
+	}
+	interval = 1000000000LL / refreshRate;
+	deadline = now();
+#ifdef _WIN32
+	timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer(void)
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+long long FramePacer::now(void)
+{
+#ifdef _WIN32
+	return nowNanos();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+void FramePacer::sleepUntil(long long time)
+{
+#ifdef _WIN32
+	long long ms = (time - now()) / 1000000;
+	if(ms > 0){
+		Sleep((DWORD)ms);
+	}
+#else
+	struct timespec ts;
+	ts.tv_sec = time / 1000000000LL;
+	ts.tv_nsec = time % 1000000000LL;
+	//woken by a signal: sleep the rest; any other error leaves it to the spin
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#endif
+}
+
+//Asks the driver to sync buffer swaps to the display. Must be called from
+//the thread that owns the GL context.
+bool FramePacer::enableVsync(void)
+{
+#ifdef _WIN32
+	typedef BOOL (WINAPI *SwapIntervalFunc)(int);
+	SwapIntervalFunc swapInterval = (SwapIntervalFunc)wglGetProcAddress("wglSwapIntervalEXT");
+
+	vsync = swapInterval && swapInterval(1);
+#else
+	typedef int (*SwapIntervalFunc)(unsigned int);
+	SwapIntervalFunc swapInterval;
+
+	swapInterval = (SwapIntervalFunc)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+	if(!swapInterval){
+		swapInterval = (SwapIntervalFunc)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+	}
+
+	vsync = swapInterval && swapInterval(1) == 0;
+#endif
+
+	//trust it until the measured intervals say otherwise
+	vsyncWorking = vsync;
+	return vsync;
+}
+
+bool FramePacer::getVsync(void)
+{
+	return vsyncWorking;
+}
+
+void FramePacer::wait(void)
+{
+	long long t = now();
+	long long margin = spinMargin;
+	long long woke, late;
+
+	if(vsyncWorking){
+		//the swap blocks until the display is ready, so just have the
+		//frame posted half way through the interval to stay in phase,
+		//and at most once per interval while a swap is still pending
+		long long next = lastPresent + interval / 2;
+		if(next <= deadline){
+			next = deadline + interval;
+		}
+		deadline = next;
+		if(deadline > t){
+			sleepUntil(deadline);
+		}
+		return;
+	}
+
+	deadline += interval;
+
+	//more than a frame behind, start over rather than rush to catch up
+	if(deadline < t - interval){
+		deadline = t;
+		return;
+	}
+
+	if(deadline - margin > t){
+		sleepUntil(deadline - margin);
+		woke = now();
+
+		//calibrate the margin from how late the sleep woke up, growing
+		//straight away and shrinking back slowly
+		late = (woke - (deadline - margin)) * 5 / 4;
+		if(late > margin)
+			margin = late;
+		else
+			margin -= (margin - late) / 64;
+
+		if(margin < MIN_SPIN)
+			margin = MIN_SPIN;
+		else if(margin > MAX_SPIN)
+			margin = MAX_SPIN;
+		spinMargin = margin;
+	}
+
+	//spin out the rest
+	while(now() < deadline){
+#ifdef _WIN32
+		YieldProcessor();
+#else
+		sched_yield();
+#endif
+	}
+}
+
+//Called right after the buffers are swapped
+void FramePacer::framePresented(void)
+{
+	long long t = now();
+	long long last = lastPresent.exchange(t);
+	double delta, d;
+
+	if(!last){
+		return;
+	}
+	delta = (t - last) / 1000000.0;
+
+	lock_guard<mutex> guard(statsLock);
+
+	//running mean and variance of the frame interval
+	frames++;
+	d = delta - mean;
+	mean += d / frames;
+	m2 += d * (delta - mean);
+	if(delta > worst){
+		worst = delta;
+	}
+
+	//swaps that come back much faster than the refresh rate mean the
+	//driver ignored the swap interval
+	if(vsync && checkFrames < VSYNC_CHECK_FRAMES){
+		checkFrames++;
+		checkTotal += delta;
+		if(checkFrames == VSYNC_CHECK_FRAMES &&
+				checkTotal / checkFrames < 0.75 * interval / 1000000.0){
+			vsyncWorking = false;
+		}
+	}
+}
+
+//Frame interval mean, standard deviation and worst case in milliseconds
+//since the previous call
+void FramePacer::sampleStats(double& outMean, double& outStdDev, double& outWorst)
+{
+	lock_guard<mutex> guard(statsLock);
+
+	outMean = mean;
+	outStdDev = frames > 1 ? sqrt(m2 / (frames - 1)) : 0;
+	outWorst = worst;
+
+	frames = 0;
+	mean = 0;
+	m2 = 0;
+	worst = 0;
+}
+
+double FramePacer::getSpinMargin(void)
+{
+	return spinMargin / 1000000.0;
+}
@@ -0,0 +1,47 @@
+/*
+ *	FramePacer.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef FRAMEPACER_H_
+#define FRAMEPACER_H_
+#include <atomic>
+#include <mutex>
+using namespace std;
+
+class FramePacer
+{
+public:
+			FramePacer(int refreshRate);
+			~FramePacer(void);
+	bool	enableVsync(void);
+	bool	getVsync(void);
+	void	wait(void);
+	void	framePresented(void);
+	void	sampleStats(double& mean, double& stdDev, double& worst);
+	double	getSpinMargin(void);
+
+private:
+	static long long now(void);
+	void	sleepUntil(long long time);
+
+	long long interval;				//target frame interval
+	long long deadline;				//when the next frame is due
+	atomic<long long> spinMargin;	//how early to stop sleeping and spin
+	bool	vsync;					//swap interval set, swaps block
+	atomic<bool> vsyncWorking;		//swaps really do wait for the display
+	atomic<long long> lastPresent;
+
+	//frame interval statistics since the last sample
+	mutex	statsLock;
+	long long frames;
+	double	mean, m2, worst;
+	long long checkFrames;
+	double	checkTotal;
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ *	GLExtensions.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Looks up the OpenGL entry points the renderer uses beyond 1.1. Each
+	one is fetched by name from the driver; anything that comes back
+	missing leaves its pointer NULL and makes loadExtensions() fail, so
+	callers can fall back to the fixed function path.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "GLExtensions.h"
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+PFNGLCREATESHADERPROC			createShader;
+PFNGLSHADERSOURCEPROC			shaderSource;
+PFNGLCOMPILESHADERPROC			compileShader;
+PFNGLGETSHADERIVPROC			getShaderiv;
+PFNGLGETSHADERINFOLOGPROC		getShaderInfoLog;
+PFNGLDELETESHADERPROC			deleteShader;
+PFNGLCREATEPROGRAMPROC			createProgram;
+PFNGLATTACHSHADERPROC			attachShader;
+PFNGLLINKPROGRAMPROC			linkProgram;
+PFNGLGETPROGRAMIVPROC			getProgramiv;
+PFNGLGETPROGRAMINFOLOGPROC		getProgramInfoLog;
+PFNGLDELETEPROGRAMPROC			deleteProgram;
+PFNGLUSEPROGRAMPROC				useProgram;
+PFNGLGETUNIFORMLOCATIONPROC		getUniformLocation;
+PFNGLUNIFORM1IPROC				uniform1i;
+PFNGLUNIFORM2FPROC				uniform2f;
+PFNGLUNIFORM4FPROC				uniform4f;
+PFNGLGETUNIFORMBLOCKINDEXPROC	getUniformBlockIndex;
+PFNGLUNIFORMBLOCKBINDINGPROC	uniformBlockBinding;
+
+PFNGLGENBUFFERSPROC				genBuffers;
+PFNGLBINDBUFFERPROC				bindBuffer;
+PFNGLBUFFERDATAPROC				bufferData;
+PFNGLBUFFERSUBDATAPROC			bufferSubData;
+PFNGLBINDBUFFERBASEPROC			bindBufferBase;
+PFNGLDELETEBUFFERSPROC			deleteBuffers;
+PFNGLMAPBUFFERPROC				mapBuffer;
+PFNGLUNMAPBUFFERPROC			unmapBuffer;
+PFNGLGENVERTEXARRAYSPROC		genVertexArrays;
+PFNGLBINDVERTEXARRAYPROC		bindVertexArray;
+PFNGLDELETEVERTEXARRAYSPROC		deleteVertexArrays;
+PFNGLVERTEXATTRIBPOINTERPROC	vertexAttribPointer;
+PFNGLENABLEVERTEXATTRIBARRAYPROC	enableVertexAttribArray;
+PFNGLVERTEXATTRIBDIVISORPROC	vertexAttribDivisor;
+PFNGLDRAWELEMENTSINSTANCEDPROC	drawElementsInstanced;
+
+PFNGLACTIVETEXTUREPROC			activeTexture;
+PFNGLGENFRAMEBUFFERSPROC		genFramebuffers;
+PFNGLBINDFRAMEBUFFERPROC		bindFramebuffer;
+PFNGLDELETEFRAMEBUFFERSPROC		deleteFramebuffers;
+PFNGLFRAMEBUFFERTEXTURE2DPROC	framebufferTexture2D;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC	framebufferRenderbuffer;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC	checkFramebufferStatus;
+PFNGLGENRENDERBUFFERSPROC		genRenderbuffers;
+PFNGLBINDRENDERBUFFERPROC		bindRenderbuffer;
+PFNGLDELETERENDERBUFFERSPROC	deleteRenderbuffers;
+PFNGLRENDERBUFFERSTORAGEPROC	renderbufferStorage;
+PFNGLBLITFRAMEBUFFERPROC		blitFramebuffer;
+PFNGLDRAWBUFFERSPROC			drawBuffers;
+PFNGLCLEARBUFFERFVPROC			clearBufferfv;
+PFNGLBLENDFUNCIPROC				blendFunci;
+
+//Name and pointer of every entry point, in one table so none is missed
+struct EntryPoint
+{
+	const char* name;
+	void** proc;
+};
+
+static EntryPoint entryPoints[] = {
+	{ "glCreateShader",				(void**)&createShader },
+	{ "glShaderSource",				(void**)&shaderSource },
+	{ "glCompileShader",			(void**)&compileShader },
+	{ "glGetShaderiv",				(void**)&getShaderiv },
+	{ "glGetShaderInfoLog",			(void**)&getShaderInfoLog },
+	{ "glDeleteShader",				(void**)&deleteShader },
+	{ "glCreateProgram",			(void**)&createProgram },
+	{ "glAttachShader",				(void**)&attachShader },
+	{ "glLinkProgram",				(void**)&linkProgram },
+	{ "glGetProgramiv",				(void**)&getProgramiv },
+	{ "glGetProgramInfoLog",		(void**)&getProgramInfoLog },
+	{ "glDeleteProgram",			(void**)&deleteProgram },
+	{ "glUseProgram",				(void**)&useProgram },
+	{ "glGetUniformLocation",		(void**)&getUniformLocation },
+	{ "glUniform1i",				(void**)&uniform1i },
+	{ "glUniform2f",				(void**)&uniform2f },
+	{ "glUniform4f",				(void**)&uniform4f },
+	{ "glGetUniformBlockIndex",		(void**)&getUniformBlockIndex },
+	{ "glUniformBlockBinding",		(void**)&uniformBlockBinding },
+	{ "glGenBuffers",				(void**)&genBuffers },
+	{ "glBindBuffer",				(void**)&bindBuffer },
+	{ "glBufferData",				(void**)&bufferData },
+	{ "glBufferSubData",			(void**)&bufferSubData },
+	{ "glBindBufferBase",			(void**)&bindBufferBase },
+	{ "glDeleteBuffers",			(void**)&deleteBuffers },
+	{ "glMapBuffer",				(void**)&mapBuffer },
+	{ "glUnmapBuffer",				(void**)&unmapBuffer },
+	{ "glGenVertexArrays",			(void**)&genVertexArrays },
+	{ "glBindVertexArray",			(void**)&bindVertexArray },
+	{ "glDeleteVertexArrays",		(void**)&deleteVertexArrays },
+	{ "glVertexAttribPointer",		(void**)&vertexAttribPointer },
+	{ "glEnableVertexAttribArray",	(void**)&enableVertexAttribArray },
+	{ "glVertexAttribDivisor",		(void**)&vertexAttribDivisor },
+	{ "glDrawElementsInstanced",	(void**)&drawElementsInstanced },
+	{ "glActiveTexture",			(void**)&activeTexture },
+	{ "glGenFramebuffers",			(void**)&genFramebuffers },
+	{ "glBindFramebuffer",			(void**)&bindFramebuffer },
+	{ "glDeleteFramebuffers",		(void**)&deleteFramebuffers },
+	{ "glFramebufferTexture2D",		(void**)&framebufferTexture2D },
+	{ "glFramebufferRenderbuffer",	(void**)&framebufferRenderbuffer },
+	{ "glCheckFramebufferStatus",	(void**)&checkFramebufferStatus },
+	{ "glGenRenderbuffers",			(void**)&genRenderbuffers },
+	{ "glBindRenderbuffer",			(void**)&bindRenderbuffer },
+	{ "glDeleteRenderbuffers",		(void**)&deleteRenderbuffers },
+	{ "glRenderbufferStorage",		(void**)&renderbufferStorage },
+	{ "glBlitFramebuffer",			(void**)&blitFramebuffer },
+	{ "glDrawBuffers",				(void**)&drawBuffers },
+	{ "glClearBufferfv",			(void**)&clearBufferfv },
+	{ "glBlendFunci",				(void**)&blendFunci },
+};
+
+static void* getProc(const char* name)
+{
+#ifdef _WIN32
+	void* proc = (void*)wglGetProcAddress(name);
+
+	//some drivers hand back small integers instead of NULL
+	if(proc == (void*)1 || proc == (void*)2 || proc == (void*)3 || proc == (void*)-1){
+		return NULL;
+	}
+	return proc;
+#else
+	return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+bool loadExtensions(void)
+{
+	bool complete = true;
+
+	for(unsigned int i = 0; i < sizeof(entryPoints) / sizeof(entryPoints[0]); i++){
+		*entryPoints[i].proc = getProc(entryPoints[i].name);
+
+		//per target blending came in as an extension before GL 4.0
+		if(!*entryPoints[i].proc && !strcmp(entryPoints[i].name, "glBlendFunci")){
+			*entryPoints[i].proc = getProc("glBlendFunciARB");
+		}
+		if(!*entryPoints[i].proc){
+			complete = false;
+		}
+	}
+
+	//on some platforms every name resolves, so check the version too
+	return complete && getGLVersion() >= 30;
+}
+
+int getGLVersion(void)
+{
+	const char* version = (const char*)glGetString(GL_VERSION);
+	int major = 0, minor = 0;
+
+	if(!version || sscanf(version, "%d.%d", &major, &minor) != 2){
+		return 0;
+	}
+	return major * 10 + minor;
+}
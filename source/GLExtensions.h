@@ -0,0 +1,75 @@
+/*
+ *	GLExtensions.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef GLEXTENSIONS_H_
+#define GLEXTENSIONS_H_
+#include <GL/glut.h>
+#include <GL/glext.h>
+
+//Entry points past OpenGL 1.1. Windows only exports 1.1, so everything
+//newer is looked up at run time once a context is current.
+bool	loadExtensions(void);
+int		getGLVersion(void);				//major*10 + minor
+
+//shaders
+extern PFNGLCREATESHADERPROC			createShader;
+extern PFNGLSHADERSOURCEPROC			shaderSource;
+extern PFNGLCOMPILESHADERPROC			compileShader;
+extern PFNGLGETSHADERIVPROC				getShaderiv;
+extern PFNGLGETSHADERINFOLOGPROC		getShaderInfoLog;
+extern PFNGLDELETESHADERPROC			deleteShader;
+extern PFNGLCREATEPROGRAMPROC			createProgram;
+extern PFNGLATTACHSHADERPROC			attachShader;
+extern PFNGLLINKPROGRAMPROC				linkProgram;
+extern PFNGLGETPROGRAMIVPROC			getProgramiv;
+extern PFNGLGETPROGRAMINFOLOGPROC		getProgramInfoLog;
+extern PFNGLDELETEPROGRAMPROC			deleteProgram;
+extern PFNGLUSEPROGRAMPROC				useProgram;
+extern PFNGLGETUNIFORMLOCATIONPROC		getUniformLocation;
+extern PFNGLUNIFORM1IPROC				uniform1i;
+extern PFNGLUNIFORM2FPROC				uniform2f;
+extern PFNGLUNIFORM4FPROC				uniform4f;
+extern PFNGLGETUNIFORMBLOCKINDEXPROC	getUniformBlockIndex;
+extern PFNGLUNIFORMBLOCKBINDINGPROC		uniformBlockBinding;
+
+//buffers and vertex arrays
+extern PFNGLGENBUFFERSPROC				genBuffers;
+extern PFNGLBINDBUFFERPROC				bindBuffer;
+extern PFNGLBUFFERDATAPROC				bufferData;
+extern PFNGLBUFFERSUBDATAPROC			bufferSubData;
+extern PFNGLBINDBUFFERBASEPROC			bindBufferBase;
+extern PFNGLDELETEBUFFERSPROC			deleteBuffers;
+extern PFNGLMAPBUFFERPROC				mapBuffer;
+extern PFNGLUNMAPBUFFERPROC				unmapBuffer;
+extern PFNGLGENVERTEXARRAYSPROC			genVertexArrays;
+extern PFNGLBINDVERTEXARRAYPROC			bindVertexArray;
+extern PFNGLDELETEVERTEXARRAYSPROC		deleteVertexArrays;
+extern PFNGLVERTEXATTRIBPOINTERPROC		vertexAttribPointer;
+extern PFNGLENABLEVERTEXATTRIBARRAYPROC	enableVertexAttribArray;
+extern PFNGLVERTEXATTRIBDIVISORPROC		vertexAttribDivisor;
+extern PFNGLDRAWELEMENTSINSTANCEDPROC	drawElementsInstanced;
+
+//framebuffers and textures
+extern PFNGLACTIVETEXTUREPROC			activeTexture;
+extern PFNGLGENFRAMEBUFFERSPROC			genFramebuffers;
+extern PFNGLBINDFRAMEBUFFERPROC			bindFramebuffer;
+extern PFNGLDELETEFRAMEBUFFERSPROC		deleteFramebuffers;
+extern PFNGLFRAMEBUFFERTEXTURE2DPROC	framebufferTexture2D;
+extern PFNGLFRAMEBUFFERRENDERBUFFERPROC	framebufferRenderbuffer;
+extern PFNGLCHECKFRAMEBUFFERSTATUSPROC	checkFramebufferStatus;
+extern PFNGLGENRENDERBUFFERSPROC		genRenderbuffers;
+extern PFNGLBINDRENDERBUFFERPROC		bindRenderbuffer;
+extern PFNGLDELETERENDERBUFFERSPROC		deleteRenderbuffers;
+extern PFNGLRENDERBUFFERSTORAGEPROC		renderbufferStorage;
+extern PFNGLBLITFRAMEBUFFERPROC			blitFramebuffer;
+extern PFNGLDRAWBUFFERSPROC				drawBuffers;
+extern PFNGLCLEARBUFFERFVPROC			clearBufferfv;
+extern PFNGLBLENDFUNCIPROC				blendFunci;
+
+#endif
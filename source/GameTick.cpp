@@ -0,0 +1,419 @@
+/*
+ *	GameTick.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	The game's rules, out of game.cpp so headless can run them without a
+	window or sound. Timer callbacks and frame graph passes get the
+	GameTick as their data.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include "GameTick.h"
+#include "Trace.h"
+
+GameTick::GameTick(World* inWorld, Player* inPlayer, Rng* inRng, ParticleSystem* inParticles, JobSystem* inJobs, int inTickRate)
+			: world(inWorld),
+			  player(inPlayer),
+			  rng(inRng),
+			  particles(inParticles),
+			  jobs(inJobs),
+			  renderer(NULL),
+			  graph(inJobs),
+			  tickRate(inTickRate),
+			  orbLife(120),
+			  waveInterval(60),
+			  waveSize(20),
+			  decayInterval(10),
+			  mouseButtons(0),
+			  orbHit(NULL),
+			  orbHitCount(0),
+			  spawnTimer(0),
+			  decayTimer(0),
+			  timersFired(0),
+			  turbo(false),
+			  captured(0),
+			  released(0),
+			  escaped(0),
+			  decay(0)
+{
+	memset(&sounds, 0, sizeof(sounds));
+	memset(&input, 0, sizeof(input));
+	memset(keyDown, 0, sizeof(keyDown));
+	memset(keyPressed, 0, sizeof(keyPressed));
+
+	int move = graph.addPass("move", movePass, this);
+	int collide = graph.addPass("collide", collidePass, this);
+	int listener = graph.addPass("listener", listenerPass, this);
+	int cull = graph.addPass("cull", cullPass, this);
+	int capture = graph.addPass("capture", capturePass, this);
+	int debris = graph.addPass("particles", particlePass, this);
+	int clock = graph.addPass("timers", timerPass, this);
+
+	//collision and render preparation only read the world, captured orbs
+	//are removed once both are done
+	graph.addDependency(move, collide);
+	graph.addDependency(move, listener);
+	graph.addDependency(move, cull);
+	graph.addDependency(collide, capture);
+	graph.addDependency(cull, capture);
+	graph.addDependency(capture, debris);
+	graph.addDependency(capture, clock);
+}
+
+GameTick::~GameTick(void)
+{
+}
+
+void GameTick::setRenderer(Renderer* inRenderer)
+{
+	renderer = inRenderer;
+}
+
+void GameTick::setSounds(const GameSounds& inSounds)
+{
+	sounds = inSounds;
+}
+
+void GameTick::setRules(int inOrbLife, int inWaveInterval, int inWaveSize, int inDecayInterval)
+{
+	orbLife = inOrbLife;
+	waveInterval = inWaveInterval;
+	waveSize = inWaveSize;
+	decayInterval = inDecayInterval;
+}
+
+//Every orb has at most one lifetime timer, tracked or not, so timers for
+//all of them and the game's own never grow the wheel
+void GameTick::reserve(int orbs)
+{
+	world->reserve(orbs);
+	timers.reserve(world->getTotal() + orbs + GAME_TIMERS);
+}
+
+//Timers for a fresh game, or a restored one; restored orbs stay until
+//they are caught, their lifetimes aren't saved
+void GameTick::start(int inCaptured, int inReleased)
+{
+	captured = inCaptured;
+	released = inReleased;
+	escaped = max(released - captured - world->getTotal(), 0);
+	decay = 0;
+
+	timers.clear();
+	spawnTimer = timers.schedule(ticksIn(3000), spawnOrb, this, 0);
+	if(waveInterval > 0){
+		timers.schedule(ticksIn(waveInterval * 1000.0), spawnWave, this, 0);
+	}
+	decayTimer = 0;
+	if(decayInterval > 0){
+		decayTimer = timers.schedule(ticksIn(decayInterval * 1000.0), decayScore, this, 0);
+	}
+	updateScore();
+}
+
+//Applies the events queued since the last tick in the order they happened
+long long GameTick::drainInput(InputQueue& queue)
+{
+	InputEvent e;
+	long long oldest = 0;
+
+	memset(keyPressed, 0, sizeof(keyPressed));
+
+	while(queue.pop(e)){
+		if(!oldest){
+			oldest = e.time;
+		}
+
+		switch(e.type){
+		case INPUT_KEY_DOWN:
+			keyDown[e.key] = 1;
+			keyPressed[e.key] = 1;
+			break;
+		case INPUT_KEY_UP:
+			keyDown[e.key] = 0;
+			break;
+		case INPUT_MOUSE_BUTTON:
+			if(e.dx)
+				mouseButtons |= 1 << e.key;
+			else
+				mouseButtons &= ~(1 << e.key);
+			break;
+		}
+	}
+	return oldest;
+}
+
+bool GameTick::held(int key)
+{
+	return keyDown[key] == 1 || keyPressed[key] == 1;
+}
+
+bool GameTick::pressed(int key)
+{
+	return keyPressed[key] == 1;
+}
+
+int GameTick::getMouseButtons(void)
+{
+	return mouseButtons;
+}
+
+void GameTick::setInput(const PlayerInput& inInput)
+{
+	input = inInput;
+}
+
+//The next orb comes at the new pace, not after the old wait
+void GameTick::setTurbo(bool on)
+{
+	turbo = on;
+	timers.cancel(spawnTimer);
+	spawnTimer = timers.schedule(1, spawnOrb, this, 0);
+}
+
+bool GameTick::getTurbo(void)
+{
+	return turbo;
+}
+
+//Simulation ticks in ms milliseconds, at least one
+unsigned int GameTick::ticksIn(double ms)
+{
+	double ticks = ms * tickRate / 1000;
+
+	return ticks < 1 ? 1 : (unsigned int)ticks;
+}
+
+//Starts an orb's lifetime, kept in the orb so a capture can cancel it.
+//One in a dormant chunk can't be written to; its timer runs out
+//untracked and expireOrb() checks the orb is still there.
+void GameTick::startLife(unsigned int id)
+{
+	TimerId timer = timers.schedule(ticksIn(orbLife * 1000.0), expireOrb, this, id);
+	int index = world->indexOf(id);
+
+	if(index >= 0){
+		world->getOrbs()[index].timer = timer;
+	}
+}
+
+//Puts one orb in the world and starts its lifetime
+Point3D GameTick::releaseOrb(void)
+{
+	Point3D treasure = world->spawn(*rng);
+
+	if(orbLife > 0){
+		startLife(world->getNextId() - 1);
+	}
+	released++;
+	return treasure;
+}
+
+void GameTick::updateScore(void)
+{
+	int score = released > 0 ? (int)((double)captured / released * 100) - decay : 0;
+
+	if(renderer){
+		renderer->setScore(max(score, 0), captured, released - escaped);
+	}
+}
+
+//One tick of the world around the player
+void GameTick::run(void)
+{
+	Point3D eye = player->getCamera()->getLocation();
+
+	arena.reset();
+	world->setRegion(&eye, 1, VIEW_DISTANCE);
+	graph.execute();
+}
+
+void GameTick::detectCollision(void)
+{
+	TRACE_ZONE("detectCollision");
+	int count = world->size();
+	Orb* orbs = world->getOrbs();
+
+	//sweep the player along the path it moved this tick so fast
+	//movement or a slow tick rate can't skip over an orb
+	Point3D from = player->getLastPosition();
+	Point3D to = player->getPosition();
+
+	orbHit = arena.alloc<char>(count);
+	orbHitCount = count;
+
+	//test every orb against the player in parallel
+	auto test = [&](int first, int last){
+		int i = first;
+
+		for(; i + 4 <= last; i += 4){
+			int hits = sweepHits4(orbs + i, from, to, CAPTURE_RADIUS);
+			for(int k = 0; k < 4; k++)
+				orbHit[i + k] = hits >> k & 1;
+		}
+		for(; i < last; i++)
+			orbHit[i] = sweepHits(orbs[i].pos, from, to, CAPTURE_RADIUS);
+	};
+	jobs->parallelFor(0, count, 1024, test);
+}
+
+void GameTick::captureOrbs(void)
+{
+	//remove captured orbs back to front, the orb swapped into each hole
+	//has already been tested
+	Orb* orbs = world->getOrbs();
+
+	for(int i = orbHitCount - 1; i >= 0; i--){
+		if(orbHit[i]){
+			Point3D at = orbs[i].pos;
+
+			particles->burst(at, PARTICLE_BURST);
+			timers.cancel(orbs[i].timer);
+			world->remove(i);
+			if(sounds.capture){
+				sounds.capture(at);
+			}
+			captured++;
+			if(decayTimer){
+				timers.cancel(decayTimer);
+				decayTimer = timers.schedule(ticksIn(decayInterval * 1000.0), decayScore, this, 0);
+			}
+			decay = max(decay - 1, 0);
+			updateScore();
+		}
+	}
+	orbHitCount = 0;
+}
+
+//Game timers, fired inside the tick with the world locked. The spawner
+//releases an orb and sets itself for the next, sooner the better the
+//player is doing.
+void GameTick::spawnOrb(void* data, unsigned int arg)
+{
+	TRACE_ZONE("spawn");
+	GameTick* game = (GameTick*)data;
+	Point3D treasure = game->releaseOrb();
+	double interval = game->turbo ? 10 : 3000 - (game->captured*900.0 / (game->released+1));
+
+	if(!game->turbo && game->sounds.release){
+		game->sounds.release(treasure);
+	}
+	game->updateScore();
+	game->spawnTimer = game->timers.schedule(game->ticksIn(interval), spawnOrb, game, 0);
+}
+
+void GameTick::spawnWave(void* data, unsigned int arg)
+{
+	TRACE_ZONE("wave");
+	GameTick* game = (GameTick*)data;
+	Point3D treasure;
+
+	for(int i = 0; i < game->waveSize; i++){
+		treasure = game->releaseOrb();
+	}
+	if(game->sounds.release){
+		game->sounds.release(treasure);
+	}
+	game->updateScore();
+	game->timers.schedule(game->ticksIn(game->waveInterval * 1000.0), spawnWave, game, 0);
+}
+
+//An orb's lifetime is up. Dormant chunks aren't simulated, so neither
+//are their orbs' clocks: one found out there gets another lifetime. One
+//caught since its untracked timer started is simply gone.
+void GameTick::expireOrb(void* data, unsigned int id)
+{
+	GameTick* game = (GameTick*)data;
+	int index = game->world->indexOf(id);
+
+	if(index < 0){
+		if(game->world->has(id)){
+			game->startLife(id);
+		}
+		return;
+	}
+	game->world->remove(index);
+	game->escaped++;
+	game->updateScore();
+}
+
+//A point lost for every decayInterval without a capture; each capture
+//wins one back and starts the wait again
+void GameTick::decayScore(void* data, unsigned int arg)
+{
+	GameTick* game = (GameTick*)data;
+
+	game->decay++;
+	game->updateScore();
+	game->decayTimer = game->timers.schedule(game->ticksIn(game->decayInterval * 1000.0), decayScore, game, 0);
+}
+
+void GameTick::movePass(void* data, int begin, int end)
+{
+	GameTick* game = (GameTick*)data;
+
+	game->player->move(game->input, 1.0 / game->tickRate);
+}
+
+void GameTick::collidePass(void* data, int begin, int end)
+{
+	((GameTick*)data)->detectCollision();
+}
+
+void GameTick::listenerPass(void* data, int begin, int end)
+{
+	GameTick* game = (GameTick*)data;
+
+	if(game->sounds.listener){
+		TRACE_ZONE("listener");
+		game->sounds.listener(game->player->getCamera());
+	}
+}
+
+void GameTick::cullPass(void* data, int begin, int end)
+{
+	GameTick* game = (GameTick*)data;
+
+	if(game->renderer){
+		game->renderer->prepareFrame(game->jobs, &game->arena);
+	}
+}
+
+void GameTick::capturePass(void* data, int begin, int end)
+{
+	((GameTick*)data)->captureOrbs();
+}
+
+void GameTick::particlePass(void* data, int begin, int end)
+{
+	GameTick* game = (GameTick*)data;
+
+	game->particles->update(1.0 / game->tickRate, game->jobs);
+}
+
+void GameTick::timerPass(void* data, int begin, int end)
+{
+	GameTick* game = (GameTick*)data;
+
+	game->timersFired += game->timers.advance();
+}
+
+int		GameTick::getCaptured(void)		{ return captured; }
+int		GameTick::getReleased(void)		{ return released; }
+int		GameTick::getEscaped(void)		{ return escaped; }
+TimingWheel*	GameTick::getTimers(void)	{ return &timers; }
+FrameGraph*	GameTick::getGraph(void)		{ return &graph; }
+FrameArena*	GameTick::getArena(void)		{ return &arena; }
+
+int GameTick::takeTimersFired(void)
+{
+	int fired = timersFired;
+
+	timersFired = 0;
+	return fired;
+}
@@ -0,0 +1,128 @@
+/*
+ *	GameTick.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef GAMETICK_H_
+#define GAMETICK_H_
+#include "Camera.h"
+#include "World.h"
+#include "Player.h"
+#include "Rng.h"
+#include "Renderer.h"
+#include "ParticleSystem.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "InputQueue.h"
+#include "TimingWheel.h"
+
+//What the game does besides the simulation, called from inside the tick;
+//any may be NULL
+struct GameSounds
+{
+	void	(*capture)(const Point3D& at);		//an orb was caught there
+	void	(*release)(const Point3D& at);		//a spawn or a wave came out there
+	void	(*listener)(Camera* camera);		//once a tick, after the move
+};
+
+//The game's simulation, one tick at a time. A tick is a frame graph on
+//the job system: the player moves, then collision, the audio listener
+//and render preparation run side by side, then the orbs caught are taken
+//out and the particles and timers run. Spawns, waves, orb lifetimes and
+//score decay are all timers. The game runs it on its simulation thread
+//with the world locked and headless runs it under --alloc-check, so
+//anything a tick needs is made or reserved before the first one.
+class GameTick
+{
+public:
+			GameTick(World* world, Player* player, Rng* rng, ParticleSystem* particles, JobSystem* jobs, int tickRate);
+			~GameTick(void);
+	void	setRenderer(Renderer* renderer);	//prepared for each tick, if set
+	void	setSounds(const GameSounds& sounds);
+	void	setRules(int orbLife, int waveInterval, int waveSize, int decayInterval);
+	void	reserve(int orbs);					//room for this many more without growing
+	void	start(int captured, int released);	//timers and score for a new or restored game
+
+	//input: drain the queue at the start of a tick, then hand the
+	//player's buttons over before run()
+	long long	drainInput(InputQueue& queue);	//time of the oldest event, 0 if none
+	bool	held(int key);						//down now or tapped since the last drain
+	bool	pressed(int key);					//went down since the last drain
+	int		getMouseButtons(void);
+	void	setInput(const PlayerInput& input);
+
+	void	setTurbo(bool on);
+	bool	getTurbo(void);
+	Point3D	releaseOrb(void);
+	void	run(void);
+
+	int		getCaptured(void);
+	int		getReleased(void);
+	int		getEscaped(void);
+	int		takeTimersFired(void);				//since the last call
+	TimingWheel*	getTimers(void);
+	FrameGraph*	getGraph(void);
+	FrameArena*	getArena(void);
+
+private:
+	//timers that aren't orb lifetimes: spawner, wave and decay
+	static const int GAME_TIMERS = 3;
+
+	unsigned int	ticksIn(double ms);
+	void	startLife(unsigned int id);
+	void	updateScore(void);
+	void	detectCollision(void);
+	void	captureOrbs(void);
+
+	static void	spawnOrb(void* data, unsigned int arg);
+	static void	spawnWave(void* data, unsigned int arg);
+	static void	expireOrb(void* data, unsigned int id);
+	static void	decayScore(void* data, unsigned int arg);
+
+	static void	movePass(void* data, int begin, int end);
+	static void	collidePass(void* data, int begin, int end);
+	static void	listenerPass(void* data, int begin, int end);
+	static void	cullPass(void* data, int begin, int end);
+	static void	capturePass(void* data, int begin, int end);
+	static void	particlePass(void* data, int begin, int end);
+	static void	timerPass(void* data, int begin, int end);
+
+	World* world;
+	Player* player;
+	Rng* rng;
+	ParticleSystem* particles;
+	JobSystem* jobs;
+	Renderer* renderer;
+	GameSounds sounds;
+	FrameGraph graph;
+	FrameArena arena;				//scratch for one tick, reset before it runs
+	TimingWheel timers;				//in ticks
+	int tickRate;
+
+	int orbLife;					//seconds, 0 for ever
+	int waveInterval;				//seconds between waves, 0 for none
+	int waveSize;
+	int decayInterval;				//seconds without a capture per point lost, 0 for none
+
+	PlayerInput input;				//buttons held this tick
+	int keyDown[256];
+	int keyPressed[256];
+	int mouseButtons;
+
+	char* orbHit;					//per orb, from arena
+	int orbHitCount;
+	TimerId spawnTimer;
+	TimerId decayTimer;
+	int timersFired;
+	bool turbo;
+	int captured;
+	int released;
+	int escaped;					//lifetime ran out before they were caught
+	int decay;						//points lost to idling, see decayScore()
+};
+
+#endif
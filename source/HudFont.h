@@ -0,0 +1,26 @@
+/*
+ *	HudFont.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef HUDFONT_H_
+#define HUDFONT_H_
+
+//The 9x15 fixed font GLUT_BITMAP_9_BY_15 draws, for renderers that can't
+//call glutBitmapCharacter(). Glyphs cover printable ASCII; each row is
+//nine bits with the leftmost pixel in bit 8, top row first. The baseline
+//sits FONT_DESCENT rows above the bottom of the cell, and every glyph
+//advances FONT_WIDTH pixels.
+const int FONT_WIDTH = 9;
+const int FONT_HEIGHT = 16;
+const int FONT_DESCENT = 4;
+const int FONT_FIRST = 32;
+const int FONT_COUNT = 95;
+
+extern const unsigned short hudFont[FONT_COUNT][FONT_HEIGHT];
+
+#endif
@@ -0,0 +1,23 @@
+/*
+ *	HudText.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Formats the score panel both renderers draw, so the fixed function and
+	core profile HUDs can't drift apart and the bench can time it without
+	a GL context.
+ */
+
+#include <stdio.h>
+#include "HudText.h"
+
+void formatHud(HudText& text, int captured, int released, int score, double fps)
+{
+	sprintf(text.captured, "Captured:    %i", captured);
+	sprintf(text.remaining, "Remaining:   %i", released - captured);
+	sprintf(text.score, "Score:       %i", score);
+	sprintf(text.fps, "FPS:         %#.2f", fps);
+}
@@ -0,0 +1,25 @@
+/*
+ *	HudText.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef HUDTEXT_H_
+#define HUDTEXT_H_
+
+//The lines of the score panel, formatted once for whichever renderer
+//draws them
+struct HudText
+{
+	char captured[30];
+	char remaining[30];
+	char score[30];
+	char fps[30];
+};
+
+void	formatHud(HudText& text, int captured, int released, int score, double fps);
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ *	ImageWriter.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Saves captured frames to disk. Binary PPM needs no libraries and is
+	read back for golden image comparisons. PNG is written without zlib:
+	the image goes into stored deflate blocks, so files are no smaller
+	than the pixels but open anywhere. Y4M is plain planar video a frame
+	at a time.
+ */
+
+#include <string.h>
+#include "ImageWriter.h"
+
+//PNG's CRC-32, table built on first use
+static unsigned int crc32(unsigned int crc, const unsigned char* data, size_t size)
+{
+	static unsigned int table[256];
+
+	if(!table[1]){
+		for(unsigned int n = 0; n < 256; n++){
+			unsigned int c = n;
+			for(int k = 0; k < 8; k++)
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+	}
+
+	crc = ~crc;
+	for(size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void putBig32(unsigned char* p, unsigned int v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+//One chunk: length, type, data, CRC of type and data
+static bool writeChunk(FILE* fp, const char* type, const unsigned char* data, unsigned int size)
+{
+	unsigned char head[8], tail[4];
+
+	putBig32(head, size);
+	memcpy(head + 4, type, 4);
+	putBig32(tail, crc32(crc32(0, head + 4, 4), data, size));
+
+	return fwrite(head, 1, 8, fp) == 8 &&
+		(size == 0 || fwrite(data, 1, size, fp) == size) &&
+		fwrite(tail, 1, 4, fp) == 4;
+}
+
+bool writePPM(const char* fileName, const unsigned char* rgb, int width, int height)
+{
+	FILE* fp = fopen(fileName, "wb");
+	size_t size = (size_t)width * height * 3;
+	bool ok;
+
+	if(!fp){
+		return false;
+	}
+
+	fprintf(fp, "P6\n%d %d\n255\n", width, height);
+	ok = fwrite(rgb, 1, size, fp) == size;
+	fclose(fp);
+
+	return ok;
+}
+
+bool readPPM(const char* fileName, vector<unsigned char>& rgb, int& width, int& height)
+{
+	FILE* fp = fopen(fileName, "rb");
+	int maxVal;
+	size_t size;
+	bool ok;
+
+	if(!fp){
+		return false;
+	}
+
+	//header is followed by exactly one whitespace character
+	if(fscanf(fp, "P6 %d %d %d", &width, &height, &maxVal) != 3 ||
+			maxVal != 255 || width <= 0 || height <= 0){
+		fclose(fp);
+		return false;
+	}
+	fgetc(fp);
+
+	size = (size_t)width * height * 3;
+	rgb.resize(size);
+	ok = fread(&rgb[0], 1, size, fp) == size;
+	fclose(fp);
+
+	return ok;
+}
+
+//A zlib stream of stored blocks, filled a run of bytes at a time
+struct StoredStream
+{
+	unsigned char* out;
+	size_t	left;						//bytes still to come, all blocks
+	size_t	inBlock;					//bytes still to come in this block
+	unsigned int a, b;					//Adler-32 of everything so far
+
+	void put(const unsigned char* data, size_t size)
+	{
+		while(size > 0){
+			if(inBlock == 0){
+				inBlock = left < 65535 ? left : 65535;
+				*out++ = left == inBlock;		//last block flag, type stored
+				*out++ = inBlock & 0xFF;
+				*out++ = inBlock >> 8;
+				*out++ = ~inBlock & 0xFF;
+				*out++ = (~inBlock >> 8) & 0xFF;
+			}
+
+			size_t run = size < inBlock ? size : inBlock;
+			memcpy(out, data, run);
+			for(size_t i = 0; i < run; i++){
+				a += data[i];
+				b += a;
+				if((i & 2047) == 2047){
+					a %= 65521;
+					b %= 65521;
+				}
+			}
+			a %= 65521;
+			b %= 65521;
+			out += run;
+			data += run;
+			size -= run;
+			inBlock -= run;
+			left -= run;
+		}
+	}
+};
+
+bool writePNG(const char* fileName, const unsigned char* rgb, int width, int height)
+{
+	vector<unsigned char> scratch;
+
+	return writePNG(fileName, rgb, width, height, scratch);
+}
+
+//Each row is a filter byte (none) and the pixels, all in one IDAT chunk
+bool writePNG(const char* fileName, const unsigned char* rgb, int width, int height, vector<unsigned char>& idat)
+{
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	static const unsigned char filter = 0;
+	size_t rowSize = (size_t)width * 3;
+	size_t rawSize = (rowSize + 1) * height;
+	size_t blocks = (rawSize + 65534) / 65535;
+	unsigned char header[13];
+	StoredStream zs;
+	FILE* fp;
+	bool ok;
+
+	if(width <= 0 || height <= 0 || 2 + rawSize + blocks * 5 + 4 > 0x7FFFFFFF){
+		return false;
+	}
+	idat.resize(2 + rawSize + blocks * 5 + 4);
+
+	//zlib header: deflate, 32K window, no dictionary, fastest
+	idat[0] = 0x78;
+	idat[1] = 0x01;
+	zs.out = &idat[2];
+	zs.left = rawSize;
+	zs.inBlock = 0;
+	zs.a = 1;
+	zs.b = 0;
+	for(int y = 0; y < height; y++){
+		zs.put(&filter, 1);
+		zs.put(rgb + y * rowSize, rowSize);
+	}
+	putBig32(zs.out, zs.b << 16 | zs.a);
+
+	putBig32(header, width);
+	putBig32(header + 4, height);
+	header[8] = 8;								//bits per channel
+	header[9] = 2;								//RGB
+	header[10] = header[11] = header[12] = 0;	//deflate, adaptive filters, not interlaced
+
+	fp = fopen(fileName, "wb");
+	if(!fp){
+		return false;
+	}
+	ok = fwrite(signature, 1, 8, fp) == 8 &&
+		writeChunk(fp, "IHDR", header, 13) &&
+		writeChunk(fp, "IDAT", &idat[0], (unsigned int)idat.size()) &&
+		writeChunk(fp, "IEND", NULL, 0);
+	ok = fclose(fp) == 0 && ok;
+
+	return ok;
+}
+
+bool writeY4MHeader(FILE* fp, int width, int height, int fps)
+{
+	return fprintf(fp, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, fps) > 0;
+}
+
+int getY4MFrameSize(int width, int height)
+{
+	int cw = (width + 1) / 2, ch = (height + 1) / 2;
+
+	return width * height + 2 * cw * ch;
+}
+
+//Luma per pixel, chroma from the mean of each 2x2 block
+bool writeY4MFrame(FILE* fp, const unsigned char* rgb, int width, int height, unsigned char* yuv)
+{
+	int cw = (width + 1) / 2, ch = (height + 1) / 2;
+	unsigned char* yPlane = yuv;
+	unsigned char* uPlane = yuv + width * height;
+	unsigned char* vPlane = uPlane + cw * ch;
+	size_t size = getY4MFrameSize(width, height);
+
+	for(int i = 0; i < width * height; i++){
+		const unsigned char* p = rgb + i * 3;
+		yPlane[i] = (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+	}
+
+	for(int cy = 0; cy < ch; cy++){
+		for(int cx = 0; cx < cw; cx++){
+			int r = 0, g = 0, b = 0, n = 0;
+
+			for(int y = cy * 2; y < cy * 2 + 2 && y < height; y++){
+				for(int x = cx * 2; x < cx * 2 + 2 && x < width; x++){
+					const unsigned char* p = rgb + (y * width + x) * 3;
+					r += p[0];
+					g += p[1];
+					b += p[2];
+					n++;
+				}
+			}
+			r /= n;
+			g /= n;
+			b /= n;
+			uPlane[cy * cw + cx] = (-43 * r - 85 * g + 128 * b + 32768 + 128) >> 8;
+			vPlane[cy * cw + cx] = (128 * r - 107 * g - 21 * b + 32768 + 128) >> 8;
+		}
+	}
+
+	return fwrite("FRAME\n", 1, 6, fp) == 6 && fwrite(yuv, 1, size, fp) == size;
+}
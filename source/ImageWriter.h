@@ -0,0 +1,32 @@
+/*
+ *	ImageWriter.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef IMAGEWRITER_H_
+#define IMAGEWRITER_H_
+#include <stdio.h>
+#include <vector>
+using namespace std;
+
+//Images are tightly packed RGB, top row first
+bool	writePPM(const char* fileName, const unsigned char* rgb, int width, int height);
+bool	readPPM(const char* fileName, vector<unsigned char>& rgb, int& width, int& height);
+bool	writePNG(const char* fileName, const unsigned char* rgb, int width, int height);
+
+//the same, building the file in scratch, which is kept for the next
+bool	writePNG(const char* fileName, const unsigned char* rgb, int width, int height, vector<unsigned char>& scratch);
+
+//YUV4MPEG2 video, 4:2:0 with full range BT.601 colour, which ffmpeg and
+//most players open as is. The header goes once at the start of the
+//file, then each frame is converted through yuv, width * height * 3 / 2
+//bytes (rounded up for odd sizes) of scratch.
+bool	writeY4MHeader(FILE* fp, int width, int height, int fps);
+bool	writeY4MFrame(FILE* fp, const unsigned char* rgb, int width, int height, unsigned char* yuv);
+int		getY4MFrameSize(int width, int height);
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ *	InputQueue.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef INPUTQUEUE_H_
+#define INPUTQUEUE_H_
+#include <atomic>
+using namespace std;
+
+enum InputType
+{
+	INPUT_KEY_DOWN,
+	INPUT_KEY_UP,
+	INPUT_MOUSE_BUTTON		//key went down if dx, else up; motion is in MouseInput
+};
+
+//A single timestamped input event
+struct InputEvent
+{
+	int type;
+	int key;
+	int dx, dy;
+	long long time;
+};
+
+//Lock-free queue from the GLUT thread, which pushes events as they
+//arrive, to the simulation thread, which pops them at the start of a tick.
+//Only one thread may push and only one may pop.
+class InputQueue
+{
+public:
+	InputQueue(void) : head(0), tail(0), dropped(0) {}
+
+	bool push(const InputEvent& e)
+	{
+		unsigned int t = tail.load(memory_order_relaxed);
+
+		//full, the simulation has stalled
+		if(t - head.load(memory_order_acquire) == SIZE){
+			dropped.fetch_add(1, memory_order_relaxed);
+			return false;
+		}
+		events[t % SIZE] = e;
+		tail.store(t + 1, memory_order_release);
+		return true;
+	}
+
+	bool pop(InputEvent& e)
+	{
+		unsigned int h = head.load(memory_order_relaxed);
+
+		if(h == tail.load(memory_order_acquire)){
+			return false;
+		}
+		e = events[h % SIZE];
+		head.store(h + 1, memory_order_release);
+		return true;
+	}
+
+	int getDropped(void)
+	{
+		return dropped.load(memory_order_relaxed);
+	}
+
+private:
+	static const unsigned int SIZE = 1024;
+
+	InputEvent events[SIZE];
+	atomic<unsigned int> head;			//next event to pop
+	atomic<unsigned int> tail;			//next free slot
+	atomic<int> dropped;
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ *	JobSystem.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	A small work-stealing job scheduler. Each worker thread owns a queue of
+	jobs; it works from the bottom of its own queue and, once that is empty,
+	steals from the top of the other workers' queues. Threads outside the
+	pool submit into a shared queue and help out while they wait on a
+	counter. FrameGraph builds on top of this to run the passes of a frame
+	as soon as their dependencies are satisfied.
+ */
+
+#include <stdio.h>
+#include "JobSystem.h"
+#include "Timer.h"
+#include "Trace.h"
+
+//worker the current thread belongs to, NULL outside the pool
+static thread_local void* currentWorker = NULL;
+
+JobSystem::JobSystem(int count)
+			: lastSample(nowNanos()),
+			  numInjected(0),
+			  pending(0),
+			  sleeping(0),
+			  quit(false)
+{
+	//default to one worker per spare core
+	if(count <= 0){
+		count = (int)thread::hardware_concurrency() - 1;
+		if(count < 0){
+			count = 0;
+		}
+	}
+	numWorkers = count;
+
+	workers = new Worker[numWorkers > 0 ? numWorkers : 1];
+	for(int i = 0; i < numWorkers; i++){
+		Worker* w = &workers[i];
+		w->owner = this;
+		w->index = i;
+		w->queue.lock.clear();
+		w->queue.jobs.resize(QUEUE_SIZE);
+		w->queue.top = 0;
+		w->queue.bottom = 0;
+		w->busyNanos = 0;
+		w->lastBusy = 0;
+		w->utilization = 0;
+	}
+
+	//start the threads once every queue is ready to be stolen from
+	for(int i = 0; i < numWorkers; i++){
+		workers[i].handle = thread(&JobSystem::workerLoop, this, &workers[i]);
+	}
+}
+
+JobSystem::~JobSystem(void)
+{
+	quit = true;
+	{
+		lock_guard<mutex> lock(sleepMutex);
+		wake.notify_all();
+	}
+
+	for(int i = 0; i < numWorkers; i++){
+		workers[i].handle.join();
+	}
+	delete [] workers;
+}
+
+int JobSystem::getWorkerCount(void)
+{
+	return numWorkers;
+}
+
+void JobSystem::run(JobFunc func, void* data, int begin, int end, JobCounter* counter)
+{
+	Job job = { func, data, begin, end, counter };
+
+	if(counter){
+		counter->count++;
+	}
+	submit(&job, 1);
+}
+
+void JobSystem::submit(const Job* jobs, int count)
+{
+	Worker* self = (Worker*)currentWorker;
+
+	pending += count;
+
+	if(self && self->owner == this){
+		for(int i = 0; i < count; i++){
+			//queue is full, do the work now instead
+			if(!push(self->queue, jobs[i])){
+				pending--;
+				execute(jobs[i]);
+			}
+		}
+	}
+	else {
+		lock_guard<mutex> lock(injectMutex);
+		injected.insert(injected.end(), jobs, jobs + count);
+		numInjected += count;
+	}
+
+	if(sleeping > 0){
+		lock_guard<mutex> lock(sleepMutex);
+		wake.notify_all();
+	}
+}
+
+void JobSystem::wait(JobCounter* counter)
+{
+	Worker* self = (Worker*)currentWorker;
+	int index = (self && self->owner == this) ? self->index : -1;
+	Job job;
+
+	//help with outstanding work instead of blocking
+	while(counter->count.load(memory_order_acquire) > 0){
+		if(findJob(index, job)){
+			execute(job);
+		}
+		else {
+			this_thread::yield();
+		}
+	}
+}
+
+bool JobSystem::push(WorkQueue& q, const Job& job)
+{
+	bool ok = false;
+
+	while(q.lock.test_and_set(memory_order_acquire));
+	if(q.bottom - q.top < (unsigned int)QUEUE_SIZE){
+		q.jobs[q.bottom % QUEUE_SIZE] = job;
+		q.bottom++;
+		ok = true;
+	}
+	q.lock.clear(memory_order_release);
+
+	return ok;
+}
+
+bool JobSystem::pop(WorkQueue& q, Job& job)
+{
+	bool ok = false;
+
+	while(q.lock.test_and_set(memory_order_acquire));
+	if(q.bottom != q.top){
+		q.bottom--;
+		job = q.jobs[q.bottom % QUEUE_SIZE];
+		ok = true;
+	}
+	q.lock.clear(memory_order_release);
+
+	return ok;
+}
+
+bool JobSystem::steal(WorkQueue& q, Job& job)
+{
+	bool ok = false;
+
+	//don't fight the owner or another thief for the lock
+	if(q.lock.test_and_set(memory_order_acquire)){
+		return false;
+	}
+	if(q.bottom != q.top){
+		job = q.jobs[q.top % QUEUE_SIZE];
+		q.top++;
+		ok = true;
+	}
+	q.lock.clear(memory_order_release);
+
+	return ok;
+}
+
+bool JobSystem::findJob(int self, Job& job)
+{
+	//own queue first, newest job is the one most likely still in cache
+	if(self >= 0 && pop(workers[self].queue, job)){
+		pending--;
+		return true;
+	}
+
+	//then anything submitted from outside the pool
+	if(numInjected > 0){
+		lock_guard<mutex> lock(injectMutex);
+		if(!injected.empty()){
+			job = injected.back();
+			injected.pop_back();
+			numInjected--;
+			pending--;
+			return true;
+		}
+	}
+
+	//then steal, starting with the next worker along
+	for(int i = 1; i <= numWorkers; i++){
+		int victim = (self + i + numWorkers) % numWorkers;
+		if(victim != self && steal(workers[victim].queue, job)){
+			pending--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(const Job& job)
+{
+	job.func(job.data, job.begin, job.end);
+
+	if(job.counter){
+		job.counter->count.fetch_sub(1, memory_order_release);
+	}
+}
+
+void JobSystem::workerLoop(Worker* w)
+{
+	Job job;
+	int idle = 0;
+	long long start;
+	char name[16];
+
+	currentWorker = w;
+	sprintf(name, "worker %i", w->index);
+	traceThreadName(name);
+
+	while(!quit){
+		if(findJob(w->index, job)){
+			start = nowNanos();
+			execute(job);
+			w->busyNanos += nowNanos() - start;
+			idle = 0;
+		}
+		else if(++idle < 64){
+			this_thread::yield();
+		}
+		else {
+			//nothing to do for a while, sleep until work is submitted
+			unique_lock<mutex> lock(sleepMutex);
+			sleeping++;
+			while(pending <= 0 && !quit){
+				wake.wait(lock);
+			}
+			sleeping--;
+			idle = 0;
+		}
+	}
+}
+
+void JobSystem::sampleUtilization(void)
+{
+	long long now = nowNanos();
+	long long elapsed = now - lastSample;
+	long long busy;
+
+	if(elapsed <= 0){
+		return;
+	}
+
+	for(int i = 0; i < numWorkers; i++){
+		busy = workers[i].busyNanos;
+		workers[i].utilization = (float)(busy - workers[i].lastBusy) / elapsed;
+		workers[i].lastBusy = busy;
+	}
+	lastSample = now;
+}
+
+float JobSystem::getUtilization(int worker)
+{
+	if(worker < 0 || worker >= numWorkers){
+		return 0;
+	}
+	return workers[worker].utilization;
+}
+
+
+//Frame graph
+FrameGraph::FrameGraph(JobSystem* jobSystem)
+{
+	jobs = jobSystem;
+}
+
+FrameGraph::~FrameGraph(void)
+{
+	for(unsigned int i = 0; i < passes.size(); i++){
+		delete passes[i];
+	}
+}
+
+int FrameGraph::addPass(const char* name, JobFunc func, void* data)
+{
+	Pass* p = new Pass;
+
+	p->name = name;
+	p->func = func;
+	p->data = data;
+	p->numDependencies = 0;
+	p->waitingOn = 0;
+	p->millis = 0;
+	p->graph = this;
+	passes.push_back(p);
+
+	return passes.size() - 1;
+}
+
+void FrameGraph::addDependency(int before, int after)
+{
+	passes[before]->successors.push_back(after);
+	passes[after]->numDependencies++;
+}
+
+void FrameGraph::execute(void)
+{
+	for(unsigned int i = 0; i < passes.size(); i++){
+		passes[i]->waitingOn = passes[i]->numDependencies;
+	}
+
+	//kick off every pass without dependencies, the rest follow on
+	for(unsigned int i = 0; i < passes.size(); i++){
+		if(passes[i]->numDependencies == 0){
+			jobs->run(runPass, passes[i], 0, 0, &done);
+		}
+	}
+
+	jobs->wait(&done);
+}
+
+void FrameGraph::runPass(void* data, int begin, int end)
+{
+	Pass* p = (Pass*)data;
+	FrameGraph* g = p->graph;
+	long long start = nowNanos();
+
+	{
+		TRACE_ZONE(p->name);
+		p->func(p->data, 0, 0);
+	}
+	p->millis = (nowNanos() - start) / 1000000.0;
+
+	//successors are queued before this pass is counted as done, so the
+	//graph can't appear finished while work is still to come
+	for(unsigned int i = 0; i < p->successors.size(); i++){
+		Pass* next = g->passes[p->successors[i]];
+		if(--next->waitingOn == 0){
+			g->jobs->run(runPass, next, 0, 0, &g->done);
+		}
+	}
+}
+
+int FrameGraph::getPassCount(void)
+{
+	return passes.size();
+}
+
+const char* FrameGraph::getPassName(int pass)
+{
+	return passes[pass]->name;
+}
+
+double FrameGraph::getPassTime(int pass)
+{
+	return passes[pass]->millis;
+}
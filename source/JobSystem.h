@@ -0,0 +1,185 @@
+/*
+ *	JobSystem.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+//A job runs func over the index range [begin, end)
+typedef void (*JobFunc)(void* data, int begin, int end);
+
+//Counts outstanding jobs; wait() on it returns once it reaches zero
+struct JobCounter
+{
+	atomic<int> count;
+
+	JobCounter() : count(0) {}
+};
+
+struct Job
+{
+	JobFunc func;
+	void* data;
+	int begin, end;
+	JobCounter* counter;
+};
+
+class JobSystem
+{
+public:
+			JobSystem(int numWorkers);
+			~JobSystem(void);
+	void	run(JobFunc func, void* data, int begin, int end, JobCounter* counter);
+	void	wait(JobCounter* counter);
+	int		getWorkerCount(void);
+	void	sampleUtilization(void);
+	float	getUtilization(int worker);
+
+	//splits [begin, end) into chunks of at least grain indices and runs
+	//body(first, last) on each, returning when all chunks are done
+	template<class F>
+	void	parallelFor(int begin, int end, int grain, F& body);
+
+private:
+	//per-worker double ended queue: the owner pushes and pops at the
+	//bottom, idle workers steal from the top
+	struct WorkQueue
+	{
+		atomic_flag lock;
+		vector<Job> jobs;
+		unsigned int top, bottom;
+	};
+
+	struct Worker
+	{
+		JobSystem* owner;
+		int index;
+		WorkQueue queue;
+		atomic<long long> busyNanos;
+		long long lastBusy;
+		float utilization;
+		thread handle;
+	};
+
+	void	submit(const Job* jobs, int count);
+	bool	push(WorkQueue& q, const Job& job);
+	bool	pop(WorkQueue& q, Job& job);
+	bool	steal(WorkQueue& q, Job& job);
+	bool	findJob(int self, Job& job);
+	void	execute(const Job& job);
+	void	workerLoop(Worker* w);
+
+	template<class F>
+	static void forChunk(void* data, int begin, int end);
+
+	Worker* workers;
+	int numWorkers;
+	long long lastSample;
+
+	//jobs submitted from threads outside the pool
+	mutex injectMutex;
+	vector<Job> injected;
+	atomic<int> numInjected;
+
+	//idle workers sleep here until work arrives
+	mutex sleepMutex;
+	condition_variable wake;
+	atomic<int> pending;
+	atomic<int> sleeping;
+	atomic<bool> quit;
+
+	static const int QUEUE_SIZE = 4096;
+	static const int MAX_CHUNKS = 64;
+};
+
+template<class F>
+void JobSystem::forChunk(void* data, int begin, int end)
+{
+	(*(F*)data)(begin, end);
+}
+
+template<class F>
+void JobSystem::parallelFor(int begin, int end, int grain, F& body)
+{
+	int count = end - begin;
+	if(count <= 0){
+		return;
+	}
+	if(grain < 1){
+		grain = 1;
+	}
+
+	//a few chunks per worker (and the caller) unless the range is too small
+	int chunks = (numWorkers + 1) * 4;
+	if(chunks > MAX_CHUNKS){
+		chunks = MAX_CHUNKS;
+	}
+	if(count / chunks < grain){
+		chunks = (count + grain - 1) / grain;
+	}
+
+	if(chunks <= 1 || numWorkers == 0){
+		body(begin, end);
+		return;
+	}
+
+	JobCounter counter;
+	Job batch[MAX_CHUNKS];
+	for(int i = 0; i < chunks; i++){
+		batch[i].func = &forChunk<F>;
+		batch[i].data = &body;
+		batch[i].begin = begin + (int)((long long)count * i / chunks);
+		batch[i].end = begin + (int)((long long)count * (i+1) / chunks);
+		batch[i].counter = &counter;
+	}
+	counter.count += chunks;
+	submit(batch, chunks);
+	wait(&counter);
+}
+
+//A frame graph is a set of passes with dependencies between them. Each
+//pass starts as soon as all passes it depends on have finished.
+class FrameGraph
+{
+public:
+			FrameGraph(JobSystem* jobs);
+			~FrameGraph(void);
+	int		addPass(const char* name, JobFunc func, void* data);
+	void	addDependency(int before, int after);
+	void	execute(void);
+	int		getPassCount(void);
+	const char*	getPassName(int pass);
+	double	getPassTime(int pass);
+
+private:
+	struct Pass
+	{
+		const char* name;
+		JobFunc func;
+		void* data;
+		vector<int> successors;
+		int numDependencies;
+		atomic<int> waitingOn;
+		double millis;
+		FrameGraph* graph;
+	};
+
+	static void runPass(void* data, int begin, int end);
+
+	JobSystem* jobs;
+	vector<Pass*> passes;
+	JobCounter done;
+};
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ *	LatencyStats.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Rolling window of latency samples. Samples are recorded from one thread
+	(typically once per frame) and percentiles are read from another, so
+	the window is guarded by a lock and percentiles are taken from a copy.
+ */
+
+#include <algorithm>
+#include "LatencyStats.h"
+
+LatencyStats::LatencyStats(void)
+			: next(0),
+			  count(0)
+{
+}
+
+void LatencyStats::record(long long nanos)
+{
+	lock_guard<mutex> guard(lock);
+
+	samples[next] = nanos;
+	next = (next + 1) % WINDOW;
+	if(count < WINDOW){
+		count++;
+	}
+}
+
+int LatencyStats::getCount(void)
+{
+	lock_guard<mutex> guard(lock);
+	return count;
+}
+
+//Returns the p-th percentile (0-100) of the window in milliseconds
+double LatencyStats::getPercentile(double p)
+{
+	lock_guard<mutex> guard(lock);
+	int k;
+
+	if(count == 0){
+		return 0;
+	}
+
+	k = (int)(p / 100 * (count - 1) + 0.5);
+	if(k < 0)
+		k = 0;
+	else if(k >= count)
+		k = count - 1;
+
+	copy(samples, samples + count, sorted);
+	nth_element(sorted, sorted + k, sorted + count);
+
+	return sorted[k] / 1000000.0;
+}
@@ -0,0 +1,34 @@
+/*
+ *	LatencyStats.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef LATENCYSTATS_H_
+#define LATENCYSTATS_H_
+#include <mutex>
+using namespace std;
+
+//Keeps the most recent latency samples and reports percentiles over them
+class LatencyStats
+{
+public:
+			LatencyStats(void);
+	void	record(long long nanos);
+	int		getCount(void);
+	double	getPercentile(double p);
+
+private:
+	static const int WINDOW = 1024;
+
+	long long samples[WINDOW];
+	long long sorted[WINDOW];
+	int next;
+	int count;
+	mutex lock;
+};
+
+#endif
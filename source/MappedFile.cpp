@@ -0,0 +1,113 @@
+/*
+ *	MappedFile.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Maps files with mmap() / MapViewOfFile() so large data such as a saved
+	world can be used where it lies. Pages are only read from disk when
+	first touched.
+ */
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(void)
+			: data(NULL),
+			  size(0)
+{
+#ifdef _WIN32
+	file = NULL;
+	mapping = NULL;
+#endif
+}
+
+MappedFile::~MappedFile(void)
+{
+	close();
+}
+
+bool MappedFile::open(const char* fileName)
+{
+	close();
+
+#ifdef _WIN32
+	LARGE_INTEGER length;
+
+	file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		file = NULL;
+		return false;
+	}
+	GetFileSizeEx(file, &length);
+	size = length.QuadPart;
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	if(mapping){
+		data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	}
+#else
+	struct stat info;
+	void* p;
+	int fd;
+
+	fd = ::open(fileName, O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	if(fstat(fd, &info) == 0 && info.st_size > 0){
+		size = info.st_size;
+		p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if(p != MAP_FAILED){
+			data = (unsigned char*)p;
+		}
+	}
+	//the mapping keeps the file open
+	::close(fd);
+#endif
+
+	if(!data){
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close(void)
+{
+#ifdef _WIN32
+	if(data)
+		UnmapViewOfFile(data);
+	if(mapping)
+		CloseHandle(mapping);
+	if(file)
+		CloseHandle(file);
+	file = NULL;
+	mapping = NULL;
+#else
+	if(data)
+		munmap(data, size);
+#endif
+	data = NULL;
+	size = 0;
+}
+
+unsigned char* MappedFile::getData(void)
+{
+	return data;
+}
+
+long long MappedFile::getSize(void)
+{
+	return size;
+}
@@ -0,0 +1,34 @@
+/*
+ *	MappedFile.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+//A whole file mapped into memory copy-on-write: it can be read and
+//written like any memory, and writes never reach the file
+class MappedFile
+{
+public:
+			MappedFile(void);
+			~MappedFile(void);
+	bool	open(const char* fileName);
+	void	close(void);
+	unsigned char*	getData(void);
+	long long	getSize(void);
+
+private:
+	unsigned char* data;
+	long long size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,255 @@
+/*
+ *	Metrics.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Counters, gauges and histograms that can be read from outside the
+	game. Recording goes to the calling thread's own shard with relaxed
+	loads and stores: no locks, no read-modify-write and no allocation,
+	so it is safe on the tick's hot paths and from worker threads.
+	Readers sum the shards and may be a sample or two behind. The
+	registry only takes its lock to register a metric; MetricsExporter
+	reads it from its own thread and serves it in Prometheus' text format.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "Metrics.h"
+
+static atomic<int> nextShard(0);
+
+int assignMetricShard(void)
+{
+	int shard = nextShard.fetch_add(1, memory_order_relaxed);
+
+	return shard < SHARED_SHARD ? shard : SHARED_SHARD;
+}
+
+Counter::Counter(void)
+{
+	for(int i = 0; i < METRIC_SHARDS; i++){
+		shards[i].value.store(0, memory_order_relaxed);
+	}
+}
+
+long long Counter::get(void)
+{
+	long long total = 0;
+
+	for(int i = 0; i < METRIC_SHARDS; i++){
+		total += shards[i].value.load(memory_order_relaxed);
+	}
+	return total;
+}
+
+Gauge::Gauge(void)
+{
+	set(0);
+}
+
+double Gauge::get(void)
+{
+	long long b = bits.load(memory_order_relaxed);
+	double value;
+
+	memcpy(&value, &b, sizeof(value));
+	return value;
+}
+
+Histogram::Histogram(void)
+			: boundCount(0)
+{
+	double zero = 0;
+	long long b;
+
+	memcpy(&b, &zero, sizeof(b));
+	for(int i = 0; i < METRIC_SHARDS; i++){
+		for(int j = 0; j <= MAX_BUCKETS; j++){
+			shards[i].counts[j].store(0, memory_order_relaxed);
+		}
+		shards[i].sumBits.store(b, memory_order_relaxed);
+	}
+}
+
+//upper bounds must be ascending; anything past the last lands in +Inf
+void Histogram::setBounds(const double* upper, int count)
+{
+	if(count > MAX_BUCKETS){
+		count = MAX_BUCKETS;
+	}
+	for(int i = 0; i < count; i++){
+		bounds[i] = upper[i];
+	}
+	boundCount = count;
+}
+
+int Histogram::getBucketCount(void)
+{
+	return boundCount + 1;
+}
+
+double Histogram::getBound(int bucket)
+{
+	return bounds[bucket];
+}
+
+long long Histogram::getCount(int bucket)
+{
+	long long total = 0;
+
+	for(int i = 0; i < METRIC_SHARDS; i++){
+		total += shards[i].counts[bucket].load(memory_order_relaxed);
+	}
+	return total;
+}
+
+double Histogram::getSum(void)
+{
+	double total = 0, sum;
+	long long b;
+
+	for(int i = 0; i < METRIC_SHARDS; i++){
+		b = shards[i].sumBits.load(memory_order_relaxed);
+		memcpy(&sum, &b, sizeof(sum));
+		total += sum;
+	}
+	return total;
+}
+
+MetricsRegistry::MetricsRegistry(void)
+			: entryCount(0),
+			  counterCount(0),
+			  gaugeCount(0),
+			  histogramCount(0)
+{
+}
+
+int MetricsRegistry::find(const char* name, MetricType type)
+{
+	int count = entryCount.load(memory_order_acquire);
+
+	for(int i = 0; i < count; i++){
+		if(entries[i].type == type && !strcmp(entries[i].name, name))
+			return entries[i].index;
+	}
+	return -1;
+}
+
+void MetricsRegistry::add(const char* name, const char* help, MetricType type, int index)
+{
+	int i = entryCount.load(memory_order_relaxed);
+
+	strncpy(entries[i].name, name, sizeof(entries[i].name) - 1);
+	entries[i].name[sizeof(entries[i].name) - 1] = 0;
+	strncpy(entries[i].help, help, sizeof(entries[i].help) - 1);
+	entries[i].help[sizeof(entries[i].help) - 1] = 0;
+	entries[i].type = type;
+	entries[i].index = index;
+	entryCount.store(i + 1, memory_order_release);
+}
+
+Counter* MetricsRegistry::counter(const char* name, const char* help)
+{
+	lock_guard<mutex> guard(lock);
+	int i = find(name, METRIC_COUNTER);
+
+	if(i < 0){
+		if(counterCount == MAX_COUNTERS){
+			return &counters[MAX_COUNTERS];
+		}
+		i = counterCount++;
+		add(name, help, METRIC_COUNTER, i);
+	}
+	return &counters[i];
+}
+
+Gauge* MetricsRegistry::gauge(const char* name, const char* help)
+{
+	lock_guard<mutex> guard(lock);
+	int i = find(name, METRIC_GAUGE);
+
+	if(i < 0){
+		if(gaugeCount == MAX_GAUGES){
+			return &gauges[MAX_GAUGES];
+		}
+		i = gaugeCount++;
+		add(name, help, METRIC_GAUGE, i);
+	}
+	return &gauges[i];
+}
+
+Histogram* MetricsRegistry::histogram(const char* name, const char* help, const double* bounds, int count)
+{
+	lock_guard<mutex> guard(lock);
+	int i = find(name, METRIC_HISTOGRAM);
+
+	if(i < 0){
+		if(histogramCount == MAX_HISTOGRAMS){
+			return &histograms[MAX_HISTOGRAMS];
+		}
+		i = histogramCount++;
+		histograms[i].setBounds(bounds, count);
+		add(name, help, METRIC_HISTOGRAM, i);
+	}
+	return &histograms[i];
+}
+
+//snprintf onto the end of buffer, counting what didn't fit so the caller
+//can grow it and try again
+static void append(char* buffer, int size, int& length, const char* format, ...)
+{
+	va_list args;
+	int room = length < size ? size - length : 0;
+
+	va_start(args, format);
+	length += vsnprintf(room ? buffer + length : NULL, room, format, args);
+	va_end(args);
+}
+
+int MetricsRegistry::format(char* buffer, int size)
+{
+	int count = entryCount.load(memory_order_acquire);
+	static const char* typeNames[] = { "counter", "gauge", "histogram" };
+	int length = 0;
+
+	if(size > 0){
+		buffer[0] = 0;
+	}
+
+	for(int i = 0; i < count; i++){
+		const Entry& e = entries[i];
+
+		append(buffer, size, length, "# HELP %s %s\n# TYPE %s %s\n",
+			e.name, e.help, e.name, typeNames[e.type]);
+
+		switch(e.type){
+		case METRIC_COUNTER:
+			append(buffer, size, length, "%s %lld\n", e.name, counters[e.index].get());
+			break;
+		case METRIC_GAUGE:
+			append(buffer, size, length, "%s %.17g\n", e.name, gauges[e.index].get());
+			break;
+		case METRIC_HISTOGRAM: {
+			Histogram& h = histograms[e.index];
+			int buckets = h.getBucketCount();
+			long long total = 0;
+
+			//Prometheus buckets are cumulative
+			for(int b = 0; b < buckets; b++){
+				total += h.getCount(b);
+				if(b < buckets - 1)
+					append(buffer, size, length, "%s_bucket{le=\"%g\"} %lld\n", e.name, h.getBound(b), total);
+				else
+					append(buffer, size, length, "%s_bucket{le=\"+Inf\"} %lld\n", e.name, total);
+			}
+			append(buffer, size, length, "%s_sum %.17g\n%s_count %lld\n", e.name, h.getSum(), e.name, total);
+			break;
+		}
+		}
+	}
+
+	return length;
+}
@@ -0,0 +1,179 @@
+/*
+ *	Metrics.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+#include <string.h>
+#include <atomic>
+#include <mutex>
+using namespace std;
+
+//Metrics are split into shards so threads recording at the same time
+//never share a cache line. The first threads to record each get a shard
+//of their own, which only they write, so recording is a plain load and
+//store rather than a locked add; any threads past that share the last
+//shard and pay for the atomic add.
+const int METRIC_SHARDS = 16;
+const int SHARED_SHARD = METRIC_SHARDS - 1;
+
+int		assignMetricShard(void);
+
+inline int metricShard(void)
+{
+	static thread_local int shard = -1;
+
+	if(shard < 0){
+		shard = assignMetricShard();
+	}
+	return shard;
+}
+
+inline void bumpShard(atomic<long long>& value, long long n, int shard)
+{
+	if(shard != SHARED_SHARD)
+		value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+	else
+		value.fetch_add(n, memory_order_relaxed);
+}
+
+//A count that only goes up
+class Counter
+{
+public:
+			Counter(void);
+	void	add(long long n = 1)
+	{
+		int s = metricShard();
+		bumpShard(shards[s].value, n, s);
+	}
+	long long	get(void);
+
+private:
+	struct alignas(64) Shard
+	{
+		atomic<long long> value;
+	};
+
+	Shard	shards[METRIC_SHARDS];
+};
+
+//A value that is set rather than accumulated
+class Gauge
+{
+public:
+			Gauge(void);
+	void	set(double value)
+	{
+		long long bits;
+		memcpy(&bits, &value, sizeof(bits));
+		this->bits.store(bits, memory_order_relaxed);
+	}
+	double	get(void);
+
+private:
+	atomic<long long> bits;
+};
+
+//Counts observations into fixed buckets and keeps their sum
+class Histogram
+{
+public:
+	static const int MAX_BUCKETS = 16;
+
+			Histogram(void);
+	void	setBounds(const double* upper, int count);
+	void	observe(double value);
+	int		getBucketCount(void);
+	double	getBound(int bucket);
+	long long	getCount(int bucket);	//not cumulative, the last bucket is +Inf
+	double	getSum(void);
+
+private:
+	struct alignas(64) Shard
+	{
+		atomic<long long> counts[MAX_BUCKETS + 1];
+		atomic<long long> sumBits;	//a double
+	};
+
+	double	bounds[MAX_BUCKETS];
+	int		boundCount;
+	Shard	shards[METRIC_SHARDS];
+};
+
+inline void Histogram::observe(double value)
+{
+	int s = metricShard();
+	Shard& shard = shards[s];
+	long long expected = shard.sumBits.load(memory_order_relaxed);
+	long long desired;
+	double sum;
+	int b = 0;
+
+	while(b < boundCount && value > bounds[b])
+		b++;
+	bumpShard(shard.counts[b], 1, s);
+
+	do {
+		memcpy(&sum, &expected, sizeof(sum));
+		sum += value;
+		memcpy(&desired, &sum, sizeof(desired));
+		if(s != SHARED_SHARD){
+			shard.sumBits.store(desired, memory_order_relaxed);
+			break;
+		}
+	} while(!shard.sumBits.compare_exchange_weak(expected, desired, memory_order_relaxed));
+}
+
+//Every metric the process exports. Metrics are registered once at startup
+//and the pointers kept; recording through them never takes a lock. Asking
+//for a name that is already registered returns the same metric; once a
+//table is full the extras share one metric that is never exported.
+class MetricsRegistry
+{
+public:
+			MetricsRegistry(void);
+	Counter*	counter(const char* name, const char* help);
+	Gauge*		gauge(const char* name, const char* help);
+	Histogram*	histogram(const char* name, const char* help, const double* bounds, int count);
+
+	//Prometheus text format; returns the length it needed, which is more
+	//than size if the buffer was too small
+	int		format(char* buffer, int size);
+
+private:
+	enum MetricType { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM };
+
+	struct Entry
+	{
+		char name[48];
+		char help[96];
+		MetricType type;
+		int index;
+	};
+
+	static const int MAX_COUNTERS = 32;
+	static const int MAX_GAUGES = 32;
+	static const int MAX_HISTOGRAMS = 8;
+	static const int MAX_ENTRIES = MAX_COUNTERS + MAX_GAUGES + MAX_HISTOGRAMS;
+
+	int		find(const char* name, MetricType type);
+	void	add(const char* name, const char* help, MetricType type, int index);
+
+	Entry	entries[MAX_ENTRIES];
+	atomic<int> entryCount;			//published after the entry is filled in
+	Counter	counters[MAX_COUNTERS + 1];	//the last of each is the overflow
+	Gauge	gauges[MAX_GAUGES + 1];
+	Histogram histograms[MAX_HISTOGRAMS + 1];
+	int		counterCount;
+	int		gaugeCount;
+	int		histogramCount;
+	mutex	lock;					//registration only
+};
+
+#endif
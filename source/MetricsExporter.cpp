@@ -0,0 +1,165 @@
+/*
+ *	MetricsExporter.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Serves the metrics registry to anything outside the process. The
+	exporter thread waits on the listening socket with a short timeout,
+	answers each scrape with a plain HTTP/1.0 response and closes the
+	connection, and in between rewrites the dump file on its interval.
+	The file is written next to its final name and renamed over it so a
+	reader never sees half of one. Nothing here runs on the game's own
+	threads.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "MetricsExporter.h"
+#include "Timer.h"
+
+MetricsExporter::MetricsExporter(MetricsRegistry* inRegistry)
+			: registry(inRegistry),
+			  listening(false),
+			  dumpSeconds(0),
+			  text(16384),
+			  running(false)
+{
+}
+
+MetricsExporter::~MetricsExporter(void)
+{
+	stop();
+}
+
+bool MetricsExporter::listen(unsigned short port)
+{
+	listening = listener.open(port);
+	return listening;
+}
+
+unsigned short MetricsExporter::getPort(void)
+{
+	return listener.getPort();
+}
+
+void MetricsExporter::setDumpFile(const char* path, int seconds)
+{
+	dumpPath = path ? path : "";
+	dumpTemp = dumpPath + ".tmp";
+	dumpSeconds = seconds < 1 ? 1 : seconds;
+}
+
+void MetricsExporter::start(void)
+{
+	if(running || (!listening && dumpPath.empty())){
+		return;
+	}
+	running = true;
+	worker = thread(&MetricsExporter::run, this);
+}
+
+void MetricsExporter::stop(void)
+{
+	if(!running){
+		return;
+	}
+	running = false;
+	worker.join();
+
+	if(!dumpPath.empty()){
+		dump();
+	}
+}
+
+void MetricsExporter::run(void)
+{
+	long long nextDump = nowNanos();
+	TcpStream stream;
+
+	while(running){
+		if(listening){
+			if(listener.accept(stream, 100)){
+				serve(stream);
+				stream.close();
+			}
+		}
+		else {
+			sleepMillis(100);
+		}
+
+		if(!dumpPath.empty() && nowNanos() >= nextDump){
+			dump();
+			nextDump = nowNanos() + dumpSeconds * 1000000000LL;
+		}
+	}
+}
+
+//Formats the registry into text, growing it if it didn't fit
+int MetricsExporter::render(void)
+{
+	int length = registry->format(&text[0], text.size());
+
+	if(length >= (int)text.size()){
+		text.resize(length + 4096);
+		length = registry->format(&text[0], text.size());
+	}
+	return length;
+}
+
+//Answers one request. Any path but / and /metrics is a 404, and the
+//request body, if there is one, is ignored.
+void MetricsExporter::serve(TcpStream& stream)
+{
+	char request[1024];
+	char header[256];
+	int got = 0;
+	int length;
+
+	//only the request line matters, but wait for it all to arrive
+	while(got < (int)sizeof(request) - 1){
+		int n = stream.receive(request + got, sizeof(request) - 1 - got, 1000);
+		if(n <= 0)
+			break;
+		got += n;
+		request[got] = 0;
+		if(strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+			break;
+	}
+	request[got] = 0;
+
+	if(strncmp(request, "GET /metrics ", 13) && strncmp(request, "GET / ", 6)){
+		const char notFound[] = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+		stream.send(notFound, sizeof(notFound) - 1);
+		return;
+	}
+
+	length = render();
+	sprintf(header, "HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %i\r\n"
+		"Connection: close\r\n\r\n", length);
+	if(stream.send(header, strlen(header))){
+		stream.send(&text[0], length);
+	}
+}
+
+void MetricsExporter::dump(void)
+{
+	int length = render();
+	FILE* f = fopen(dumpTemp.c_str(), "wb");
+
+	if(!f){
+		return;
+	}
+	fwrite(&text[0], 1, length, f);
+	fclose(f);
+
+#ifdef _WIN32
+	//rename() won't replace an existing file on Windows
+	remove(dumpPath.c_str());
+#endif
+	rename(dumpTemp.c_str(), dumpPath.c_str());
+}
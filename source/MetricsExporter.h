@@ -0,0 +1,51 @@
+/*
+ *	MetricsExporter.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef METRICSEXPORTER_H_
+#define METRICSEXPORTER_H_
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
+#include "Net.h"
+using namespace std;
+
+//Publishes a registry from a background thread: over HTTP on a localhost
+//port for Prometheus to scrape, and/or as a text file rewritten every
+//few seconds
+class MetricsExporter
+{
+public:
+			MetricsExporter(MetricsRegistry* registry);
+			~MetricsExporter(void);
+	bool	listen(unsigned short port);	//0 picks any free port
+	unsigned short	getPort(void);
+	void	setDumpFile(const char* path, int seconds);
+	void	start(void);
+	void	stop(void);						//writes the file one last time
+
+private:
+	void	run(void);
+	void	serve(TcpStream& stream);
+	int		render(void);
+	void	dump(void);
+
+	MetricsRegistry* registry;
+	TcpListener listener;
+	bool	listening;
+	string	dumpPath;
+	string	dumpTemp;				//written first, then renamed over dumpPath
+	int		dumpSeconds;
+	vector<char> text;				//kept between renders, grows to fit
+	thread	worker;
+	atomic<bool> running;
+};
+
+#endif
@@ -0,0 +1,596 @@
+/*
+ *	MouseInput.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Mouse motion sources. Each raw source owns a reader thread that waits
+	on its device with a short timeout, so it notices when to stop, and
+	adds every batch of motion it reads to the running total. The totals
+	are only a pair of doubles under a mutex: the simulation takes them
+	once a tick, however many events came in between. XInput2 is tried
+	first where it was built in, since it needs no special permissions;
+	evdev works without an X server but needs read access to
+	/dev/input/event*. The XInput2 and raw input sources also watch the
+	game window's focus, XInput2 through focus events on its own display
+	connection and raw input by subclassing the window; evdev has no
+	window to watch, so the game falls back to the pointer leaving it.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "MouseInput.h"
+#include "Timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#endif
+#ifdef HAVE_XINPUT2
+#include <X11/Xlib.h>
+#include <X11/extensions/XInput2.h>
+#include <GL/glx.h>
+#endif
+
+//how long a reader waits for its device before checking it should stop
+static const int READ_TIMEOUT = 100;
+
+MouseInput::MouseInput(void)
+			: sumX(0),
+			  sumY(0),
+			  first(0),
+			  focused(true)
+{
+}
+
+MouseInput::~MouseInput(void)
+{
+}
+
+void MouseInput::add(double dx, double dy)
+{
+	long long now = nowNanos();
+	lock_guard<mutex> guard(lock);
+
+	if(!focused){
+		return;
+	}
+	sumX += dx;
+	sumY += dy;
+	if(!first){
+		first = now;
+	}
+}
+
+//Losing the focus also drops what came in since the last take(), which
+//may already be motion meant for another window
+void MouseInput::setFocus(bool has)
+{
+	lock_guard<mutex> guard(lock);
+
+	focused = has;
+	if(!has){
+		sumX = sumY = 0;
+		first = 0;
+	}
+}
+
+//Everything since the last call, and when the first of it came in
+bool MouseInput::take(double& dx, double& dy, long long& since)
+{
+	lock_guard<mutex> guard(lock);
+
+	dx = sumX;
+	dy = sumY;
+	since = first;
+	sumX = sumY = 0;
+	first = 0;
+	return since != 0;
+}
+
+const char*	MouseInput::getName(void)		{ return "pointer"; }
+bool		MouseInput::isRaw(void)			{ return false; }
+bool		MouseInput::trackFocus(void)	{ return false; }
+
+//A source with a thread of its own reading the device. Subclasses call
+//start() once they are set up and stop() first thing in their destructor.
+class RawMouse : public MouseInput
+{
+public:
+	RawMouse(void) : running(false) {}
+	bool	isRaw(void)		{ return true; }
+
+protected:
+	virtual void run(void) = 0;
+
+	void start(void)
+	{
+		running = true;
+		reader = thread(&RawMouse::run, this);
+	}
+
+	void stop(void)
+	{
+		running = false;
+		if(reader.joinable()){
+			reader.join();
+		}
+	}
+
+	atomic<bool> running;
+
+private:
+	thread	reader;
+};
+
+#ifdef HAVE_XINPUT2
+//XInput2 raw motion from every pointer, on a display connection of its
+//own. Raw events are unaccelerated device counts and go to the root
+//window whether or not anything has the pointer grabbed. Focus events
+//for the game window come in on the same connection.
+class XInputMouse : public RawMouse
+{
+public:
+	XInputMouse(void) : display(NULL), opcode(0), focusWindow(0), watched(0)
+	{
+		memset(relative, 0, sizeof(relative));
+	}
+
+	~XInputMouse(void)
+	{
+		stop();
+		if(display){
+			XCloseDisplay(display);
+		}
+	}
+
+	const char* getName(void)	{ return "xinput2"; }
+
+	//The reader selects the events itself; Xlib connections aren't
+	//shared between threads here
+	bool trackFocus(void)
+	{
+		focusWindow = glXGetCurrentDrawable();
+		return focusWindow != 0;
+	}
+
+	bool init(void)
+	{
+		unsigned char bits[XIMaskLen(XI_RawMotion)];
+		XIEventMask mask;
+		int event, error;
+		int major = 2, minor = 2;			//2.1 and up get raw events during grabs
+
+		display = XOpenDisplay(NULL);
+		if(!display || !XQueryExtension(display, "XInputExtension", &opcode, &event, &error) ||
+				XIQueryVersion(display, &major, &minor) != Success){
+			return false;
+		}
+
+		memset(bits, 0, sizeof(bits));
+		XISetMask(bits, XI_RawMotion);
+		mask.deviceid = XIAllMasterDevices;
+		mask.mask_len = sizeof(bits);
+		mask.mask = bits;
+		XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+		XFlush(display);
+
+		start();
+		return true;
+	}
+
+protected:
+	void run(void)
+	{
+		struct pollfd fd = { ConnectionNumber(display), POLLIN, 0 };
+		XEvent e;
+
+		while(running){
+			if(focusWindow != watched){
+				watchFocus(focusWindow);
+			}
+			if(!XPending(display) && poll(&fd, 1, READ_TIMEOUT) <= 0){
+				continue;
+			}
+			while(XPending(display)){
+				XNextEvent(display, &e);
+
+				XGenericEventCookie* cookie = &e.xcookie;
+				if(cookie->type == GenericEvent && cookie->extension == opcode &&
+						XGetEventData(display, cookie)){
+					if(cookie->evtype == XI_RawMotion){
+						motion((XIRawEvent*)cookie->data);
+					}
+					else if(cookie->evtype == XI_FocusIn || cookie->evtype == XI_FocusOut){
+						focus((XIFocusInEvent*)cookie->data);
+					}
+					XFreeEventData(display, cookie);
+				}
+			}
+		}
+	}
+
+private:
+	//Focus events from the keyboards on the game window, which belongs to
+	//the GLUT connection; any client may select events on it
+	void watchFocus(Window window)
+	{
+		unsigned char bits[XIMaskLen(XI_FocusOut)];
+		XIEventMask mask;
+
+		memset(bits, 0, sizeof(bits));
+		XISetMask(bits, XI_FocusIn);
+		XISetMask(bits, XI_FocusOut);
+		mask.deviceid = XIAllMasterDevices;
+		mask.mask_len = sizeof(bits);
+		mask.mask = bits;
+		XISelectEvents(display, window, &mask, 1);
+		XFlush(display);
+		watched = window;
+	}
+
+	//Grabs, such as the window manager's while alt-tab is held, and the
+	//focus moving to or from a child don't change which window has it
+	void focus(XIFocusInEvent* event)
+	{
+		if(event->mode == XINotifyGrab || event->mode == XINotifyUngrab ||
+				event->detail == XINotifyInferior){
+			return;
+		}
+		setFocus(event->evtype == XI_FocusIn);
+	}
+
+	//Valuators 0 and 1 are x and y; raw_values only holds the ones set
+	void motion(XIRawEvent* raw)
+	{
+		double* value = raw->raw_values;
+		double dx = 0, dy = 0;
+
+		if(!isRelative(raw->sourceid)){
+			return;
+		}
+		for(int i = 0; i < raw->valuators.mask_len * 8 && i < 2; i++){
+			if(XIMaskIsSet(raw->valuators.mask, i)){
+				if(i == 0)
+					dx = *value;
+				else
+					dy = *value;
+				value++;
+			}
+		}
+		if(dx != 0 || dy != 0){
+			add(dx, dy);
+		}
+	}
+
+	//Tablets and touchscreens report where they are, not how far they
+	//moved; each device is asked the first time it's seen
+	bool isRelative(int device)
+	{
+		if(device < 0 || device >= MAX_DEVICES){
+			return false;
+		}
+		if(!relative[device]){
+			XIDeviceInfo* info;
+			int count;
+
+			relative[device] = -1;
+			info = XIQueryDevice(display, device, &count);
+			for(int i = 0; info && i < info->num_classes; i++){
+				XIValuatorClassInfo* valuator = (XIValuatorClassInfo*)info->classes[i];
+
+				if(valuator->type == XIValuatorClass && valuator->number == 0 &&
+						valuator->mode == XIModeRelative){
+					relative[device] = 1;
+				}
+			}
+			if(info){
+				XIFreeDeviceInfo(info);
+			}
+		}
+		return relative[device] > 0;
+	}
+
+	static const int MAX_DEVICES = 256;
+
+	Display* display;
+	int		opcode;
+	atomic<Window> focusWindow;				//set by trackFocus(), 0 for none
+	Window	watched;						//the reader's selection
+	signed char relative[MAX_DEVICES];		//0 not asked yet, 1 relative, -1 not
+};
+#endif
+
+#ifdef __linux__
+//Every mouse under /dev/input read directly, with no X server involved.
+//Most systems only let the "input" group open them.
+class EvdevMouse : public RawMouse
+{
+public:
+	EvdevMouse(void) : count(0) {}
+
+	~EvdevMouse(void)
+	{
+		stop();
+		for(int i = 0; i < count; i++){
+			::close(fds[i]);
+		}
+	}
+
+	const char* getName(void)	{ return "evdev"; }
+
+	bool init(void)
+	{
+		DIR* dir = opendir("/dev/input");
+		struct dirent* entry;
+		char path[300];
+
+		if(!dir){
+			return false;
+		}
+		while((entry = readdir(dir)) && count < MAX_DEVICES){
+			if(strncmp(entry->d_name, "event", 5)){
+				continue;
+			}
+			snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+
+			int fd = ::open(path, O_RDONLY | O_NONBLOCK);
+			if(fd >= 0 && isMouse(fd))
+				fds[count++] = fd;
+			else if(fd >= 0)
+				::close(fd);
+		}
+		closedir(dir);
+
+		if(!count){
+			return false;
+		}
+		start();
+		return true;
+	}
+
+protected:
+	void run(void)
+	{
+		struct pollfd fd[MAX_DEVICES];
+		struct input_event events[64];
+
+		for(int i = 0; i < count; i++){
+			fd[i].fd = fds[i];
+			fd[i].events = POLLIN;
+			fd[i].revents = 0;
+		}
+
+		while(running){
+			if(poll(fd, count, READ_TIMEOUT) <= 0){
+				continue;
+			}
+			for(int i = 0; i < count; i++){
+				//unplugged: poll() skips negative descriptors
+				if(fd[i].revents & (POLLERR | POLLHUP | POLLNVAL)){
+					fd[i].fd = -1;
+					continue;
+				}
+				if(!(fd[i].revents & POLLIN)){
+					continue;
+				}
+
+				ssize_t bytes = read(fds[i], events, sizeof(events));
+				double dx = 0, dy = 0;
+
+				for(int k = 0; k < bytes / (ssize_t)sizeof(events[0]); k++){
+					if(events[k].type == EV_REL && events[k].code == REL_X)
+						dx += events[k].value;
+					else if(events[k].type == EV_REL && events[k].code == REL_Y)
+						dy += events[k].value;
+				}
+				if(dx != 0 || dy != 0){
+					add(dx, dy);
+				}
+			}
+		}
+	}
+
+private:
+	//Moves in x and y and has a left button, so not a wheel or a joystick
+	static bool isMouse(int fd)
+	{
+		const int LONG_BITS = 8 * sizeof(long);
+		unsigned long rel[REL_MAX / LONG_BITS + 1];
+		unsigned long key[KEY_MAX / LONG_BITS + 1];
+
+		memset(rel, 0, sizeof(rel));
+		memset(key, 0, sizeof(key));
+		if(ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel)), rel) < 0 ||
+				ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key)), key) < 0){
+			return false;
+		}
+		return (rel[REL_X / LONG_BITS] >> (REL_X % LONG_BITS) & 1) &&
+			   (rel[REL_Y / LONG_BITS] >> (REL_Y % LONG_BITS) & 1) &&
+			   (key[BTN_LEFT / LONG_BITS] >> (BTN_LEFT % LONG_BITS) & 1);
+	}
+
+	static const int MAX_DEVICES = 16;
+
+	int		fds[MAX_DEVICES];
+	int		count;
+};
+#endif
+
+#ifdef _WIN32
+//WM_INPUT from every mouse, sent to a message-only window the reader
+//thread makes for itself. That window never has the focus, so it needs
+//RIDEV_INPUTSINK, which sends it input whatever is in the foreground,
+//the game or not; setFocus() is what keeps other windows' motion out,
+//called from the game window's own WM_ACTIVATEAPP and focus messages.
+class WindowsMouse : public RawMouse
+{
+public:
+	WindowsMouse(void) : window(NULL), status(0), gameWindow(NULL) {}
+
+	~WindowsMouse(void)
+	{
+		stop();
+		if(gameWindow && IsWindow(gameWindow)){
+			SetWindowLongPtrA(gameWindow, GWLP_WNDPROC, (LONG_PTR)gameProc);
+		}
+		focusMouse = NULL;
+	}
+
+	const char* getName(void)	{ return "rawinput"; }
+
+	//Subclasses the game window; its messages arrive on the thread that
+	//made it, which is the one calling this
+	bool trackFocus(void)
+	{
+		HDC dc = wglGetCurrentDC();
+
+		gameWindow = dc ? WindowFromDC(dc) : NULL;
+		if(!gameWindow || focusMouse){
+			gameWindow = NULL;
+			return false;
+		}
+		focusMouse = this;
+		gameProc = (WNDPROC)SetWindowLongPtrA(gameWindow, GWLP_WNDPROC, (LONG_PTR)focusProc);
+		return gameProc != NULL;
+	}
+
+	//the window has to be made on the thread that reads its messages
+	bool init(void)
+	{
+		start();
+		while(status == 0){
+			Sleep(1);
+		}
+		if(status < 0){
+			stop();
+			return false;
+		}
+		return true;
+	}
+
+protected:
+	void run(void)
+	{
+		WNDCLASSA windowClass;
+		RAWINPUTDEVICE device;
+		MSG msg;
+
+		memset(&windowClass, 0, sizeof(windowClass));
+		windowClass.lpfnWndProc = DefWindowProcA;
+		windowClass.hInstance = GetModuleHandleA(NULL);
+		windowClass.lpszClassName = "AotoRawMouse";
+		RegisterClassA(&windowClass);
+		window = CreateWindowA(windowClass.lpszClassName, "", 0, 0, 0, 0, 0,
+			HWND_MESSAGE, NULL, windowClass.hInstance, NULL);
+
+		device.usUsagePage = 0x01;			//generic desktop
+		device.usUsage = 0x02;				//mouse
+		device.dwFlags = RIDEV_INPUTSINK;
+		device.hwndTarget = window;
+		if(!window || !RegisterRawInputDevices(&device, 1, sizeof(device))){
+			if(window){
+				DestroyWindow(window);
+			}
+			status = -1;
+			return;
+		}
+		status = 1;
+
+		while(running){
+			MsgWaitForMultipleObjects(0, NULL, FALSE, READ_TIMEOUT, QS_ALLINPUT);
+			while(PeekMessageA(&msg, window, 0, 0, PM_REMOVE)){
+				if(msg.message == WM_INPUT){
+					motion((HRAWINPUT)msg.lParam);
+				}
+				DispatchMessageA(&msg);
+			}
+		}
+
+		device.dwFlags = RIDEV_REMOVE;
+		device.hwndTarget = NULL;
+		RegisterRawInputDevices(&device, 1, sizeof(device));
+		DestroyWindow(window);
+	}
+
+private:
+	void motion(HRAWINPUT handle)
+	{
+		RAWINPUT input;
+		UINT size = sizeof(input);
+
+		if(GetRawInputData(handle, RID_INPUT, &input, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1 ||
+				input.header.dwType != RIM_TYPEMOUSE ||
+				(input.data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE)){
+			return;
+		}
+		if(input.data.mouse.lLastX || input.data.mouse.lLastY){
+			add(input.data.mouse.lLastX, input.data.mouse.lLastY);
+		}
+	}
+
+	//The game window's procedure, ahead of GLUT's
+	static LRESULT CALLBACK focusProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+	{
+		if(focusMouse){
+			if(msg == WM_ACTIVATEAPP)
+				focusMouse->setFocus(wParam != FALSE);
+			else if(msg == WM_KILLFOCUS)
+				focusMouse->setFocus(false);
+			else if(msg == WM_SETFOCUS)
+				focusMouse->setFocus(true);
+		}
+		return CallWindowProcA(gameProc, hwnd, msg, wParam, lParam);
+	}
+
+	HWND	window;
+	atomic<int> status;						//0 starting, 1 reading, -1 failed
+	HWND	gameWindow;						//subclassed by trackFocus()
+
+	static WindowsMouse* focusMouse;		//the one a window procedure can't be handed
+	static WNDPROC gameProc;				//GLUT's
+};
+
+WindowsMouse* WindowsMouse::focusMouse = NULL;
+WNDPROC WindowsMouse::gameProc = NULL;
+#endif
+
+MouseInput* MouseInput::open(bool raw)
+{
+	if(raw){
+#ifdef _WIN32
+		WindowsMouse* windows = new WindowsMouse();
+		if(windows->init()){
+			return windows;
+		}
+		delete windows;
+#endif
+#ifdef HAVE_XINPUT2
+		XInputMouse* xinput = new XInputMouse();
+		if(xinput->init()){
+			return xinput;
+		}
+		delete xinput;
+#endif
+#ifdef __linux__
+		EvdevMouse* evdev = new EvdevMouse();
+		if(evdev->init()){
+			return evdev;
+		}
+		delete evdev;
+#endif
+	}
+	return new MouseInput();
+}
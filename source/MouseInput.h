@@ -0,0 +1,50 @@
+/*
+ *	MouseInput.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef MOUSEINPUT_H_
+#define MOUSEINPUT_H_
+#include <mutex>
+using namespace std;
+
+//Relative mouse motion, added up between simulation ticks. The plain
+//source is fed by whoever watches the pointer, the GLUT thread. open()
+//looks for a raw source first, which reads motion straight from the
+//device on a thread of its own (XInput2 or evdev, raw input on Windows),
+//so the pointer no longer has to be warped back to the middle of the
+//window after every event to measure how far it went. Any thread may
+//add(); only the simulation take()s.
+//
+//Raw sources see the mouse whichever window has the focus, so while the
+//game's window doesn't have it motion is dropped instead of added up.
+//trackFocus() has the source follow the window's own focus events
+//(XInput2, raw input); where it can't, whoever watches the window calls
+//setFocus() instead.
+class MouseInput
+{
+public:
+				MouseInput(void);
+	virtual		~MouseInput(void);
+	virtual const char*	getName(void);
+	virtual bool		isRaw(void);		//motion doesn't come from the pointer
+	virtual bool		trackFocus(void);	//of the window whose GL context is current, false if it can't
+
+	void		add(double dx, double dy);
+	void		setFocus(bool has);		//false drops motion until it is true again
+	bool		take(double& dx, double& dy, long long& since);	//false if it hasn't moved
+
+	static MouseInput*	open(bool raw);		//the first raw source that works, else plain
+
+private:
+	mutex		lock;
+	double		sumX, sumY;
+	long long	first;						//when the oldest motion not taken came in
+	bool		focused;
+};
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ *	Net.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Thin wrapper over BSD sockets / Winsock for the server and its clients.
+	UDP sockets never block: receive() returns straight away when no
+	datagram is waiting, the caller polls once per tick. The TCP listener
+	is for the metrics exporter, it only binds to the loopback interface
+	and waits with a timeout so its thread can notice it should stop.
+ */
+
+#include <string.h>
+#include "Net.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#pragma comment(lib,"ws2_32.lib")
+typedef int socklen_t;
+static const long long NO_SOCKET = (long long)INVALID_SOCKET;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <errno.h>
+#include <unistd.h>
+static const long long NO_SOCKET = -1;
+#endif
+
+//A peer that hangs up mid send must not raise SIGPIPE, which would kill
+//the game or server; the send fails with EPIPE instead. Where there's no
+//MSG_NOSIGNAL (macOS) the accepted socket gets SO_NOSIGPIPE.
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+//Winsock has to be started before the first socket is made
+static void initSockets(void)
+{
+#ifdef _WIN32
+	static bool started = false;
+	WSADATA data;
+
+	if(!started){
+		WSAStartup(MAKEWORD(2, 2), &data);
+		started = true;
+	}
+#endif
+}
+
+static void closeHandle(long long handle)
+{
+#ifdef _WIN32
+	closesocket(handle);
+#else
+	::close(handle);
+#endif
+}
+
+//True once the socket has something to read, or a connection to accept
+static bool waitReadable(long long handle, int timeoutMillis)
+{
+	fd_set set;
+	struct timeval tv;
+
+	FD_ZERO(&set);
+	FD_SET(handle, &set);
+	tv.tv_sec = timeoutMillis / 1000;
+	tv.tv_usec = (timeoutMillis % 1000) * 1000;
+
+	return select((int)handle + 1, &set, NULL, NULL, &tv) > 0;
+}
+
+NetAddress makeAddress(const char* host, unsigned short port)
+{
+	NetAddress a = { 0, port };
+	struct hostent* he;
+
+	initSockets();
+	he = gethostbyname(host);
+	if(he && he->h_addrtype == AF_INET){
+		unsigned int ip;
+		memcpy(&ip, he->h_addr_list[0], sizeof(ip));
+		a.host = ntohl(ip);
+	}
+	return a;
+}
+
+UdpSocket::UdpSocket(void)
+			: handle(NO_SOCKET),
+			  port(0)
+{
+	initSockets();
+}
+
+UdpSocket::~UdpSocket(void)
+{
+	close();
+}
+
+bool UdpSocket::open(unsigned short inPort)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int bufferSize = 1 << 20;
+
+	close();
+	handle = (long long)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(handle == NO_SOCKET){
+		return false;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(inPort);
+	if(bind(handle, (struct sockaddr*)&addr, sizeof(addr)) != 0){
+		close();
+		return false;
+	}
+	getsockname(handle, (struct sockaddr*)&addr, &len);
+	port = ntohs(addr.sin_port);
+
+	//a server takes a burst of inputs from every client each tick
+	setsockopt(handle, SOL_SOCKET, SO_RCVBUF, (const char*)&bufferSize, sizeof(bufferSize));
+	setsockopt(handle, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferSize, sizeof(bufferSize));
+
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+	fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	return true;
+}
+
+void UdpSocket::close(void)
+{
+	if(handle != NO_SOCKET){
+		closeHandle(handle);
+		handle = NO_SOCKET;
+	}
+}
+
+unsigned short UdpSocket::getPort(void)
+{
+	return port;
+}
+
+bool UdpSocket::send(const NetAddress& to, const void* data, int size)
+{
+	struct sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(to.host);
+	addr.sin_port = htons(to.port);
+
+	return sendto(handle, (const char*)data, size, 0, (struct sockaddr*)&addr, sizeof(addr)) == size;
+}
+
+int UdpSocket::receive(NetAddress& from, void* buffer, int size)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int got;
+
+	got = recvfrom(handle, (char*)buffer, size, 0, (struct sockaddr*)&addr, &len);
+	if(got < 0){
+		return -1;
+	}
+	from.host = ntohl(addr.sin_addr.s_addr);
+	from.port = ntohs(addr.sin_port);
+
+	return got;
+}
+
+TcpStream::TcpStream(void)
+			: handle(NO_SOCKET)
+{
+}
+
+TcpStream::~TcpStream(void)
+{
+	close();
+}
+
+void TcpStream::close(void)
+{
+	if(handle != NO_SOCKET){
+		closeHandle(handle);
+		handle = NO_SOCKET;
+	}
+}
+
+bool TcpStream::send(const void* data, int size)
+{
+	const char* p = (const char*)data;
+	int sent;
+
+	while(size > 0){
+		sent = ::send(handle, p, size, SEND_FLAGS);
+#ifndef _WIN32
+		if(sent < 0 && errno == EINTR){
+			continue;
+		}
+#endif
+		//EPIPE or a reset: the other end closed the connection
+		if(sent <= 0){
+			return false;
+		}
+		p += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+int TcpStream::receive(void* buffer, int size, int timeoutMillis)
+{
+	if(!waitReadable(handle, timeoutMillis)){
+		return -1;
+	}
+	return recv(handle, (char*)buffer, size, 0);
+}
+
+TcpListener::TcpListener(void)
+			: handle(NO_SOCKET),
+			  port(0)
+{
+	initSockets();
+}
+
+TcpListener::~TcpListener(void)
+{
+	close();
+}
+
+bool TcpListener::open(unsigned short inPort)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int reuse = 1;
+
+	close();
+	handle = (long long)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(handle == NO_SOCKET){
+		return false;
+	}
+
+	//a restarted game shouldn't have to wait for the old port to expire
+	setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(inPort);
+	if(bind(handle, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(handle, 4) != 0){
+		close();
+		return false;
+	}
+	getsockname(handle, (struct sockaddr*)&addr, &len);
+	port = ntohs(addr.sin_port);
+
+	return true;
+}
+
+void TcpListener::close(void)
+{
+	if(handle != NO_SOCKET){
+		closeHandle(handle);
+		handle = NO_SOCKET;
+	}
+}
+
+unsigned short TcpListener::getPort(void)
+{
+	return port;
+}
+
+bool TcpListener::accept(TcpStream& stream, int timeoutMillis)
+{
+	long long accepted;
+
+	if(handle == NO_SOCKET || !waitReadable(handle, timeoutMillis)){
+		return false;
+	}
+	accepted = (long long)::accept(handle, NULL, NULL);
+	if(accepted == NO_SOCKET){
+		return false;
+	}
+
+#ifdef SO_NOSIGPIPE
+	int on = 1;
+	setsockopt(accepted, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+	stream.close();
+	stream.handle = accepted;
+	return true;
+}
@@ -0,0 +1,76 @@
+/*
+ *	Net.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef NET_H_
+#define NET_H_
+
+//IPv4 address and port, both in host byte order
+struct NetAddress
+{
+	unsigned int host;
+	unsigned short port;
+
+	bool operator==(const NetAddress& a) const
+	{
+		return host == a.host && port == a.port;
+	}
+};
+
+NetAddress	makeAddress(const char* host, unsigned short port);
+
+//Non-blocking UDP socket
+class UdpSocket
+{
+public:
+			UdpSocket(void);
+			~UdpSocket(void);
+	bool	open(unsigned short port);		//0 picks any free port
+	void	close(void);
+	unsigned short	getPort(void);
+	bool	send(const NetAddress& to, const void* data, int size);
+	int		receive(NetAddress& from, void* buffer, int size);	//-1 if nothing waiting
+
+private:
+	long long handle;
+	unsigned short port;
+};
+
+//Blocking TCP connection, for short request/response exchanges
+class TcpStream
+{
+	friend class TcpListener;
+
+public:
+			TcpStream(void);
+			~TcpStream(void);
+	void	close(void);
+	bool	send(const void* data, int size);
+	int		receive(void* buffer, int size, int timeoutMillis);	//-1 on timeout or error, 0 once closed
+
+private:
+	long long handle;
+};
+
+//TCP socket listening on 127.0.0.1 only
+class TcpListener
+{
+public:
+			TcpListener(void);
+			~TcpListener(void);
+	bool	open(unsigned short port);		//0 picks any free port
+	void	close(void);
+	unsigned short	getPort(void);
+	bool	accept(TcpStream& stream, int timeoutMillis);	//false if nobody connected in time
+
+private:
+	long long handle;
+	unsigned short port;
+};
+
+#endif
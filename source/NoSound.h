@@ -0,0 +1,48 @@
+/*
+ *	NoSound.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef NOSOUND_H_
+#define NOSOUND_H_
+
+//Stands in for the FMOD 3 calls the game makes when it is built without
+//FMOD (NO_FMOD, see CMakeLists.txt): nothing loads, every call does
+//nothing, and the game plays silently.
+
+struct FSOUND_STREAM;
+struct FSOUND_SAMPLE;
+
+const int FSOUND_FREE = -1;
+const int FSOUND_OUTPUT_DSOUND = 0;
+const int FSOUND_MIXER_AUTODETECT = 0;
+const unsigned int FSOUND_LOOP_NORMAL = 2;
+
+inline signed char	FSOUND_SetOutput(int)						{ return 1; }
+inline signed char	FSOUND_SetDriver(int)						{ return 1; }
+inline signed char	FSOUND_SetMixer(int)						{ return 1; }
+inline signed char	FSOUND_Init(int, int, unsigned int)			{ return 1; }
+inline void			FSOUND_Close(void)							{}
+inline void			FSOUND_Update(void)							{}
+inline signed char	FSOUND_SetVolume(int, int)					{ return 1; }
+inline signed char	FSOUND_SetPaused(int, signed char)			{ return 1; }
+inline int			FSOUND_PlaySound(int, FSOUND_SAMPLE*)		{ return -1; }
+inline int			FSOUND_PlaySoundEx(int, FSOUND_SAMPLE*, void*, signed char)	{ return -1; }
+
+inline FSOUND_SAMPLE*	FSOUND_Sample_Load(int, const char*, unsigned int, int, int)	{ return 0; }
+inline void			FSOUND_Sample_Free(FSOUND_SAMPLE*)			{}
+inline signed char	FSOUND_Sample_SetMinMaxDistance(FSOUND_SAMPLE*, float, float)	{ return 1; }
+
+inline FSOUND_STREAM*	FSOUND_Stream_Open(const char*, unsigned int, int, int)		{ return 0; }
+inline int			FSOUND_Stream_Play(int, FSOUND_STREAM*)		{ return -1; }
+inline signed char	FSOUND_Stream_SetMode(FSOUND_STREAM*, unsigned int)	{ return 1; }
+inline signed char	FSOUND_Stream_Close(FSOUND_STREAM*)			{ return 1; }
+
+inline void	FSOUND_3D_Listener_SetAttributes(const float*, const float*, float, float, float, float, float, float)	{}
+inline signed char	FSOUND_3D_SetAttributes(int, const float*, const float*)	{ return 1; }
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ *	Offscreen.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Creates a desktop GL context through EGL without any window system.
+	Mesa's surfaceless platform is preferred, which works with llvmpipe on
+	machines with no GPU at all; otherwise the default EGL display is used
+	with a tiny pbuffer. Rendering goes to a framebuffer object of the
+	requested size, which is left bound for the renderer.
+ */
+
+#include <string.h>
+#include "Offscreen.h"
+#include <GL/glext.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+//framebuffer object entry points, looked up once a context exists
+static PFNGLGENFRAMEBUFFERSPROC			genFramebuffers;
+static PFNGLBINDFRAMEBUFFERPROC			bindFramebuffer;
+static PFNGLDELETEFRAMEBUFFERSPROC		deleteFramebuffers;
+static PFNGLFRAMEBUFFERRENDERBUFFERPROC	framebufferRenderbuffer;
+static PFNGLCHECKFRAMEBUFFERSTATUSPROC	checkFramebufferStatus;
+static PFNGLGENRENDERBUFFERSPROC		genRenderbuffers;
+static PFNGLBINDRENDERBUFFERPROC		bindRenderbuffer;
+static PFNGLDELETERENDERBUFFERSPROC		deleteRenderbuffers;
+static PFNGLRENDERBUFFERSTORAGEPROC		renderbufferStorage;
+
+static bool hasExtension(const char* list, const char* name)
+{
+	const char* p = list;
+	int len = strlen(name);
+
+	while(p && (p = strstr(p, name))){
+		if((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == 0)){
+			return true;
+		}
+		p += len;
+	}
+	return false;
+}
+
+OffscreenContext::OffscreenContext(void)
+			: display(EGL_NO_DISPLAY),
+			  context(EGL_NO_CONTEXT),
+			  surface(EGL_NO_SURFACE),
+			  framebuffer(0),
+			  colorBuffer(0),
+			  depthBuffer(0),
+			  w(0),
+			  h(0)
+{
+}
+
+OffscreenContext::~OffscreenContext(void)
+{
+	destroy();
+}
+
+bool OffscreenContext::create(int width, int height, bool coreProfile)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay;
+	const char* clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	const char* displayExts;
+	EGLConfig config = NULL;
+	EGLint numConfigs = 0;
+	EGLint major, minor;
+
+	w = width;
+	h = height;
+
+	//surfaceless platform first, any display will do otherwise
+	getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(getPlatformDisplay && hasExtension(clientExts, "EGL_MESA_platform_surfaceless")){
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+	if(display == EGL_NO_DISPLAY){
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)){
+		display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	if(!eglBindAPI(EGL_OPENGL_API)){
+		destroy();
+		return false;
+	}
+
+	displayExts = eglQueryString(display, EGL_EXTENSIONS);
+
+	//a config is only needed if we can't go without one or without a surface
+	if(!hasExtension(displayExts, "EGL_KHR_no_config_context") ||
+			!hasExtension(displayExts, "EGL_KHR_surfaceless_context")){
+		EGLint attribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE };
+
+		if(!eglChooseConfig(display, attribs, &config, 1, &numConfigs) || numConfigs == 0){
+			destroy();
+			return false;
+		}
+	}
+
+	//default attributes give a compatibility profile, which the fixed
+	//function renderer needs; the core backend asks for 3.3 core
+	if(coreProfile){
+		EGLint attribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+			EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+			EGL_NONE };
+
+		if(!hasExtension(displayExts, "EGL_KHR_create_context")){
+			destroy();
+			return false;
+		}
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, attribs);
+	}
+	else {
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+	}
+	if(context == EGL_NO_CONTEXT){
+		destroy();
+		return false;
+	}
+
+	if(!hasExtension(displayExts, "EGL_KHR_surfaceless_context")){
+		EGLint attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		surface = eglCreatePbufferSurface(display, config, attribs);
+	}
+	if(!eglMakeCurrent(display, surface, surface, context)){
+		destroy();
+		return false;
+	}
+
+	genFramebuffers = (PFNGLGENFRAMEBUFFERSPROC)eglGetProcAddress("glGenFramebuffers");
+	bindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC)eglGetProcAddress("glBindFramebuffer");
+	deleteFramebuffers = (PFNGLDELETEFRAMEBUFFERSPROC)eglGetProcAddress("glDeleteFramebuffers");
+	framebufferRenderbuffer = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)eglGetProcAddress("glFramebufferRenderbuffer");
+	checkFramebufferStatus = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)eglGetProcAddress("glCheckFramebufferStatus");
+	genRenderbuffers = (PFNGLGENRENDERBUFFERSPROC)eglGetProcAddress("glGenRenderbuffers");
+	bindRenderbuffer = (PFNGLBINDRENDERBUFFERPROC)eglGetProcAddress("glBindRenderbuffer");
+	deleteRenderbuffers = (PFNGLDELETERENDERBUFFERSPROC)eglGetProcAddress("glDeleteRenderbuffers");
+	renderbufferStorage = (PFNGLRENDERBUFFERSTORAGEPROC)eglGetProcAddress("glRenderbufferStorage");
+
+	if(!genFramebuffers || !bindFramebuffer || !framebufferRenderbuffer ||
+			!checkFramebufferStatus || !genRenderbuffers || !bindRenderbuffer ||
+			!renderbufferStorage){
+		destroy();
+		return false;
+	}
+
+	//colour and depth targets the size of the "screen"
+	genRenderbuffers(1, &colorBuffer);
+	bindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+
+	genRenderbuffers(1, &depthBuffer);
+	bindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+
+	genFramebuffers(1, &framebuffer);
+	bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	if(checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE){
+		destroy();
+		return false;
+	}
+
+	glViewport(0, 0, w, h);
+	return true;
+}
+
+void OffscreenContext::destroy(void)
+{
+	if(display == EGL_NO_DISPLAY){
+		return;
+	}
+
+	if(context != EGL_NO_CONTEXT){
+		if(framebuffer){
+			deleteFramebuffers(1, &framebuffer);
+			deleteRenderbuffers(1, &colorBuffer);
+			deleteRenderbuffers(1, &depthBuffer);
+			framebuffer = colorBuffer = depthBuffer = 0;
+		}
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		context = EGL_NO_CONTEXT;
+	}
+	if(surface != EGL_NO_SURFACE){
+		eglDestroySurface(display, surface);
+		surface = EGL_NO_SURFACE;
+	}
+
+	eglTerminate(display);
+	display = EGL_NO_DISPLAY;
+}
+
+//Reads the framebuffer back as tightly packed RGB, top row first
+void OffscreenContext::readPixels(unsigned char* rgb)
+{
+	int rowSize = w * 3;
+	unsigned char* top;
+	unsigned char* bottom;
+	unsigned char tmp;
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+
+	//GL reads bottom up
+	for(int y = 0; y < h / 2; y++){
+		top = rgb + y * rowSize;
+		bottom = rgb + (h - 1 - y) * rowSize;
+		for(int x = 0; x < rowSize; x++){
+			tmp = top[x];
+			top[x] = bottom[x];
+			bottom[x] = tmp;
+		}
+	}
+}
+
+const char* OffscreenContext::getRendererName(void)
+{
+	return (const char*)glGetString(GL_RENDERER);
+}
@@ -0,0 +1,36 @@
+/*
+ *	Offscreen.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef OFFSCREEN_H_
+#define OFFSCREEN_H_
+#include <GL/gl.h>
+
+//A GL context with no window behind it, rendering into a framebuffer
+//object. Used to run the renderer on machines without a display.
+class OffscreenContext
+{
+public:
+			OffscreenContext(void);
+			~OffscreenContext(void);
+	bool	create(int width, int height, bool coreProfile = false);
+	void	destroy(void);
+	void	readPixels(unsigned char* rgb);
+	const char*	getRendererName(void);
+
+private:
+	void*	display;				//EGLDisplay
+	void*	context;				//EGLContext
+	void*	surface;				//EGLSurface, only if surfaceless is unsupported
+	GLuint	framebuffer;
+	GLuint	colorBuffer;
+	GLuint	depthBuffer;
+	int		w, h;
+};
+
+#endif
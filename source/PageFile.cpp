@@ -0,0 +1,185 @@
+/*
+ *	PageFile.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	The file grows a segment at a time and each segment is mapped on its
+	own, so adding one never moves the blocks already handed out. Blocks
+	are rounded up to a power of two and released blocks are kept on a
+	free list per size, which is all the reuse a world of chunks going in
+	and out needs. The file is unlinked as soon as it is open (deleted on
+	close on Windows), so a crash never leaves one behind.
+ */
+
+#include "PageFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+PageFile::PageFile(void)
+			: segmentUsed(SEGMENT),
+			  used(0)
+{
+#ifdef _WIN32
+	file = NULL;
+#else
+	fd = -1;
+#endif
+}
+
+PageFile::~PageFile(void)
+{
+	close();
+}
+
+bool PageFile::open(const char* fileName)
+{
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		file = NULL;
+		return false;
+	}
+#else
+	fd = ::open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		return false;
+	}
+	unlink(fileName);
+#endif
+
+	return true;
+}
+
+void PageFile::close(void)
+{
+	for(unsigned int i = 0; i < segments.size(); i++){
+#ifdef _WIN32
+		UnmapViewOfFile(segments[i]);
+		CloseHandle(mappings[i]);
+#else
+		munmap(segments[i], SEGMENT);
+#endif
+	}
+	segments.clear();
+	for(int i = 0; i < CLASSES; i++){
+		freeBlocks[i].clear();
+	}
+	segmentUsed = SEGMENT;
+	used = 0;
+
+#ifdef _WIN32
+	mappings.clear();
+	if(file)
+		CloseHandle(file);
+	file = NULL;
+#else
+	if(fd >= 0)
+		::close(fd);
+	fd = -1;
+#endif
+}
+
+//Grows the file by a segment and maps it
+bool PageFile::addSegment(void)
+{
+	unsigned long long offset = (unsigned long long)segments.size() * SEGMENT;
+	unsigned long long length = offset + SEGMENT;
+	void* p = NULL;
+
+#ifdef _WIN32
+	HANDLE mapping;
+
+	if(!file){
+		return false;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(length >> 32), (DWORD)length, NULL);
+	if(!mapping){
+		return false;
+	}
+	p = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, SEGMENT);
+	if(!p){
+		CloseHandle(mapping);
+		return false;
+	}
+	mappings.push_back(mapping);
+#else
+	if(fd < 0 || ftruncate(fd, length) != 0){
+		return false;
+	}
+	p = mmap(NULL, SEGMENT, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+	if(p == MAP_FAILED){
+		return false;
+	}
+#endif
+
+	segments.push_back((unsigned char*)p);
+	segmentUsed = 0;
+	return true;
+}
+
+void* PageFile::allocate(size_t bytes, size_t& granted)
+{
+	int c = 0;
+	void* block;
+
+	granted = MIN_BLOCK;
+	while(granted < bytes && c < CLASSES - 1){
+		granted *= 2;
+		c++;
+	}
+	if(granted < bytes){
+		return NULL;
+	}
+
+	if(!freeBlocks[c].empty()){
+		block = freeBlocks[c].back();
+		freeBlocks[c].pop_back();
+	}
+	else {
+		//whatever is left at the end of a segment too small for this
+		//block is never used
+		if(segmentUsed + granted > SEGMENT && !addSegment()){
+			return NULL;
+		}
+		block = segments.back() + segmentUsed;
+		segmentUsed += granted;
+	}
+
+	used += granted;
+	return block;
+}
+
+void PageFile::release(void* block, size_t granted)
+{
+	int c = 0;
+	size_t size = MIN_BLOCK;
+
+	while(size < granted && c < CLASSES - 1){
+		size *= 2;
+		c++;
+	}
+	freeBlocks[c].push_back(block);
+	used -= granted;
+}
+
+long long PageFile::getUsed(void)
+{
+	return used;
+}
+
+long long PageFile::getMapped(void)
+{
+	return (long long)segments.size() * SEGMENT;
+}
@@ -0,0 +1,55 @@
+/*
+ *	PageFile.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef PAGEFILE_H_
+#define PAGEFILE_H_
+#include <stddef.h>
+#include <vector>
+using namespace std;
+
+//Scratch file mapped shared into memory, handing out blocks that stay at
+//the same address until released. Data parked here is backed by the file
+//rather than the swap, so the OS can drop it from memory whenever it
+//likes and read it back in when it is next touched. The file is deleted
+//when it is closed.
+class PageFile
+{
+public:
+			PageFile(void);
+			~PageFile(void);
+	bool	open(const char* fileName);		//creates or empties it
+	void	close(void);
+	void*	allocate(size_t bytes, size_t& granted);	//NULL if too big or out of disk
+	void	release(void* block, size_t granted);
+	long long	getUsed(void);				//bytes in blocks handed out
+	long long	getMapped(void);
+
+private:
+	PageFile(const PageFile&);
+	PageFile& operator=(const PageFile&);
+
+	bool	addSegment(void);
+
+	static const size_t SEGMENT = 16 << 20;	//mapped a segment at a time
+	static const size_t MIN_BLOCK = 64;			//two orbs
+	static const int CLASSES = 19;			//MIN_BLOCK up to SEGMENT
+
+	vector<unsigned char*> segments;
+	size_t	segmentUsed;					//of the last segment
+	vector<void*> freeBlocks[CLASSES];		//released blocks by size class
+	long long used;
+#ifdef _WIN32
+	void*	file;
+	vector<void*> mappings;
+#else
+	int		fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ *	ParticleSystem.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Capture debris. update() splits the particles into slices and runs them
+	on the job system; each slice steps four particles a lane at a time,
+	drops the expired ones and packs its survivors down to its own start
+	in the same pass. Slices that lost particles then get moved down
+	against each other, which is a few memmove()s since expiry is rare
+	next to the number of particles updated. Nothing is allocated after
+	construction.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "ParticleSystem.h"
+#include "Timer.h"
+
+const float ParticleSystem::MAX_LIFE = 1.0f;
+
+static const float MIN_LIFE = 0.5f;
+static const float MIN_SPEED = 3;
+static const float MAX_SPEED = 9;
+static const float DRAG = 2;			//velocity lost per second, as a rate
+
+ParticleSystem::ParticleSystem(int inCapacity)
+			: count(0),
+			  capacity(inCapacity > 0 ? inCapacity : 0),
+			  updateTime(0),
+			  rng(0x5EED)
+{
+	//round each array up to whole SIMD registers
+	int stride = (capacity + 3) & ~3;
+
+	pool = new float[7 * stride + 4];
+	x = pool;
+	y = x + stride;
+	z = y + stride;
+	vx = z + stride;
+	vy = vx + stride;
+	vz = vy + stride;
+	life = vz + stride;
+	kept.resize(capacity / SLICE + 1);
+}
+
+ParticleSystem::~ParticleSystem(void)
+{
+	delete[] pool;
+}
+
+//Random direction and speed, scattered evenly over the sphere
+int ParticleSystem::burst(const Point3D& at, int n)
+{
+	if(n > capacity - count){
+		n = capacity - count;
+	}
+
+	for(int i = 0; i < n; i++){
+		Vector3D d;
+		float len2;
+
+		do {
+			d.x = rng.next() / 2147483648.0f - 1;
+			d.y = rng.next() / 2147483648.0f - 1;
+			d.z = rng.next() / 2147483648.0f - 1;
+			d.w = 0;
+			len2 = lengthSquared(d);
+		} while(len2 > 1 || len2 < 1e-4f);
+
+		float speed = MIN_SPEED + (MAX_SPEED - MIN_SPEED) * (rng.next() / 4294967296.0f);
+		d = d * (speed / sqrtf(len2));
+
+		x[count] = at.x;
+		y[count] = at.y;
+		z[count] = at.z;
+		vx[count] = d.x;
+		vy[count] = d.y;
+		vz[count] = d.z;
+		life[count] = MIN_LIFE + (MAX_LIFE - MIN_LIFE) * (rng.next() / 4294967296.0f);
+		count++;
+	}
+	return n;
+}
+
+//Steps particles [first, last) and packs the live ones down to first,
+//returning how many there are
+int ParticleSystem::updateSlice(int first, int last, float dt, float damp)
+{
+	Lanes dt4 = lanesSplat(dt), damp4 = lanesSplat(damp), zero = lanesSplat(0);
+	float* arrays[7] = { x, y, z, vx, vy, vz, life };
+	int i = first, out = first;
+
+	for(; i + 4 <= last; i += 4){
+		Lanes px = lanesLoad(x + i), py = lanesLoad(y + i), pz = lanesLoad(z + i);
+		Lanes ux = lanesMul(lanesLoad(vx + i), damp4);
+		Lanes uy = lanesMul(lanesLoad(vy + i), damp4);
+		Lanes uz = lanesMul(lanesLoad(vz + i), damp4);
+		Lanes left = lanesSub(lanesLoad(life + i), dt4);
+		Lanes step[7];
+		int alive = maskBits(lanesLess(zero, left));
+
+		step[0] = lanesMulAdd(ux, dt4, px);
+		step[1] = lanesMulAdd(uy, dt4, py);
+		step[2] = lanesMulAdd(uz, dt4, pz);
+		step[3] = ux;
+		step[4] = uy;
+		step[5] = uz;
+		step[6] = left;
+
+		//out never passes i, so this only overwrites particles already read
+		if(alive == 15){
+			for(int a = 0; a < 7; a++)
+				lanesStore(arrays[a] + out, step[a]);
+			out += 4;
+		}
+		else if(alive){
+			float lanes[7][4];
+
+			for(int a = 0; a < 7; a++)
+				lanesStore(lanes[a], step[a]);
+			for(int k = 0; k < 4; k++){
+				if(alive >> k & 1){
+					for(int a = 0; a < 7; a++)
+						arrays[a][out] = lanes[a][k];
+					out++;
+				}
+			}
+		}
+	}
+
+	for(; i < last; i++){
+		float ux = vx[i] * damp, uy = vy[i] * damp, uz = vz[i] * damp;
+		float left = life[i] - dt;
+
+		if(left > 0){
+			x[out] = ux * dt + x[i];
+			y[out] = uy * dt + y[i];
+			z[out] = uz * dt + z[i];
+			vx[out] = ux;
+			vy[out] = uy;
+			vz[out] = uz;
+			life[out] = left;
+			out++;
+		}
+	}
+
+	return out - first;
+}
+
+void ParticleSystem::update(float dt, JobSystem* jobs)
+{
+	long long start = nowNanos();
+	float* arrays[7] = { x, y, z, vx, vy, vz, life };
+	float damp = expf(-DRAG * dt);
+	int slices = (count + SLICE - 1) / SLICE;
+
+	auto step = [&](int first, int last){
+		for(int s = first; s < last; s++){
+			int end = (s + 1) * SLICE < count ? (s + 1) * SLICE : count;
+			kept[s] = updateSlice(s * SLICE, end, dt, damp);
+		}
+	};
+	if(jobs){
+		jobs->parallelFor(0, slices, 1, step);
+	}
+	else {
+		step(0, slices);
+	}
+
+	//close the gaps the slices left
+	int packed = slices ? kept[0] : 0;
+	for(int s = 1; s < slices; s++){
+		if(packed != s * SLICE){
+			for(int a = 0; a < 7; a++)
+				memmove(arrays[a] + packed, arrays[a] + s * SLICE, kept[s] * sizeof(float));
+		}
+		packed += kept[s];
+	}
+	count = packed;
+
+	updateTime = (nowNanos() - start) / 1000000.0;
+}
+
+void ParticleSystem::copyOut(int first, int last, float* out)
+{
+	Lanes scale = lanesSplat(1 / MAX_LIFE);
+	int i = first;
+
+	//four particles' worth of x, y, z and life turned into four xyzw
+	for(; i + 4 <= last; i += 4){
+		Lanes a = lanesLoad(x + i), b = lanesLoad(y + i), c = lanesLoad(z + i);
+		Lanes d = lanesMul(lanesLoad(life + i), scale);
+
+		lanesTranspose(a, b, c, d);
+		lanesStore(out, a);
+		lanesStore(out + 4, b);
+		lanesStore(out + 8, c);
+		lanesStore(out + 12, d);
+		out += 16;
+	}
+	for(; i < last; i++){
+		out[0] = x[i];
+		out[1] = y[i];
+		out[2] = z[i];
+		out[3] = life[i] / MAX_LIFE;
+		out += 4;
+	}
+}
+
+void ParticleSystem::clear(void)
+{
+	count = 0;
+}
+
+int		ParticleSystem::size(void)				{ return count; }
+int		ParticleSystem::getCapacity(void)		{ return capacity; }
+double	ParticleSystem::getUpdateTime(void)		{ return updateTime; }
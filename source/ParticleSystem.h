@@ -0,0 +1,65 @@
+/*
+ *	ParticleSystem.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef PARTICLESYSTEM_H_
+#define PARTICLESYSTEM_H_
+#include <vector>
+#include "Camera.h"
+#include "JobSystem.h"
+#include "Rng.h"
+using namespace std;
+
+//particles thrown off by one captured orb
+const int PARTICLE_BURST = 64;
+
+//Debris from captured orbs. Particles live structure of arrays in pools
+//sized once, at construction: position, velocity and the seconds each
+//has left, packed at [0, size()). They drift without gravity, slowing
+//under drag, and update() retires the ones whose time is up by closing
+//the gap behind them, so the pools stay packed and in spawn order. A
+//burst that doesn't fit is cut short rather than grow anything.
+class ParticleSystem
+{
+public:
+			ParticleSystem(int capacity);
+			~ParticleSystem(void);
+	int		burst(const Point3D& at, int count);	//particles actually added
+	void	update(float dt, JobSystem* jobs);
+	void	clear(void);
+	int		size(void);
+	int		getCapacity(void);
+	double	getUpdateTime(void);		//ms the last update() took
+
+	//x, y, z and the fraction of its life left of particles [first, last)
+	//into out, four floats each
+	void	copyOut(int first, int last, float* out);
+
+	static const float MAX_LIFE;
+
+private:
+	int		updateSlice(int first, int last, float dt, float damp);
+
+	float*	pool;						//all the arrays below, in one block
+	float*	x;
+	float*	y;
+	float*	z;
+	float*	vx;
+	float*	vy;
+	float*	vz;
+	float*	life;						//seconds left
+	int		count;
+	int		capacity;
+	vector<int> kept;					//survivors of each slice in update()
+	double	updateTime;
+	Rng		rng;						//not the world's, so debris can't change the spawns
+
+	static const int SLICE = 16384;		//particles per update job, a multiple of 4
+};
+
+#endif
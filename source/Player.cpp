@@ -0,0 +1,93 @@
+/*
+ *	Player.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Player movement, shared by the game and the server so a player flies
+	the same way whichever of them is simulating it. Acceleration ramps are
+	scaled by the tick length so the feel doesn't depend on the tick rate.
+ */
+
+#include "Player.h"
+
+const double MAX_ACCEL = 100;		//acceleration cap in each direction
+const double ACCEL_RATE = 100;		//acceleration gained per second
+const double SPEED = 0.5;			//units per second per unit of acceleration
+
+Player::Player(Camera* inCamera)
+			: camera(inCamera),
+			  uAccel(0),
+			  vAccel(0),
+			  nAccel(0)
+{
+	pos = lastPos = camera->getLocation();
+}
+
+Camera* Player::getCamera(void)
+{
+	return camera;
+}
+
+Point3D Player::getLastPosition(void)
+{
+	return lastPos;
+}
+
+Point3D Player::getPosition(void)
+{
+	return pos;
+}
+
+void Player::move(const PlayerInput& input, double dt)
+{
+	if(input.yaw != 0)
+		camera->yaw(input.yaw);
+	if(input.pitch != 0)
+		camera->pitch(input.pitch);
+	if(input.roll != 0)
+		camera->roll(input.roll);
+
+	// N DIRECTION IN CAMERA COORDINATES
+	nAccel = accelerate(nAccel, (input.buttons & BUTTON_FORWARD) != 0, -MAX_ACCEL, dt);
+	nAccel = accelerate(nAccel, (input.buttons & BUTTON_BACK) != 0, MAX_ACCEL, dt);
+
+	// U DIRECTION IN CAMERA COORDINATES
+	uAccel = accelerate(uAccel, (input.buttons & BUTTON_LEFT) != 0, -MAX_ACCEL, dt);
+	uAccel = accelerate(uAccel, (input.buttons & BUTTON_RIGHT) != 0, MAX_ACCEL, dt);
+
+	//"Jetpack"
+	vAccel = accelerate(vAccel, (input.buttons & BUTTON_UP) != 0, MAX_ACCEL, dt);
+
+	lastPos = camera->getLocation();
+	camera->slide(uAccel * SPEED * dt, vAccel * SPEED * dt, nAccel * SPEED * dt);
+	pos = camera->getLocation();
+}
+
+//Ramps an acceleration towards limit while its key is held; once the key
+//is released, speed on that side of zero degrades back to rest
+double Player::accelerate(double accel, bool held, double limit, double dt)
+{
+	double step = ACCEL_RATE * dt;
+
+	if(limit < 0){
+		step = -step;
+	}
+
+	if(held){
+		accel += step;
+		if(fabs(accel) > fabs(limit)){
+			accel = limit;
+		}
+	}
+	else if(accel * limit > 0){
+		accel -= step;
+		if(accel * limit < 0){
+			accel = 0;
+		}
+	}
+
+	return accel;
+}
@@ -0,0 +1,53 @@
+/*
+ *	Player.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef PLAYER_H_
+#define PLAYER_H_
+#include "Camera.h"
+
+//Movement buttons held during a tick
+enum PlayerButton
+{
+	BUTTON_FORWARD	= 1,
+	BUTTON_BACK		= 2,
+	BUTTON_LEFT		= 4,
+	BUTTON_RIGHT	= 8,
+	BUTTON_UP		= 16
+};
+
+//What a player asks to do in one tick: buttons held and how far to turn
+struct PlayerInput
+{
+	unsigned int buttons;
+	float yaw, pitch, roll;
+};
+
+//Moves a camera around the room the way the player flies: each direction
+//accelerates while its button is held and coasts back to rest after
+class Player
+{
+public:
+			Player(Camera* camera);
+	void	move(const PlayerInput& input, double dt);
+	Camera*	getCamera(void);
+	Point3D	getLastPosition(void);
+	Point3D	getPosition(void);
+
+private:
+	double	accelerate(double accel, bool held, double limit, double dt);
+
+	Camera* camera;
+	double uAccel;					//accelleration of player in u,v,n directions
+	double vAccel;
+	double nAccel;
+	Point3D lastPos;				//position at the start of the last move
+	Point3D pos;					//and at the end of it
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*
+ *	Pool.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+#include <new>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//Fixed size slots for objects of one type that come and go while the
+//game runs. Freed slots go on a free list and are handed out again
+//before any new memory is asked for, so the heap is only touched when
+//more objects are alive at once than ever before, a chunk at a time.
+//Not thread safe: each pool belongs to whoever creates its objects.
+template<class T, int CHUNK = 64>
+class Pool
+{
+public:
+	Pool(void) : freeList(NULL), live(0) {}
+
+	~Pool(void)
+	{
+		//objects still alive are the owner's bug, but don't leak the memory
+		for(unsigned int i = 0; i < chunks.size(); i++){
+			::operator delete(chunks[i]);
+		}
+	}
+
+	template<class... Args>
+	T* create(Args&&... args)
+	{
+		Slot* s;
+
+		if(!freeList){
+			grow();
+		}
+		s = freeList;
+		freeList = s->next;
+		live++;
+		return new(s->storage) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* p)
+	{
+		Slot* s = (Slot*)p;
+
+		if(!p){
+			return;
+		}
+		p->~T();
+		s->next = freeList;
+		freeList = s;
+		live--;
+	}
+
+	int		getLive(void)		{ return live; }
+	int		getCapacity(void)	{ return chunks.size() * CHUNK; }
+
+private:
+	Pool(const Pool&);
+	Pool& operator=(const Pool&);
+
+	union Slot
+	{
+		Slot* next;
+		alignas(T) char storage[sizeof(T)];
+	};
+
+	void grow(void)
+	{
+		Slot* chunk = (Slot*)::operator new(CHUNK * sizeof(Slot));
+
+		chunks.push_back(chunk);
+		for(int i = CHUNK - 1; i >= 0; i--){
+			chunk[i].next = freeList;
+			freeList = &chunk[i];
+		}
+	}
+
+	vector<Slot*> chunks;
+	Slot* freeList;
+	int live;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ *	Profiler.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Collects named timings and counters from any thread so the renderer
+	can show them in the profiler overlay. Entries are created the first
+	time a name is set and keep their order from then on.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "Profiler.h"
+
+Profiler::Profiler(void)
+			: count(0)
+{
+}
+
+void Profiler::set(const char* name, double value, const char* unit)
+{
+	lock_guard<mutex> guard(lock);
+	int i;
+
+	for(i = 0; i < count; i++){
+		if(!strcmp(entries[i].name, name))
+			break;
+	}
+
+	if(i == count){
+		//table full, drop the sample
+		if(count == MAX_ENTRIES){
+			return;
+		}
+		strncpy(entries[i].name, name, sizeof(entries[i].name) - 1);
+		entries[i].name[sizeof(entries[i].name) - 1] = 0;
+		strncpy(entries[i].unit, unit, sizeof(entries[i].unit) - 1);
+		entries[i].unit[sizeof(entries[i].unit) - 1] = 0;
+		count++;
+	}
+
+	entries[i].value = value;
+}
+
+int Profiler::getCount(void)
+{
+	lock_guard<mutex> guard(lock);
+	return count;
+}
+
+void Profiler::format(int entry, char* buffer, int size)
+{
+	lock_guard<mutex> guard(lock);
+
+	if(entry < 0 || entry >= count){
+		buffer[0] = 0;
+		return;
+	}
+	snprintf(buffer, size, "%-13s%#.2f %s", entries[entry].name,
+				entries[entry].value, entries[entry].unit);
+}
@@ -0,0 +1,38 @@
+/*
+ *	Profiler.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+#include <mutex>
+using namespace std;
+
+class Profiler
+{
+public:
+			Profiler(void);
+	void	set(const char* name, double value, const char* unit);
+	int		getCount(void);
+	void	format(int entry, char* buffer, int size);
+
+private:
+	struct Entry
+	{
+		char name[24];
+		char unit[8];
+		double value;
+	};
+
+	static const int MAX_ENTRIES = 32;
+
+	Entry entries[MAX_ENTRIES];
+	int count;
+	mutex lock;
+};
+
+#endif
@@ -11,15 +11,43 @@
 	object is passed to the renderer.
  */
 
-#pragma comment(lib, "GLaux.lib")
-#include <time.h>
-#include <gl/glaux.h>
-#include "renderer.h"
-
-//used to turn features on/off
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "Renderer.h"
+#include "CoreRenderer.h"
+#include "Bitmap.h"
+#include "HudText.h"
+#include "Bvh.h"
+#include "Timer.h"
+#include "Trace.h"
+
+//used to turn features on/off, see Renderer::setFeatures()
 bool textured = true;		//toggle texturing
 bool materials = true;		//toggle materials
 bool lighting = true;		//toggle shading
+bool blended = true;		//toggle order independent transparency
+
+//The draw passes are templates over a feature set, so each set compiles
+//into its own copy with the toggles folded away. A set known at compile
+//time...
+template<int FEATURES>
+struct StaticFeatures
+{
+	static bool textured(void)	{ return (FEATURES & FEATURE_TEXTURED) != 0; }
+	static bool materials(void)	{ return (FEATURES & FEATURE_MATERIALS) != 0; }
+	static bool lighting(void)	{ return (FEATURES & FEATURE_LIGHTING) != 0; }
+};
+
+//...and the toggles read every time they're checked, as the renderer
+//used to, kept to benchmark the others against
+struct RuntimeFeatures
+{
+	static bool textured(void)	{ return ::textured; }
+	static bool materials(void)	{ return ::materials; }
+	static bool lighting(void)	{ return ::lighting; }
+};
 
 //Light definitions
 GLfloat globalAmbient[] =	{ 0.6, 0.6, 0.6, 0.6 };
@@ -28,6 +56,8 @@ GLfloat light1Position[] =	{ 0.0, 0.0, 0.0, 1.0 };
 GLfloat light1Diffuse[] =	{ 0.0, 0.0, 0.8, 1.0 };
 GLfloat light1Specular[] =	{ 0.0, 0.0, 0.8, 1.0 };
 GLfloat light1Ambient[] =	{ 0.0, 0.0, 0.3, 1.0 };
+GLfloat light1Attenuation[] = { 0.6, 0.05, 0.0 };	//constant, linear, quadratic
+GLfloat light1Exponent =	9.0;
 
 //Material definitions
 GLfloat defAmbient[] =		{ 0.8, 0.8, 0.8, 1.0 };
@@ -48,24 +78,99 @@ GLfloat ballSpecular[] =	{ 0.8, 0.8, 0.8, 0.7 };
 GLfloat ballEmission[] =	{ 0.3, 0.3, 0.3, 0.7 };
 GLfloat ballShininess =		33.0;
 
+GLfloat targetEmission[] =	{ 0.6, 0.3, 0.0, 0.6 };
+GLfloat aimEmission[] =		{ 0.9, 0.0, 0.0, 0.7 };
+
 GLfloat skyEmission[] =		{ 1.0, 1.0, 1.0, 0.5 };
 
 
 //Member Functions
-Renderer::Renderer(int width, int height)
+Renderer::Renderer(int width, int height, RenderBackend backend, int features)
 			: frameCount(0),
 			  splash(false),
-			  paused(false)
+			  paused(false),
+			  profiling(false),
+			  text(true),
+			  skyScroll(0),
+			  theWorld(NULL),
+			  particles(NULL),
+			  profiler(NULL),
+			  capture(width, height),
+			  core(NULL),
+			  drawFront(0)
 {
-	AUX_RGBImageRec* textureImage[4];
+	RGBImage* textureImage[4];
 	
 	score = 0;
 	orbsCaptured = 0;
 	orbsReleased = 0;
 	w = width;
 	h = height;
-	initRoom();
+	memset(roomFaces, 0, sizeof(roomFaces));
+
+	//room tiles in view never outgrow this: VIEW_DISTANCE either side of
+	//the eye spans at most across chunks, on each face, four vertices of
+	//eight floats a tile
+	int across = 2 * VIEW_DISTANCE / CHUNK_SIZE + 2;
+	for(int i = 0; i < 2; i++){
+		roomList[i].reserve(6 * across * across * 4 * 8);
+	}
+	initOrb();
+	setFeatures(features);
 
+	//init textures, whatever the features, so they can change later
+	glGenTextures(4, &textureID[0]);
+	
+	//load textures into main memory
+	textureImage[0] = loadBitmap("tex/bricks.bmp");
+	textureImage[1] = loadBitmap("tex/sky.bmp");
+	textureImage[2] = loadBitmap("tex/grass.bmp");
+	textureImage[3] = loadBitmap("tex/splash.bmp");
+
+	for(int i = 0; i < 4; i++){
+		if(textureImage[i]){
+			if(textureImage[i]->data){
+				glBindTexture(GL_TEXTURE_2D, textureID[i]);
+				               
+				glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T, GL_REPEAT);
+				glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+				//load into texture memory
+				glTexImage2D(GL_TEXTURE_2D,
+								0,						//mipmap level
+								GL_RGB,
+								textureImage[i]->sizeX,
+								textureImage[i]->sizeY,
+								0,						//border pixels
+								GL_RGB,					//pixel format
+								GL_UNSIGNED_BYTE,
+								textureImage[i]->data);
+				 
+				//free main memory
+				free(textureImage[i]->data);
+			}
+			free(textureImage[i]);
+		}
+	}
+
+	if(backend == BACKEND_CORE){
+		core = new CoreRenderer(this);
+		if(!core->init()){
+			printf("OpenGL 3.3 core profile unavailable, using fixed function\n");
+			delete core;
+			core = NULL;
+		}
+	}
+	if(!core){
+		initFixedFunction();
+	}
+}
+
+//Pipeline state, projection and lighting for the fixed function path
+void Renderer::initFixedFunction(void)
+{
 	glEnable(GL_DEPTH_TEST | GL_POLYGON_SMOOTH);
 	glEnable(GL_CULL_FACE);						//enable culling
 	glCullFace(GL_BACK);						//cull back facing polys
@@ -79,79 +184,89 @@ Renderer::Renderer(int width, int height)
 
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
-	gluPerspective(75, (GLfloat)w/(GLfloat)h, 0.1, 200);
+	gluPerspective(FOV, (GLfloat)w/(GLfloat)h, 0.1, VIEW_DISTANCE);
 
 	glMatrixMode(GL_MODELVIEW);
 
-	//init textures
-	if(textured){
-		glGenTextures(4, &textureID[0]);
-		
-		//load textures into main memory
-		textureImage[0] = auxDIBImageLoad("tex/bricks.bmp");
-		textureImage[1] = auxDIBImageLoad("tex/sky.bmp");
-		textureImage[2] = auxDIBImageLoad("tex/grass.bmp");
-		textureImage[3] = auxDIBImageLoad("tex/splash.bmp");
-
-		for(int i = 0; i < 4; i++){
-			if(textureImage[i]){
-				if(textureImage[i]->data){
-					glBindTexture(GL_TEXTURE_2D, textureID[i]);
-					               
-					glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S, GL_REPEAT);
-					glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T, GL_REPEAT);
-					glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-					glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-					//load into texture memory
-					glTexImage2D(GL_TEXTURE_2D,
-									0,						//mipmap level
-									GL_RGB,
-									textureImage[i]->sizeX,
-									textureImage[i]->sizeY,
-									0,						//border pixels
-									GL_RGB,					//pixel format
-									GL_UNSIGNED_BYTE,
-									textureImage[i]->data);
-					 
-					//free main memory
-					free(textureImage[i]->data);
-				}
-				free(textureImage[i]);
-			}
-		}
-	}
+	//init lighting, only switched on while drawing lit
+	glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
+	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, globalAmbient);
+	
+	glLightfv(GL_LIGHT1, GL_POSITION, light1Position);
+	glLightfv(GL_LIGHT1, GL_DIFFUSE, light1Diffuse);
+	glLightfv(GL_LIGHT1, GL_SPECULAR, light1Specular);
+	glLightfv(GL_LIGHT1, GL_AMBIENT, light1Ambient);
+	
+	glLightf(GL_LIGHT1, GL_SPOT_EXPONENT, light1Exponent);
+	glLightf(GL_LIGHT1, GL_CONSTANT_ATTENUATION, light1Attenuation[0]);
+	glLightf(GL_LIGHT1, GL_LINEAR_ATTENUATION, light1Attenuation[1]);
+	glLightf(GL_LIGHT1, GL_QUADRATIC_ATTENUATION, light1Attenuation[2]);
+	glLightf(GL_LIGHT1, GL_SPOT_CUTOFF, SPOT_ANGLE);
+	
+	glEnable(GL_LIGHT1);
 
-	//init lighting
-	if(lighting){
-		glLightModeli(GL_LIGHT_MODEL_TWO_SIDE, GL_TRUE);
-		glLightModelfv(GL_LIGHT_MODEL_AMBIENT, globalAmbient);
-		
-		glLightfv(GL_LIGHT1, GL_POSITION, light1Position);
-		glLightfv(GL_LIGHT1, GL_DIFFUSE, light1Diffuse);
-		glLightfv(GL_LIGHT1, GL_SPECULAR, light1Specular);
-		glLightfv(GL_LIGHT1, GL_AMBIENT, light1Ambient);
-		
-		glLightf(GL_LIGHT1, GL_SPOT_EXPONENT, 9.0);
-		glLightf(GL_LIGHT1, GL_CONSTANT_ATTENUATION, 0.6);
-		glLightf(GL_LIGHT1, GL_LINEAR_ATTENUATION, 0.05);
-		glLightf(GL_LIGHT1, GL_QUADRATIC_ATTENUATION, 0.0);
-		glLightf(GL_LIGHT1, GL_SPOT_CUTOFF, 45.0);
-		
-		glEnable(GL_LIGHT1);
+	//falls back to unsorted blending if the driver can't do it
+	if(blended){
+		transparency.init(w, h);
 	}
 }
 
 Renderer::~Renderer(void)
 {
-	delete [] vertexBuffer;
-	delete [] textureCoord;
-	delete [] normalBuffer;
+	delete core;
+	delete [] orbVertex;
+	delete [] outlineVertex;
+	delete [] orbIndex;
 }
 
 void Renderer::setCamera(Camera* inCamera)
 {
 	camera = inCamera;
+
+	viewMatrix[0] = camera->getModelViewMatrix();
+	viewMatrix[1] = viewMatrix[0];
+}
+
+FrameCapture* Renderer::getCapture(void)
+{
+	return &capture;
+}
+
+RenderBackend Renderer::getBackend(void)
+{
+	return core ? BACKEND_CORE : BACKEND_FIXED;
+}
+
+//Done once at startup, or when the settings change, instead of checking
+//the toggles all through every frame. The core backend reads them once a
+//frame into its uniforms and needs nothing more.
+void Renderer::setFeatures(int features, bool specialized)
+{
+	static void (Renderer::* const passes[8])(void) = {
+		&Renderer::drawScene< StaticFeatures<0> >,
+		&Renderer::drawScene< StaticFeatures<1> >,
+		&Renderer::drawScene< StaticFeatures<2> >,
+		&Renderer::drawScene< StaticFeatures<3> >,
+		&Renderer::drawScene< StaticFeatures<4> >,
+		&Renderer::drawScene< StaticFeatures<5> >,
+		&Renderer::drawScene< StaticFeatures<6> >,
+		&Renderer::drawScene< StaticFeatures<7> > };
+
+	features &= FEATURES_ALL;
+	textured = (features & FEATURE_TEXTURED) != 0;
+	materials = (features & FEATURE_MATERIALS) != 0;
+	lighting = (features & FEATURE_LIGHTING) != 0;
+
+	if(specialized)
+		drawPass = passes[features];
+	else
+		drawPass = &Renderer::drawScene<RuntimeFeatures>;
+}
+
+int Renderer::getFeatures(void)
+{
+	return (textured ? FEATURE_TEXTURED : 0) | (materials ? FEATURE_MATERIALS : 0) |
+		(lighting ? FEATURE_LIGHTING : 0);
 }
 
 Camera*	Renderer::getCamera(void)
@@ -159,18 +274,177 @@ Camera*	Renderer::getCamera(void)
 	return camera;
 }
 
-int	Renderer::getBoundary(void)
+void Renderer::setWorld(World* newWorld)
 {
-	return WORLDSCALE - 1;
+	theWorld = newWorld;
 }
 
-void Renderer::setWorld(deque<Point3D>* newWorld)
+//Sizes the draw lists for every particle there can be, so frames never
+//reallocate them
+void Renderer::setParticles(ParticleSystem* newParticles)
 {
-	theWorld = newWorld;
+	particles = newParticles;
+	for(int i = 0; i < 2; i++){
+		particleList[i].clear();
+		if(particles){
+			particleList[i].reserve(particles->getCapacity() * 4);
+		}
+	}
+}
+
+void Renderer::setProfiler(Profiler* newProfiler)
+{
+	profiler = newProfiler;
+}
+
+//Sizes a per-orb list for the world's working set, not just the orbs in
+//it now, so it only reallocates when the world itself has had to grow
+template<class T>
+static void reserveForWorld(vector<T>& list, int perOrb, int count, World* world)
+{
+	if(list.capacity() < (size_t)(count * perOrb)){
+		list.reserve((size_t)max(count, world->getCapacity()) * perOrb);
+	}
+}
+
+//Scratch for the frame comes from arena, which must outlive the call
+//but nothing else: the results are copied into the draw lists
+void Renderer::prepareFrame(JobSystem* jobs, FrameArena* arena)
+{
+	//only this thread changes drawFront, so it can read it unlocked
+	int back = 1 - drawFront;
+	int count = theWorld->size();
+	Point3D eye = camera->getLocation();
+	Vector3D n = camera->getN();
+
+	//cone around the view direction that encloses the whole frustum
+	double tanY = tan(FOV * rads / 2);
+	double tanXY = tanY * sqrt(1 + ((double)w*w) / ((double)h*h));
+	double halfAngle = atan(tanXY);
+	float sinA = sin(halfAngle);
+	float cosA = cos(halfAngle);
+
+	//snapshot the camera so display() never reads it mid-update
+	viewMatrix[back] = camera->getModelViewMatrix();
+
+	char* visible = arena->alloc<char>(count);
+	char* marked = arena->alloc<char>(count);
+
+	//cull orbs in parallel, each job writes its own slice of flags, four
+	//orbs a lane each and then the ones left over
+	const Orb* orbs = theWorld->getOrbs();
+	Vec3x4 eye4 = splat(eye), n4 = splat(n);
+	Lanes one = lanesSplat(1), sin4 = lanesSplat(sinA), cos4 = lanesSplat(cosA);
+	auto cull = [&](int first, int last){
+		int i = first;
+
+		for(; i + 4 <= last; i += 4){
+			Vec3x4 d = gather(orbs[i].pos, orbs[i + 1].pos, orbs[i + 2].pos, orbs[i + 3].pos) - eye4;
+			Lanes behind = dot(d, n4);
+			Lanes perp = lanesSqrt(lanesAbs(lanesSub(dot(d, d), lanesMul(behind, behind))));
+			Lanes edge = lanesMulAdd(behind, sin4, lanesMul(perp, cos4));
+			int in = maskBits(maskAnd(lanesLess(behind, one), lanesLess(edge, one)));
+
+			for(int k = 0; k < 4; k++)
+				visible[i + k] = in >> k & 1;
+		}
+		for(; i < last; i++){
+			Vector3D d = (*theWorld)[i].pos - eye;
+
+			//the camera looks down -N
+			float along = -dot(d, n);
+			float perp = sqrtf(fabsf(dot(d, d) - along*along));
+
+			//distance from the orb to the side of the cone vs orb radius
+			visible[i] = (along > -1 && perp*cosA - along*sinA < 1);
+		}
+	};
+	jobs->parallelFor(0, count, 1024, cull);
+
+	//pick out the orbs in the flashlight beam and the one dead ahead
+	fill_n(marked, count, (char)ORB_PLAIN);
+	radarList[back].clear();
+	reserveForWorld(radarList[back], 2, count, theWorld);
+	reserveForWorld(targets, 1, count, theWorld);
+	OrbBvh* bvh = theWorld->getBvh();
+	if(bvh){
+		Vector3D dir = -n;
+		Vector3D u = camera->getU();
+		Vector3D v = camera->getV();
+		double sinSpot = sin(SPOT_ANGLE * rads);
+		double dist;
+		int aimed;
+
+		bvh->cone(eye, dir, SPOT_ANGLE, SPOT_RANGE, targets);
+		for(unsigned int i = 0; i < targets.size(); i++){
+			Vector3D d = (*theWorld)[theWorld->indexOf(targets[i])].pos - eye;
+			double len = length(d) * sinSpot;
+			double rx = 0, ry = 0, r;
+
+			//position across the beam, the edge of the beam is the rim
+			if(len > 0){
+				rx = dot(d, u) / len;
+				ry = dot(d, v) / len;
+			}
+			r = sqrt(rx*rx + ry*ry);
+			if(r > 1){
+				rx /= r;
+				ry /= r;
+			}
+			radarList[back].push_back(rx);
+			radarList[back].push_back(ry);
+			marked[theWorld->indexOf(targets[i])] = ORB_TARGETED;
+		}
+
+		aimed = theWorld->indexOf(bvh->raycast(eye, dir, SPOT_RANGE, dist));
+		if(aimed >= 0){
+			marked[aimed] = ORB_AIMED;
+		}
+	}
+
+	//room for every orb, so a busier view never reallocates mid game
+	drawList[back].clear();
+	drawMark[back].clear();
+	reserveForWorld(drawList[back], 1, count, theWorld);
+	reserveForWorld(drawMark[back], 1, count, theWorld);
+	for(int i = 0; i < count; i++){
+		if(visible[i]){
+			drawList[back].push_back((*theWorld)[i].pos);
+			drawMark[back].push_back(marked[i]);
+		}
+	}
+
+	buildRoom(back, eye);
+
+	//debris goes out as it is, clipping is left to GL
+	if(particles){
+		int live = particles->size();
+		float* out;
+
+		particleList[back].resize(live * 4);
+		out = particleList[back].data();
+		auto copy = [&](int first, int last){
+			particles->copyOut(first, last, out + first * 4);
+		};
+		jobs->parallelFor(0, live, 16384, copy);
+	}
+
+	lock_guard<mutex> lock(drawLock);
+	drawFront = back;
 }
 
 void Renderer::display(void)
 {
+	TRACE_ZONE("render");
+
+	if(core){
+		core->display();
+		if(!splash)
+			frameCount++;
+		capture.grab();
+		return;
+	}
+
 	//clear window
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glLoadIdentity();
@@ -193,82 +467,228 @@ void Renderer::display(void)
 		glDisable(GL_TEXTURE_2D);
 	}
 	else {
-		if(lighting){
-			glEnable(GL_LIGHTING);
-		}
-		
-		glPushMatrix();									//Push -- camera
-		glLoadMatrixd(camera->getModelViewMatrix());
-		
-		glPushMatrix();									//Push -- draw world
-		drawRoom();
-		glPopMatrix();									//Pop  -- draw world
+		(this->*drawPass)();
+	}
+
+	capture.grab();
+}
+
+//Everything but the splash screen, for the feature set F
+template<class F>
+void Renderer::drawScene(void)
+{
+	if(F::lighting()){
+		glEnable(GL_LIGHTING);
+	}
+
+	drawLock.lock();
+	if(transparency.isReady()){
+		transparency.beginScene();
+	}
+	glPushMatrix();									//Push -- camera
+	glLoadMatrixf(viewMatrix[drawFront].m);
 
-		drawTreasures();
-		glPopMatrix();									//Pop  -- camera
+	glPushMatrix();									//Push -- draw world
+	drawRoom<F>();
+	glPopMatrix();									//Pop  -- draw world
 
-		if(lighting){
-			glDisable(GL_LIGHTING);
+	if(transparency.isReady()){
+		if(!F::lighting()){
+			drawOutlines();
 		}
+		drawParticles<F>();
+		transparency.beginAccumulate();
+		transparency.useOrbShader(F::lighting());
+		drawTreasures<F, true>();
+		TRACE_ZONE("resolve");
+		transparency.resolve();
+	}
+	else {
+		drawParticles<F>();
+		drawTreasures<F, false>();
+	}
+	glPopMatrix();									//Pop  -- camera
+
+	copyRadar();
+	drawLock.unlock();
 
-		drawHUD();
-		frameCount++;
+	if(F::lighting()){
+		glDisable(GL_LIGHTING);
 	}
-	glutSwapBuffers();
+
+	drawHUD();
+	if(profiling && profiler){
+		drawProfile();
+	}
+	frameCount++;
 }
 
-void Renderer::initRoom()
+//HUD text goes through GLUT's bitmap fonts, which need a window system
+void Renderer::setText(bool toggle)
 {
-	GLdouble vB[] = {
-		-40, -40, -40,		 40, -40, -40,		 40,  40, -40,		-40,  40, -40,		//back face
-		-40, -40,  40,		-40,  40,  40,		 40,  40,  40,		 40, -40,  40,		//front face
-		-40, -40, -40,		-40, -40,  40,		 40, -40,  40,		 40, -40, -40,		//bottom face
-		-40,  40, -40,		 40,  40, -40,		 40,  40,  40,		-40,  40,  40,		//top face
-		-40, -40, -40,		-40,  40, -40,		-40,  40,  40,		-40, -40,  40,		//left face
-		 40, -40, -40,		 40, -40,  40,		 40,  40,  40,		 40,  40, -40};		//right face
-
-	GLdouble tC[] = {
-		0.0,0.0,	4.0,0.0,	4.0,4.0,	0.0,4.0,	//back
-		4.0,0.0,	4.0,4.0,	0.0,4.0,	0.0,0.0,	//front
-		20.0,20.0,	10.0,20.0,	10.0,0.0,	20.0,0.0,	//bottom
-		0.0,1.0,	0.0,0.0,	0.5,0.0,	0.5,1.0,	//top 24-31
-		4.0,0.0,	4.0,4.0,	0.0,4.0,	0.0,0.0,	//left
-		0.0,0.0,	4.0,0.0,	4.0,4.0,	0.0,4.0};	//right
+	text = toggle;
+}
 
-	GLdouble nB[] = {
-		 0, 0, 1,	 0, 0, 1,	 0, 0, 1,	 0, 0, 1,	//back normal
-		 0, 0,-1,	 0, 0,-1,	 0, 0,-1,	 0, 0,-1,	//front normal
-		 0, 1, 0,	 0, 1, 0,	 0, 1, 0,	 0, 1, 0,	//bottom normal
-		 0,-1, 0,	 0,-1, 0,	 0,-1, 0,	 0,-1, 0,	//top normal
-		 1, 0, 0,	 1, 0, 0,	 1, 0, 0,	 1, 0, 0,	//left normal
-		-1, 0, 0,	-1, 0, 0,	-1, 0, 0,	-1, 0, 0};	//right normal
+//The room's faces: the axis each is square to and which end of it, the
+//two axes across it, its corners in drawing order and how its texture
+//coordinates follow position (s and t per unit along a and b, measured
+//from the low corner). Matches the single quad per face the room used to
+//be, so a room of the old size looks the same.
+struct RoomFace
+{
+	int axis, side;
+	int a, b;
+	int corner[4][2];
+	GLfloat normal[3];
+	double sa, sb, ta, tb;
+};
+
+static const RoomFace roomFace[6] = {
+	{ 2, -1,	0, 1,	{ {0,0}, {1,0}, {1,1}, {0,1} },	{ 0, 0, 1 },	1/20.0, 0,	0, 1/20.0 },		//back
+	{ 2,  1,	0, 1,	{ {0,0}, {0,1}, {1,1}, {1,0} },	{ 0, 0,-1 },	-1/20.0, 0,	0, 1/20.0 },		//front
+	{ 1, -1,	0, 2,	{ {0,0}, {0,1}, {1,1}, {1,0} },	{ 0, 1, 0 },	0, -1/8.0,	-1/4.0, 0 },		//bottom
+	{ 1,  1,	0, 2,	{ {0,0}, {1,0}, {1,1}, {0,1} },	{ 0,-1, 0 },	0, 1/160.0,	-1/80.0, 0 },		//top
+	{ 0, -1,	1, 2,	{ {0,0}, {1,0}, {1,1}, {0,1} },	{ 1, 0, 0 },	0, -1/20.0,	1/20.0, 0 },		//left
+	{ 0,  1,	1, 2,	{ {0,0}, {0,1}, {1,1}, {1,0} },	{-1, 0, 0 },	0, 1/20.0,	1/20.0, 0 } };		//right
+
+//Fills roomList[back] with the tiles of the room within VIEW_DISTANCE of
+//the eye, a chunk square each, so a room of any size costs what can be
+//seen of it. Eight floats a vertex: position, normal, texture coordinate.
+void Renderer::buildRoom(int back, const Point3D& eye)
+{
+	vector<GLfloat>& list = roomList[back];
+	double edge = theWorld->getBoundary() + 1;
+	double e[3] = { eye.x, eye.y, eye.z };
+	int tiles = (int)ceil(2 * edge / CHUNK_SIZE);
+	int quads = 0;
+
+	list.clear();
+	for(int f = 0; f < 6; f++){
+		const RoomFace& face = roomFace[f];
+		double plane = face.side * edge;
+		double d = fabs(e[face.axis] - plane);
+		double reach;
+		int a0, a1, b0, b1;
+
+		roomFaces[back][f] = quads;
+		if(d > VIEW_DISTANCE){
+			continue;
+		}
+		reach = sqrt(VIEW_DISTANCE * VIEW_DISTANCE - d * d);
+		a0 = max((int)floor((e[face.a] - reach + edge) / CHUNK_SIZE), 0);
+		a1 = min((int)floor((e[face.a] + reach + edge) / CHUNK_SIZE), tiles - 1);
+		b0 = max((int)floor((e[face.b] - reach + edge) / CHUNK_SIZE), 0);
+		b1 = min((int)floor((e[face.b] + reach + edge) / CHUNK_SIZE), tiles - 1);
+
+		for(int i = a0; i <= a1; i++){
+			for(int j = b0; j <= b1; j++){
+				double lo[2] = { i * CHUNK_SIZE - edge, j * CHUNK_SIZE - edge };
+				double hi[2] = { min(lo[0] + CHUNK_SIZE, edge), min(lo[1] + CHUNK_SIZE, edge) };
+				double ca = fmax(lo[0] - e[face.a], fmax(e[face.a] - hi[0], 0));
+				double cb = fmax(lo[1] - e[face.b], fmax(e[face.b] - hi[1], 0));
+				double s0, t0;
+
+				if(ca*ca + cb*cb > reach*reach){
+					continue;
+				}
 
+				//the texture repeats, so take whole repeats off each tile
+				//to keep its coordinates small in a big room
+				s0 = floor(face.sa * (lo[0] + edge) + face.sb * (lo[1] + edge));
+				t0 = floor(face.ta * (lo[0] + edge) + face.tb * (lo[1] + edge));
+
+				for(int k = 0; k < 4; k++){
+					double pa = face.corner[k][0] ? hi[0] : lo[0];
+					double pb = face.corner[k][1] ? hi[1] : lo[1];
+					double p[3];
+
+					p[face.axis] = plane;
+					p[face.a] = pa;
+					p[face.b] = pb;
+					list.push_back(p[0]);
+					list.push_back(p[1]);
+					list.push_back(p[2]);
+					list.push_back(face.normal[0]);
+					list.push_back(face.normal[1]);
+					list.push_back(face.normal[2]);
+					list.push_back(face.sa * (pa + edge) + face.sb * (pb + edge) - s0);
+					list.push_back(face.ta * (pa + edge) + face.tb * (pb + edge) - t0);
+				}
+				quads++;
+			}
+		}
+	}
+	roomFaces[back][6] = quads;
+}
 
-	vertexBuffer = new GLdouble[sizeof(vB)];
-	textureCoord = new GLdouble[sizeof(tC)];
-	normalBuffer = new GLdouble[sizeof(nB)];
+void Renderer::initOrb()
+{
+	int i, j, k;
+	double phi, theta;
+
+	//same tessellation as glutSolidSphere(1,25,25), poles along z
+	orbVertex = new GLfloat[(ORB_STACKS+1) * (ORB_SLICES+1) * 3];
+	outlineVertex = new GLfloat[(ORB_STACKS+1) * (ORB_SLICES+1) * 3];
+	orbIndexCount = ORB_STACKS * ORB_SLICES * 6;
+	orbIndex = new GLuint[orbIndexCount];
+
+	k = 0;
+	for(i = 0; i <= ORB_STACKS; i++){
+		phi = 3.14159265358979 * i / ORB_STACKS;
+		for(j = 0; j <= ORB_SLICES; j++){
+			theta = 2 * 3.14159265358979 * j / ORB_SLICES;
+			orbVertex[k++] = sin(phi) * cos(theta);
+			orbVertex[k++] = sin(phi) * sin(theta);
+			orbVertex[k++] = cos(phi);
+		}
+	}
 
-	for(int i = 0; i < sizeof(vB); i++){
-		vertexBuffer[i] = vB[i];
-		normalBuffer[i] = nB[i];
+	//turned 90 degrees about -x, so the outline's poles don't sit on the
+	//orb's and the wireframe needs no rotation of its own
+	for(i = 0; i < k; i += 3){
+		outlineVertex[i] = orbVertex[i];
+		outlineVertex[i+1] = orbVertex[i+2];
+		outlineVertex[i+2] = -orbVertex[i+1];
 	}
 
-	for(int i = 0; i < sizeof(tC); i++){
-		textureCoord[i] = tC[i];
+	//two counter clockwise triangles per quad
+	k = 0;
+	for(i = 0; i < ORB_STACKS; i++){
+		for(j = 0; j < ORB_SLICES; j++){
+			GLuint a = i * (ORB_SLICES+1) + j;
+			GLuint b = a + ORB_SLICES + 1;
+
+			orbIndex[k++] = a;
+			orbIndex[k++] = b;
+			orbIndex[k++] = b + 1;
+			orbIndex[k++] = a;
+			orbIndex[k++] = b + 1;
+			orbIndex[k++] = a + 1;
+		}
 	}
 }
 
-void Renderer::drawRoom()
+template<class F>
+void Renderer::drawRoom(void)
 {
+	TRACE_ZONE("room");
+	vector<GLfloat>& list = roomList[drawFront];
+	int* faces = roomFaces[drawFront];
+	GLsizei stride = 8 * sizeof(GLfloat);
+
+	if(list.empty()){
+		return;
+	}
+
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_DOUBLE, 0, vertexBuffer);
+	glVertexPointer(3, GL_FLOAT, stride, &list[0]);
 
-	if(lighting){
+	if(F::lighting()){
 		glEnableClientState(GL_NORMAL_ARRAY);
-		glNormalPointer(GL_DOUBLE, 0, normalBuffer);
+		glNormalPointer(GL_FLOAT, stride, &list[3]);
 	}
 
-	if(materials){
+	if(F::materials()){
 		glMaterialfv(GL_FRONT,GL_AMBIENT,brickAmbient);
 		glMaterialfv(GL_FRONT,GL_DIFFUSE,brickDiffuse);
 		glMaterialfv(GL_FRONT,GL_SPECULAR,brickSpecular);
@@ -276,97 +696,194 @@ void Renderer::drawRoom()
 		glMaterialf (GL_FRONT,GL_SHININESS,brickShininess);
 	}
 
-	if(textured){
+	if(F::textured()){
 		glEnable(GL_TEXTURE_2D);
 		glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
 
 		//animate the sky texture
-		double x1,x2;
-		
-		x1 = textureCoord[24];
-		x2 = textureCoord[28];
-		
-		x1 += 0.0002;
-		x2 += 0.0002;
-		
-		textureCoord[24] = textureCoord[26] = x1;
-		textureCoord[28] = textureCoord[30] = x2;
+		skyScroll += 0.0002;
 		
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glTexCoordPointer(2, GL_DOUBLE, 0, textureCoord);
+		glTexCoordPointer(2, GL_FLOAT, stride, &list[6]);
 		
 		glEnable(GL_TEXTURE_2D);
 		
 		glBindTexture(GL_TEXTURE_2D, textureID[0]);
-		glDrawArrays(GL_QUADS,0,8);
-		glDrawArrays(GL_QUADS,16,8);
+		glDrawArrays(GL_QUADS, faces[0] * 4, (faces[2] - faces[0]) * 4);
+		glDrawArrays(GL_QUADS, faces[4] * 4, (faces[6] - faces[4]) * 4);
 		glBindTexture(GL_TEXTURE_2D, textureID[1]);
 		glMaterialfv(GL_FRONT, GL_EMISSION, skyEmission);
-		glDrawArrays(GL_QUADS,12,4);
+		glMatrixMode(GL_TEXTURE);
+		glLoadIdentity();
+		glTranslated(skyScroll, 0, 0);
+		glDrawArrays(GL_QUADS, faces[3] * 4, (faces[4] - faces[3]) * 4);
+		glLoadIdentity();
+		glMatrixMode(GL_MODELVIEW);
 		glBindTexture(GL_TEXTURE_2D, textureID[2]);
-		glDrawArrays(GL_QUADS,8,4);
+		glDrawArrays(GL_QUADS, faces[2] * 4, (faces[3] - faces[2]) * 4);
 		glMaterialfv(GL_FRONT, GL_EMISSION, defEmission);
 		
 		glDisable(GL_TEXTURE_2D);
 	}
 	else {
-		glColor3d(1,1,0);
-		glDrawArrays(GL_QUADS,0,4);
-		glColor3d(1,0,0);
-		glDrawArrays(GL_QUADS,4,4);
-		glColor3d(1,.5,0);
-		glDrawArrays(GL_QUADS,8,4);
-		glColor3d(0,1,0);
-		glDrawArrays(GL_QUADS,12,4);
-		glColor3d(0,0,1);
-		glDrawArrays(GL_QUADS,16,4);
-		glColor3d(1,0,1);
-		glDrawArrays(GL_QUADS,20,4);
+		GLdouble colors[6][3] = { {1,1,0}, {1,0,0}, {1,.5,0}, {0,1,0}, {0,0,1}, {1,0,1} };
+
+		for(int f = 0; f < 6; f++){
+			glColor3dv(colors[f]);
+			glDrawArrays(GL_QUADS, faces[f] * 4, (faces[f + 1] - faces[f]) * 4);
+		}
 	}
 }
 
-void Renderer::drawTreasures()
+//With ACCUMULATE the transparency pass owns blending and depth, and orbs
+//are drawn in one go with no per orb state changes. Otherwise they blend
+//over the room without depth, and unlit ones get a wireframe on top
+//that is depth tested, so the state flips every orb only then.
+template<class F, bool ACCUMULATE>
+void Renderer::drawTreasures(void)
 {
-	Point3D tPoint;
+	TRACE_ZONE("orbs");
+	const bool outlined = !ACCUMULATE && !F::lighting();
+	vector<Point3D>& orbs = drawList[drawFront];
+	vector<char>& marks = drawMark[drawFront];
+	char lastMark = ORB_PLAIN;
 
-	if(materials){
+	if(F::materials()){
 		glMaterialfv(GL_FRONT,GL_AMBIENT,ballAmbient);
 		glMaterialfv(GL_FRONT,GL_DIFFUSE,ballDiffuse);
 		glMaterialfv(GL_FRONT,GL_SPECULAR,ballSpecular);
 		glMaterialf (GL_FRONT,GL_SHININESS,ballShininess);
 	}
 
-	for(unsigned int i = 0; i < (*theWorld).size(); i++){
-		tPoint = (*theWorld)[i];
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, orbVertex);
+	glNormalPointer(GL_FLOAT, 0, orbVertex);
+
+	if(!ACCUMULATE && !outlined){
+		glEnable(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+	}
+
+	for(unsigned int i = 0; i < orbs.size(); i++){
+		const Point3D& p = orbs[i];
 
 		glPushMatrix();
-		glTranslated(tPoint.x,
-						tPoint.y,
-						tPoint.z);
+		glTranslatef(p.x, p.y, p.z);
 
 		//sphere treasure
-		glEnable(GL_BLEND);
-		glDisable(GL_DEPTH_TEST);
-		glColor4d(1,1,0,.5);
-		glutSolidSphere(1,25,25);
-		glEnable(GL_DEPTH_TEST);
-		glDisable(GL_BLEND);
+		if(outlined){
+			glEnable(GL_BLEND);
+			glDisable(GL_DEPTH_TEST);
+		}
+		//lit orbs ignore glColor, so the flashlight marks glow instead
+		if(F::materials() && marks[i] != lastMark){
+			if(marks[i] == ORB_AIMED)
+				glMaterialfv(GL_FRONT,GL_EMISSION,aimEmission);
+			else if(marks[i] == ORB_TARGETED)
+				glMaterialfv(GL_FRONT,GL_EMISSION,targetEmission);
+			else
+				glMaterialfv(GL_FRONT,GL_EMISSION,defEmission);
+			lastMark = marks[i];
+		}
+		if(!F::lighting()){
+			if(marks[i] == ORB_AIMED)
+				glColor4d(1,0,0,.7);
+			else if(marks[i] == ORB_TARGETED)
+				glColor4d(1,.5,0,.6);
+			else
+				glColor4d(1,1,0,.5);
+		}
+		glDrawElements(GL_TRIANGLES, orbIndexCount, GL_UNSIGNED_INT, orbIndex);
 
-		if(!lighting){
-			glRotated(90,-1,0,0);
+		if(outlined){
+			glEnable(GL_DEPTH_TEST);
+			glDisable(GL_BLEND);
+			glVertexPointer(3, GL_FLOAT, 0, outlineVertex);
 			glPolygonMode(GL_FRONT,GL_LINE);
 			glColor3d(.5,.5,0);
-			glutSolidSphere(1,25,25);
+			glDrawElements(GL_TRIANGLES, orbIndexCount, GL_UNSIGNED_INT, orbIndex);
 			glPolygonMode(GL_FRONT,GL_FILL);
+			glVertexPointer(3, GL_FLOAT, 0, orbVertex);
 		}
 		glPopMatrix();
 	}
+
+	if(!ACCUMULATE && !outlined){
+		glEnable(GL_DEPTH_TEST);
+		glDisable(GL_BLEND);
+	}
+	if(F::materials() && lastMark != ORB_PLAIN){
+		glMaterialfv(GL_FRONT,GL_EMISSION,defEmission);
+	}
+}
+
+//Capture debris as one batch of points, glowing over the room and tested
+//against it but not hiding anything behind them
+template<class F>
+void Renderer::drawParticles(void)
+{
+	TRACE_ZONE("particles");
+	vector<GLfloat>& list = particleList[drawFront];
+
+	if(list.empty()){
+		return;
+	}
+
+	if(F::lighting()){
+		glDisable(GL_LIGHTING);
+	}
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glDepthMask(GL_FALSE);
+	glPointSize(2);
+	glColor4f(1, .6, .1, .8);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 4 * sizeof(GLfloat), &list[0]);
+	glDrawArrays(GL_POINTS, 0, list.size() / 4);
+
+	glPointSize(1);
+	glDepthMask(GL_TRUE);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
+	if(F::lighting()){
+		glEnable(GL_LIGHTING);
+	}
+}
+
+//Wireframes drawn with the opaque scene when orbs go through the
+//transparency pass
+void Renderer::drawOutlines()
+{
+	TRACE_ZONE("outlines");
+	vector<Point3D>& orbs = drawList[drawFront];
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, outlineVertex);
+
+	glPolygonMode(GL_FRONT,GL_LINE);
+	glColor3d(.5,.5,0);
+	for(unsigned int i = 0; i < orbs.size(); i++){
+		glPushMatrix();
+		glTranslatef(orbs[i].x, orbs[i].y, orbs[i].z);
+		glDrawElements(GL_TRIANGLES, orbIndexCount, GL_UNSIGNED_INT, orbIndex);
+		glPopMatrix();
+	}
+	glPolygonMode(GL_FRONT,GL_FILL);
 }
 
 void Renderer::drawHUD()
 {
-	char outputBuffer[30];
+	TRACE_ZONE("hud");
+	HudText text;
 	
+	formatHud(text, orbsCaptured, orbsReleased, score, getFPS());
 	glPushMatrix();
 
 	glEnable(GL_BLEND);
@@ -394,32 +911,139 @@ void Renderer::drawHUD()
 	//white text
 	glColor4f(1,1,1,1);
 
-	sprintf(outputBuffer, "Captured:    %i", orbsCaptured);
 	glRasterPos3f(-1.85,1.4,-2);
-	printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+	printString(GLUT_BITMAP_9_BY_15,text.captured);
 
-	sprintf(outputBuffer, "Remaining:   %i", orbsReleased - orbsCaptured);
 	glRasterPos3f(-1.85,1.35,-2);
-	printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+	printString(GLUT_BITMAP_9_BY_15,text.remaining);
 
-	sprintf(outputBuffer, "Score:       %i", score);
 	glRasterPos3f(-1.85,1.30,-2);
-	printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+	printString(GLUT_BITMAP_9_BY_15,text.score);
 
-	sprintf(outputBuffer, "FPS:         %#.2f", getFPS());
 	glRasterPos3f(-1.85,1.22,-2);
-	printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+	printString(GLUT_BITMAP_9_BY_15,text.fps);
 
 	if(paused){
-        sprintf(outputBuffer, "PAUSED");
 		glRasterPos3f(-.085,-.01,-2);
-		printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+		printString(GLUT_BITMAP_9_BY_15,"PAUSED");
 	}
 	
 	glEnable(GL_DEPTH_TEST);
 	glDisable(GL_BLEND);
 	
 	glPopMatrix();
+
+	drawRadar();
+}
+
+//The HUD is drawn unlocked, by when the radar's list may be the back
+//one, so its dots are copied out under drawLock. The copy grows as the
+//list did, not dot by dot.
+void Renderer::copyRadar(void)
+{
+	vector<GLfloat>& dots = radarList[drawFront];
+
+	if(radarDots.capacity() < dots.capacity()){
+		radarDots.reserve(dots.capacity());
+	}
+	radarDots.assign(dots.begin(), dots.end());
+}
+
+//Top right scope looking down the flashlight beam: each dot is an orb
+//in the beam, the rim is the edge of the light
+void Renderer::drawRadar()
+{
+	char outputBuffer[30];
+	vector<GLfloat>& dots = radarDots;
+	const float cx = 1.55, cy = 1.15, radius = .28;
+	const int SEGMENTS = 32;
+
+	glPushMatrix();
+
+	glEnable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+
+	//black disc
+	glColor4f(0,0,0,.7);
+	glBegin(GL_TRIANGLE_FAN);
+		glVertex3f(cx, cy, -2);
+		for(int i = 0; i <= SEGMENTS; i++){
+			float a = i * 2 * 3.14159265f / SEGMENTS;
+			glVertex3f(cx + radius*cos(a), cy + radius*sin(a), -2);
+		}
+	glEnd();
+
+	//rim and crosshair
+	glColor4f(0,.5,1,.8);
+	glBegin(GL_LINE_LOOP);
+		for(int i = 0; i < SEGMENTS; i++){
+			float a = i * 2 * 3.14159265f / SEGMENTS;
+			glVertex3f(cx + radius*cos(a), cy + radius*sin(a), -2);
+		}
+	glEnd();
+	glBegin(GL_LINES);
+		glVertex3f(cx - radius, cy, -2);
+		glVertex3f(cx + radius, cy, -2);
+		glVertex3f(cx, cy - radius, -2);
+		glVertex3f(cx, cy + radius, -2);
+	glEnd();
+
+	//orbs in the beam
+	glColor4f(1,.5,0,1);
+	glPointSize(2);
+	glBegin(GL_POINTS);
+		for(unsigned int i = 0; i + 1 < dots.size(); i += 2){
+			glVertex3f(cx + dots[i]*radius, cy + dots[i+1]*radius, -2);
+		}
+	glEnd();
+	glPointSize(1);
+
+	glColor4f(1,1,1,1);
+	sprintf(outputBuffer, "Targets: %i", (int)(dots.size() / 2));
+	glRasterPos3f(cx - radius, cy - radius - .07, -2);
+	printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glPopMatrix();
+}
+
+void Renderer::drawProfile()
+{
+	TRACE_ZONE("profile");
+	char outputBuffer[64];
+	int lines = profiler->getCount();
+	float bottom = 1.13 - lines*.05;
+
+	glPushMatrix();
+
+	glEnable(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+
+	//black background
+	glColor4f(0,0,0,.7);
+
+	glBegin(GL_QUADS);
+		glVertex3f(-1.9, 1.165, -2);
+		glVertex3f(-1.9, bottom, -2);
+		glVertex3f(-1.0, bottom, -2);
+		glVertex3f(-1.0, 1.165, -2);
+	glEnd();
+
+	//white text, one line per profiler entry
+	glColor4f(1,1,1,1);
+
+	for(int i = 0; i < lines; i++){
+		profiler->format(i, outputBuffer, sizeof(outputBuffer));
+		glRasterPos3f(-1.85, 1.12 - i*.05, -2);
+		printString(GLUT_BITMAP_9_BY_15,outputBuffer);
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glPopMatrix();
 }
 
 void Renderer::setScore(int points, int captured, int total)
@@ -454,15 +1078,25 @@ bool Renderer::getPaused()
 	return paused;
 }
 
+void Renderer::setProfiling(bool toggle)
+{
+	profiling = toggle;
+}
+
+bool Renderer::getProfiling()
+{
+	return profiling;
+}
+
 float Renderer::getFPS()
 {
 	static float fps = 0;
-	static clock_t last = 0;
-	clock_t now;
+	static long long last = 0;
+	long long now;
 	float delta;
 	
 	if(frameCount > 0){
-		now  = clock();
+		now  = nowNanos() / 1000000;
 		delta= (now - last);
 
 		if(delta > 1000){
@@ -475,8 +1109,12 @@ float Renderer::getFPS()
 	return fps;
 }
 
-void Renderer::printString(void* font, char* str)
+void Renderer::printString(void* font, const char* str)
 {
+	if(!text){
+		return;
+	}
+
 	for(unsigned int i = 0; i < strlen(str); i++)
 		glutBitmapCharacter(font,str[i]);
 }
\ No newline at end of file
@@ -9,35 +9,83 @@
 
 #ifndef RENDERER_H_
 #define RENDERER_H_
-#include <deque>
-#include <gl/glut.h>
-#include "camera.h"
+#include <mutex>
+#include <vector>
+#include <GL/glut.h>
+#include "Camera.h"
+#include "FrameArena.h"
+#include "FrameCapture.h"
+#include "JobSystem.h"
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "Transparency.h"
+#include "World.h"
 using namespace std;
 
+class CoreRenderer;
+
+//Which GL the frames are drawn with
+enum RenderBackend { BACKEND_FIXED, BACKEND_CORE };
+
+//Optional parts of the frame, or'd together
+enum RenderFeature
+{
+	FEATURE_TEXTURED = 1,
+	FEATURE_MATERIALS = 2,
+	FEATURE_LIGHTING = 4,
+	FEATURES_ALL = 7
+};
+
+//far plane; nothing past it is drawn, so the room is only built this far
+//out and the world only needs to be live this far out
+const int VIEW_DISTANCE = 200;
+
 class Renderer
 {
+	friend class CoreRenderer;
+
 public:
-			Renderer(int width, int height);
+			Renderer(int width, int height, RenderBackend backend = BACKEND_FIXED, int features = FEATURES_ALL);
 			~Renderer(void);
 	void	display(void);
-	int		getBoundary(void);
+	void	setText(bool toggle);
 	void	setCamera(Camera* inCamera);
 	Camera*	getCamera(void);
-	void	setWorld(deque<Point3D>* newWorld);
+	void	setWorld(World* newWorld);
+	void	setParticles(ParticleSystem* newParticles);
 	void	setScore(int points, int captured, int total);
 	void	setSplash(bool toggle);
 	bool	getSplash(void);
 	void	setPaused(bool toggle);
 	bool	getPaused(void);	
+	void	setProfiler(Profiler* newProfiler);
+	void	setProfiling(bool toggle);
+	bool	getProfiling(void);
+	void	prepareFrame(JobSystem* jobs, FrameArena* arena);
+	RenderBackend getBackend(void);
+	FrameCapture* getCapture(void);		//reads back what display() drew
+
+	//picks the copy of the draw passes compiled for these features, or
+	//with specialized false the one that checks the toggles as it goes
+	void	setFeatures(int features, bool specialized = true);
+	int		getFeatures(void);
 
 private:
+	void	initFixedFunction(void);
 	int		getScore(void);
 	float	getFPS(void);
-	void	initRoom(void);
-	void	drawRoom(void);
-	void	drawTreasures(void);
+	void	buildRoom(int back, const Point3D& eye);
+	void	initOrb(void);
+	template<class F> void drawScene(void);
+	template<class F> void drawRoom(void);
+	template<class F, bool ACCUMULATE> void drawTreasures(void);
+	template<class F> void drawParticles(void);
+	void	drawOutlines(void);
 	void	drawHUD(void);
-	void	printString(void* font, char* str);
+	void	drawRadar(void);
+	void	copyRadar(void);
+	void	drawProfile(void);
+	void	printString(void* font, const char* str);
 
 	int w, h;
 	int frameCount;
@@ -46,14 +94,45 @@ private:
 	int orbsReleased;
 	bool splash;
 	bool paused;
-	GLdouble* vertexBuffer;
-	GLdouble* normalBuffer;
-	GLdouble* textureCoord;
+	bool profiling;
+	bool text;
+	double	skyScroll;
+	GLfloat* orbVertex;					//unit sphere, doubles as its normals
+	GLfloat* outlineVertex;				//the same turned a quarter about x
+	GLuint* orbIndex;
+	int orbIndexCount;
 	Camera* camera;
-	deque<Point3D>* theWorld;
-	GLuint textureID[3];
+	World* theWorld;
+	ParticleSystem* particles;
+	Profiler* profiler;
+	GLuint textureID[4];
+	Transparency transparency;
+	FrameCapture capture;
+	CoreRenderer* core;					//NULL when drawing fixed function
+	void	(Renderer::*drawPass)(void);	//drawScene() for the features set
+
+	//camera and orbs to draw, filled by prepareFrame() and swapped in
+	//under drawLock
+	Mat4	viewMatrix[2];
+	vector<Point3D> drawList[2];
+	vector<char> drawMark[2];			//per drawList entry, see OrbMark
+	vector<GLfloat> radarList[2];		//x,y of each orb in the flashlight
+	vector<GLfloat> particleList[2];	//x,y,z and life left of each particle
+	vector<GLfloat> roomList[2];		//room tiles as quads, see buildRoom()
+	int roomFaces[2][7];				//face f is quads roomFaces[f] .. [f+1]
+	vector<unsigned int> targets;
+	vector<GLfloat> radarDots;			//radarList[drawFront] as it was under drawLock, for the HUD
+	int drawFront;
+	mutex drawLock;
+
+	//how orbs are picked out by the flashlight
+	enum OrbMark { ORB_PLAIN, ORB_TARGETED, ORB_AIMED };
 
-	static const int WORLDSCALE = 40;
+	static const int SPOT_ANGLE = 45;
+	static const int SPOT_RANGE = 30;
+	static const int FOV = 75;
+	static const int ORB_SLICES = 25;
+	static const int ORB_STACKS = 25;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+/*
+ *	Rng.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef RNG_H_
+#define RNG_H_
+
+//Small xorshift64* generator. Unlike rand() its whole state is one value,
+//so a world can be reproduced or saved along with it.
+class Rng
+{
+public:
+	Rng(unsigned long long seed = 1)
+	{
+		setState(seed);
+	}
+
+	unsigned int next(void)
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return (unsigned int)((state * 2685821657736338717ULL) >> 32);
+	}
+
+	//0 <= result < n
+	int nextInt(int n)
+	{
+		return next() % n;
+	}
+
+	unsigned long long getState(void)
+	{
+		return state;
+	}
+
+	void setState(unsigned long long s)
+	{
+		//an all zero state would only ever produce zeros
+		state = s ? s : 0x9E3779B97F4A7C15ULL;
+	}
+
+private:
+	unsigned long long state;
+};
+
+#endif
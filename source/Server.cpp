@@ -0,0 +1,506 @@
+/*
+ *	Server.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	The dedicated server. Each tick it reads every client's input, moves
+	the players, resolves captures against the shared world and sends each
+	client a snapshot of the orbs within its interest radius. Snapshots
+	are deltas from the newest snapshot the client has acknowledged, so
+	once a client has caught up it is only sent orbs that appeared or went
+	away near it. Orbs are picked nearest first when a delta is too big
+	for one packet; the rest follow in later ticks.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "Server.h"
+#include "Timer.h"
+
+//type, tick, baseline, position, captured, released
+static const int HEADER_SIZE = 1 + 4 + 4 + 12 + 5 + 5;
+
+//bytes an added orb takes besides its id
+static const int ORB_SIZE = 6;
+
+static bool byId(const SnapshotOrb& a, const SnapshotOrb& b)
+{
+	return a.id < b.id;
+}
+
+Server::Server(World* inWorld, JobSystem* inJobs, int inTickRate)
+			: world(inWorld),
+			  jobs(inJobs),
+			  tickCount(1),
+			  tickRate(inTickRate),
+			  population(0),
+			  released(0),
+			  bytesSent(0),
+			  bytesReceived(0),
+			  packetsSent(0),
+			  largestPacket(0)
+{
+	setInterestRadius(16);
+	centers.reserve(MAX_CLIENTS);
+	world->reserveRegion(MAX_CLIENTS);
+}
+
+Server::~Server(void)
+{
+	while(!clients.empty()){
+		disconnect(clients.size() - 1);
+	}
+}
+
+bool Server::open(unsigned short port)
+{
+	return socket.open(port);
+}
+
+unsigned short Server::getPort(void)
+{
+	return socket.getPort();
+}
+
+void Server::setInterestRadius(double radius)
+{
+	//a little slack so orbs on the edge don't flicker in and out
+	interestRadius = radius;
+	keepRadius = radius * 1.1;
+}
+
+double Server::getInterestRadius(void)
+{
+	return interestRadius;
+}
+
+double Server::getKeepRadius(void)
+{
+	return keepRadius;
+}
+
+//The server keeps the world topped up to this many orbs
+void Server::setPopulation(int orbs)
+{
+	population = orbs;
+}
+
+void Server::setSeed(unsigned int seed)
+{
+	rng.setState(seed);
+}
+
+unsigned int Server::getTick(void)
+{
+	return tickCount;
+}
+
+int Server::getClientCount(void)
+{
+	return clients.size();
+}
+
+long long Server::getBytesSent(void)
+{
+	return bytesSent;
+}
+
+long long Server::getBytesReceived(void)
+{
+	return bytesReceived;
+}
+
+long long Server::getPacketsSent(void)
+{
+	return packetsSent;
+}
+
+int Server::getLargestPacket(void)
+{
+	return largestPacket;
+}
+
+double Server::getTickTime(double percentile)
+{
+	return tickTimes.getPercentile(percentile);
+}
+
+bool Server::getPlayerPosition(const NetAddress& addr, Point3D& pos)
+{
+	Client* c = findClient(addr);
+
+	if(!c){
+		return false;
+	}
+	pos = c->player->getPosition();
+	return true;
+}
+
+Server::Client* Server::findClient(const NetAddress& addr)
+{
+	for(unsigned int i = 0; i < clients.size(); i++){
+		if(clients[i]->addr == addr){
+			return clients[i];
+		}
+	}
+	return NULL;
+}
+
+void Server::connect(const NetAddress& addr)
+{
+	int bound = world->getBoundary();
+	Client* c;
+
+	if(clients.size() >= MAX_CLIENTS){
+		return;
+	}
+
+	c = clientPool.create();
+	c->addr = addr;
+
+	//drop new players somewhere random in the room
+	c->camera.setBoundary(bound);
+	c->camera.setLocation(rng.nextInt(bound) - rng.nextInt(bound),
+						  rng.nextInt(bound) - rng.nextInt(bound),
+						  rng.nextInt(bound) - rng.nextInt(bound));
+	c->player = playerPool.create(&c->camera);
+
+	c->input.buttons = 0;
+	c->input.yaw = c->input.pitch = c->input.roll = 0;
+	c->sequence = 0;
+	c->ack = NO_TICK;
+	c->lastHeard = tickCount;
+	c->captured = 0;
+	c->packetSize = 0;
+	for(int i = 0; i < HISTORY; i++){
+		c->history[i].tick = NO_TICK;
+	}
+	reserveScratch(c);
+
+	clients.push_back(c);
+}
+
+//Sizes a client's lists for the most orbs it can expect around it, so
+//they don't keep growing as it flies into busier parts of the room.
+//Spawns pile up towards the middle (see World::spawn), where there are
+//population / bound^3 orbs per unit volume.
+void Server::reserveScratch(Client* c)
+{
+	double bound = world->getBoundary();
+	double sphere = 4.0 / 3.0 * 3.14159265 * keepRadius * keepRadius * keepRadius;
+	double expected = fmin(population, population * sphere / (bound * bound * bound));
+	int capacity = (int)(expected + 4 * sqrt(expected)) + 64;
+
+	c->hits.reserve(256);				//far more than one move can sweep up
+	c->near.reserve(capacity);
+	c->known.reserve(population + 64);
+	c->adds.reserve(capacity);
+	c->removes.reserve(capacity);
+	c->candidates.reserve(capacity);
+	c->sent.reserve(capacity);
+	for(int i = 0; i < HISTORY; i++){
+		c->history[i].ids.reserve(capacity);
+	}
+}
+
+void Server::disconnect(int index)
+{
+	playerPool.destroy(clients[index]->player);
+	clientPool.destroy(clients[index]);
+	clients.erase(clients.begin() + index);
+}
+
+void Server::receive(void)
+{
+	unsigned char buffer[MAX_PACKET];
+	unsigned int sequence, ack;
+	PlayerInput input;
+	NetAddress from;
+	Client* c;
+	int got;
+
+	while((got = socket.receive(from, buffer, sizeof(buffer))) >= 0){
+		bytesReceived += got;
+		if(got == 0){
+			continue;
+		}
+
+		PacketReader in(buffer, got);
+		c = findClient(from);
+
+		switch(buffer[0]){
+		case MSG_CONNECT:
+			if(!c){
+				connect(from);
+			}
+			break;
+		case MSG_INPUT:
+			//late or duplicate inputs are dropped
+			if(c && readInput(in, sequence, ack, input) && sequence > c->sequence){
+				c->sequence = sequence;
+				c->ack = ack;
+				c->lastHeard = tickCount;
+
+				//turns add up if several inputs land in one tick
+				c->input.buttons = input.buttons;
+				c->input.yaw += input.yaw;
+				c->input.pitch += input.pitch;
+				c->input.roll += input.roll;
+			}
+			break;
+		case MSG_DISCONNECT:
+			for(unsigned int i = 0; c && i < clients.size(); i++){
+				if(clients[i] == c){
+					disconnect(i);
+					break;
+				}
+			}
+			break;
+		}
+	}
+}
+
+//Sweeps every player along its move and takes the orbs it passed through.
+//An orb two players reach in the same tick goes to only one of them.
+//Returns how many were taken.
+int Server::capture(void)
+{
+	int count = clients.size();
+	int numClaims = 0, taken = 0;
+	int last = -1;
+	pair<int, int>* claims;
+
+	auto sweep = [&](int first, int end){
+		for(int i = first; i < end; i++){
+			Client* c = clients[i];
+			world->sweep(c->player->getLastPosition(), c->player->getPosition(), CAPTURE_RADIUS, c->hits);
+		}
+	};
+	jobs->parallelFor(0, count, 1, sweep);
+
+	for(int i = 0; i < count; i++){
+		numClaims += clients[i]->hits.size();
+	}
+	claims = arena.alloc<pair<int, int> >(numClaims);
+	numClaims = 0;
+	for(int i = 0; i < count; i++){
+		for(unsigned int j = 0; j < clients[i]->hits.size(); j++){
+			claims[numClaims++] = make_pair(clients[i]->hits[j], i);
+		}
+	}
+	sort(claims, claims + numClaims);
+
+	//back to front, so the orb swapped into each hole is already done with
+	for(int i = numClaims - 1; i >= 0; i--){
+		if(claims[i].first != last){
+			last = claims[i].first;
+			world->remove(last);
+			clients[claims[i].second]->captured++;
+			taken++;
+		}
+	}
+	return taken;
+}
+
+void Server::buildSnapshot(Client* c)
+{
+	Point3D pos = c->player->getPosition();
+	Known* base = NULL;
+	Known& next = c->history[tickCount % HISTORY];
+	SnapshotHeader header;
+	Nearby candidate;
+	double keep2 = keepRadius * keepRadius;
+	int bound = world->getBoundary();
+	int budget, numRemoves, numAdds, maxAdds, lo, hi, index;
+	unsigned int i, j, k;
+
+	//only deltas against a snapshot we still remember
+	if(c->ack != NO_TICK && tickCount - c->ack < (unsigned int)HISTORY &&
+			c->history[c->ack % HISTORY].tick == c->ack){
+		base = &c->history[c->ack % HISTORY];
+	}
+
+	//known orbs that were captured or are now out of range go, the rest
+	//are marked so they aren't sent again
+	c->removes.clear();
+	c->known.resize(world->size());
+	for(i = 0; base && i < base->ids.size(); i++){
+		index = world->indexOf(base->ids[i]);
+		if(index >= 0){
+			if(distanceSquared((*world)[index].pos, pos) <= keep2){
+				c->known[index] = 1;
+				continue;
+			}
+		}
+		c->removes.push_back(base->ids[i]);
+	}
+
+	//orbs in range the client doesn't know about come
+	world->query(pos, interestRadius, c->near);
+	c->adds.clear();
+	for(i = 0; i < c->near.size(); i++){
+		if(!c->known[c->near[i]]){
+			candidate.index = c->near[i];
+			candidate.dist2 = distanceSquared((*world)[c->near[i]].pos, pos);
+			c->adds.push_back(candidate);
+		}
+	}
+
+	//clear the marks for next time
+	for(i = 0; base && i < base->ids.size(); i++){
+		index = world->indexOf(base->ids[i]);
+		if(index >= 0){
+			c->known[index] = 0;
+		}
+	}
+
+	//removals go first, but leave at least half the packet for adds
+	budget = MAX_PACKET - HEADER_SIZE;
+	numRemoves = c->removes.size();
+	while(numRemoves > 0 && idListSize(&c->removes[0], numRemoves) > budget / 2){
+		numRemoves /= 2;
+	}
+	budget -= idListSize(numRemoves ? &c->removes[0] : NULL, numRemoves);
+
+	//then as many of the nearest new orbs as fit; no more than this
+	//many could, so only those need to be put in order
+	maxAdds = budget / (ORB_SIZE + 1);
+	if(maxAdds > (int)c->adds.size()){
+		maxAdds = c->adds.size();
+	}
+	auto nearer = [](const Nearby& a, const Nearby& b){ return a.dist2 < b.dist2; };
+	nth_element(c->adds.begin(), c->adds.begin() + maxAdds, c->adds.end(), nearer);
+	sort(c->adds.begin(), c->adds.begin() + maxAdds, nearer);
+
+	c->sent.resize(maxAdds);
+	for(int n = 0; n < maxAdds; n++){
+		const Orb& o = (*world)[c->adds[n].index];
+		c->sent[n].id = o.id;
+		c->sent[n].x = quantize(o.pos.x, bound);
+		c->sent[n].y = quantize(o.pos.y, bound);
+		c->sent[n].z = quantize(o.pos.z, bound);
+	}
+	c->candidates.assign(c->sent.begin(), c->sent.end());
+
+	auto fill = [&](int count){
+		int bytes = varintSize(count);
+		unsigned int last = 0;
+
+		c->sent.assign(c->candidates.begin(), c->candidates.begin() + count);
+		sort(c->sent.begin(), c->sent.end(), byId);
+
+		for(int n = 0; n < count; n++){
+			bytes += varintSize(c->sent[n].id - last) + ORB_SIZE;
+			last = c->sent[n].id;
+		}
+		return bytes;
+	};
+
+	//encoded size only grows with the count, so binary search for it
+	lo = 0;
+	hi = maxAdds;
+	while(lo < hi){
+		int mid = (lo + hi + 1) / 2;
+		if(fill(mid) <= budget)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	numAdds = lo;
+	fill(numAdds);
+
+	header.tick = tickCount;
+	header.baseline = base ? base->tick : NO_TICK;
+	header.pos = pos;
+	header.captured = c->captured;
+	header.released = released;
+
+	PacketWriter out(c->packet, MAX_PACKET);
+	writeSnapshot(out, header, numRemoves ? &c->removes[0] : NULL, numRemoves,
+		numAdds ? &c->sent[0] : NULL, numAdds);
+	c->packetSize = out.getSize();
+
+	//what the client will know if this snapshot gets through
+	next.tick = tickCount;
+	next.ids.clear();
+	i = j = k = 0;
+	while(base && i < base->ids.size()){
+		unsigned int id = base->ids[i++];
+
+		while(j < (unsigned int)numRemoves && c->removes[j] < id)
+			j++;
+		if(j < (unsigned int)numRemoves && c->removes[j] == id)
+			continue;
+		while(k < (unsigned int)numAdds && c->sent[k].id < id)
+			next.ids.push_back(c->sent[k++].id);
+		next.ids.push_back(id);
+	}
+	while(k < (unsigned int)numAdds){
+		next.ids.push_back(c->sent[k++].id);
+	}
+}
+
+void Server::tick(void)
+{
+	long long start = nowNanos();
+	double dt = 1.0 / tickRate;
+	int count, taken;
+
+	arena.reset();
+	receive();
+
+	//forget clients that have gone quiet
+	for(int i = clients.size() - 1; i >= 0; i--){
+		if(tickCount - clients[i]->lastHeard > (unsigned int)(TIMEOUT_SECONDS * tickRate)){
+			disconnect(i);
+		}
+	}
+
+	for(unsigned int i = 0; i < clients.size(); i++){
+		Client* c = clients[i];
+		c->player->move(c->input, dt);
+		c->input.yaw = c->input.pitch = c->input.roll = 0;
+	}
+
+	//only the chunks around the players are simulated, the rest of the
+	//world just keeps its orbs
+	centers.clear();
+	for(unsigned int i = 0; i < clients.size(); i++){
+		centers.push_back(clients[i]->player->getPosition());
+	}
+	world->setRegion(centers.data(), centers.size(), keepRadius);
+
+	world->updateGrid();
+	count = world->size();
+	taken = capture();
+	while(world->getTotal() < population){
+		world->spawn(rng);
+		released++;
+	}
+	if(world->size() != count || taken){
+		world->updateGrid();
+	}
+
+	auto build = [&](int first, int last){
+		for(int i = first; i < last; i++){
+			buildSnapshot(clients[i]);
+		}
+	};
+	jobs->parallelFor(0, clients.size(), 1, build);
+
+	for(unsigned int i = 0; i < clients.size(); i++){
+		Client* c = clients[i];
+		socket.send(c->addr, c->packet, c->packetSize);
+		bytesSent += c->packetSize;
+		packetsSent++;
+		if(c->packetSize > largestPacket){
+			largestPacket = c->packetSize;
+		}
+	}
+
+	tickTimes.record(nowNanos() - start);
+	tickCount++;
+}
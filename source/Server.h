@@ -0,0 +1,126 @@
+/*
+ *	Server.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+#include <vector>
+#include "Camera.h"
+#include "World.h"
+#include "Player.h"
+#include "Rng.h"
+#include "Net.h"
+#include "Snapshot.h"
+#include "JobSystem.h"
+#include "LatencyStats.h"
+#include "FrameArena.h"
+#include "Pool.h"
+using namespace std;
+
+//Authoritative game server: owns the world, moves every player from the
+//inputs they send and streams each of them the orbs around them
+class Server
+{
+public:
+			Server(World* world, JobSystem* jobs, int tickRate);
+			~Server(void);
+	bool	open(unsigned short port);
+	unsigned short	getPort(void);
+	void	setInterestRadius(double radius);
+	void	setPopulation(int orbs);
+	void	setSeed(unsigned int seed);
+	void	tick(void);
+
+	unsigned int	getTick(void);
+	int		getClientCount(void);
+	bool	getPlayerPosition(const NetAddress& addr, Point3D& pos);
+	double	getInterestRadius(void);
+	double	getKeepRadius(void);
+
+	//traffic since the server started, payload only
+	long long	getBytesSent(void);
+	long long	getBytesReceived(void);
+	long long	getPacketsSent(void);
+	int		getLargestPacket(void);
+	double	getTickTime(double percentile);
+
+private:
+	static const int HISTORY = 16;		//snapshots a baseline can be taken from
+	static const int MAX_CLIENTS = 256;
+	static const int TIMEOUT_SECONDS = 10;
+
+	//orb ids a client holds after decoding the snapshot sent at tick
+	struct Known
+	{
+		unsigned int tick;
+		vector<unsigned int> ids;
+	};
+
+	//an orb in range, as a candidate for the next snapshot
+	struct Nearby
+	{
+		int index;
+		double dist2;
+	};
+
+	struct Client
+	{
+		NetAddress addr;
+		Camera camera;
+		Player* player;
+		PlayerInput input;
+		unsigned int sequence;		//newest input applied
+		unsigned int ack;			//newest snapshot the client decoded
+		unsigned int lastHeard;
+		int captured;
+		Known history[HISTORY];
+
+		//per tick scratch, so clients can be worked on in parallel
+		vector<int> hits;
+		vector<int> near;
+		vector<char> known;			//baseline orbs still in range, by index
+		vector<Nearby> adds;
+		vector<unsigned int> removes;
+		vector<SnapshotOrb> candidates;	//nearest first
+		vector<SnapshotOrb> sent;		//in id order
+		unsigned char packet[MAX_PACKET];
+		int packetSize;
+	};
+
+	void	receive(void);
+	Client*	findClient(const NetAddress& addr);
+	void	connect(const NetAddress& addr);
+	void	disconnect(int index);
+	void	reserveScratch(Client* c);
+	int		capture(void);
+	void	buildSnapshot(Client* c);
+
+	World* world;
+	JobSystem* jobs;
+	UdpSocket socket;
+	Rng rng;
+	vector<Client*> clients;
+	vector<Point3D> centers;		//of the world's active region
+	unsigned int tickCount;
+	int tickRate;
+	int population;
+	unsigned int released;
+	double interestRadius;
+	double keepRadius;				//known orbs stay until they drift past this
+	FrameArena arena;				//per tick scratch
+	Pool<Client> clientPool;
+	Pool<Player> playerPool;
+
+	long long bytesSent;
+	long long bytesReceived;
+	long long packetsSent;
+	int largestPacket;
+	LatencyStats tickTimes;
+};
+
+#endif
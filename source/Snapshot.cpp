@@ -0,0 +1,274 @@
+/*
+ *	Snapshot.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Wire format shared by the server and its clients. Everything is
+	written byte by byte so the format doesn't depend on the compiler's
+	struct layout or the machine's byte order.
+ */
+
+#include <string.h>
+#include "Snapshot.h"
+
+PacketWriter::PacketWriter(unsigned char* buffer, int capacity)
+			: buf(buffer),
+			  cap(capacity),
+			  size(0),
+			  overflow(false)
+{
+}
+
+void PacketWriter::putByte(unsigned int v)
+{
+	if(size >= cap){
+		overflow = true;
+		return;
+	}
+	buf[size++] = (unsigned char)v;
+}
+
+void PacketWriter::putShort(unsigned int v)
+{
+	putByte(v);
+	putByte(v >> 8);
+}
+
+void PacketWriter::putLong(unsigned int v)
+{
+	putShort(v);
+	putShort(v >> 16);
+}
+
+//7 bits at a time, high bit set while more follow
+void PacketWriter::putVarint(unsigned int v)
+{
+	while(v >= 0x80){
+		putByte((v & 0x7F) | 0x80);
+		v >>= 7;
+	}
+	putByte(v);
+}
+
+void PacketWriter::putFloat(float v)
+{
+	unsigned int bits;
+	memcpy(&bits, &v, sizeof(bits));
+	putLong(bits);
+}
+
+int PacketWriter::getSize(void)
+{
+	return size;
+}
+
+bool PacketWriter::overflowed(void)
+{
+	return overflow;
+}
+
+PacketReader::PacketReader(const unsigned char* buffer, int inSize)
+			: buf(buffer),
+			  size(inSize),
+			  pos(0),
+			  fail(false)
+{
+}
+
+unsigned int PacketReader::getByte(void)
+{
+	if(pos >= size){
+		fail = true;
+		return 0;
+	}
+	return buf[pos++];
+}
+
+unsigned int PacketReader::getShort(void)
+{
+	unsigned int lo = getByte();
+	return lo | (getByte() << 8);
+}
+
+unsigned int PacketReader::getLong(void)
+{
+	unsigned int lo = getShort();
+	return lo | (getShort() << 16);
+}
+
+unsigned int PacketReader::getVarint(void)
+{
+	unsigned int v = 0;
+	unsigned int b;
+
+	for(int shift = 0; shift < 35; shift += 7){
+		b = getByte();
+		v |= (b & 0x7F) << shift;
+		if(!(b & 0x80)){
+			return v;
+		}
+	}
+	fail = true;
+	return 0;
+}
+
+float PacketReader::getFloat(void)
+{
+	unsigned int bits = getLong();
+	float v;
+	memcpy(&v, &bits, sizeof(v));
+	return v;
+}
+
+bool PacketReader::failed(void)
+{
+	return fail;
+}
+
+int varintSize(unsigned int v)
+{
+	int n = 1;
+	while(v >= 0x80){
+		v >>= 7;
+		n++;
+	}
+	return n;
+}
+
+unsigned short quantize(double v, int bound)
+{
+	double t = (v + bound + 1) / (2.0 * (bound + 1));
+
+	if(t < 0)
+		t = 0;
+	else if(t > 1)
+		t = 1;
+	return (unsigned short)(t * 65535 + 0.5);
+}
+
+double dequantize(unsigned short q, int bound)
+{
+	return q / 65535.0 * (2.0 * (bound + 1)) - (bound + 1);
+}
+
+int idListSize(const unsigned int* ids, int count)
+{
+	int bytes = varintSize(count);
+	unsigned int last = 0;
+
+	for(int i = 0; i < count; i++){
+		bytes += varintSize(ids[i] - last);
+		last = ids[i];
+	}
+	return bytes;
+}
+
+void writeSnapshot(PacketWriter& out, const SnapshotHeader& header,
+			const unsigned int* removes, int numRemoves,
+			const SnapshotOrb* adds, int numAdds)
+{
+	unsigned int last;
+
+	out.putByte(MSG_SNAPSHOT);
+	out.putLong(header.tick);
+	out.putLong(header.baseline);
+	out.putFloat((float)header.pos.x);
+	out.putFloat((float)header.pos.y);
+	out.putFloat((float)header.pos.z);
+	out.putVarint(header.captured);
+	out.putVarint(header.released);
+
+	out.putVarint(numRemoves);
+	last = 0;
+	for(int i = 0; i < numRemoves; i++){
+		out.putVarint(removes[i] - last);
+		last = removes[i];
+	}
+
+	out.putVarint(numAdds);
+	last = 0;
+	for(int i = 0; i < numAdds; i++){
+		out.putVarint(adds[i].id - last);
+		out.putShort(adds[i].x);
+		out.putShort(adds[i].y);
+		out.putShort(adds[i].z);
+		last = adds[i].id;
+	}
+}
+
+bool readSnapshot(PacketReader& in, SnapshotHeader& header,
+			vector<unsigned int>& removes, vector<SnapshotOrb>& adds)
+{
+	SnapshotOrb orb;
+	unsigned int count, last;
+
+	if(in.getByte() != MSG_SNAPSHOT){
+		return false;
+	}
+	header.tick = in.getLong();
+	header.baseline = in.getLong();
+	header.pos.x = in.getFloat();
+	header.pos.y = in.getFloat();
+	header.pos.z = in.getFloat();
+	header.captured = in.getVarint();
+	header.released = in.getVarint();
+
+	//every entry takes at least a byte, so a count past the packet
+	//size can only be garbage
+	count = in.getVarint();
+	if(count > MAX_PACKET){
+		return false;
+	}
+	removes.resize(count);
+	last = 0;
+	for(unsigned int i = 0; i < count; i++){
+		last += in.getVarint();
+		removes[i] = last;
+	}
+
+	count = in.getVarint();
+	if(count > MAX_PACKET){
+		return false;
+	}
+	adds.resize(count);
+	last = 0;
+	for(unsigned int i = 0; i < count; i++){
+		last += in.getVarint();
+		orb.id = last;
+		orb.x = in.getShort();
+		orb.y = in.getShort();
+		orb.z = in.getShort();
+		adds[i] = orb;
+	}
+
+	return !in.failed();
+}
+
+void writeInput(PacketWriter& out, unsigned int sequence, unsigned int ack, const PlayerInput& input)
+{
+	out.putByte(MSG_INPUT);
+	out.putLong(sequence);
+	out.putLong(ack);
+	out.putByte(input.buttons);
+	out.putFloat(input.yaw);
+	out.putFloat(input.pitch);
+	out.putFloat(input.roll);
+}
+
+bool readInput(PacketReader& in, unsigned int& sequence, unsigned int& ack, PlayerInput& input)
+{
+	if(in.getByte() != MSG_INPUT){
+		return false;
+	}
+	sequence = in.getLong();
+	ack = in.getLong();
+	input.buttons = in.getByte();
+	input.yaw = in.getFloat();
+	input.pitch = in.getFloat();
+	input.roll = in.getFloat();
+
+	return !in.failed();
+}
@@ -0,0 +1,111 @@
+/*
+ *	Snapshot.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+#include <vector>
+#include "Camera.h"
+#include "Player.h"
+using namespace std;
+
+const unsigned short SERVER_PORT = 7777;
+const int MAX_PACKET = 1200;			//stay clear of fragmentation
+const unsigned int NO_TICK = 0xFFFFFFFF;
+
+enum MessageType
+{
+	MSG_CONNECT = 1,		//client -> server
+	MSG_INPUT,				//client -> server, every tick
+	MSG_SNAPSHOT,			//server -> client, every tick
+	MSG_DISCONNECT			//either way
+};
+
+//Writes little endian values into a fixed buffer; anything past the end
+//is dropped and flagged
+class PacketWriter
+{
+public:
+			PacketWriter(unsigned char* buffer, int capacity);
+	void	putByte(unsigned int v);
+	void	putShort(unsigned int v);
+	void	putLong(unsigned int v);
+	void	putVarint(unsigned int v);
+	void	putFloat(float v);
+	int		getSize(void);
+	bool	overflowed(void);
+
+private:
+	unsigned char* buf;
+	int cap;
+	int size;
+	bool overflow;
+};
+
+class PacketReader
+{
+public:
+			PacketReader(const unsigned char* buffer, int size);
+	unsigned int	getByte(void);
+	unsigned int	getShort(void);
+	unsigned int	getLong(void);
+	unsigned int	getVarint(void);
+	float	getFloat(void);
+	bool	failed(void);
+
+private:
+	const unsigned char* buf;
+	int size;
+	int pos;
+	bool fail;
+};
+
+//Bytes putVarint() takes for v
+int		varintSize(unsigned int v);
+
+//Orb positions travel as 16 bits per axis across the room
+unsigned short	quantize(double v, int bound);
+double	dequantize(unsigned short q, int bound);
+
+//An orb as a client knows it
+struct SnapshotOrb
+{
+	unsigned int id;
+	unsigned short x, y, z;
+};
+
+/*
+ *	A snapshot is a delta from an earlier snapshot the client acknowledged
+ *	(the baseline), or from nothing when baseline is NO_TICK:
+ *		type, tick, baseline, player position, captured, released,
+ *		removed orb ids, added orbs
+ *	Ids are sent sorted as varint gaps from the previous id, so a run of
+ *	nearby orbs costs a byte or two each plus six for the position.
+ */
+struct SnapshotHeader
+{
+	unsigned int tick;
+	unsigned int baseline;
+	Point3D pos;
+	unsigned int captured;
+	unsigned int released;
+};
+
+//Encoded size of a sorted id list, gaps and count included
+int		idListSize(const unsigned int* ids, int count);
+void	writeSnapshot(PacketWriter& out, const SnapshotHeader& header,
+			const unsigned int* removes, int numRemoves,
+			const SnapshotOrb* adds, int numAdds);
+bool	readSnapshot(PacketReader& in, SnapshotHeader& header,
+			vector<unsigned int>& removes, vector<SnapshotOrb>& adds);
+
+//Inputs carry the last snapshot tick the client decoded as its ack
+void	writeInput(PacketWriter& out, unsigned int sequence, unsigned int ack, const PlayerInput& input);
+bool	readInput(PacketReader& in, unsigned int& sequence, unsigned int& ack, PlayerInput& input);
+
+#endif
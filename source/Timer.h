@@ -0,0 +1,32 @@
+/*
+ *	Timer.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+#include <chrono>
+#include <thread>
+
+//Monotonic clock in nanoseconds
+inline long long nowNanos(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+inline void sleepMillis(int ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline void sleepNanos(long long ns)
+{
+	std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+}
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ *	TimingWheel.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Hierarchical timing wheel. Wheel 0 has a slot per tick; a timer more
+	than SLOTS ticks out goes in wheel 1, whose slots are SLOTS ticks
+	each, and so on up. Slot lists are doubly linked through indices
+	into the timer array, so cancel() unlinks in place. Each time wheel 0
+	wraps, the slot of wheel 1 now coming due is spread back out over
+	wheel 0 (and so on up, when wheel 1 wraps too); a timer is moved at
+	most once per wheel on its way down.
+ */
+
+#include <string.h>
+#include "TimingWheel.h"
+
+TimingWheel::TimingWheel(void)
+			: freeHead(-1),
+			  pending(0),
+			  now(0)
+{
+	memset(heads, -1, sizeof(heads));
+}
+
+//Fires delay ticks from now, at least the next tick
+TimerId TimingWheel::schedule(unsigned int delay, TimerFunc func, void* data, unsigned int arg)
+{
+	int t;
+
+	if(freeHead >= 0){
+		t = freeHead;
+		freeHead = timers[t].next;
+	}
+	else {
+		Timer fresh;
+		fresh.generation = 1;
+		timers.push_back(fresh);
+		t = timers.size() - 1;
+	}
+
+	Timer& timer = timers[t];
+	timer.expires = now + (delay ? delay : 1);
+	timer.func = func;
+	timer.data = data;
+	timer.arg = arg;
+	insert(t);
+	pending++;
+
+	return (TimerId)timer.generation << 32 | (unsigned int)t;
+}
+
+bool TimingWheel::cancel(TimerId id)
+{
+	unsigned int t = (unsigned int)id;
+
+	if(id == 0 || t >= timers.size() || timers[t].generation != (unsigned int)(id >> 32) ||
+			timers[t].slot < 0){
+		return false;
+	}
+
+	unlink(t);
+	release(t);
+	return true;
+}
+
+//Moves on a tick and runs every timer due on it, in no set order. They
+//may schedule and cancel others as they go; anything they schedule
+//fires on a later tick.
+int TimingWheel::advance(void)
+{
+	int fired = 0;
+	int index;
+
+	now++;
+	index = now & (SLOTS - 1);
+	if(index == 0){
+		cascade(1);
+	}
+
+	int& head = heads[index];
+	while(head >= 0){
+		int t = head;
+		TimerFunc func = timers[t].func;
+		void* data = timers[t].data;
+		unsigned int arg = timers[t].arg;
+
+		unlink(t);
+		release(t);
+		func(data, arg);
+		fired++;
+	}
+
+	return fired;
+}
+
+//Empties wheel level's current slot into the wheels below, after its
+//own turn has moved the one above on
+void TimingWheel::cascade(int level)
+{
+	int index;
+
+	if(level >= LEVELS){
+		return;
+	}
+	index = (now >> (BITS * level)) & (SLOTS - 1);
+	if(index == 0){
+		cascade(level + 1);
+	}
+
+	int& head = heads[level * SLOTS + index];
+	while(head >= 0){
+		int t = head;
+		unlink(t);
+		insert(t);
+	}
+}
+
+//Into the lowest wheel that reaches its expiry
+void TimingWheel::insert(int t)
+{
+	Timer& timer = timers[t];
+	unsigned long long delta = timer.expires - now;
+	int level = 0, slot;
+
+	//a timer due now, found while cascading, goes in this tick's slot
+	while(level < LEVELS - 1 && delta >= (1ULL << (BITS * (level + 1)))){
+		level++;
+	}
+	if(delta >= (1ULL << (BITS * LEVELS))){
+		//beyond the top wheel: park it in the farthest slot, and it will be
+		//placed again when that comes round
+		slot = (level * SLOTS) + (((now >> (BITS * level)) - 1) & (SLOTS - 1));
+	}
+	else {
+		slot = (level * SLOTS) + ((timer.expires >> (BITS * level)) & (SLOTS - 1));
+	}
+
+	timer.slot = slot;
+	timer.prev = -1;
+	timer.next = heads[slot];
+	if(heads[slot] >= 0){
+		timers[heads[slot]].prev = t;
+	}
+	heads[slot] = t;
+}
+
+void TimingWheel::unlink(int t)
+{
+	Timer& timer = timers[t];
+
+	if(timer.prev >= 0)
+		timers[timer.prev].next = timer.next;
+	else
+		heads[timer.slot] = timer.next;
+	if(timer.next >= 0){
+		timers[timer.next].prev = timer.prev;
+	}
+}
+
+void TimingWheel::release(int t)
+{
+	Timer& timer = timers[t];
+
+	timer.slot = -1;
+	timer.generation++;
+	if(timer.generation == 0){
+		timer.generation = 1;
+	}
+	timer.next = freeHead;
+	freeHead = t;
+	pending--;
+}
+
+void TimingWheel::clear(void)
+{
+	for(unsigned int t = 0; t < timers.size(); t++){
+		if(timers[t].slot >= 0){
+			unlink(t);
+			release(t);
+		}
+	}
+}
+
+void TimingWheel::reserve(int count)
+{
+	timers.reserve(count);
+}
+
+int		TimingWheel::size(void)						{ return pending; }
+unsigned long long	TimingWheel::getTick(void)		{ return now; }
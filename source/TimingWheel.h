@@ -0,0 +1,72 @@
+/*
+ *	TimingWheel.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef TIMINGWHEEL_H_
+#define TIMINGWHEEL_H_
+#include <vector>
+using namespace std;
+
+//What a timer calls when it fires, with the data and arg it was given
+typedef void (*TimerFunc)(void* data, unsigned int arg);
+
+//Names one scheduled timer; 0 is never handed out. A timer that has
+//fired or been cancelled keeps its id retired, so cancelling late is
+//harmless.
+typedef unsigned long long TimerId;
+
+//Timers counted in simulation ticks, in a hierarchical timing wheel:
+//LEVELS wheels of SLOTS slots each, every slot of one wheel as long as
+//a whole turn of the one below. A timer goes in the slot of the lowest
+//wheel its expiry reaches; when a wheel comes round, the next slot of
+//the wheel above is emptied into it. Scheduling and cancelling are a
+//list insert and unlink, and advance() only looks at the timers in one
+//slot, so the cost doesn't grow with how many are waiting. Timers live
+//in one array with a free list; it only grows when more are pending at
+//once than ever before. Not thread safe: the simulation owns it.
+class TimingWheel
+{
+public:
+			TimingWheel(void);
+	TimerId	schedule(unsigned int delay, TimerFunc func, void* data, unsigned int arg);
+	bool	cancel(TimerId id);				//false if it already fired
+	int		advance(void);					//one tick; returns timers fired
+	void	clear(void);
+	void	reserve(int timers);
+	int		size(void);						//timers waiting
+	unsigned long long	getTick(void);
+
+private:
+	struct Timer
+	{
+		unsigned long long expires;
+		TimerFunc func;
+		void*	data;
+		unsigned int arg;
+		unsigned int generation;			//bumped every time it's freed
+		int		next, prev;					//in its slot, or next free
+		int		slot;						//-1 while free
+	};
+
+	void	insert(int timer);
+	void	unlink(int timer);
+	void	release(int timer);
+	void	cascade(int level);
+
+	static const int BITS = 8;
+	static const int SLOTS = 1 << BITS;
+	static const int LEVELS = 4;			//2^32 ticks ahead, later is clamped
+
+	vector<Timer> timers;
+	int		heads[LEVELS * SLOTS];			//first timer of each slot, -1 if none
+	int		freeHead;
+	int		pending;
+	unsigned long long now;
+};
+
+#endif
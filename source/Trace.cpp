@@ -0,0 +1,177 @@
+/*
+ *	Trace.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Each thread records its zones into a ring of its own, made the first
+	time it records anything, so recording never locks or contends with
+	another thread: it writes the event and then publishes it by bumping
+	the ring's head. A full ring overwrites its oldest events. writeTrace()
+	can run while threads are still recording; it copies each ring and
+	then drops whatever the owner may have written over during the copy.
+	Each startTracing() begins a new recording: it notes where every ring
+	has got to rather than emptying them, since their owners may be
+	writing, and writeTrace() starts from there.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "Trace.h"
+using namespace std;
+
+atomic<bool> traceEnabled(false);
+
+struct TraceEvent
+{
+	const char* name;
+	long long start;
+	long long end;
+};
+
+struct TraceBuffer
+{
+	static const int CAPACITY = 1 << 16;	//a power of two
+
+	char name[32];
+	int tid;
+	atomic<unsigned long long> head;		//events ever written
+	unsigned long long begin;				//head when this recording started, under buffersLock
+	TraceEvent events[CAPACITY];
+};
+
+static mutex buffersLock;					//the list, not the rings
+static vector<TraceBuffer*> buffers;
+static long long traceOrigin = 0;			//start of this recording, under buffersLock
+static thread_local TraceBuffer* localBuffer = NULL;
+static thread_local char localName[32] = "";
+
+static TraceBuffer* createBuffer(void)
+{
+	lock_guard<mutex> guard(buffersLock);
+	TraceBuffer* b = new TraceBuffer;
+
+	if(localName[0])
+		strcpy(b->name, localName);
+	else
+		sprintf(b->name, "thread %i", (int)buffers.size());
+	b->tid = buffers.size() + 1;
+	b->head = 0;
+	b->begin = 0;
+	buffers.push_back(b);
+
+	return b;
+}
+
+void startTracing(void)
+{
+	{
+		lock_guard<mutex> guard(buffersLock);
+
+		traceOrigin = nowNanos();
+		for(unsigned int i = 0; i < buffers.size(); i++){
+			buffers[i]->begin = buffers[i]->head.load(memory_order_acquire);
+		}
+	}
+	traceEnabled = true;
+}
+
+void stopTracing(void)
+{
+	traceEnabled = false;
+}
+
+void traceThreadName(const char* name)
+{
+	strncpy(localName, name, sizeof(localName) - 1);
+	if(localBuffer){
+		lock_guard<mutex> guard(buffersLock);
+		strcpy(localBuffer->name, localName);
+	}
+}
+
+void recordZone(const char* name, long long start, long long end)
+{
+	TraceBuffer* b = localBuffer;
+	unsigned long long h;
+
+	if(!b){
+		b = localBuffer = createBuffer();
+	}
+
+	h = b->head.load(memory_order_relaxed);
+	TraceEvent& e = b->events[h & (TraceBuffer::CAPACITY - 1)];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+	b->head.store(h + 1, memory_order_release);
+}
+
+bool writeTrace(const char* path)
+{
+	vector<TraceEvent> copy;
+	vector<TraceBuffer*> list;
+	vector<unsigned long long> begins;
+	unsigned long long first, last, copied, after;
+	long long origin;
+	bool comma = false;
+	FILE* f;
+
+	{
+		lock_guard<mutex> guard(buffersLock);
+		list = buffers;
+		for(unsigned int i = 0; i < list.size(); i++){
+			begins.push_back(list[i]->begin);
+		}
+		origin = traceOrigin;
+	}
+
+	f = fopen(path, "w");
+	if(!f){
+		return false;
+	}
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for(unsigned int i = 0; i < list.size(); i++){
+		TraceBuffer* b = list[i];
+
+		fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+			comma ? ",\n" : "", b->tid, b->name);
+		comma = true;
+
+		//this recording's newest CAPACITY events, less any the owner
+		//overwrote while they were being copied
+		last = b->head.load(memory_order_acquire);
+		first = last > TraceBuffer::CAPACITY ? last - TraceBuffer::CAPACITY : 0;
+		first = max(first, begins[i]);
+		copied = first;
+		copy.resize(last - first);
+		for(unsigned long long j = first; j < last; j++){
+			copy[j - copied] = b->events[j & (TraceBuffer::CAPACITY - 1)];
+		}
+		after = b->head.load(memory_order_acquire);
+		if(after + 1 > first + TraceBuffer::CAPACITY){
+			first = after + 1 - TraceBuffer::CAPACITY;
+		}
+
+		for(unsigned long long j = first; j < last; j++){
+			const TraceEvent& e = copy[j - copied];
+
+			//a zone the last recording opened may close in this one
+			if(e.start < origin){
+				continue;
+			}
+			fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f}",
+				e.name, b->tid, (e.start - origin) / 1000.0, (e.end - e.start) / 1000.0);
+		}
+	}
+
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	return true;
+}
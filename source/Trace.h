@@ -0,0 +1,65 @@
+/*
+ *	Trace.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+#include <atomic>
+#include "Timer.h"
+using namespace std;
+
+//Scoped zones recorded per thread and written out as Chrome trace-event
+//JSON, for chrome://tracing or Perfetto. Build with NO_TRACING to compile
+//the zones out altogether; otherwise a zone costs one relaxed load while
+//tracing is off.
+void	startTracing(void);
+void	stopTracing(void);
+bool	writeTrace(const char* path);	//the last recording, as much as the buffers hold
+void	traceThreadName(const char* name);	//shown against the calling thread
+void	recordZone(const char* name, long long start, long long end);
+
+extern atomic<bool> traceEnabled;
+
+inline bool isTracing(void)
+{
+	return traceEnabled.load(memory_order_relaxed);
+}
+
+//Times the scope it lives in. The name must outlive the trace, a string
+//literal or a name that is never freed.
+class TraceZone
+{
+public:
+	TraceZone(const char* inName)
+			: name(inName),
+			  start(isTracing() ? nowNanos() : 0)
+	{
+	}
+
+	~TraceZone(void)
+	{
+		if(start){
+			recordZone(name, start, nowNanos());
+		}
+	}
+
+private:
+	const char* name;
+	long long start;
+};
+
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+
+#ifdef NO_TRACING
+#define TRACE_ZONE(name)
+#else
+#define TRACE_ZONE(name) TraceZone TRACE_JOIN(traceZone, __LINE__)(name)
+#endif
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ *	Transparency.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Orbs are translucent and used to be drawn with the depth test off in
+	whatever order the world stored them, so overlaps blended wrongly and
+	orbs showed through the walls. Here every orb fragment that passes the
+	depth test against the room adds its premultiplied colour, scaled by a
+	weight that falls off with distance, into a float target, and
+	multiplies (1 - alpha) into a second one. Dividing the first by its
+	summed weight gives an average colour that is blended over the room
+	by the remaining revealage. This is McGuire and Bavoil's weighted
+	blended OIT.
+
+	The orb shader lights each vertex the way the fixed function pipeline
+	does with the flashlight (GL_LIGHT1) and reads the same material and
+	colour state, so drawTreasures() sets up orbs the same either way.
+	The core profile backend has no fixed function state to read, so
+	there only the targets and the resolve are used.
+ */
+
+#include <stdio.h>
+#include "Transparency.h"
+
+//Fixed function spotlight, one light, per vertex
+static const char* orbVertexSource =
+	"#version 120\n"
+	"uniform bool lit;\n"
+	"varying float depth;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n"
+	"	gl_Position = gl_ProjectionMatrix * eye;\n"
+	"	depth = -eye.z;\n"
+	"	if(!lit){\n"
+	"		gl_FrontColor = gl_Color;\n"
+	"		return;\n"
+	"	}\n"
+	"	vec3 n = normalize(gl_NormalMatrix * gl_Normal);\n"
+	"	vec3 toLight = gl_LightSource[1].position.xyz - eye.xyz;\n"
+	"	float d = length(toLight);\n"
+	"	vec3 l = toLight / d;\n"
+	"	float att = 1.0 / (gl_LightSource[1].constantAttenuation +\n"
+	"			gl_LightSource[1].linearAttenuation * d +\n"
+	"			gl_LightSource[1].quadraticAttenuation * d * d);\n"
+	"	float spot = dot(-l, normalize(gl_LightSource[1].spotDirection));\n"
+	"	att *= spot < gl_LightSource[1].spotCosCutoff ? 0.0 : pow(spot, gl_LightSource[1].spotExponent);\n"
+	"	float diffuse = max(dot(n, l), 0.0);\n"
+	"	float specular = 0.0;\n"
+	"	if(diffuse > 0.0)\n"
+	"		specular = pow(max(dot(n, normalize(l + vec3(0.0, 0.0, 1.0))), 0.0), gl_FrontMaterial.shininess);\n"
+	"	vec4 c = gl_FrontLightModelProduct.sceneColor + att * (gl_FrontLightProduct[1].ambient +\n"
+	"			diffuse * gl_FrontLightProduct[1].diffuse + specular * gl_FrontLightProduct[1].specular);\n"
+	"	gl_FrontColor = vec4(clamp(c.rgb, 0.0, 1.0), gl_FrontMaterial.diffuse.a);\n"
+	"}\n";
+
+//Weight favours near fragments, equation 7 of the paper
+static const char* orbFragmentSource =
+	"#version 120\n"
+	"varying float depth;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 c = gl_Color;\n"
+	"	float w = c.a * clamp(10.0 / (1e-5 + pow(depth / 5.0, 2.0) + pow(depth / 200.0, 6.0)), 1e-2, 3e3);\n"
+	"	gl_FragData[0] = vec4(c.rgb * c.a, c.a) * w;\n"
+	"	gl_FragData[1] = vec4(c.a);\n"
+	"}\n";
+
+static const char* resolveVertexSource =
+	"#version 120\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = gl_Vertex;\n"
+	"}\n";
+
+static const char* resolveFragmentSource =
+	"#version 120\n"
+	"uniform sampler2D accum;\n"
+	"uniform sampler2D reveal;\n"
+	"uniform vec2 size;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 uv = gl_FragCoord.xy / size;\n"
+	"	float r = texture2D(reveal, uv).r;\n"
+	"	if(r >= 1.0)\n"
+	"		discard;\n"
+	"	vec4 a = texture2D(accum, uv);\n"
+	"	gl_FragColor = vec4(a.rgb / clamp(a.a, 1e-4, 5e4), r);\n"
+	"}\n";
+
+//Same resolve for core profiles, drawn as one triangle with no vertices
+static const char* coreResolveVertexSource =
+	"#version 330 core\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 p = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);\n"
+	"	gl_Position = vec4(p, 0.0, 1.0);\n"
+	"}\n";
+
+static const char* coreResolveFragmentSource =
+	"#version 330 core\n"
+	"uniform sampler2D accum;\n"
+	"uniform sampler2D reveal;\n"
+	"uniform vec2 size;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 uv = gl_FragCoord.xy / size;\n"
+	"	float r = texture(reveal, uv).r;\n"
+	"	if(r >= 1.0)\n"
+	"		discard;\n"
+	"	vec4 a = texture(accum, uv);\n"
+	"	fragColor = vec4(a.rgb / clamp(a.a, 1e-4, 5e4), r);\n"
+	"}\n";
+
+Transparency::Transparency(void)
+			: ready(false),
+			  core(false),
+			  w(0),
+			  h(0),
+			  target(0),
+			  sceneFbo(0),
+			  sceneColor(0),
+			  sceneDepth(0),
+			  accumFbo(0),
+			  accumTex(0),
+			  revealTex(0),
+			  orbProgram(0),
+			  resolveProgram(0),
+			  emptyVao(0),
+			  litLoc(-1)
+{
+}
+
+Transparency::~Transparency(void)
+{
+	destroy();
+}
+
+static GLuint newTarget(GLenum format, int w, int h)
+{
+	GLuint tex;
+
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, GL_RGBA, GL_FLOAT, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return tex;
+}
+
+//Sets up the targets and shaders; false leaves the caller on the old path
+bool Transparency::init(int width, int height, bool coreProfile)
+{
+	GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+
+	destroy();
+	w = width;
+	h = height;
+	core = coreProfile;
+
+	if(!loadExtensions()){
+		return false;
+	}
+
+	if(core){
+		resolveProgram = compile(coreResolveVertexSource, coreResolveFragmentSource);
+		genVertexArrays(1, &emptyVao);
+	}
+	else {
+		orbProgram = compile(orbVertexSource, orbFragmentSource);
+		resolveProgram = compile(resolveVertexSource, resolveFragmentSource);
+		if(orbProgram){
+			litLoc = getUniformLocation(orbProgram, "lit");
+		}
+	}
+	if((!core && !orbProgram) || !resolveProgram){
+		destroy();
+		return false;
+	}
+
+	useProgram(resolveProgram);
+	uniform1i(getUniformLocation(resolveProgram, "accum"), 0);
+	uniform1i(getUniformLocation(resolveProgram, "reveal"), 1);
+	uniform2f(getUniformLocation(resolveProgram, "size"), w, h);
+	useProgram(0);
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+	//opaque scene: colour and the depth the orbs are tested against
+	genRenderbuffers(1, &sceneColor);
+	bindRenderbuffer(GL_RENDERBUFFER, sceneColor);
+	renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+	genRenderbuffers(1, &sceneDepth);
+	bindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+	renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+
+	genFramebuffers(1, &sceneFbo);
+	bindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+	framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sceneColor);
+	framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+	ready = checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	//accumulation: half floats are enough with the weights clamped
+	accumTex = newTarget(GL_RGBA16F, w, h);
+	revealTex = newTarget(GL_R16F, w, h);
+
+	genFramebuffers(1, &accumFbo);
+	bindFramebuffer(GL_FRAMEBUFFER, accumFbo);
+	framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accumTex, 0);
+	framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealTex, 0);
+	framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+	drawBuffers(2, buffers);
+	ready = ready && checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+	bindFramebuffer(GL_FRAMEBUFFER, target);
+	if(!ready){
+		destroy();
+	}
+	return ready;
+}
+
+bool Transparency::isReady(void)
+{
+	return ready;
+}
+
+void Transparency::destroy(void)
+{
+	if(orbProgram)
+		deleteProgram(orbProgram);
+	if(resolveProgram)
+		deleteProgram(resolveProgram);
+	if(sceneFbo)
+		deleteFramebuffers(1, &sceneFbo);
+	if(accumFbo)
+		deleteFramebuffers(1, &accumFbo);
+	if(sceneColor)
+		deleteRenderbuffers(1, &sceneColor);
+	if(sceneDepth)
+		deleteRenderbuffers(1, &sceneDepth);
+	if(accumTex)
+		glDeleteTextures(1, &accumTex);
+	if(revealTex)
+		glDeleteTextures(1, &revealTex);
+	if(emptyVao)
+		deleteVertexArrays(1, &emptyVao);
+
+	orbProgram = resolveProgram = emptyVao = 0;
+	sceneFbo = accumFbo = sceneColor = sceneDepth = accumTex = revealTex = 0;
+	ready = false;
+}
+
+GLuint Transparency::compile(const char* vertexSource, const char* fragmentSource)
+{
+	const char* sources[2] = { vertexSource, fragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint program = createProgram();
+	GLint ok;
+	char log[1024];
+
+	for(int i = 0; i < 2; i++){
+		GLuint shader = createShader(types[i]);
+
+		shaderSource(shader, 1, &sources[i], NULL);
+		compileShader(shader);
+		getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+		if(!ok){
+			getShaderInfoLog(shader, sizeof(log), NULL, log);
+			printf("transparency: shader failed to compile\n%s\n", log);
+			deleteShader(shader);
+			deleteProgram(program);
+			return 0;
+		}
+		attachShader(program, shader);
+		deleteShader(shader);				//freed along with the program
+	}
+
+	linkProgram(program);
+	getProgramiv(program, GL_LINK_STATUS, &ok);
+	if(!ok){
+		getProgramInfoLog(program, sizeof(log), NULL, log);
+		printf("transparency: shaders failed to link\n%s\n", log);
+		deleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+//Sends the opaque scene to the offscreen target
+void Transparency::beginScene(void)
+{
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+	bindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+}
+
+//Everything drawn from here until resolve() is summed, not blended
+void Transparency::beginAccumulate(void)
+{
+	GLfloat zero[] = { 0, 0, 0, 0 };
+	GLfloat one[] = { 1, 1, 1, 1 };
+
+	bindFramebuffer(GL_FRAMEBUFFER, accumFbo);
+	clearBufferfv(GL_COLOR, 0, zero);
+	clearBufferfv(GL_COLOR, 1, one);
+
+	//test against the room, but don't hide orbs behind other orbs
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	blendFunci(0, GL_ONE, GL_ONE);
+	blendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+//The fixed function stand in, for the compatibility profile renderer
+void Transparency::useOrbShader(bool lit)
+{
+	useProgram(orbProgram);
+	uniform1i(litLoc, lit);
+}
+
+//Puts the scene back on the original framebuffer with the orbs over it
+void Transparency::resolve(void)
+{
+	useProgram(0);
+	glDepthMask(GL_TRUE);
+
+	bindFramebuffer(GL_READ_FRAMEBUFFER, sceneFbo);
+	bindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+	blitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	bindFramebuffer(GL_FRAMEBUFFER, target);
+
+	activeTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, revealTex);
+	activeTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, accumTex);
+
+	//average colour over the scene, weighted by what shows through
+	glDisable(GL_DEPTH_TEST);
+	glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+	useProgram(resolveProgram);
+	if(core){
+		bindVertexArray(emptyVao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		bindVertexArray(0);
+	}
+	else {
+		glBegin(GL_QUADS);
+			glVertex2f(-1, -1);
+			glVertex2f(1, -1);
+			glVertex2f(1, 1);
+			glVertex2f(-1, 1);
+		glEnd();
+	}
+	useProgram(0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
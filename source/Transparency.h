@@ -0,0 +1,52 @@
+/*
+ *	Transparency.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef TRANSPARENCY_H_
+#define TRANSPARENCY_H_
+#include "GLExtensions.h"
+
+//Weighted blended order independent transparency. The opaque scene is
+//drawn into an offscreen target, translucent surfaces are summed into
+//accumulation targets that share its depth buffer, and resolve() blends
+//the weighted average over the scene in one full screen pass. Draw order
+//doesn't matter, so nothing needs sorting. In a core profile the caller
+//brings its own orb shader, writing the same two outputs.
+class Transparency
+{
+public:
+			Transparency(void);
+			~Transparency(void);
+	bool	init(int width, int height, bool coreProfile = false);
+	bool	isReady(void);
+	void	beginScene(void);
+	void	beginAccumulate(void);
+	void	useOrbShader(bool lit);
+	void	resolve(void);
+
+private:
+	GLuint	compile(const char* vertexSource, const char* fragmentSource);
+	void	destroy(void);
+
+	bool	ready;
+	bool	core;
+	int		w, h;
+	GLint	target;					//framebuffer bound when the frame began
+	GLuint	sceneFbo;
+	GLuint	sceneColor;
+	GLuint	sceneDepth;
+	GLuint	accumFbo;
+	GLuint	accumTex;				//sum of weighted premultiplied colour
+	GLuint	revealTex;				//product of (1 - alpha)
+	GLuint	orbProgram;
+	GLuint	resolveProgram;
+	GLuint	emptyVao;				//core profiles won't draw without one
+	GLint	litLoc;
+};
+
+#endif
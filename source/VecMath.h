@@ -0,0 +1,504 @@
+/*
+ *	VecMath.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef VECMATH_H_
+#define VECMATH_H_
+#include <math.h>
+
+//SSE2 on x86 (always there on x64), NEON on ARM, plain C++ otherwise or
+//when VECMATH_SCALAR is defined
+#if defined(VECMATH_SCALAR)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VECMATH_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VECMATH_NEON
+#include <arm_neon.h>
+#endif
+
+//Float vectors padded to 16 bytes so each is one SIMD register. They stay
+//plain aggregates, so { x, y, z } still initialises one (w comes out 0)
+//and they can go in files and memcpy'd arrays. Loads and stores are
+//unaligned: heap blocks from 32 bit allocators and mapped files only
+//promise 8 bytes.
+struct alignas(16) Vec3
+{
+	float x, y, z;
+	float w;					//padding, kept 0
+};
+
+struct alignas(16) Vec4
+{
+	float x, y, z, w;
+};
+
+//Rotation, w the real part
+struct alignas(16) Quat
+{
+	float x, y, z, w;
+};
+
+//Column major, as GL takes it: m[12..14] is the translation
+struct alignas(16) Mat4
+{
+	float m[16];
+};
+
+//Four floats in whatever register the target has
+#if defined(VECMATH_SSE)
+typedef __m128 Lanes;
+inline Lanes	lanesLoad(const float* p)				{ return _mm_loadu_ps(p); }
+inline void		lanesStore(float* p, Lanes a)			{ _mm_storeu_ps(p, a); }
+inline Lanes	lanesSplat(float s)						{ return _mm_set1_ps(s); }
+inline Lanes	lanesAdd(Lanes a, Lanes b)				{ return _mm_add_ps(a, b); }
+inline Lanes	lanesSub(Lanes a, Lanes b)				{ return _mm_sub_ps(a, b); }
+inline Lanes	lanesMul(Lanes a, Lanes b)				{ return _mm_mul_ps(a, b); }
+inline Lanes	lanesMulAdd(Lanes a, Lanes b, Lanes c)	{ return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+inline Lanes	lanesDiv(Lanes a, Lanes b)				{ return _mm_div_ps(a, b); }
+inline Lanes	lanesMin(Lanes a, Lanes b)				{ return _mm_min_ps(a, b); }
+inline Lanes	lanesMax(Lanes a, Lanes b)				{ return _mm_max_ps(a, b); }
+inline Lanes	lanesSqrt(Lanes a)						{ return _mm_sqrt_ps(a); }
+inline Lanes	lanesAbs(Lanes a)						{ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+inline float lanesSum(Lanes a)
+{
+	Lanes s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+	return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+}
+
+//x y z w to y z x w
+inline Lanes	lanesYzx(Lanes a)						{ return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)); }
+
+//rows a..d become columns
+inline void lanesTranspose(Lanes& a, Lanes& b, Lanes& c, Lanes& d)
+{
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+}
+
+//per lane comparisons, and the result as bits, lane 0 lowest
+typedef __m128 LaneMask;
+inline LaneMask	lanesLess(Lanes a, Lanes b)				{ return _mm_cmplt_ps(a, b); }
+inline LaneMask	maskAnd(LaneMask a, LaneMask b)			{ return _mm_and_ps(a, b); }
+inline int		maskBits(LaneMask a)					{ return _mm_movemask_ps(a); }
+#elif defined(VECMATH_NEON)
+typedef float32x4_t Lanes;
+inline Lanes	lanesLoad(const float* p)				{ return vld1q_f32(p); }
+inline void		lanesStore(float* p, Lanes a)			{ vst1q_f32(p, a); }
+inline Lanes	lanesSplat(float s)						{ return vdupq_n_f32(s); }
+inline Lanes	lanesAdd(Lanes a, Lanes b)				{ return vaddq_f32(a, b); }
+inline Lanes	lanesSub(Lanes a, Lanes b)				{ return vsubq_f32(a, b); }
+inline Lanes	lanesMul(Lanes a, Lanes b)				{ return vmulq_f32(a, b); }
+inline Lanes	lanesMulAdd(Lanes a, Lanes b, Lanes c)	{ return vmlaq_f32(c, a, b); }
+
+inline Lanes	lanesMin(Lanes a, Lanes b)				{ return vminq_f32(a, b); }
+inline Lanes	lanesMax(Lanes a, Lanes b)				{ return vmaxq_f32(a, b); }
+inline Lanes	lanesAbs(Lanes a)						{ return vabsq_f32(a); }
+#if defined(__aarch64__)
+inline Lanes	lanesDiv(Lanes a, Lanes b)				{ return vdivq_f32(a, b); }
+inline Lanes	lanesSqrt(Lanes a)						{ return vsqrtq_f32(a); }
+#else
+//32 bit ARM has neither, only estimates
+inline Lanes lanesDiv(Lanes a, Lanes b)
+{
+	float x[4], y[4];
+	vst1q_f32(x, a);
+	vst1q_f32(y, b);
+	for(int i = 0; i < 4; i++)
+		x[i] /= y[i];
+	return vld1q_f32(x);
+}
+
+inline Lanes lanesSqrt(Lanes a)
+{
+	float x[4];
+	vst1q_f32(x, a);
+	for(int i = 0; i < 4; i++)
+		x[i] = sqrtf(x[i]);
+	return vld1q_f32(x);
+}
+#endif
+
+inline float lanesSum(Lanes a)
+{
+	float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+
+inline Lanes lanesYzx(Lanes a)
+{
+	Lanes r = vextq_f32(a, a, 1);
+
+	r = vsetq_lane_f32(vgetq_lane_f32(a, 0), r, 2);
+	return vsetq_lane_f32(vgetq_lane_f32(a, 3), r, 3);
+}
+
+inline void lanesTranspose(Lanes& a, Lanes& b, Lanes& c, Lanes& d)
+{
+	float32x4x2_t ab = vtrnq_f32(a, b);
+	float32x4x2_t cd = vtrnq_f32(c, d);
+
+	a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+	b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+	c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+	d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+typedef uint32x4_t LaneMask;
+inline LaneMask	lanesLess(Lanes a, Lanes b)				{ return vcltq_f32(a, b); }
+inline LaneMask	maskAnd(LaneMask a, LaneMask b)			{ return vandq_u32(a, b); }
+
+inline int maskBits(LaneMask a)
+{
+	return (vgetq_lane_u32(a, 0) & 1) | (vgetq_lane_u32(a, 1) & 2) |
+		(vgetq_lane_u32(a, 2) & 4) | (vgetq_lane_u32(a, 3) & 8);
+}
+#else
+struct Lanes
+{
+	float v[4];
+};
+
+inline Lanes lanesLoad(const float* p)
+{
+	Lanes r = { { p[0], p[1], p[2], p[3] } };
+	return r;
+}
+
+inline void lanesStore(float* p, Lanes a)
+{
+	p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];
+}
+
+inline Lanes lanesSplat(float s)
+{
+	Lanes r = { { s, s, s, s } };
+	return r;
+}
+
+inline Lanes lanesAdd(Lanes a, Lanes b)
+{
+	Lanes r = { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } };
+	return r;
+}
+
+inline Lanes lanesSub(Lanes a, Lanes b)
+{
+	Lanes r = { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } };
+	return r;
+}
+
+inline Lanes lanesMul(Lanes a, Lanes b)
+{
+	Lanes r = { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } };
+	return r;
+}
+
+inline Lanes lanesDiv(Lanes a, Lanes b)
+{
+	Lanes r = { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } };
+	return r;
+}
+
+inline Lanes lanesMin(Lanes a, Lanes b)
+{
+	Lanes r = { { fminf(a.v[0], b.v[0]), fminf(a.v[1], b.v[1]), fminf(a.v[2], b.v[2]), fminf(a.v[3], b.v[3]) } };
+	return r;
+}
+
+inline Lanes lanesMax(Lanes a, Lanes b)
+{
+	Lanes r = { { fmaxf(a.v[0], b.v[0]), fmaxf(a.v[1], b.v[1]), fmaxf(a.v[2], b.v[2]), fmaxf(a.v[3], b.v[3]) } };
+	return r;
+}
+
+inline Lanes lanesSqrt(Lanes a)
+{
+	Lanes r = { { sqrtf(a.v[0]), sqrtf(a.v[1]), sqrtf(a.v[2]), sqrtf(a.v[3]) } };
+	return r;
+}
+
+inline Lanes lanesAbs(Lanes a)
+{
+	Lanes r = { { fabsf(a.v[0]), fabsf(a.v[1]), fabsf(a.v[2]), fabsf(a.v[3]) } };
+	return r;
+}
+
+inline Lanes	lanesMulAdd(Lanes a, Lanes b, Lanes c)	{ return lanesAdd(lanesMul(a, b), c); }
+inline float	lanesSum(Lanes a)						{ return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]); }
+
+inline Lanes lanesYzx(Lanes a)
+{
+	Lanes r = { { a.v[1], a.v[2], a.v[0], a.v[3] } };
+	return r;
+}
+
+inline void lanesTranspose(Lanes& a, Lanes& b, Lanes& c, Lanes& d)
+{
+	Lanes r[4] = { a, b, c, d };
+
+	for(int i = 0; i < 4; i++){
+		a.v[i] = r[i].v[0];
+		b.v[i] = r[i].v[1];
+		c.v[i] = r[i].v[2];
+		d.v[i] = r[i].v[3];
+	}
+}
+
+typedef int LaneMask;
+inline LaneMask lanesLess(Lanes a, Lanes b)
+{
+	return (a.v[0] < b.v[0]) | (a.v[1] < b.v[1]) << 1 | (a.v[2] < b.v[2]) << 2 | (a.v[3] < b.v[3]) << 3;
+}
+
+inline LaneMask	maskAnd(LaneMask a, LaneMask b)			{ return a & b; }
+inline int		maskBits(LaneMask a)					{ return a; }
+#endif
+
+template<class V>
+inline Lanes lanesOf(const V& v)
+{
+	return lanesLoad(&v.x);
+}
+
+template<class V>
+inline V fromLanes(Lanes a)
+{
+	V r;
+	lanesStore(&r.x, a);
+	return r;
+}
+
+//Vec3; the padding lane is 0 in and 0 out of all of these
+inline Vec3		operator+(const Vec3& a, const Vec3& b)	{ return fromLanes<Vec3>(lanesAdd(lanesOf(a), lanesOf(b))); }
+inline Vec3		operator-(const Vec3& a, const Vec3& b)	{ return fromLanes<Vec3>(lanesSub(lanesOf(a), lanesOf(b))); }
+inline Vec3		operator*(const Vec3& a, float s)		{ return fromLanes<Vec3>(lanesMul(lanesOf(a), lanesSplat(s))); }
+inline Vec3		operator*(float s, const Vec3& a)		{ return a * s; }
+inline Vec3		operator-(const Vec3& a)				{ return fromLanes<Vec3>(lanesSub(lanesSplat(0), lanesOf(a))); }
+inline Vec3&	operator+=(Vec3& a, const Vec3& b)		{ return a = a + b; }
+inline Vec3&	operator-=(Vec3& a, const Vec3& b)		{ return a = a - b; }
+inline Vec3&	operator*=(Vec3& a, float s)			{ return a = a * s; }
+
+//a*s + b, the usual step along a direction
+inline Vec3 mulAdd(const Vec3& a, float s, const Vec3& b)
+{
+	return fromLanes<Vec3>(lanesMulAdd(lanesOf(a), lanesSplat(s), lanesOf(b)));
+}
+
+inline float	dot(const Vec3& a, const Vec3& b)		{ return lanesSum(lanesMul(lanesOf(a), lanesOf(b))); }
+inline float	lengthSquared(const Vec3& a)			{ return dot(a, a); }
+inline float	length(const Vec3& a)					{ return sqrtf(dot(a, a)); }
+
+inline float distanceSquared(const Vec3& a, const Vec3& b)
+{
+	Lanes d = lanesSub(lanesOf(a), lanesOf(b));
+	return lanesSum(lanesMul(d, d));
+}
+
+//the products are those of the textbook form, a rotation apart, so the
+//result is the same to the bit
+inline Vec3 cross(const Vec3& a, const Vec3& b)
+{
+	Lanes la = lanesOf(a), lb = lanesOf(b);
+	Lanes r = lanesSub(lanesMul(la, lanesYzx(lb)), lanesMul(lanesYzx(la), lb));
+	return fromLanes<Vec3>(lanesYzx(r));
+}
+
+//Unit length, or left alone if it has none
+inline Vec3 normalize(const Vec3& a)
+{
+	float len = length(a);
+	return len > 0 ? a * (1 / len) : a;
+}
+
+//Four Vec3s a lane each, for testing orbs four at a time without
+//summing across a register for every dot product
+struct Vec3x4
+{
+	Lanes x, y, z;
+};
+
+inline Vec3x4 gather(const Vec3& a, const Vec3& b, const Vec3& c, const Vec3& d)
+{
+	Lanes x = lanesOf(a), y = lanesOf(b), z = lanesOf(c), w = lanesOf(d);
+	Vec3x4 r;
+
+	lanesTranspose(x, y, z, w);
+	r.x = x;
+	r.y = y;
+	r.z = z;
+	return r;
+}
+
+inline Vec3x4 splat(const Vec3& a)
+{
+	Vec3x4 r = { lanesSplat(a.x), lanesSplat(a.y), lanesSplat(a.z) };
+	return r;
+}
+
+inline Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b)
+{
+	Vec3x4 r = { lanesSub(a.x, b.x), lanesSub(a.y, b.y), lanesSub(a.z, b.z) };
+	return r;
+}
+
+inline Lanes dot(const Vec3x4& a, const Vec3x4& b)
+{
+	return lanesMulAdd(a.z, b.z, lanesMulAdd(a.y, b.y, lanesMul(a.x, b.x)));
+}
+
+//a*s + b per lane
+inline Vec3x4 mulAdd(const Vec3x4& a, Lanes s, const Vec3x4& b)
+{
+	Vec3x4 r = { lanesMulAdd(a.x, s, b.x), lanesMulAdd(a.y, s, b.y), lanesMulAdd(a.z, s, b.z) };
+	return r;
+}
+
+//Vec4
+inline Vec4		operator+(const Vec4& a, const Vec4& b)	{ return fromLanes<Vec4>(lanesAdd(lanesOf(a), lanesOf(b))); }
+inline Vec4		operator-(const Vec4& a, const Vec4& b)	{ return fromLanes<Vec4>(lanesSub(lanesOf(a), lanesOf(b))); }
+inline Vec4		operator*(const Vec4& a, float s)		{ return fromLanes<Vec4>(lanesMul(lanesOf(a), lanesSplat(s))); }
+inline float	dot(const Vec4& a, const Vec4& b)		{ return lanesSum(lanesMul(lanesOf(a), lanesOf(b))); }
+
+inline Vec4 toVec4(const Vec3& a, float w)
+{
+	Vec4 r = { a.x, a.y, a.z, w };
+	return r;
+}
+
+//Mat4
+inline Mat4 identity(void)
+{
+	Mat4 r = { { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 } };
+	return r;
+}
+
+//Each column of the product is a's columns weighted by one of b's
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+	Lanes c0 = lanesLoad(a.m), c1 = lanesLoad(a.m + 4), c2 = lanesLoad(a.m + 8), c3 = lanesLoad(a.m + 12);
+	Mat4 r;
+
+	for(int j = 0; j < 4; j++){
+		const float* w = b.m + j*4;
+		Lanes c = lanesMul(c0, lanesSplat(w[0]));
+		c = lanesMulAdd(c1, lanesSplat(w[1]), c);
+		c = lanesMulAdd(c2, lanesSplat(w[2]), c);
+		c = lanesMulAdd(c3, lanesSplat(w[3]), c);
+		lanesStore(r.m + j*4, c);
+	}
+	return r;
+}
+
+inline Vec4 transform(const Mat4& a, const Vec4& v)
+{
+	Lanes c = lanesMul(lanesLoad(a.m), lanesSplat(v.x));
+	c = lanesMulAdd(lanesLoad(a.m + 4), lanesSplat(v.y), c);
+	c = lanesMulAdd(lanesLoad(a.m + 8), lanesSplat(v.z), c);
+	c = lanesMulAdd(lanesLoad(a.m + 12), lanesSplat(v.w), c);
+	return fromLanes<Vec4>(c);
+}
+
+//As a position, translation applied; the result's w is dropped
+inline Vec3 transformPoint(const Mat4& a, const Vec3& p)
+{
+	Vec4 r = transform(a, toVec4(p, 1));
+	Vec3 q = { r.x, r.y, r.z, 0 };
+	return q;
+}
+
+inline Mat4 transpose(const Mat4& a)
+{
+	Mat4 r;
+
+	for(int i = 0; i < 4; i++){
+		for(int j = 0; j < 4; j++){
+			r.m[i*4 + j] = a.m[j*4 + i];
+		}
+	}
+	return r;
+}
+
+//World to eye for an eye at eye with right, up and backward axes u, v, n
+inline Mat4 viewMatrix(const Vec3& eye, const Vec3& u, const Vec3& v, const Vec3& n)
+{
+	Mat4 r = { {
+		u.x, v.x, n.x, 0,
+		u.y, v.y, n.y, 0,
+		u.z, v.z, n.z, 0,
+		-dot(eye, u), -dot(eye, v), -dot(eye, n), 1 } };
+	return r;
+}
+
+//Same as gluPerspective
+inline Mat4 perspective(float fovY, float aspect, float zNear, float zFar)
+{
+	float f = 1 / tanf(fovY * 0.5f * 0.0174532925f);
+	Mat4 r = { {
+		f / aspect, 0, 0, 0,
+		0, f, 0, 0,
+		0, 0, (zFar + zNear) / (zNear - zFar), -1,
+		0, 0, 2 * zFar * zNear / (zNear - zFar), 0 } };
+	return r;
+}
+
+//Quat
+inline Quat axisAngle(const Vec3& axis, float radians)
+{
+	float s = sinf(radians * 0.5f);
+	Quat r = { axis.x * s, axis.y * s, axis.z * s, cosf(radians * 0.5f) };
+	return r;
+}
+
+inline Quat operator*(const Quat& a, const Quat& b)
+{
+	Quat r = {
+		a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
+		a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x,
+		a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w,
+		a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z };
+	return r;
+}
+
+inline Quat conjugate(const Quat& a)
+{
+	Quat r = { -a.x, -a.y, -a.z, a.w };
+	return r;
+}
+
+inline Quat normalize(const Quat& a)
+{
+	Lanes q = lanesOf(a);
+	float len2 = lanesSum(lanesMul(q, q));
+	return len2 > 0 ? fromLanes<Quat>(lanesMul(q, lanesSplat(1 / sqrtf(len2)))) : a;
+}
+
+//v turned by a unit quaternion: v + 2w(q x v) + 2q x (q x v)
+inline Vec3 rotate(const Quat& a, const Vec3& v)
+{
+	Vec3 q = { a.x, a.y, a.z, 0 };
+	Vec3 t = cross(q, v) * 2;
+	return v + t * a.w + cross(q, t);
+}
+
+inline Mat4 toMat4(const Quat& a)
+{
+	float x2 = a.x + a.x, y2 = a.y + a.y, z2 = a.z + a.z;
+	float xx = a.x * x2, yy = a.y * y2, zz = a.z * z2;
+	float xy = a.x * y2, xz = a.x * z2, yz = a.y * z2;
+	float wx = a.w * x2, wy = a.w * y2, wz = a.w * z2;
+	Mat4 r = { {
+		1 - (yy + zz), xy + wz, xz - wy, 0,
+		xy - wz, 1 - (xx + zz), yz + wx, 0,
+		xz + wy, yz - wx, 1 - (xx + yy), 0,
+		0, 0, 0, 1 } };
+	return r;
+}
+
+#endif
@@ -0,0 +1,893 @@
+/*
+ *	World.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Owns every orb in the game. The orbs of the active chunks live in one
+	packed array, the working set, so they can be scanned in parallel and
+	sent or saved in bulk; the spatial grid lets the server find the orbs
+	near each player without touching the rest. The rest of the world sits
+	still in chunks that are only visited when the region moves over them
+	or now and then by maintain(), which parks the ones left alone in the
+	page file so the OS can drop them from memory.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "World.h"
+#include "Bvh.h"
+
+//what slots holds for an orb taken out of the world
+static const int REMOVED = -2;
+
+World::World(int boundary)
+			: backing(NULL),
+			  bvh(NULL),
+			  nextId(1),
+			  bound(boundary),
+			  total(0),
+			  focusRadius(-1),
+			  regionPass(0),
+			  regionChanges(0),
+			  pages(NULL),
+			  bucketBits(6),
+			  denseGrid(false),
+			  gridValid(true)
+{
+	//cover the whole room, walls included
+	chunksPerAxis = (2 * (bound + 1) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	cellsPerAxis = (2 * (bound + 1) + CELL_SIZE - 1) / CELL_SIZE;
+	bucketStart.assign((1 << bucketBits) + 1, 0);
+	slots.push_back(-1);
+}
+
+World::~World(void)
+{
+	//the tree may already be gone, don't rebuild it on the way out
+	bvh = NULL;
+	clear();
+	delete pages;
+}
+
+int World::getBoundary(void)
+{
+	return bound;
+}
+
+int World::size(void)
+{
+	return orbs.size();
+}
+
+int World::getTotal(void)
+{
+	return total;
+}
+
+Orb* World::getOrbs(void)
+{
+	return orbs.data();
+}
+
+const Orb& World::operator[](int index) const
+{
+	return orbs[index];
+}
+
+unsigned int World::getNextId(void)
+{
+	return nextId;
+}
+
+unsigned int World::add(const Point3D& pos)
+{
+	int index = getChunk(chunkAxis(pos.x), chunkAxis(pos.y), chunkAxis(pos.z));
+	Chunk* c = chunks[index];
+	Orb orb;
+
+	orb.pos = pos;
+	orb.id = nextId++;
+	orb.chunk = index;
+	orb.timer = 0;
+	slots.push_back(-1);
+
+	//a chunk made just now for this orb joins the region if it's in it
+	if(!c->active && c->count == 0 && inRegion(c)){
+		activate(index, false);
+	}
+	c->count++;
+	total++;
+
+	if(c->active){
+		addActive(orb);
+		c->dirty = true;
+		if(bvh){
+			bvh->insert(orb.id, pos);
+		}
+	}
+	else if(isPaged(c) && !c->dirty && (c->count) * sizeof(Orb) <= c->pageBytes){
+		//room left in the page, which stays an exact copy
+		c->page[c->count - 1] = orb;
+		c->orbs.borrow(c->page, c->count);
+	}
+	else {
+		c->orbs.push_back(orb);
+		c->dirty = true;
+	}
+
+	return orb.id;
+}
+
+Point3D World::spawn(Rng& rng)
+{
+	Point3D treasure;
+
+	//subtracting rand from another rand gives us
+	//       -bound < position < +bound
+	//positions the treasure within the boundaries
+	treasure.x = rng.nextInt(bound) - rng.nextInt(bound);
+	treasure.y = rng.nextInt(bound) - rng.nextInt(bound);
+	treasure.z = rng.nextInt(bound) - rng.nextInt(bound);
+
+	add(treasure);
+	return treasure;
+}
+
+void World::remove(int index)
+{
+	Chunk* c = chunks[orbs[index].chunk];
+
+	c->count--;
+	c->dirty = true;
+	total--;
+
+	if(bvh){
+		bvh->remove(orbs[index].id);
+	}
+	slots[orbs[index].id] = REMOVED;
+	orbs[index] = orbs.back();
+	orbs.pop_back();
+	gridValid = false;
+
+	if(index < (int)orbs.size()){
+		slots[orbs[index].id] = index;
+	}
+}
+
+//Where the orb with this id is in the working set, or -1 if it's gone or
+//its chunk is dormant
+int World::indexOf(unsigned int id)
+{
+	if(id >= (unsigned int)slots.size() || slots[id] < 0){
+		return -1;
+	}
+	return slots[id];
+}
+
+bool World::has(unsigned int id)
+{
+	return id < (unsigned int)slots.size() && slots[id] != REMOVED;
+}
+
+void World::clear(void)
+{
+	for(unsigned int i = 0; i < chunks.size(); i++){
+		if(chunks[i]){
+			dropPage(chunks[i]);
+			delete chunks[i];
+		}
+	}
+	chunks.clear();
+	freeChunks.clear();
+	chunkIndex.clear();
+	activeChunks.clear();
+	total = 0;
+
+	//forget everything that came from the file before letting it go
+	delete backing;
+	backing = NULL;
+
+	orbs.clear();
+	slots.assign(nextId, REMOVED);
+	gridOrbs.clear();
+	gridPos.clear();
+	gridRow.clear();
+	gridX.clear();
+	bucketStart.assign(bucketStart.size(), 0);
+	gridValid = true;
+	if(bvh){
+		bvh->build(*this);
+	}
+}
+
+//Takes over a world laid out in memory, typically a mapped checkpoint, and
+//uses it in place: its chunks stay dormant, borrowing their orbs from the
+//file, until the region reaches them. Until a region is set none are
+//active, so restoring copies nothing. The world owns the file from here on.
+bool World::borrow(MappedFile* file, Orb* inOrbs, const ChunkRecord* table, int chunkCount, int orbCount, unsigned int inNextId)
+{
+	long long sum = 0;
+
+	for(int i = 0; i < chunkCount; i++){
+		const ChunkRecord& r = table[i];
+
+		if(r.x < 0 || r.x >= chunksPerAxis || r.y < 0 || r.y >= chunksPerAxis ||
+				r.z < 0 || r.z >= chunksPerAxis || r.count == 0 ||
+				r.first > (unsigned long long)orbCount || r.count > orbCount - r.first){
+			return false;
+		}
+		sum += r.count;
+	}
+	if(sum != orbCount){
+		return false;
+	}
+
+	clear();
+	nextId = inNextId;
+	slots.assign(nextId, -1);
+	backing = file;
+
+	for(int i = 0; i < chunkCount; i++){
+		const ChunkRecord& r = table[i];
+		Chunk* c = chunks[getChunk(r.x, r.y, r.z)];
+
+		if(c->count){
+			//listed twice, keep the first
+			continue;
+		}
+		c->orbs.borrow(inOrbs + r.first, r.count);
+		c->count = r.count;
+		total += r.count;
+	}
+
+	//bring back whatever the region covers
+	if(focusRadius >= 0){
+		applyRegion();
+	}
+
+	return true;
+}
+
+//All orbs, the working set's and the dormant chunks', grouped by chunk
+void World::flatten(vector<ChunkRecord>& table, vector<Orb>& out)
+{
+	vector<int> start(chunks.size(), 0);
+	int n = 0;
+
+	table.clear();
+	for(unsigned int i = 0; i < chunks.size(); i++){
+		Chunk* c = chunks[i];
+		ChunkRecord r;
+
+		if(!c || !c->count){
+			continue;
+		}
+		r.x = c->x;
+		r.y = c->y;
+		r.z = c->z;
+		r.count = c->count;
+		r.first = n;
+		table.push_back(r);
+		start[i] = n;
+		n += c->count;
+	}
+
+	out.resize(n);
+	for(unsigned int i = 0; i < chunks.size(); i++){
+		Chunk* c = chunks[i];
+
+		if(c && c->count && !c->active){
+			memcpy(&out[start[i]], c->orbs.data(), c->count * sizeof(Orb));
+		}
+	}
+	for(int i = 0; i < orbs.size(); i++){
+		out[start[orbs[i].chunk]++] = orbs[i];
+	}
+}
+
+//Attaches a BVH and builds it over the working set; NULL detaches
+void World::setBvh(OrbBvh* tree)
+{
+	bvh = tree;
+	if(bvh){
+		bvh->build(*this);
+	}
+}
+
+//Grows the working set, the id slots and the attached BVH up front, so
+//the next more orbs added don't allocate; they still double when they run
+//out, like any FlatArray
+void World::reserve(int more)
+{
+	orbs.reserve(orbs.size() + more);
+	slots.reserve(slots.size() + more);
+	if(bvh){
+		bvh->reserve(bvh->size() + more, nextId + more);
+	}
+}
+
+int World::getCapacity(void)
+{
+	return orbs.getCapacity();
+}
+
+OrbBvh* World::getBvh(void)
+{
+	return bvh;
+}
+
+//Chunk along one axis, clamped to the world
+int World::chunkAxis(double v)
+{
+	int c = (int)floor((v + bound + 1) / CHUNK_SIZE);
+
+	if(c < 0)
+		return 0;
+	if(c >= chunksPerAxis)
+		return chunksPerAxis - 1;
+	return c;
+}
+
+long long World::chunkKey(int x, int y, int z)
+{
+	return ((long long)z * chunksPerAxis + y) * chunksPerAxis + x;
+}
+
+//The chunk at these coordinates, made dormant and empty if there isn't one
+int World::getChunk(int x, int y, int z)
+{
+	long long key = chunkKey(x, y, z);
+	unordered_map<long long, int>::iterator it = chunkIndex.find(key);
+	Chunk* c;
+	int index;
+
+	if(it != chunkIndex.end()){
+		return it->second;
+	}
+
+	c = new Chunk;
+	c->x = x;
+	c->y = y;
+	c->z = z;
+	c->count = 0;
+	c->active = false;
+	c->dirty = true;
+	c->idle = 0;
+	c->wanted = 0;
+	c->page = NULL;
+	c->pageBytes = 0;
+
+	if(!freeChunks.empty()){
+		index = freeChunks.back();
+		freeChunks.pop_back();
+		chunks[index] = c;
+	}
+	else {
+		index = chunks.size();
+		chunks.push_back(c);
+	}
+	chunkIndex[key] = index;
+
+	return index;
+}
+
+void World::freeChunk(int index)
+{
+	Chunk* c = chunks[index];
+
+	chunkIndex.erase(chunkKey(c->x, c->y, c->z));
+	dropPage(c);
+	delete c;
+	chunks[index] = NULL;
+	freeChunks.push_back(index);
+}
+
+//Distance between a chunk and the chunk with this key, 0 if they touch
+double World::chunkGap(const Chunk* c, long long key)
+{
+	int x = key % chunksPerAxis;
+	int y = key / chunksPerAxis % chunksPerAxis;
+	int z = key / chunksPerAxis / chunksPerAxis;
+	double dx = abs(c->x - x) - 1, dy = abs(c->y - y) - 1, dz = abs(c->z - z) - 1;
+
+	if(dx < 0)
+		dx = 0;
+	if(dy < 0)
+		dy = 0;
+	if(dz < 0)
+		dz = 0;
+	return sqrt(dx*dx + dy*dy + dz*dz) * CHUNK_SIZE;
+}
+
+bool World::inRegion(const Chunk* c)
+{
+	if(focusRadius < 0){
+		return true;
+	}
+	for(unsigned int i = 0; i < focusChunks.size(); i++){
+		if(chunkGap(c, focusChunks[i]) <= focusRadius){
+			return true;
+		}
+	}
+	return false;
+}
+
+void World::setRegion(const Point3D* centers, int count, double radius)
+{
+	newFocus.clear();
+	for(int i = 0; i < count; i++){
+		long long key = chunkKey(chunkAxis(centers[i].x), chunkAxis(centers[i].y), chunkAxis(centers[i].z));
+		bool seen = false;
+
+		for(unsigned int j = 0; j < newFocus.size() && !seen; j++){
+			seen = newFocus[j] == key;
+		}
+		if(!seen){
+			newFocus.push_back(key);
+		}
+	}
+
+	//copied rather than swapped, so each keeps the room it was given
+	if(radius == focusRadius && newFocus == focusChunks){
+		return;
+	}
+	focusChunks.assign(newFocus.begin(), newFocus.end());
+	focusRadius = radius;
+	applyRegion();
+}
+
+void World::reserveRegion(int centers)
+{
+	focusChunks.reserve(centers);
+	newFocus.reserve(centers);
+}
+
+int World::getRegionChanges(void)
+{
+	return regionChanges;
+}
+
+//Brings the active chunks in line with the region. The region is worked
+//out from the chunks the centres are in rather than the centres, so it
+//stays put while they move about inside them, and a chunk only leaves
+//once it is a chunk clear of the region, so walking back and forth over
+//the edge doesn't page it in and out.
+//
+//An attached BVH is patched rather than rebuilt: a chunk coming in is
+//hung in it as a subtree and the orbs of one going out are removed,
+//unless the newcomers are most of the new working set, as on the first
+//pass after a restore; then one build is quicker and gives a better tree.
+void World::applyRegion(void)
+{
+	int reach = (int)ceil(focusRadius / CHUNK_SIZE);
+	bool changed = false;
+	bool patch;
+	unsigned int kept = 0;
+	int leavingOrbs = 0, enteringOrbs = 0;
+
+	regionPass++;
+	entering.clear();
+
+	for(unsigned int i = 0; i < focusChunks.size(); i++){
+		long long key = focusChunks[i];
+		int fx = key % chunksPerAxis;
+		int fy = key / chunksPerAxis % chunksPerAxis;
+		int fz = key / chunksPerAxis / chunksPerAxis;
+
+		for(int z = max(fz - reach, 0); z <= min(fz + reach, chunksPerAxis - 1); z++){
+			for(int y = max(fy - reach, 0); y <= min(fy + reach, chunksPerAxis - 1); y++){
+				for(int x = max(fx - reach, 0); x <= min(fx + reach, chunksPerAxis - 1); x++){
+					int index;
+					Chunk* c;
+
+					//skip the corners of the cube without making chunks there
+					double dx = max(abs(x - fx) - 1, 0), dy = max(abs(y - fy) - 1, 0), dz = max(abs(z - fz) - 1, 0);
+					if(sqrt(dx*dx + dy*dy + dz*dz) * CHUNK_SIZE > focusRadius){
+						continue;
+					}
+
+					index = getChunk(x, y, z);
+					c = chunks[index];
+					if(c->wanted != regionPass){
+						c->wanted = regionPass;
+						if(!c->active){
+							entering.push_back(index);
+							enteringOrbs += c->count;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	//let go of active chunks well outside the region
+	for(unsigned int i = 0; i < activeChunks.size(); i++){
+		Chunk* c = chunks[activeChunks[i]];
+		bool near = c->wanted == regionPass;
+
+		for(unsigned int j = 0; j < focusChunks.size() && !near; j++){
+			near = chunkGap(c, focusChunks[j]) <= focusRadius + CHUNK_SIZE;
+		}
+		if(!near){
+			c->active = false;
+			changed = true;
+			leavingOrbs += c->count;
+		}
+	}
+
+	patch = bvh && enteringOrbs * 2 <= orbs.size() - leavingOrbs + enteringOrbs;
+	if(changed){
+		deactivate(patch);
+		for(unsigned int i = 0; i < activeChunks.size(); i++){
+			int index = activeChunks[i];
+			Chunk* c = chunks[index];
+
+			if(c->active){
+				activeChunks[kept++] = index;
+			}
+			else if(c->count == 0){
+				freeChunk(index);
+			}
+			else if(!c->dirty && c->page){
+				//the page is still an exact copy, nothing to keep
+				c->orbs.discard();
+				c->orbs.borrow(c->page, c->count);
+			}
+		}
+		activeChunks.resize(kept);
+	}
+
+	for(unsigned int i = 0; i < entering.size(); i++){
+		activate(entering[i], patch);
+	}
+
+	if(changed || !entering.empty()){
+		regionChanges++;
+		gridValid = false;
+		if(bvh && !patch){
+			bvh->build(*this);
+		}
+	}
+}
+
+//Moves a dormant chunk's orbs into the working set. A page it has stays
+//behind, so if nothing changes before it goes dormant again it can just
+//take the page back.
+void World::activate(int index, bool patchBvh)
+{
+	Chunk* c = chunks[index];
+	int first = orbs.size();
+
+	if(!c || c->active){
+		return;
+	}
+	for(int i = 0; i < c->orbs.size(); i++){
+		Orb orb = c->orbs[i];
+
+		orb.chunk = index;
+		addActive(orb);
+	}
+	if(patchBvh && orbs.size() > first){
+		bvh->insert(&orbs[first], orbs.size() - first);
+	}
+	c->orbs.discard();
+	c->active = true;
+	c->idle = 0;
+	activeChunks.push_back(index);
+}
+
+//Moves the orbs of chunks no longer active out of the working set. Back
+//to front, so what swaps into a hole has already been looked at.
+void World::deactivate(bool patchBvh)
+{
+	for(int i = orbs.size() - 1; i >= 0; i--){
+		Chunk* c = chunks[orbs[i].chunk];
+
+		if(c->active){
+			continue;
+		}
+		if(c->dirty || !c->page){
+			c->orbs.push_back(orbs[i]);
+		}
+		c->idle = 0;
+		if(patchBvh){
+			bvh->remove(orbs[i].id);
+		}
+		slots[orbs[i].id] = -1;
+		orbs[i] = orbs.back();
+		orbs.pop_back();
+		if(i < orbs.size()){
+			slots[orbs[i].id] = i;
+		}
+	}
+}
+
+void World::addActive(const Orb& orb)
+{
+	slots[orb.id] = orbs.size();
+	orbs.push_back(orb);
+	gridValid = false;
+}
+
+bool World::setPageFile(const char* fileName)
+{
+	if(pages){
+		return false;
+	}
+	pages = new PageFile;
+	if(!pages->open(fileName)){
+		delete pages;
+		pages = NULL;
+		return false;
+	}
+	return true;
+}
+
+//True if a dormant chunk is using its page for its orbs
+bool World::isPaged(Chunk* c)
+{
+	return c->page && c->orbs.data() == c->page;
+}
+
+//Moves a dormant chunk's orbs out of memory and into the page file
+void World::pageOut(Chunk* c)
+{
+	size_t bytes = c->count * sizeof(Orb);
+	size_t granted;
+	Orb* page;
+
+	if(c->dirty || !c->page){
+		if(bytes > c->pageBytes){
+			//too big to fit in memory mapped a segment at a time stays put
+			page = (Orb*)pages->allocate(bytes, granted);
+			if(!page){
+				return;
+			}
+			dropPage(c);
+			c->page = page;
+			c->pageBytes = granted;
+		}
+		memcpy(c->page, c->orbs.data(), bytes);
+		c->dirty = false;
+	}
+	c->orbs.discard();
+	c->orbs.borrow(c->page, c->count);
+}
+
+void World::dropPage(Chunk* c)
+{
+	if(c->page && pages){
+		pages->release(c->page, c->pageBytes);
+	}
+	c->page = NULL;
+	c->pageBytes = 0;
+	c->dirty = true;
+}
+
+void World::maintain(void)
+{
+	if(!pages){
+		return;
+	}
+	for(unsigned int i = 0; i < chunks.size(); i++){
+		Chunk* c = chunks[i];
+
+		if(!c || c->active){
+			continue;
+		}
+		//orbs borrowed from a checkpoint are file backed already
+		if(++c->idle >= PAGE_AFTER && c->orbs.isOwned() && c->count){
+			pageOut(c);
+		}
+	}
+}
+
+int World::getActiveChunks(void)
+{
+	return activeChunks.size();
+}
+
+int World::getResidentChunks(void)
+{
+	int n = 0;
+
+	for(unsigned int i = 0; i < chunks.size(); i++){
+		if(chunks[i] && !chunks[i]->active && !isPaged(chunks[i])){
+			n++;
+		}
+	}
+	return n;
+}
+
+int World::getPagedChunks(void)
+{
+	int n = 0;
+
+	for(unsigned int i = 0; i < chunks.size(); i++){
+		if(chunks[i] && !chunks[i]->active && isPaged(chunks[i])){
+			n++;
+		}
+	}
+	return n;
+}
+
+long long World::getPagedBytes(void)
+{
+	return pages ? pages->getUsed() : 0;
+}
+
+//Cell along one axis, clamped to the grid
+int World::cellAxis(double v)
+{
+	double t = (v + bound + 1) * (1.0 / CELL_SIZE);
+
+	//truncating is flooring for everything not clamped to 0
+	if(t < 0)
+		return 0;
+	if(t >= cellsPerAxis)
+		return cellsPerAxis - 1;
+	return (int)t;
+}
+
+//A row of cells along x, by the cell's y and z
+long long World::rowKey(const Point3D& p)
+{
+	return cellAxis(p.y) | (long long)cellAxis(p.z) << 21;
+}
+
+int World::bucketOf(long long row)
+{
+	return (int)((unsigned long long)row * 0x9E3779B97F4A7C15ULL >> (64 - bucketBits));
+}
+
+//The part of the grid to scan for cells x0..x1 of a row. Past the end of
+//that, or an orb beyond x1, there is nothing more in the row.
+void World::rowRange(long long row, int x0, int x1, int& first, int& last)
+{
+	int base;
+
+	if(denseGrid){
+		base = ((int)(row >> 21) * cellsPerAxis + (int)(row & 0x1FFFFF)) * cellsPerAxis;
+		first = bucketStart[base + x0];
+		last = bucketStart[base + x1 + 1];
+		return;
+	}
+
+	base = bucketOf(row);
+	first = bucketStart[base];
+	last = bucketStart[base + 1];
+	while(first < last && gridX[first] < x0)
+		first++;
+}
+
+//Counting sort of the working set into buckets. A room small enough for
+//it gets a bucket per cell, which keeps each row of cells in one run;
+//otherwise rows are hashed into at least twice as many buckets as orbs,
+//so most have a bucket to themselves, and sorted by cell along x first
+//so each bucket is in x order whichever rows share it.
+void World::updateGrid(void)
+{
+	int n = orbs.size();
+	int numBuckets, b, c, k, i;
+	long long cells = (long long)cellsPerAxis * cellsPerAxis * cellsPerAxis;
+
+	if(gridValid){
+		return;
+	}
+	gridValid = true;
+
+	for(bucketBits = 6; (1 << bucketBits) < 2 * n; bucketBits++);
+	numBuckets = 1 << bucketBits;
+	denseGrid = cells <= numBuckets;
+	if(denseGrid){
+		numBuckets = (int)cells;
+	}
+
+	gridOrbs.resize(n);
+	gridPos.resize(n);
+	gridRow.resize(n);
+	gridX.resize(n);
+	orbCell.resize(n);
+	orbRow.resize(n);
+	orbBucket.resize(n);
+	byCell.resize(n);
+
+	for(i = 0; i < n; i++){
+		orbCell[i] = cellAxis(orbs[i].pos.x);
+		orbRow[i] = rowKey(orbs[i].pos);
+	}
+
+	//running totals leave each start at the end of its cell or bucket, and
+	//filling back to front walks it down to the start, keeping each in
+	//the order it was filled from
+	if(denseGrid){
+		for(i = 0; i < n; i++){
+			orbBucket[i] = ((int)(orbRow[i] >> 21) * cellsPerAxis + (int)(orbRow[i] & 0x1FFFFF)) * cellsPerAxis + orbCell[i];
+			byCell[i] = i;
+		}
+	}
+	else {
+		cellStart.assign(cellsPerAxis + 1, 0);
+		for(i = 0; i < n; i++){
+			cellStart[orbCell[i]]++;
+		}
+		for(c = 1; c <= cellsPerAxis; c++){
+			cellStart[c] += cellStart[c - 1];
+		}
+		for(i = n - 1; i >= 0; i--){
+			byCell[--cellStart[orbCell[i]]] = i;
+		}
+		for(i = 0; i < n; i++){
+			orbBucket[i] = bucketOf(orbRow[i]);
+		}
+	}
+
+	bucketStart.assign(numBuckets + 1, 0);
+	for(i = 0; i < n; i++){
+		bucketStart[orbBucket[i]]++;
+	}
+	for(b = 1; b <= numBuckets; b++){
+		bucketStart[b] += bucketStart[b - 1];
+	}
+	for(int j = n - 1; j >= 0; j--){
+		i = byCell[j];
+		k = --bucketStart[orbBucket[i]];
+		gridOrbs[k] = i;
+		gridPos[k] = orbs[i].pos;
+		gridRow[k] = orbRow[i];
+		gridX[k] = orbCell[i];
+	}
+}
+
+//Indices of all orbs in the working set within radius of center
+void World::query(const Point3D& center, double radius, vector<int>& out)
+{
+	int x0 = cellAxis(center.x - radius), x1 = cellAxis(center.x + radius);
+	int y0 = cellAxis(center.y - radius), y1 = cellAxis(center.y + radius);
+	int z0 = cellAxis(center.z - radius), z1 = cellAxis(center.z + radius);
+	float r2 = radius * radius;
+	int k, end;
+
+	out.clear();
+	for(int z = z0; z <= z1; z++){
+		for(int y = y0; y <= y1; y++){
+			long long row = y | (long long)z << 21;
+
+			rowRange(row, x0, x1, k, end);
+			for(; k < end && gridX[k] <= x1; k++){
+				if(gridRow[k] == row && distanceSquared(gridPos[k], center) <= r2){
+					out.push_back(gridOrbs[k]);
+				}
+			}
+		}
+	}
+}
+
+//Indices of all orbs in the working set within radius of the segment
+//from..to
+void World::sweep(const Point3D& from, const Point3D& to, double radius, vector<int>& out)
+{
+	int x0 = cellAxis(fmin(from.x, to.x) - radius), x1 = cellAxis(fmax(from.x, to.x) + radius);
+	int y0 = cellAxis(fmin(from.y, to.y) - radius), y1 = cellAxis(fmax(from.y, to.y) + radius);
+	int z0 = cellAxis(fmin(from.z, to.z) - radius), z1 = cellAxis(fmax(from.z, to.z) + radius);
+	int k, end;
+
+	out.clear();
+	for(int z = z0; z <= z1; z++){
+		for(int y = y0; y <= y1; y++){
+			long long row = y | (long long)z << 21;
+
+			rowRange(row, x0, x1, k, end);
+			for(; k < end && gridX[k] <= x1; k++){
+				if(gridRow[k] == row && sweepHits(gridPos[k], from, to, radius)){
+					out.push_back(gridOrbs[k]);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,222 @@
+/*
+ *	World.h
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+ *
+ */
+
+#ifndef WORLD_H_
+#define WORLD_H_
+#include <vector>
+#include <unordered_map>
+#include "Camera.h"
+#include "Rng.h"
+#include "FlatArray.h"
+#include "MappedFile.h"
+#include "PageFile.h"
+#include "TimingWheel.h"
+using namespace std;
+
+class OrbBvh;
+
+//player and orb radius combined
+const double CAPTURE_RADIUS = 1.5;
+
+//edge of a chunk, the unit the world is split, streamed and paged in
+const int CHUNK_SIZE = 64;
+
+//An orb in the world. Ids are never reused, so other processes (clients,
+//saved games) can refer to an orb across frames.
+struct Orb
+{
+	Point3D pos;
+	unsigned int id;
+	unsigned int chunk;				//the world's index of its chunk
+	TimerId timer;					//the game's lifetime timer, 0 if none
+};
+
+//One chunk's orbs in a saved world, which are stored together
+struct ChunkRecord
+{
+	int x, y, z;
+	unsigned int count;
+	unsigned long long first;		//index of its first orb
+};
+
+//True if an orb at p lies within radius of the segment from a to b
+inline bool sweepHits(const Point3D& p, const Point3D& a, const Point3D& b, float radius)
+{
+	Vector3D s = b - a;
+	Vector3D d = p - a;
+	float len2 = dot(s, s);
+	float t = 0;
+
+	//closest point on the segment
+	if(len2 > 0){
+		t = dot(d, s) / len2;
+		if(t < 0)
+			t = 0;
+		else if(t > 1)
+			t = 1;
+	}
+
+	return lengthSquared(mulAdd(s, -t, d)) < radius*radius;
+}
+
+//sweepHits() for orbs[0..3] at once, bit k set if orbs[k] is hit
+inline int sweepHits4(const Orb* orbs, const Point3D& a, const Point3D& b, float radius)
+{
+	Vector3D s = b - a;
+	float len2 = dot(s, s);
+	Vec3x4 s4 = splat(s);
+	Vec3x4 d = gather(orbs[0].pos, orbs[1].pos, orbs[2].pos, orbs[3].pos) - splat(a);
+	Lanes t = lanesMul(dot(d, s4), lanesSplat(len2 > 0 ? 1 / len2 : 0));
+
+	t = lanesMin(lanesMax(t, lanesSplat(0)), lanesSplat(1));
+	Vec3x4 e = mulAdd(s4, lanesSub(lanesSplat(0), t), d);
+
+	return maskBits(lanesLess(dot(e, e), lanesSplat(radius*radius)));
+}
+
+//The orb store. The world is cut into CHUNK_SIZE cubes, and only the
+//chunks around the players (the active region, see setRegion()) are live:
+//their orbs are kept packed in one array, the working set, which is what
+//size(), indices, queries and the BVH cover. Removal swaps the last orb
+//into the hole. Every other chunk keeps its own orbs, on the heap at
+//first and, once maintain() finds it has been left alone for a while,
+//in the page file, so memory and tick time follow the active region
+//rather than the size of the world.
+//
+//A grid over the working set answers range queries; it is rebuilt on
+//demand with updateGrid(), which does nothing if the working set hasn't
+//changed since. An attached OrbBvh is patched on every change to
+//the working set instead.
+class World
+{
+public:
+			World(int boundary);
+			~World(void);
+	int		getBoundary(void);
+	int		size(void);				//orbs in the working set
+	int		getTotal(void);			//orbs in the whole world
+	Orb*	getOrbs(void);
+	const Orb&	operator[](int index) const;
+	unsigned int	add(const Point3D& pos);
+	Point3D	spawn(Rng& rng);
+	void	remove(int index);
+	int		indexOf(unsigned int id);	//-1 if gone or outside the working set
+	bool	has(unsigned int id);		//still in the world, active or dormant
+	void	clear(void);
+	unsigned int	getNextId(void);
+	void	setBvh(OrbBvh* bvh);
+	OrbBvh*	getBvh(void);
+	void	reserve(int more);		//room to spawn this many without growing
+	int		getCapacity(void);		//orbs the working set holds before it grows
+
+	//chunks within radius of any of the centres are active; cheap to call
+	//every tick, it only does work when a centre crosses into a new chunk.
+	//Chunks coming and going make, free and move orbs between heaps, so
+	//a pass that changes them may allocate; one that doesn't never does,
+	//once reserveRegion() has made room for the centres.
+	void	setRegion(const Point3D* centers, int count, double radius);
+	void	reserveRegion(int centers);
+	int		getRegionChanges(void);	//passes so far that moved chunks in or out
+	bool	setPageFile(const char* fileName);
+	void	maintain(void);			//pages out idle chunks, call now and then
+	int		getActiveChunks(void);
+	int		getResidentChunks(void);	//dormant, with their orbs in memory
+	int		getPagedChunks(void);
+	long long	getPagedBytes(void);
+
+	//saving and restoring: the whole world as orbs grouped by chunk, and
+	//a saved one used in place from a mapped file the world then owns.
+	//borrow() is false, and changes nothing, if the table doesn't fit.
+	void	flatten(vector<ChunkRecord>& table, vector<Orb>& out);
+	bool	borrow(MappedFile* file, Orb* orbs, const ChunkRecord* table, int chunkCount, int orbCount, unsigned int nextId);
+
+	void	updateGrid(void);
+	void	query(const Point3D& center, double radius, vector<int>& out);
+	void	sweep(const Point3D& from, const Point3D& to, double radius, vector<int>& out);
+
+private:
+	struct Chunk
+	{
+		int x, y, z;				//chunk coordinates, from the low corner
+		int count;					//orbs in it, active or not
+		bool active;
+		bool dirty;					//orbs differ from the paged copy
+		int idle;					//maintain() calls since it was active
+		int wanted;					//region pass that last wanted it
+		FlatArray<Orb> orbs;		//its orbs while dormant
+		Orb* page;					//paged copy, NULL if none
+		size_t pageBytes;
+	};
+
+	int		chunkAxis(double v);
+	long long	chunkKey(int x, int y, int z);
+	int		getChunk(int x, int y, int z);
+	void	freeChunk(int index);
+	double	chunkGap(const Chunk* c, long long key);
+	bool	inRegion(const Chunk* c);
+	void	applyRegion(void);
+	void	activate(int index, bool patchBvh);
+	void	deactivate(bool patchBvh);
+	void	pageOut(Chunk* c);
+	void	addActive(const Orb& orb);
+	void	dropPage(Chunk* c);
+	bool	isPaged(Chunk* c);
+
+	long long	rowKey(const Point3D& p);
+	int		bucketOf(long long row);
+	void	rowRange(long long row, int x0, int x1, int& first, int& last);
+	int		cellAxis(double v);
+
+	FlatArray<Orb> orbs;			//the working set
+	FlatArray<int> slots;			//index of each id in orbs, -1 if dormant, -2 once gone
+	MappedFile* backing;			//file dormant chunks may be borrowed from
+	OrbBvh* bvh;					//kept in step with the working set if set
+	unsigned int nextId;
+	int bound;
+	int total;
+
+	//chunks that hold orbs or are active, found by coordinates
+	int chunksPerAxis;
+	vector<Chunk*> chunks;			//NULL where freed
+	vector<int> freeChunks;
+	unordered_map<long long, int> chunkIndex;
+	vector<int> activeChunks;
+	vector<long long> focusChunks;	//chunks the region's centres are in
+	vector<long long> newFocus;
+	vector<int> entering;			//chunks a region pass activates
+	double focusRadius;				//negative before setRegion(): new chunks are active, restored ones not
+	int regionPass;
+	int regionChanges;
+	PageFile* pages;				//NULL if chunks stay on the heap
+
+	//orbs sorted into buckets, a cell each in a small room and a hashed
+	//row of cells otherwise (see updateGrid()): bucket b holds gridOrbs[
+	//bucketStart[b] .. bucketStart[b+1]) in x order, with their positions,
+	//rows and cells along x alongside so queries scan memory in order and
+	//skip orbs of other rows that hash to the same bucket
+	int cellsPerAxis;
+	int bucketBits;
+	bool denseGrid;
+	bool gridValid;
+	vector<int> bucketStart;
+	vector<int> gridOrbs;
+	vector<Point3D> gridPos;
+	vector<long long> gridRow;
+	vector<int> gridX;
+	vector<int> cellStart;			//sorting scratch
+	vector<int> orbCell;
+	vector<long long> orbRow;
+	vector<int> orbBucket;
+	vector<int> byCell;
+
+	static const int CELL_SIZE = 4;
+	static const int PAGE_AFTER = 2;	//maintain() calls a chunk stays resident
+};
+
+#endif
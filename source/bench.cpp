@@ -0,0 +1,573 @@
+/*
+ *	bench.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Times the game's hot paths at several world sizes and checks them
+	against a stored baseline:
+
+		collision	the capture sweep over every orb, ns per orb
+		spawn		orbs spawned into a world with a BVH, ns per orb
+		update		a server style tick: the player moves, the active
+					region and grid follow, captured orbs are swept up
+					and respawned; us per tick
+		camera		a tick's turns and slide and the view matrix, ns
+		hud			formatting the score panel, ns
+		particles	a million capture particles stepped one tick on the
+					job system, ms
+		timers		a million timers scheduled up to 2^16 ticks out, half
+					cancelled, the rest run out; ns per timer
+		render		an offscreen frame, prepare to glFinish(), ms
+
+	Collision, spawn, update and render are measured at every --orbs
+	size. Every metric is the best of --repeats runs and lower is better.
+	--save writes the results as a baseline; --baseline compares against
+	one and fails the run (exit status 1) if any metric is more than
+	--threshold percent slower than it was. Metrics the baseline doesn't
+	have are reported but can't fail. Baselines only mean something on
+	the machine that wrote them. Run it from the game directory so the
+	renderer finds its textures; CMake's bench-check and bench-baseline
+	targets do.
+
+	usage: bench [options]
+		--orbs A,B,...		world sizes (1000,10000,100000)
+		--repeats N			runs of each metric (5)
+		--frames N			frames per render run at 1000 orbs (20)
+		--seed S			world seed (1)
+		--workers N			job system workers (0 = one per spare core)
+		--backend fixed|core	GL pipeline to render with (fixed)
+		--no-render			skip the render metrics
+		--only PREFIX		only run metrics whose name starts with PREFIX
+		--save FILE			write the results to FILE
+		--baseline FILE		compare the results with FILE
+		--threshold P		percent slower that counts as a regression (15)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "Camera.h"
+#include "World.h"
+#include "Bvh.h"
+#include "Player.h"
+#include "Rng.h"
+#include "HudText.h"
+#include "Renderer.h"
+#include "Offscreen.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "ParticleSystem.h"
+#include "TimingWheel.h"
+#include "Timer.h"
+using namespace std;
+
+//One measured result, or one read back from a baseline
+struct Metric
+{
+	char name[48];
+	double value;
+	char unit[8];
+};
+
+//Settings
+vector<int> orbCounts;
+int repeats = 5;
+int frames = 20;
+int seed = 1;
+int workers = 0;
+int w = 640;
+int h = 480;
+RenderBackend backend = BACKEND_FIXED;
+bool render = true;
+double threshold = 15;
+const char* only = "";
+const char* saveFile = NULL;
+const char* baselineFile = NULL;
+
+const int WORLD_SIZE = 40;
+const int UPDATE_TICKS = 200;
+const int CAMERA_TICKS = 1000000;
+const int HUD_CALLS = 200000;
+const int PARTICLES = 1000000;
+const int PARTICLE_TICKS = 20;
+const int TIMERS = 1000000;
+
+vector<Metric> results;
+
+//Keeps results alive so the compiler can't drop the loops
+volatile double sink;
+
+bool wanted(const char* name)
+{
+	return !strncmp(name, only, strlen(only));
+}
+
+void addResult(const char* kind, int orbs, double value, const char* unit)
+{
+	Metric m;
+
+	if(orbs > 0)
+		sprintf(m.name, "%s/%i", kind, orbs);
+	else
+		sprintf(m.name, "%s", kind);
+	m.value = value;
+	sprintf(m.unit, "%s", unit);
+	results.push_back(m);
+	printf("%-22s %12.3f %s\n", m.name, m.value, m.unit);
+	fflush(stdout);
+}
+
+//Lowest of the repeats of a run, which is the one the rest of the
+//machine disturbed least
+template<class F>
+double best(F run)
+{
+	double low = 0;
+
+	for(int i = 0; i < repeats; i++){
+		double t = run();
+		if(i == 0 || t < low)
+			low = t;
+	}
+	return low;
+}
+
+//Fills a world the same way the game's spawner does
+void buildWorld(World& world, int orbs)
+{
+	Rng rng;
+
+	rng.setState(seed);
+	for(int i = 0; i < orbs; i++){
+		world.spawn(rng);
+	}
+}
+
+//detectCollision()'s loop, on one thread
+double benchCollision(int orbs)
+{
+	World world(WORLD_SIZE - 1);
+	vector<char> hit(orbs);
+	Point3D from = { 1, 2, 3 }, to = { 1.4f, 2.3f, 2.2f };
+	int passes = max(1, 4000000 / orbs);
+
+	buildWorld(world, orbs);
+	Orb* all = world.getOrbs();
+	int count = world.size();
+
+	return best([&](){
+		long long start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			int i = 0;
+
+			for(; i + 4 <= count; i += 4){
+				int hits = sweepHits4(all + i, from, to, CAPTURE_RADIUS);
+				for(int k = 0; k < 4; k++)
+					hit[i + k] = hits >> k & 1;
+			}
+			for(; i < count; i++)
+				hit[i] = sweepHits(all[i].pos, from, to, CAPTURE_RADIUS);
+			sink = hit[pass % count];
+		}
+		return (double)(nowNanos() - start) / passes / count;
+	});
+}
+
+double benchSpawn(int orbs)
+{
+	return best([&](){
+		World world(WORLD_SIZE - 1);
+		OrbBvh bvh;
+		Rng rng;
+
+		world.setBvh(&bvh);
+		rng.setState(seed);
+		long long start = nowNanos();
+		for(int i = 0; i < orbs; i++){
+			world.spawn(rng);
+		}
+		return (double)(nowNanos() - start) / orbs;
+	});
+}
+
+//Server::tick() for one player, without the networking
+double benchUpdate(int orbs)
+{
+	return best([&](){
+		World world(WORLD_SIZE - 1);
+		OrbBvh bvh;
+		Camera camera;
+		Player player(&camera);
+		PlayerInput input = { BUTTON_FORWARD, 1.5f, 0.4f, 0 };
+		vector<int> hits;
+		Rng rng;
+
+		camera.setBoundary(WORLD_SIZE - 1);
+		buildWorld(world, orbs);
+		world.setBvh(&bvh);
+		rng.setState(seed + 1);
+
+		long long start = nowNanos();
+		for(int tick = 0; tick < UPDATE_TICKS; tick++){
+			player.move(input, 0.01);
+			Point3D pos = player.getPosition();
+			world.setRegion(&pos, 1, VIEW_DISTANCE);
+			world.updateGrid();
+			world.sweep(player.getLastPosition(), pos, CAPTURE_RADIUS, hits);
+			sort(hits.begin(), hits.end());
+			for(int i = (int)hits.size() - 1; i >= 0; i--){
+				world.remove(hits[i]);
+			}
+			while(world.getTotal() < orbs){
+				world.spawn(rng);
+			}
+			world.updateGrid();
+		}
+		return (nowNanos() - start) / 1000.0 / UPDATE_TICKS;
+	});
+}
+
+double benchCamera(void)
+{
+	return best([&](){
+		Camera camera;
+		double sum = 0;
+
+		camera.setBoundary(WORLD_SIZE - 1);
+		long long start = nowNanos();
+		for(int tick = 0; tick < CAMERA_TICKS; tick++){
+			camera.yaw(0.5);
+			camera.pitch(0.3);
+			camera.slide(0.01, 0, -0.02);
+			sum += camera.getModelViewMatrix().m[12];
+		}
+		sink = sum;
+		return (double)(nowNanos() - start) / CAMERA_TICKS;
+	});
+}
+
+double benchHud(void)
+{
+	return best([&](){
+		HudText text;
+		int length = 0;
+
+		long long start = nowNanos();
+		for(int i = 0; i < HUD_CALLS; i++){
+			formatHud(text, i, i + i / 3, i * 10, 60 + (i & 63) * 0.37);
+			length += text.fps[13];
+		}
+		sink = length;
+		return (double)(nowNanos() - start) / HUD_CALLS;
+	});
+}
+
+//ParticleSystem::update() at the game's tick rate, refilled before each run
+double benchParticles(void)
+{
+	JobSystem jobs(workers);
+	ParticleSystem particles(PARTICLES);
+	Point3D at = { 0, 0, 0, 1 };
+
+	return best([&](){
+		particles.clear();
+		while(particles.burst(at, PARTICLE_BURST) > 0)
+			;
+		long long start = nowNanos();
+		for(int tick = 0; tick < PARTICLE_TICKS; tick++){
+			particles.update(0.01f, &jobs);
+		}
+		sink = particles.size();
+		return (nowNanos() - start) / 1000000.0 / PARTICLE_TICKS;
+	});
+}
+
+static void countTimer(void* data, unsigned int arg)
+{
+	(*(int*)data)++;
+}
+
+//Orb lifetimes on the game's timing wheel: all of them scheduled, every
+//other one cancelled as if caught, the wheel turned until the rest fire
+double benchTimers(void)
+{
+	TimingWheel wheel;
+	vector<TimerId> ids(TIMERS);
+	Rng rng;
+
+	wheel.reserve(TIMERS);
+	return best([&](){
+		int fired = 0;
+
+		rng.setState(seed);
+		long long start = nowNanos();
+		for(int i = 0; i < TIMERS; i++){
+			ids[i] = wheel.schedule(rng.next() & 0xFFFF, countTimer, &fired, i);
+		}
+		for(int i = 0; i < TIMERS; i += 2){
+			wheel.cancel(ids[i]);
+		}
+		while(wheel.size() > 0){
+			wheel.advance();
+		}
+		sink = fired;
+		return (double)(nowNanos() - start) / TIMERS;
+	});
+}
+
+//Frames along headless's default spiral, in fewer steps in bigger worlds
+//so every run draws about as many orbs
+double benchRender(Renderer& renderer, JobSystem& jobs, int orbs)
+{
+	World world(WORLD_SIZE - 1);
+	OrbBvh bvh;
+	FrameArena arena;
+	int steps = max(3, (int)((long long)frames * 1000 / max(orbs, 1000)));
+
+	buildWorld(world, orbs);
+	world.setBvh(&bvh);
+	renderer.setWorld(&world);
+	renderer.setScore(0, 0, orbs);
+
+	double ms = best([&](){
+		Camera camera;
+		Point3D eye;
+
+		camera.setBoundary(WORLD_SIZE - 1);
+		renderer.setCamera(&camera);
+		long long start = nowNanos();
+		for(int frame = 0; frame < steps; frame++){
+			camera.yaw(360.0 / steps);
+			camera.slide(0, 0, -0.1);
+			arena.reset();
+			eye = camera.getLocation();
+			world.setRegion(&eye, 1, VIEW_DISTANCE);
+			renderer.prepareFrame(&jobs, &arena);
+			renderer.display();
+			glFinish();
+		}
+		return (nowNanos() - start) / 1000000.0 / steps;
+	});
+
+	renderer.setWorld(NULL);
+	return ms;
+}
+
+void runAll(void)
+{
+	char name[48];
+
+	for(unsigned int i = 0; i < orbCounts.size(); i++){
+		int orbs = orbCounts[i];
+
+		sprintf(name, "collision/%i", orbs);
+		if(wanted(name))
+			addResult("collision", orbs, benchCollision(orbs), "ns");
+		sprintf(name, "spawn/%i", orbs);
+		if(wanted(name))
+			addResult("spawn", orbs, benchSpawn(orbs), "ns");
+		sprintf(name, "update/%i", orbs);
+		if(wanted(name))
+			addResult("update", orbs, benchUpdate(orbs), "us");
+	}
+	if(wanted("camera"))
+		addResult("camera", 0, benchCamera(), "ns");
+	if(wanted("hud"))
+		addResult("hud", 0, benchHud(), "ns");
+	if(wanted("particles"))
+		addResult("particles", 0, benchParticles(), "ms");
+	if(wanted("timers"))
+		addResult("timers", 0, benchTimers(), "ns");
+}
+
+void runRender(void)
+{
+	OffscreenContext offscreen;
+	bool any = false;
+
+	for(unsigned int i = 0; i < orbCounts.size(); i++){
+		char name[48];
+		sprintf(name, "render/%i", orbCounts[i]);
+		any = any || wanted(name);
+	}
+	if(!any)
+		return;
+	if(!offscreen.create(w, h, backend == BACKEND_CORE)){
+		printf("unable to create an offscreen GL context, render skipped\n");
+		return;
+	}
+
+	JobSystem jobs(workers);
+	Renderer renderer(w, h, backend);
+
+	renderer.setText(false);
+	for(unsigned int i = 0; i < orbCounts.size(); i++){
+		char name[48];
+		sprintf(name, "render/%i", orbCounts[i]);
+		if(wanted(name))
+			addResult("render", orbCounts[i], benchRender(renderer, jobs, orbCounts[i]), "ms");
+	}
+}
+
+bool readBaseline(const char* fileName, vector<Metric>& out)
+{
+	ifstream ifs(fileName);
+	char line[256];
+	Metric m;
+
+	if(!ifs)
+		return false;
+	while(ifs.getline(line, sizeof(line))){
+		if(line[0] == '#' || line[0] == 0)
+			continue;
+		if(sscanf(line, "%47s %lf %7s", m.name, &m.value, m.unit) == 3)
+			out.push_back(m);
+	}
+	return true;
+}
+
+bool writeBaseline(const char* fileName)
+{
+	FILE* f = fopen(fileName, "w");
+
+	if(!f)
+		return false;
+	fprintf(f, "# bench results, lower is better: name value unit\n");
+	for(unsigned int i = 0; i < results.size(); i++){
+		fprintf(f, "%s %.4f %s\n", results[i].name, results[i].value, results[i].unit);
+	}
+	fclose(f);
+	return true;
+}
+
+//Number of metrics more than threshold percent slower than the baseline
+int compare(const vector<Metric>& baseline)
+{
+	int regressed = 0;
+
+	printf("\n%-22s %12s %12s %9s\n", "metric", "now", "baseline", "change");
+	for(unsigned int i = 0; i < results.size(); i++){
+		const Metric& r = results[i];
+		const Metric* b = NULL;
+
+		for(unsigned int j = 0; j < baseline.size(); j++){
+			if(!strcmp(baseline[j].name, r.name))
+				b = &baseline[j];
+		}
+		if(!b){
+			printf("%-22s %12.3f %12s %9s\n", r.name, r.value, "-", "new");
+			continue;
+		}
+
+		double change = b->value > 0 ? (r.value - b->value) * 100 / b->value : 0;
+		bool slower = change > threshold;
+
+		printf("%-22s %12.3f %12.3f %+8.1f%%%s\n", r.name, r.value, b->value, change,
+			slower ? "  REGRESSED" : "");
+		regressed += slower;
+	}
+	return regressed;
+}
+
+void readArgs(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++){
+		const char* arg = argv[i];
+		const char* val = i + 1 < argc ? argv[i + 1] : "";
+
+		if(!strcmp(arg, "--orbs")){
+			orbCounts.clear();
+			for(const char* p = val; *p; ){
+				orbCounts.push_back(atoi(p));
+				while(*p && *p != ',')
+					p++;
+				if(*p == ',')
+					p++;
+			}
+			i++;
+		}
+		else if(!strcmp(arg, "--repeats"))
+			repeats = atoi(val), i++;
+		else if(!strcmp(arg, "--frames"))
+			frames = atoi(val), i++;
+		else if(!strcmp(arg, "--seed"))
+			seed = atoi(val), i++;
+		else if(!strcmp(arg, "--workers"))
+			workers = atoi(val), i++;
+		else if(!strcmp(arg, "--no-render"))
+			render = false;
+		else if(!strcmp(arg, "--only"))
+			only = val, i++;
+		else if(!strcmp(arg, "--save"))
+			saveFile = val, i++;
+		else if(!strcmp(arg, "--baseline"))
+			baselineFile = val, i++;
+		else if(!strcmp(arg, "--threshold"))
+			threshold = atof(val), i++;
+		else if(!strcmp(arg, "--backend")){
+			if(!strcmp(val, "core"))
+				backend = BACKEND_CORE;
+			else if(!strcmp(val, "fixed"))
+				backend = BACKEND_FIXED;
+			else {
+				printf("unknown backend %s\n", val);
+				exit(2);
+			}
+			i++;
+		}
+		else {
+			printf("unknown option %s\n", arg);
+			exit(2);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	vector<Metric> baseline;
+	int regressed;
+
+	orbCounts.push_back(1000);
+	orbCounts.push_back(10000);
+	orbCounts.push_back(100000);
+	readArgs(argc, argv);
+	if(repeats < 1)
+		repeats = 1;
+	if(frames < 1)
+		frames = 1;
+
+	//read it first so a missing baseline doesn't cost a whole run
+	if(baselineFile && !readBaseline(baselineFile, baseline)){
+		printf("unable to read baseline %s\n", baselineFile);
+		return 2;
+	}
+
+	runAll();
+	if(render)
+		runRender();
+
+	if(saveFile){
+		if(!writeBaseline(saveFile)){
+			printf("unable to write %s\n", saveFile);
+			return 2;
+		}
+		printf("saved %i results to %s\n", (int)results.size(), saveFile);
+	}
+	if(baselineFile){
+		regressed = compare(baseline);
+		if(regressed){
+			printf("%i of %i metrics more than %.0f%% slower than the baseline\n",
+				regressed, (int)results.size(), threshold);
+			return 1;
+		}
+		printf("no metric more than %.0f%% slower than the baseline\n", threshold);
+	}
+
+	return 0;
+}
@@ -0,0 +1,246 @@
+/*
+ *	bvhbench.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Checks the orb BVH against brute force and times it. A seeded world is
+	filled the way the game spawns, then random rays and flashlight cones
+	are cast through both the tree and a plain loop over every orb; any
+	disagreement is reported and fails the run. A churn phase captures and
+	respawns orbs to time the incremental updates and checks the queries
+	still agree afterwards.
+
+	usage: bvhbench [options]
+		--orbs N		orbs in the world (1000000)
+		--size S		half the room's edge (40)
+		--rays N		rays and cones per round (4000)
+		--brute N		queries also run brute force (200)
+		--churn N		orbs captured and respawned (100000)
+		--seed S		world seed (1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "World.h"
+#include "Bvh.h"
+#include "Rng.h"
+#include "Timer.h"
+using namespace std;
+
+const double RANGE = 30;
+const double HALF_ANGLE = 45;
+
+//Settings
+int orbs = 1000000;
+int boundary = 39;
+int rays = 4000;
+int brute = 200;
+int churn = 100000;
+int seed = 1;
+
+struct Query
+{
+	Point3D origin;
+	Vector3D dir;
+};
+
+double uniform(Rng& rng)
+{
+	return rng.next() * (1.0 / 4294967296.0);
+}
+
+void makeQueries(Rng& rng, vector<Query>& queries)
+{
+	queries.resize(rays);
+	for(int i = 0; i < rays; i++){
+		Query& q = queries[i];
+		double len;
+
+		q.origin.x = (uniform(rng) * 2 - 1) * boundary;
+		q.origin.y = (uniform(rng) * 2 - 1) * boundary;
+		q.origin.z = (uniform(rng) * 2 - 1) * boundary;
+		do {
+			q.dir.x = uniform(rng) * 2 - 1;
+			q.dir.y = uniform(rng) * 2 - 1;
+			q.dir.z = uniform(rng) * 2 - 1;
+			len = sqrt(q.dir.x*q.dir.x + q.dir.y*q.dir.y + q.dir.z*q.dir.z);
+		} while(len < 0.1 || len > 1);
+		q.dir.x /= len;
+		q.dir.y /= len;
+		q.dir.z /= len;
+	}
+}
+
+//Nearest orb along the ray by testing every one
+unsigned int bruteRay(World& world, const Query& q, double& dist)
+{
+	unsigned int hit = 0;
+	double best = RANGE;
+
+	for(int i = 0; i < world.size(); i++){
+		const Point3D& p = world[i].pos;
+		double cx = q.origin.x - p.x, cy = q.origin.y - p.y, cz = q.origin.z - p.z;
+		double b = cx*q.dir.x + cy*q.dir.y + cz*q.dir.z;
+		double c = cx*cx + cy*cy + cz*cz - ORB_RADIUS*ORB_RADIUS;
+		double disc = b*b - c;
+		double t;
+
+		if(disc < 0)
+			continue;
+		t = -b - sqrt(disc);
+		if(t < 0)
+			t = c < 0 ? 0 : -1;
+		if(t >= 0 && t < best){
+			best = t;
+			hit = world[i].id;
+		}
+	}
+	dist = best;
+	return hit;
+}
+
+void bruteCone(World& world, const Query& q, vector<unsigned int>& out)
+{
+	double sinA = sin(HALF_ANGLE * rads), cosA = cos(HALF_ANGLE * rads);
+
+	out.clear();
+	for(int i = 0; i < world.size(); i++){
+		const Point3D& p = world[i].pos;
+		double dx = p.x - q.origin.x, dy = p.y - q.origin.y, dz = p.z - q.origin.z;
+		double dist2 = dx*dx + dy*dy + dz*dz;
+		double along = dx*q.dir.x + dy*q.dir.y + dz*q.dir.z;
+		double perp;
+
+		if(dist2 > (RANGE + ORB_RADIUS) * (RANGE + ORB_RADIUS) || along < -ORB_RADIUS)
+			continue;
+		perp = sqrt(fabs(dist2 - along*along));
+		if(perp*cosA - along*sinA < ORB_RADIUS)
+			out.push_back(world[i].id);
+	}
+}
+
+//Runs every query through the tree, the first few through brute force too
+int runQueries(World& world, OrbBvh& bvh, vector<Query>& queries, const char* label)
+{
+	vector<unsigned int> found, expected;
+	long long start, rayTime, coneTime, bruteTime = 0;
+	long long hits = 0, inCone = 0;
+	int mismatches = 0;
+	double dist, bruteDist;
+
+	start = nowNanos();
+	for(int i = 0; i < rays; i++){
+		if(bvh.raycast(queries[i].origin, queries[i].dir, RANGE, dist))
+			hits++;
+	}
+	rayTime = nowNanos() - start;
+
+	start = nowNanos();
+	for(int i = 0; i < rays; i++){
+		bvh.cone(queries[i].origin, queries[i].dir, HALF_ANGLE, RANGE, found);
+		inCone += found.size();
+	}
+	coneTime = nowNanos() - start;
+
+	for(int i = 0; i < brute && i < rays; i++){
+		unsigned int id = bvh.raycast(queries[i].origin, queries[i].dir, RANGE, dist);
+
+		start = nowNanos();
+		unsigned int bruteId = bruteRay(world, queries[i], bruteDist);
+		bruteTime += nowNanos() - start;
+
+		//ties at the same distance may pick either orb
+		if(id != bruteId && fabs(dist - bruteDist) > 1e-4)
+			mismatches++;
+
+		bvh.cone(queries[i].origin, queries[i].dir, HALF_ANGLE, RANGE, found);
+		bruteCone(world, queries[i], expected);
+		sort(found.begin(), found.end());
+		sort(expected.begin(), expected.end());
+		if(found != expected)
+			mismatches++;
+	}
+
+	printf("%s\n", label);
+	printf("  rays:     %.0f per second, %.1f%% hit\n", rays * 1e9 / rayTime, 100.0 * hits / rays);
+	printf("  cones:    %.0f per second, %.0f orbs each\n", rays * 1e9 / coneTime, (double)inCone / rays);
+	if(brute > 0){
+		printf("  brute:    %.0f rays per second (%.0fx slower)\n", brute * 1e9 / bruteTime,
+			(bruteTime / (double)brute) / (rayTime / (double)rays));
+	}
+	printf("  mismatch: %i of %i\n", mismatches, min(brute, rays) * 2);
+	return mismatches;
+}
+
+void readArgs(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++){
+		const char* arg = argv[i];
+		const char* val = i + 1 < argc ? argv[i + 1] : "";
+
+		if(!strcmp(arg, "--orbs"))
+			orbs = atoi(val), i++;
+		else if(!strcmp(arg, "--rays"))
+			rays = atoi(val), i++;
+		else if(!strcmp(arg, "--brute"))
+			brute = atoi(val), i++;
+		else if(!strcmp(arg, "--churn"))
+			churn = atoi(val), i++;
+		else if(!strcmp(arg, "--size"))
+			boundary = max(atoi(val), 2) - 1, i++;
+		else if(!strcmp(arg, "--seed"))
+			seed = atoi(val), i++;
+		else {
+			printf("unknown option %s\n", arg);
+			exit(2);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	OrbBvh bvh;
+	Rng rng(seed);
+	vector<Query> queries;
+	long long start;
+	int failures = 0;
+
+	readArgs(argc, argv);
+	World world(boundary);
+	rng.setState(seed);
+	for(int i = 0; i < orbs; i++){
+		world.spawn(rng);
+	}
+
+	start = nowNanos();
+	world.setBvh(&bvh);
+	printf("build:      %.3f ms, %i orbs, %i nodes, depth %i\n", (nowNanos() - start) / 1000000.0,
+		bvh.size(), bvh.getNodeCount(), bvh.getDepth());
+
+	makeQueries(rng, queries);
+	failures += runQueries(world, bvh, queries, "built");
+
+	//capture random orbs and spawn replacements, as the game does
+	start = nowNanos();
+	for(int i = 0; i < churn && world.size() > 0; i++){
+		world.remove(rng.nextInt(world.size()));
+		world.spawn(rng);
+	}
+	printf("churn:      %.1f ns per capture and spawn, %i nodes, depth %i\n",
+		churn > 0 ? (nowNanos() - start) / (double)churn : 0.0, bvh.getNodeCount(), bvh.getDepth());
+
+	if(bvh.size() != world.size()){
+		printf("size:       tree has %i orbs, world %i\n", bvh.size(), world.size());
+		failures++;
+	}
+	failures += runQueries(world, bvh, queries, "after churn");
+
+	return failures ? 1 : 0;
+}
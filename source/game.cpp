@@ -7,28 +7,88 @@
  *	
  */
 
-#pragma comment(lib,"fmodvc.lib")
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
+#include <string.h>
 #include <time.h>
-#include <deque>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
 #include <windows.h>
-#include <gl/glut.h>
+#endif
+#include <GL/glut.h>
+#ifdef FREEGLUT
+#include <GL/freeglut_ext.h>
+#endif
+#ifdef NO_FMOD
+#include "NoSound.h"
+#else
+#ifdef _WIN32
+#pragma comment(lib,"fmodvc.lib")
+#endif
 #include <fmod/fmod.h>
-#include "renderer.h"
-#include "camera.h"
+#endif
+#include "Renderer.h"
+#include "Camera.h"
+#include "World.h"
+#include "Bvh.h"
+#include "Player.h"
+#include "Rng.h"
+#include "Checkpoint.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "InputQueue.h"
+#include "MouseInput.h"
+#include "LatencyStats.h"
+#include "FramePacer.h"
+#include "Timer.h"
+#include "AllocStats.h"
+#include "FrameArena.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+#include "Trace.h"
+#include "ParticleSystem.h"
+#include "TimingWheel.h"
+#include "GameTick.h"
 using namespace std;
 
 //Global values
 Camera* theCamera;
 Renderer* theRenderer;
-deque<Point3D> theWorld;
-int keyDown[256];
-int orbsCaptured = 0;
-int orbsReleased = 0;
+JobSystem* theJobs;
+GameTick* theGame;
+Profiler theProfiler;
+FramePacer* thePacer;
+Player* thePlayer;
+World* theWorld;
+OrbBvh* theBvh;
+ParticleSystem* theParticles;
+Rng theRng;							//spawn positions, saved with the world
+mutex worldLock;
+AllocSnapshot tickAllocs = { 0, 0 };	//heap use inside ticks since the last report
+int ticksSinceReport = 0;
+int recordedReported = 0;			//capture counts already added to the metrics
+int droppedReported = 0;
+InputQueue inputQueue;				//GLUT thread -> simulation thread
+MouseInput* theMouse;				//motion, taken once a tick
+LatencyStats inputLatency;
+atomic<long long> unpresentedInput(0);	//oldest input not yet on screen
+int pointerX, pointerY;				//where the GLUT thread last saw the pointer
+int warpPending = 0;				//events left that may still be the warp to the middle
+bool pointerLost = false;			//back in the window, the next event only says where
+bool focusTracked = false;			//the mouse follows the window's focus itself
+atomic<bool> wantRecentre(false);	//the simulation thread asking the GLUT thread
+int capturedReported = 0;			//game counts already added to the metrics
+int releasedReported = 0;
+int escapedReported = 0;
 bool gameOver = false;
 bool paused = false;
 bool splash = false;
-bool turbo = false;
+MetricsRegistry theMetrics;
+MetricsExporter* theExporter;
 FSOUND_STREAM* musicBuffer;
 FSOUND_SAMPLE* coinBuffer;
 FSOUND_SAMPLE* bubbleBuffer;
@@ -38,253 +98,529 @@ int w = 1280;
 int h = 1024;
 int bpp = 32;
 int refresh = 60;
+int workers = 0;
+int tickRate = 100;
+int vsync = 1;
+RenderBackend backend = BACKEND_FIXED;
+int features = FEATURES_ALL;		//RenderFeature flags, see readConfig()
+int metricsPort = 0;				//0 to not serve them
+char metricsFile[128] = "none";
+int metricsInterval = 5;
+int traceAtStart = 0;				//record from launch instead of waiting for R
+int worldSize = 40;					//half the room's edge
+char pageFile[128] = "world.pages";	//where idle chunks are paged, none for nowhere
+int particleCount = 1048576;		//most capture debris alive at once
+CaptureFormat captureFormat = CAPTURE_Y4M;	//what V records to
+int orbLife = 120;					//seconds an orb stays, 0 for ever
+int orbCapacity = 65536;			//orbs the world and its timers have room for up front
+int waveInterval = 60;				//seconds between waves, 0 for none
+int waveSize = 20;					//orbs released at once by a wave
+int decayInterval = 10;				//seconds without a capture per point lost, 0 for none
+int rawMouse = 1;					//motion from the device, 0 from the pointer
 unsigned short mouseSens = 7;
 const char configFile[] = "config.cfg";
+const char checkpointFile[] = "session.sav";
+const char traceFile[] = "trace.json";
+
+//Exported metrics, see initMetrics()
+Counter* releasedMetric;
+Counter* capturedMetric;
+Counter* escapedMetric;
+Counter* timersMetric;
+Counter* ticksMetric;
+Counter* overrunMetric;
+Counter* allocMetric;
+Counter* recordedMetric;
+Counter* recordDropMetric;
+Gauge* captureRatioMetric;
+Gauge* worldSizeMetric;
+Gauge* activeOrbsMetric;
+Histogram* tickMetric;
+Histogram* frameMetric;
+Histogram* inputMetric;
+
+void recentrePointer();
 
 void display()
 {
+	static long long lastPresent = 0;
+	long long inputTime;
+	long long now;
+
+	if(wantRecentre.exchange(false)){
+		recentrePointer();
+	}
 	theRenderer->display();
+	{
+		TRACE_ZONE("swap");
+		glutSwapBuffers();
+	}
+	thePacer->framePresented();
+
+	now = nowNanos();
+	if(lastPresent){
+		frameMetric->observe((now - lastPresent) * 1e-9);
+	}
+	lastPresent = now;
+
+	//the frame just presented shows every input consumed so far
+	inputTime = unpresentedInput.exchange(0);
+	if(inputTime){
+		inputLatency.record(now - inputTime);
+		inputMetric->observe((now - inputTime) * 1e-9);
+	}
+}
+
+void pushInput(int type, int key, int dx, int dy)
+{
+	InputEvent e = { type, key, dx, dy, nowNanos() };
+	inputQueue.push(e);
 }
 
 void keyboard(unsigned char key, int x, int y)
 {
-	keyDown[key] = 1;
+	pushInput(INPUT_KEY_DOWN, key, 0, 0);
 }
 
 void keyboardUp(unsigned char key, int x, int y)
 {
-	keyDown[key] = 0;
+	pushInput(INPUT_KEY_UP, key, 0, 0);
 }
 
-void updateScore()
+//Adds what the game counted during the tick to the metrics
+void reportGame()
 {
-	int score = ((double)orbsCaptured / orbsReleased) * 100;
-	theRenderer->setScore(score, orbsCaptured, orbsReleased);
+	int captured = theGame->getCaptured();
+	int released = theGame->getReleased();
+	int escaped = theGame->getEscaped();
+
+	capturedMetric->add(max(captured - capturedReported, 0));
+	releasedMetric->add(max(released - releasedReported, 0));
+	escapedMetric->add(max(escaped - escapedReported, 0));
+	capturedReported = captured;
+	releasedReported = released;
+	escapedReported = escaped;
+	if(released > 0){
+		captureRatioMetric->set((double)captured / released);
+	}
 }
 
-void updateListenerOrient()
+//The game's sounds, called from inside the tick
+void updateListenerOrient(Camera* camera)
 {
-	Vector3D f, t;
-	Point3D loc;
-	float pos[3];
-
-	loc = theCamera->getLocation();
-	pos[0] = loc.x;
-	pos[1] = loc.y;
-	pos[2] = loc.z;
-	f = theCamera->getN();
-	t = theCamera->getV();
-
-	FSOUND_3D_Listener_SetAttributes(pos, NULL, f.x, f.y, f.z, t.x, t.y, t.z);
+	Point3D loc = camera->getLocation();
+	Vector3D f = camera->getN();
+	Vector3D t = camera->getV();
+
+	FSOUND_3D_Listener_SetAttributes(&loc.x, NULL, f.x, f.y, f.z, t.x, t.y, t.z);
 }
 
-void gameLoop(deque<Point3D>* myWorld)
+void playBubble(const Point3D& at)
 {
-	Point3D treasure;
-	int bound = theRenderer->getBoundary();
-	int sleepTime;
+	Point3D treasure = at;
 
-	//seed random number generator
-	srand((unsigned)time(NULL));	
+	FSOUND_PlaySoundEx(1, bubbleBuffer, NULL, true);
+	FSOUND_3D_SetAttributes(1, &treasure.x, NULL);
+	FSOUND_SetPaused(1, false);
+}
 
-	//main gameloop
-	while(!gameOver){
-		if(turbo){
-            sleepTime = 10;			
-		}
-		else {
-			sleepTime = 3000 - (orbsCaptured*900.0 / (orbsReleased+1));
+void playCoin(const Point3D& at)
+{
+	FSOUND_PlaySound(FSOUND_FREE, coinBuffer);
+}
+
+//Puts the hidden pointer back in the middle of the window. The motion
+//event that causes is known by where it lands and isn't counted; if it
+//hasn't come within a few events, X dropped it as a move to nowhere.
+void recentrePointer()
+{
+	glutWarpPointer(w/2, h/2);
+	warpPending = 8;
+}
+
+//Both GLUT motion callbacks. With a raw mouse the pointer only has to be
+//kept inside the window, so it is warped back just when it nears an
+//edge, not after every event; without one, its motion is the input.
+void pointerMoved(int x, int y)
+{
+	if(warpPending > 0){
+		warpPending--;
+		if(x == w/2 && y == h/2){
+			warpPending = 0;
+			pointerLost = false;
+			pointerX = x;
+			pointerY = y;
+			return;
 		}
+	}
+
+	int dx = x - pointerX;
+	int dy = y - pointerY;
+
+	pointerX = x;
+	pointerY = y;
+	if(paused || pointerLost){
+		pointerLost = false;
+		return;
+	}
+
+	if(!theMouse->isRaw() && (dx != 0 || dy != 0)){
+		theMouse->add(dx, dy);
+	}
+	if(!warpPending && (x < w/4 || x > w*3/4 || y < h/4 || y > h*3/4)){
+		recentrePointer();
+	}
+}
+
+//The pointer leaving or entering the window. A mouse that can't follow
+//the window's focus (see MouseInput::trackFocus()) takes this for it: a
+//window raised over ours by alt-tab takes the pointer too, so a raw
+//mouse drops the motion it sees meanwhile.
+void pointerEntry(int state)
+{
+	bool entered = state == GLUT_ENTERED;
 
-		Sleep(sleepTime);
+	if(!focusTracked){
+		theMouse->setFocus(entered);
+	}
+	if(entered){
+		pointerLost = true;
 		if(!paused){
-			//subtracting rand from another rand gives us
-			//       -bound < position < +bound
-			//positions the treasure within the boundaries
-			treasure.x = (rand() % bound) - (rand() % bound);
-			treasure.y = (rand() % bound) - (rand() % bound);
-			treasure.z = (rand() % bound) - (rand() % bound);
-
-			float pos[] = { treasure.x, treasure.y, treasure.z };
-
-			//add treasure to the world
-			myWorld->push_back(treasure);
-
-			if(!turbo){
-				FSOUND_PlaySoundEx(1, bubbleBuffer, NULL, TRUE);
-				FSOUND_3D_SetAttributes(1, &pos[0], NULL);
-				FSOUND_SetPaused(1, FALSE);
-			}
-			orbsReleased++;
-			updateScore();
+			recentrePointer();
 		}
 	}
 }
 
-void mousePassiveHandler(int x, int y)
+//Held buttons turn the mouse from looking to rolling; the wheel, which
+//GLUT passes as buttons too, doesn't
+void mouseButtonHandler(int button, int state, int x, int y)
 {
-	if(paused){
-		return;
+	if(button <= GLUT_RIGHT_BUTTON){
+		pushInput(INPUT_MOUSE_BUTTON, button, state == GLUT_DOWN, 0);
 	}
+}
 
-	int dx = x - w/2;
-	int dy = y - h/2;
-	
-	if(dx != 0 || dy != 0){	
-		glutWarpPointer(w/2.0,h/2.0);
-		
-		theCamera->yaw(36 * mouseSens * (double)dx / w);
-		theCamera->pitch(36 * mouseSens * (double)dy / h);
+//Drains the input queue at the start of a tick, then turns the camera by
+//all the mouse motion since the last tick at once. Returns the time of
+//the oldest input, or 0.
+long long pollInput()
+{
+	long long oldest = theGame->drainInput(inputQueue);
+	long long since;
+	double dx, dy;
+
+	//taken while paused too, so nothing is saved up for the unpause
+	if(theMouse->take(dx, dy, since) && !paused){
+		if(theGame->getMouseButtons()){
+			theCamera->roll(-36 * mouseSens * dx / w);
+		}
+		else {
+			theCamera->yaw(36 * mouseSens * dx / w);
+			theCamera->pitch(36 * mouseSens * dy / h);
+		}
+		if(!oldest || since < oldest){
+			oldest = since;
+		}
 	}
 
-	updateListenerOrient();
+	return oldest;
 }
 
-void mouseMotionHandler(int x, int y)
+//The game's rules, with its sounds hooked in
+void initGame()
 {
-	if(paused){
-		return;
+	GameSounds sounds = { playCoin, playBubble, updateListenerOrient };
+
+	theGame = new GameTick(theWorld, thePlayer, &theRng, theParticles, theJobs, tickRate);
+	theGame->setRenderer(theRenderer);
+	theGame->setSounds(sounds);
+	theGame->setRules(orbLife, waveInterval, waveSize, decayInterval);
+	theGame->reserve(orbCapacity);
+	theGame->start(0, 0);
+}
+
+void initMetrics()
+{
+	static const double tickBounds[] = { 0.0005, 0.001, 0.002, 0.004, 0.006, 0.008, 0.010, 0.015, 0.020, 0.050 };
+	static const double frameBounds[] = { 0.004, 0.008, 0.012, 0.017, 0.021, 0.025, 0.033, 0.050, 0.100, 0.250 };
+	static const double inputBounds[] = { 0.005, 0.010, 0.020, 0.030, 0.040, 0.050, 0.075, 0.100, 0.200 };
+
+	releasedMetric = theMetrics.counter("orbs_released_total", "Orbs spawned into the world");
+	capturedMetric = theMetrics.counter("orbs_captured_total", "Orbs captured by the player");
+	escapedMetric = theMetrics.counter("orbs_escaped_total", "Orbs whose lifetime ran out");
+	timersMetric = theMetrics.counter("timers_fired_total", "Game timers fired");
+	ticksMetric = theMetrics.counter("ticks_total", "Simulation ticks run");
+	overrunMetric = theMetrics.counter("tick_overruns_total", "Ticks that finished after the next was due");
+	allocMetric = theMetrics.counter("tick_heap_allocations_total", "Heap allocations made inside ticks");
+	recordedMetric = theMetrics.counter("capture_frames_total", "Frames written by the recorder");
+	recordDropMetric = theMetrics.counter("capture_dropped_total", "Frames the recorder couldn't keep up with");
+	captureRatioMetric = theMetrics.gauge("capture_ratio", "Orbs captured over orbs released");
+	worldSizeMetric = theMetrics.gauge("world_orbs", "Orbs in the world");
+	activeOrbsMetric = theMetrics.gauge("world_active_orbs", "Orbs in the chunks around the player");
+	tickMetric = theMetrics.histogram("tick_seconds", "Time spent in one simulation tick",
+		tickBounds, sizeof(tickBounds) / sizeof(tickBounds[0]));
+	frameMetric = theMetrics.histogram("frame_seconds", "Time between presented frames",
+		frameBounds, sizeof(frameBounds) / sizeof(frameBounds[0]));
+	inputMetric = theMetrics.histogram("input_latency_seconds", "Oldest input of a tick to the frame showing it",
+		inputBounds, sizeof(inputBounds) / sizeof(inputBounds[0]));
+
+	theExporter = new MetricsExporter(&theMetrics);
+	if(metricsPort > 0){
+		theExporter->listen(metricsPort);
 	}
+	if(strcmp(metricsFile, "none")){
+		theExporter->setDumpFile(metricsFile, metricsInterval);
+	}
+	theExporter->start();
+}
 
-	int dx = x - w/2;
-	int dy = y - h/2;
-	
-	if(dx != 0 || dy != 0){	
-		glutWarpPointer(w/2.0,h/2.0);
-		theCamera->roll(-36 * mouseSens * (double)dx / w);
+void reportProfile()
+{
+	char name[24];
+	double frameMean, frameStdDev, frameWorst;
+
+	theJobs->sampleUtilization();
+	for(int i = 0; i < theJobs->getWorkerCount(); i++){
+		sprintf(name, "Worker %i", i);
+		theProfiler.set(name, theJobs->getUtilization(i) * 100, "%");
 	}
 
-	updateListenerOrient();
+	FrameGraph* tick = theGame->getGraph();
+	for(int i = 0; i < tick->getPassCount(); i++){
+		theProfiler.set(tick->getPassName(i), tick->getPassTime(i), "ms");
+	}
+
+	theProfiler.set("Input p50", inputLatency.getPercentile(50), "ms");
+	theProfiler.set("Input p95", inputLatency.getPercentile(95), "ms");
+	theProfiler.set("Input p99", inputLatency.getPercentile(99), "ms");
+	theProfiler.set("Input drops", inputQueue.getDropped(), "");
+	theProfiler.set("Raw mouse", theMouse->isRaw(), "");
+
+	thePacer->sampleStats(frameMean, frameStdDev, frameWorst);
+	theProfiler.set("Frame mean", frameMean, "ms");
+	theProfiler.set("Frame stddev", frameStdDev, "ms");
+	theProfiler.set("Frame worst", frameWorst, "ms");
+	theProfiler.set("Spin margin", thePacer->getSpinMargin(), "ms");
+	theProfiler.set("Vsync", thePacer->getVsync(), "");
+
+	//anything here in steady play is a bug, see headless --alloc-check
+	if(ticksSinceReport > 0){
+		theProfiler.set("Allocs/tick", (double)tickAllocs.count / ticksSinceReport, "");
+		theProfiler.set("Alloc KB/tick", tickAllocs.bytes / 1024.0 / ticksSinceReport, "KB");
+	}
+	theProfiler.set("Arena peak", theGame->getArena()->getPeak() / 1024.0, "KB");
+	theProfiler.set("Particles", theParticles->size(), "");
+	int timersFired = theGame->takeTimersFired();
+	theProfiler.set("Timers", theGame->getTimers()->size(), "");
+	if(ticksSinceReport > 0){
+		theProfiler.set("Timers fired/tick", (double)timersFired / ticksSinceReport, "");
+	}
+	timersMetric->add(timersFired);
+
+	//only once something has been recorded or grabbed
+	FrameCapture* capture = theRenderer->getCapture();
+	int captured = capture->getCaptured(), dropped = capture->getDropped();
+	if(captured || dropped){
+		theProfiler.set("Capture frames", captured, "");
+		theProfiler.set("Capture drops", dropped, "");
+		theProfiler.set("Capture p50", capture->getLatency(50), "ms");
+		theProfiler.set("Capture p95", capture->getLatency(95), "ms");
+		recordedMetric->add(captured - recordedReported);
+		recordDropMetric->add(dropped - droppedReported);
+		recordedReported = captured;
+		droppedReported = dropped;
+	}
+
+	//chunks left alone since the last report are paged out
+	worldLock.lock();
+	theWorld->maintain();
+	theProfiler.set("Chunks active", theWorld->getActiveChunks(), "");
+	theProfiler.set("Chunks resident", theWorld->getResidentChunks(), "");
+	theProfiler.set("Chunks paged", theWorld->getPagedChunks(), "");
+	theProfiler.set("Paged", theWorld->getPagedBytes() / 1024.0, "KB");
+	worldLock.unlock();
+
+	tickAllocs.count = tickAllocs.bytes = 0;
+	ticksSinceReport = 0;
 }
 
-void detectCollision()
+//Saves or restores the whole session, between ticks
+void checkpoint(bool save)
 {
-	Point3D playerPos = theCamera->getLocation();
-	Point3D itemPos;
-	double xd, yd, zd;
-
-	for(unsigned int i = 0; i < theWorld.size(); i++){
-		itemPos = theWorld[i];
-		xd = playerPos.x - itemPos.x;
-		yd = playerPos.y - itemPos.y;
-		zd = playerPos.z - itemPos.z;
-
-		//distance between two points formula
-		if(xd*xd + yd*yd + zd*zd < 1.5*1.5){
-			theWorld.erase(theWorld.begin() + i);
-			FSOUND_PlaySound(FSOUND_FREE, coinBuffer);
-			orbsCaptured++;
-			updateScore();
-		}
+	Session session = { theWorld, theCamera, &theRng, theGame->getCaptured(), theGame->getReleased() };
+	long long start = nowNanos();
+	bool ok;
+
+	worldLock.lock();
+	if(save){
+		ok = saveCheckpoint(checkpointFile, session);
+	}
+	else if((ok = loadCheckpoint(checkpointFile, session))){
+		theParticles->clear();
+		theGame->start(session.captured, session.released);
+		capturedReported = session.captured;
+		releasedReported = session.released;
+		escapedReported = theGame->getEscaped();
+		theRenderer->prepareFrame(theJobs, theGame->getArena());
+	}
+	worldLock.unlock();
+
+	if(ok){
+		theProfiler.set(save ? "Save" : "Restore", (nowNanos() - start) / 1000000.0, "ms");
 	}
 }
 
 void inputLoop()
 {
-	//Accelleration of player in u,v,n directions
-	int uAccel = 0;
-	int vAccel = 0;
-	int nAccel = 0;
-
-	while(!gameOver){
-		if(!paused){
+	long long lastReport = nowNanos();
+	long long period = 1000000000LL / tickRate;
+	long long nextTick = nowNanos();
+	long long wait;
+	long long inputTime;
+	long long expected;
 
-			// N DIRECTION IN CAMERA COORDINATES
-			if(keyDown['w'] == 1){	//accellerate forward
-				if(nAccel > -100){
-					nAccel--;
-				}
-			}
-			else {					//else speed degrades
-				if(nAccel < 0){
-					nAccel++;
-				}
-			}
-			if(keyDown['s'] == 1){
-				if(nAccel < 100){
-					nAccel++;
-				}
-			}
-			else {
-				if(nAccel > 0){
-					nAccel--;
-				}
-			}
+	traceThreadName("simulation");
 
-			// U DIRECTION IN CAMERA COORDINATES
-			if(keyDown['a'] == 1){
-				if(uAccel > -100){
-					uAccel--;
-				}
-			}
-			else {
-				if(uAccel < 0){
-					uAccel++;
-				}
-			}
-			if(keyDown['d'] == 1){
-				if(uAccel < 100){
-					uAccel++;
-				}
-			}
-			else {
-				if(uAccel > 0){
-					uAccel--;
-				}
-			}
+	while(!gameOver){
+		inputTime = pollInput();
 
-			//"Jetpack"
-			if(keyDown[' '] == 1){
-				if(vAccel < 100){
-					vAccel++;
-				}
-			}
-			else {
-				if(vAccel > 0){
-					vAccel--;
-				}
+		if(!paused){
+			//the mouse has already turned the camera in pollInput()
+			PlayerInput input = { 0, 0, 0, 0 };
+			if(theGame->held('w'))
+				input.buttons |= BUTTON_FORWARD;
+			if(theGame->held('s'))
+				input.buttons |= BUTTON_BACK;
+			if(theGame->held('a'))
+				input.buttons |= BUTTON_LEFT;
+			if(theGame->held('d'))
+				input.buttons |= BUTTON_RIGHT;
+			if(theGame->held(' '))
+				input.buttons |= BUTTON_UP;
+			theGame->setInput(input);
+
+			if(theGame->pressed('t')){
+				theGame->setTurbo(!theGame->getTurbo());
 			}
 
-			if(keyDown['t'] == 1){
-				turbo = !turbo;
-				keyDown['t'] = 0;
-			}
+			TRACE_ZONE("tick");
+			worldLock.lock();
+			long long tickStart = nowNanos();
+			AllocSnapshot before = getAllocSnapshot();
+			theGame->run();
+			AllocSnapshot used = allocsSince(before);
+			reportGame();
+			tickMetric->observe((nowNanos() - tickStart) * 1e-9);
+			worldSizeMetric->set(theWorld->getTotal());
+			activeOrbsMetric->set(theWorld->size());
+			worldLock.unlock();
+
+			tickAllocs.count += used.count;
+			tickAllocs.bytes += used.bytes;
+			ticksSinceReport++;
+			ticksMetric->add();
+			allocMetric->add(used.count);
+		}
 
-			theCamera->slide(uAccel * .005, vAccel * .005, nAccel * .005);
-			detectCollision();
-			updateListenerOrient();
+		if(nowNanos() - lastReport > 1000000000){
+			reportProfile();
+			lastReport = nowNanos();
 		}
 
-		if(keyDown[27] == 1){
+		if(theGame->pressed(27)){
 			if(splash){
 				theRenderer->setSplash(false);
-				keyDown[27] = 0;
 				paused = false;
 				splash = false;
-				glutWarpPointer(w/2.0,h/2.0);
+				wantRecentre = true;
 			}
 			else {
+				theExporter->stop();
+				if(isTracing()){
+					writeTrace(traceFile);
+				}
+				theRenderer->getCapture()->stop();
+				theRenderer->getCapture()->waitIdle(2000);
 				exit(0);
 			}
 		}
 
-		if(keyDown['p'] == 1 && !splash){
+		if(theGame->pressed('p') && !splash){
 			paused = !paused;
 			theRenderer->setPaused(paused);			
-			keyDown['p'] = 0;
-			glutWarpPointer(w/2.0,h/2.0);
+			wantRecentre = true;
+		}
+
+		if(theGame->pressed('f')){
+			theRenderer->setProfiling(!theRenderer->getProfiling());
+		}
+
+		if(theGame->pressed('k') || theGame->pressed('l')){
+			checkpoint(theGame->pressed('k'));
 		}
 
-		Sleep(10);
+		//V starts recording the screen, pressing it again stops; C grabs
+		//a single frame
+		if(theGame->pressed('v') || theGame->pressed('c')){
+			FrameCapture* capture = theRenderer->getCapture();
+			char name[64];
+			time_t now = time(NULL);
+
+			strftime(name, sizeof(name), "capture-%Y%m%d-%H%M%S", localtime(&now));
+			if(theGame->pressed('c')){
+				strcat(name, ".png");
+				capture->snapshot(name);
+			}
+			else if(capture->isRecording()){
+				capture->stop();
+			}
+			else {
+				capture->record(name, captureFormat, refresh);
+			}
+		}
+
+		//R starts recording a trace, pressing it again writes it out
+		if(theGame->pressed('r')){
+			if(isTracing()){
+				stopTracing();
+				writeTrace(traceFile);
+			}
+			else {
+				startTracing();
+			}
+		}
+
+		//hand the oldest input of this tick to the next present, unless
+		//an even older one is still waiting there
+		if(inputTime){
+			expected = 0;
+			unpresentedInput.compare_exchange_strong(expected, inputTime);
+		}
+
+		//fixed tick rate, skip ahead rather than burst if we fall behind
+		nextTick += period;
+		wait = nextTick - nowNanos();
+		if(wait > 0){
+			sleepNanos(wait);
+		}
+		else {
+			overrunMetric->add();
+			if(wait < -period){
+				nextTick = nowNanos();
+			}
+		}
 	}
 }
 
 void renderLoop()
 {
+	traceThreadName("pacer");
+
 	while(!gameOver){
+		thePacer->wait();
         glutPostRedisplay();
+		TRACE_ZONE("audio");
 		FSOUND_Update();
-		Sleep(10);
 	}
 }
 
@@ -298,11 +634,44 @@ void writeConfig()
 		ofs << "height " << h << endl;
 		ofs << "bpp " << bpp << endl;
 		ofs << "refresh " << refresh << endl;
+		ofs << "workers " << workers << endl;
+		ofs << "tickrate " << tickRate << endl;
+		ofs << "vsync " << vsync << endl;
+		ofs << "renderer " << (backend == BACKEND_CORE ? "core" : "fixed") << endl;
+		ofs << "textures " << ((features & FEATURE_TEXTURED) != 0) << endl;
+		ofs << "materials " << ((features & FEATURE_MATERIALS) != 0) << endl;
+		ofs << "lighting " << ((features & FEATURE_LIGHTING) != 0) << endl;
+		ofs << "metricsport " << metricsPort << endl;
+		ofs << "metricsfile " << metricsFile << endl;
+		ofs << "metricsinterval " << metricsInterval << endl;
+		ofs << "trace " << traceAtStart << endl;
+		ofs << "worldsize " << worldSize << endl;
+		ofs << "pagefile " << pageFile << endl;
+		ofs << "particles " << particleCount << endl;
+		ofs << "orblife " << orbLife << endl;
+		ofs << "orbcapacity " << orbCapacity << endl;
+		ofs << "wave " << waveInterval << endl;
+		ofs << "wavesize " << waveSize << endl;
+		ofs << "scoredecay " << decayInterval << endl;
+		ofs << "rawmouse " << rawMouse << endl;
+		ofs << "capture " << (captureFormat == CAPTURE_RAW ? "raw" : captureFormat == CAPTURE_PNG ? "png" : "y4m") << endl;
 
 		ofs.close();
 	}
 }
 
+//A 0 or 1 setting that turns one renderer feature off or on
+void readFeature(ifstream& ifs, int feature)
+{
+	int on = 1;
+
+	ifs >> on;
+	if(on)
+		features |= feature;
+	else
+		features &= ~feature;
+}
+
 void readConfig()
 {
 	char buffer[128];
@@ -321,6 +690,52 @@ void readConfig()
 				ifs >> bpp;
 			else if(!strcmp(buffer,"refresh"))
 				ifs >> refresh;
+			else if(!strcmp(buffer,"workers"))
+				ifs >> workers;
+			else if(!strcmp(buffer,"tickrate"))
+				ifs >> tickRate;
+			else if(!strcmp(buffer,"vsync"))
+				ifs >> vsync;
+			else if(!strcmp(buffer,"renderer")){
+				ifs >> buffer;
+				backend = !strcmp(buffer,"core") ? BACKEND_CORE : BACKEND_FIXED;
+			}
+			else if(!strcmp(buffer,"textures"))
+				readFeature(ifs, FEATURE_TEXTURED);
+			else if(!strcmp(buffer,"materials"))
+				readFeature(ifs, FEATURE_MATERIALS);
+			else if(!strcmp(buffer,"lighting"))
+				readFeature(ifs, FEATURE_LIGHTING);
+			else if(!strcmp(buffer,"metricsport"))
+				ifs >> metricsPort;
+			else if(!strcmp(buffer,"metricsfile"))
+				ifs >> setw(sizeof(metricsFile)) >> metricsFile;
+			else if(!strcmp(buffer,"metricsinterval"))
+				ifs >> metricsInterval;
+			else if(!strcmp(buffer,"trace"))
+				ifs >> traceAtStart;
+			else if(!strcmp(buffer,"worldsize"))
+				ifs >> worldSize;
+			else if(!strcmp(buffer,"pagefile"))
+				ifs >> setw(sizeof(pageFile)) >> pageFile;
+			else if(!strcmp(buffer,"particles"))
+				ifs >> particleCount;
+			else if(!strcmp(buffer,"orblife"))
+				ifs >> orbLife;
+			else if(!strcmp(buffer,"orbcapacity"))
+				ifs >> orbCapacity;
+			else if(!strcmp(buffer,"wave"))
+				ifs >> waveInterval;
+			else if(!strcmp(buffer,"wavesize"))
+				ifs >> waveSize;
+			else if(!strcmp(buffer,"scoredecay"))
+				ifs >> decayInterval;
+			else if(!strcmp(buffer,"rawmouse"))
+				ifs >> rawMouse;
+			else if(!strcmp(buffer,"capture")){
+				ifs >> buffer;
+				FrameCapture::parseFormat(buffer, captureFormat);
+			}
 			//else: error input
 		}
 		ifs.close();
@@ -354,41 +769,89 @@ void closeSFX()
 	FSOUND_Close();
 }
 
-void main(int argc, char** argv)
+int main(int argc, char** argv)
 {
-	HANDLE hGameThread, hInputThread, hRenderThread;
 	char gameMode[128];
 
 	//init glut, create the window
 	readConfig();
+	if(tickRate < 1){
+		tickRate = 100;
+	}
+	if(worldSize < 2){
+		worldSize = 40;
+	}
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
+#ifdef FREEGLUT
+	//only freeglut can ask for a core context, classic GLUT gets whatever
+	//the driver gives and the renderer falls back if that isn't enough
+	if(backend == BACKEND_CORE){
+		glutInitContextVersion(3, 3);
+		glutInitContextProfile(GLUT_CORE_PROFILE);
+	}
+#endif
 	sprintf(gameMode,"%ix%i:%i@%i",w,h,bpp,refresh);
 	glutGameModeString(gameMode);
 	glutEnterGameMode();
 	glutInitWindowSize(w,h);
 	glutSetCursor(GLUT_CURSOR_NONE);
-	glutWarpPointer(w/2.0,h/2.0);
+
+	//pace frames to the display's refresh rate
+	thePacer = new FramePacer(refresh);
+	if(vsync){
+		thePacer->enableVsync();
+	}
+
+	//mouse motion straight from the device where that works
+	theMouse = MouseInput::open(rawMouse != 0);
+	focusTracked = theMouse->isRaw() && theMouse->trackFocus();
+	recentrePointer();
+
+	//seed random number generator
+	theRng.setState((unsigned)time(NULL));
 
 	//create camera and renderer and link them
 	theCamera = new Camera();
-	theRenderer = new Renderer(w,h);
+	theCamera->setBoundary(worldSize - 1);
+	theRenderer = new Renderer(w,h,backend,features);
 	theRenderer->setCamera(theCamera);
-	theRenderer->setWorld(&theWorld);
+	theWorld = new World(worldSize - 1);
+	if(strcmp(pageFile, "none")){
+		theWorld->setPageFile(pageFile);
+	}
+	theBvh = new OrbBvh();
+	theWorld->setBvh(theBvh);
+	thePlayer = new Player(theCamera);
+	theParticles = new ParticleSystem(particleCount);
+	theRenderer->setWorld(theWorld);
+	theRenderer->setParticles(theParticles);
+	theRenderer->setProfiler(&theProfiler);
+
+	//spread the simulation tick across the worker threads
+	theJobs = new JobSystem(workers);
+	initMetrics();
+	initGame();
+	traceThreadName("glut");
+	if(traceAtStart){
+		startTracing();
+	}
 
 	//register functions
 	glutDisplayFunc(display);
 	glutKeyboardFunc(keyboard);
 	glutKeyboardUpFunc(keyboardUp);
-	glutMotionFunc(mouseMotionHandler);
-	glutPassiveMotionFunc(mousePassiveHandler);
+	glutMouseFunc(mouseButtonHandler);
+	glutMotionFunc(pointerMoved);
+	glutPassiveMotionFunc(pointerMoved);
+	glutEntryFunc(pointerEntry);
 
 	initSFX();
 
-	//start gameloop/input/renderer on other threads
-	hGameThread = CreateThread(NULL, 0, (unsigned long (__stdcall *)(void *))gameLoop, &theWorld, 0, NULL);
-	hInputThread = CreateThread(NULL, 0, (unsigned long (__stdcall *)(void *))inputLoop, &keyDown, 0, NULL);
-	hRenderThread = CreateThread(NULL, 0, (unsigned long (__stdcall *)(void *))renderLoop, NULL, 0, NULL);
+	//start input/simulation and renderer on other threads
+	thread inputThread(inputLoop);
+	thread renderThread(renderLoop);
+	renderThread.detach();
 
 	//start OpenGL cranking
 	theRenderer->setSplash(true);
@@ -396,12 +859,20 @@ void main(int argc, char** argv)
 	splash = true;
 	glutMainLoop();
 	
-	WaitForSingleObject(hInputThread, INFINITE);
-	WaitForSingleObject(hGameThread, INFINITE);
+	inputThread.join();
 
 	//the game is over
 	closeSFX();
+	delete thePacer;
+	delete theGame;
+	delete theJobs;
+	delete thePlayer;
+	delete theParticles;
+	delete theMouse;
+	delete theWorld;
+	delete theBvh;
 	delete theCamera;
 	delete theRenderer;
 	glutLeaveGameMode();
+	return 0;
 }
\ No newline at end of file
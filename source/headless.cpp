@@ -0,0 +1,681 @@
+/*
+ *	headless.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Runs the renderer with no window system: a surfaceless GL context
+	renders Renderer::display() into an offscreen framebuffer while a
+	scripted camera flies through a fixed, seeded world. Frames can be
+	written to disk and compared against golden images, and frame times
+	are reported for render throughput benchmarks. Run it from the game
+	directory so the textures are found.
+
+	usage: headless [options]
+		--width W --height H	framebuffer size (640x480)
+		--frames N				frames to render (300)
+		--orbs N				orbs in the world (1000)
+		--size S				half the room's edge (40)
+		--page-file FILE		page idle chunks out to FILE
+		--seed S				world seed (1)
+		--workers N				job system workers (0 = one per spare core)
+		--script FILE			camera script, see readScript()
+		--capture A,B,...		frames to write out
+		--capture-every K		write out every K-th frame
+		--out PREFIX			file name prefix for written frames (frame)
+		--golden DIR			compare written frames with DIR/<name>
+		--tolerance T			per channel difference allowed (2)
+		--save FILE				checkpoint the world before rendering
+		--load FILE				start from a checkpoint instead of --orbs/--seed
+		--backend fixed|core	GL pipeline to draw with (fixed)
+		--no-textures, --no-materials, --no-lighting
+								draw without that renderer feature
+		--runtime-features		draw with the toggles checked as it goes,
+								not the pass compiled for the features
+		--bench-features		time every feature set both ways, then exit
+		--alloc-check W			play the game's tick and fail if any frame
+								after the first W allocates, bar those that
+								move chunks in or out of the active region
+								(see World::setRegion)
+		--spawn N				orbs spawned every frame (1 with --alloc-check, else 0)
+		--trace FILE			write a Chrome trace of the run to FILE
+		--particles N			keep about N capture particles flying
+		--record PREFIX			record every frame through FrameCapture
+		--record-format F		raw, png or y4m (y4m)
+
+	Besides whole frame times, the time spent inside display() is
+	reported as submit time: the CPU cost of handing the frame to GL.
+	Heap allocations per frame are counted too. Steady state rendering
+	shouldn't make any, and --alloc-check turns that into a pass/fail.
+	It runs the game's own tick (GameTick) in place of the bare render
+	preparation: scripted key presses go through an InputQueue, the player
+	flies, orbs are caught, and spawns, waves, lifetimes and decay run on
+	the timing wheel with rules short enough that all of them fire within
+	a few hundred frames. It spawns an orb every frame on top, as turbo
+	does in the game, into a world and wheel reserved up front for them,
+	so a growing world is checked too.
+	--bench-features flies the default spiral once per feature set, with
+	the pass compiled for it and with the runtime checks, and prints the
+	mean submit time of each. --particles bursts debris off the orbs every
+	frame, as if they were being captured, and reports the update time.
+	--record reads frames back the way the game records them, a couple of
+	frames late on a worker thread, and reports the frames written and
+	dropped and how long after rendering they reached the disk.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "Camera.h"
+#include "Renderer.h"
+#include "World.h"
+#include "Bvh.h"
+#include "Rng.h"
+#include "Checkpoint.h"
+#include "JobSystem.h"
+#include "Offscreen.h"
+#include "ImageWriter.h"
+#include "Timer.h"
+#include "AllocStats.h"
+#include "FrameArena.h"
+#include "Trace.h"
+#include "ParticleSystem.h"
+#include "Player.h"
+#include "InputQueue.h"
+#include "GameTick.h"
+using namespace std;
+
+//Game rules for --alloc-check, short so a few hundred frames fire
+//every kind of timer
+const int CHECK_ORB_LIFE = 2;
+const int CHECK_WAVE_INTERVAL = 1;
+const int CHECK_WAVE_SIZE = 20;
+const int CHECK_DECAY_INTERVAL = 1;
+const int CHECK_PARTICLES = 65536;		//room for captures, drawn only with --particles
+
+//One line of the camera script: apply cmd with args a,b,c for count frames
+struct ScriptStep
+{
+	int count;
+	char cmd[16];
+	double a, b, c;
+};
+
+//Settings
+int w = 640;
+int h = 480;
+int frames = 300;
+int orbs = 1000;
+int worldSize = 40;
+int seed = 1;
+int workers = 0;
+int captureEvery = 0;
+double tolerance = 2;
+const char* scriptFile = NULL;
+const char* outPrefix = "frame";
+const char* goldenDir = NULL;
+const char* saveFile = NULL;
+const char* loadFile = NULL;
+RenderBackend backend = BACKEND_FIXED;
+int allocWarmup = -1;					//no check
+int spawnRate = -1;						//per frame, -1 for the default
+int particleCount = 0;
+const char* recordPrefix = NULL;
+CaptureFormat recordFormat = CAPTURE_Y4M;
+const char* traceFile = NULL;
+const char* pageFile = NULL;
+int features = FEATURES_ALL;
+bool specialized = true;
+bool benchFeatures = false;
+vector<int> captureFrames;
+
+/*
+ *	Camera scripts are plain text, one step per line:
+ *		<frames> yaw|pitch|roll <degrees per frame>
+ *		<frames> slide <du> <dv> <dn per frame>
+ *		<frames> hold
+ *		1 move <x> <y> <z>
+ *	Steps run one after the other; the camera holds still once the
+ *	script runs out.
+ */
+bool readScript(const char* fileName, vector<ScriptStep>& script)
+{
+	ifstream ifs(fileName);
+	ScriptStep step;
+
+	if(!ifs){
+		return false;
+	}
+
+	while(ifs >> step.count >> step.cmd){
+		step.a = step.b = step.c = 0;
+		if(!strcmp(step.cmd, "slide") || !strcmp(step.cmd, "move"))
+			ifs >> step.a >> step.b >> step.c;
+		else if(strcmp(step.cmd, "hold"))
+			ifs >> step.a;
+		script.push_back(step);
+	}
+	ifs.close();
+
+	return true;
+}
+
+//Without a script, spiral in from the default eye position
+void defaultScript(vector<ScriptStep>& script)
+{
+	ScriptStep step = { frames, "", 0, 0, 0 };
+
+	strcpy(step.cmd, "spiral");
+	script.push_back(step);
+}
+
+void applyStep(Camera* camera, const ScriptStep& step)
+{
+	if(!strcmp(step.cmd, "yaw"))
+		camera->yaw(step.a);
+	else if(!strcmp(step.cmd, "pitch"))
+		camera->pitch(step.a);
+	else if(!strcmp(step.cmd, "roll"))
+		camera->roll(step.a);
+	else if(!strcmp(step.cmd, "slide"))
+		camera->slide(step.a, step.b, step.c);
+	else if(!strcmp(step.cmd, "move"))
+		camera->setLocation(step.a, step.b, step.c);
+	else if(!strcmp(step.cmd, "spiral")){
+		camera->yaw(360.0 / frames);
+		camera->slide(0, 0, -0.1);
+	}
+}
+
+//Fills the world the same way the game's spawner does
+void buildWorld(World& world, Rng& rng)
+{
+	rng.setState(seed);
+	for(int i = 0; i < orbs; i++){
+		world.spawn(rng);
+	}
+}
+
+//Holds forward for one second in every two, the way a player would
+//press it, for --alloc-check's game
+void scriptInput(InputQueue& input, int frame)
+{
+	InputEvent e = { INPUT_KEY_DOWN, 'w', 0, 0, nowNanos() };
+
+	if(frame % 120 == 60){
+		e.type = INPUT_KEY_UP;
+	}
+	if(frame % 60 == 0){
+		input.push(e);
+	}
+}
+
+bool isCaptured(int frame)
+{
+	if(captureEvery > 0 && frame % captureEvery == 0){
+		return true;
+	}
+	return find(captureFrames.begin(), captureFrames.end(), frame) != captureFrames.end();
+}
+
+//Compares a frame against its golden image, returns false on mismatch
+bool checkGolden(const char* name, const unsigned char* rgb)
+{
+	char path[512];
+	vector<unsigned char> golden;
+	int gw, gh, bad = 0;
+
+	sprintf(path, "%s/%s", goldenDir, name);
+	if(!readPPM(path, golden, gw, gh)){
+		printf("golden: missing %s\n", path);
+		return false;
+	}
+	if(gw != w || gh != h){
+		printf("golden: %s is %ix%i, expected %ix%i\n", path, gw, gh, w, h);
+		return false;
+	}
+
+	for(int i = 0; i < w * h; i++){
+		for(int c = 0; c < 3; c++){
+			if(abs(rgb[i*3 + c] - golden[i*3 + c]) > tolerance){
+				bad++;
+				break;
+			}
+		}
+	}
+
+	//allow a handful of pixels for rasteriser differences
+	if(bad > w * h / 1000){
+		printf("golden: %s differs in %i pixels\n", name, bad);
+		return false;
+	}
+	return true;
+}
+
+void readArgs(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++){
+		const char* arg = argv[i];
+		const char* val = i + 1 < argc ? argv[i + 1] : "";
+
+		if(!strcmp(arg, "--width"))
+			w = atoi(val), i++;
+		else if(!strcmp(arg, "--height"))
+			h = atoi(val), i++;
+		else if(!strcmp(arg, "--frames"))
+			frames = atoi(val), i++;
+		else if(!strcmp(arg, "--orbs"))
+			orbs = atoi(val), i++;
+		else if(!strcmp(arg, "--size"))
+			worldSize = max(atoi(val), 2), i++;
+		else if(!strcmp(arg, "--page-file"))
+			pageFile = val, i++;
+		else if(!strcmp(arg, "--seed"))
+			seed = atoi(val), i++;
+		else if(!strcmp(arg, "--workers"))
+			workers = atoi(val), i++;
+		else if(!strcmp(arg, "--script"))
+			scriptFile = val, i++;
+		else if(!strcmp(arg, "--capture-every"))
+			captureEvery = atoi(val), i++;
+		else if(!strcmp(arg, "--out"))
+			outPrefix = val, i++;
+		else if(!strcmp(arg, "--golden"))
+			goldenDir = val, i++;
+		else if(!strcmp(arg, "--save"))
+			saveFile = val, i++;
+		else if(!strcmp(arg, "--load"))
+			loadFile = val, i++;
+		else if(!strcmp(arg, "--tolerance"))
+			tolerance = atof(val), i++;
+		else if(!strcmp(arg, "--spawn"))
+			spawnRate = max(atoi(val), 0), i++;
+		else if(!strcmp(arg, "--alloc-check"))
+			allocWarmup = atoi(val), i++;
+		else if(!strcmp(arg, "--trace"))
+			traceFile = val, i++;
+		else if(!strcmp(arg, "--particles"))
+			particleCount = atoi(val), i++;
+		else if(!strcmp(arg, "--record"))
+			recordPrefix = val, i++;
+		else if(!strcmp(arg, "--record-format")){
+			if(!FrameCapture::parseFormat(val, recordFormat)){
+				printf("unknown record format %s\n", val);
+				exit(2);
+			}
+			i++;
+		}
+		else if(!strcmp(arg, "--no-textures"))
+			features &= ~FEATURE_TEXTURED;
+		else if(!strcmp(arg, "--no-materials"))
+			features &= ~FEATURE_MATERIALS;
+		else if(!strcmp(arg, "--no-lighting"))
+			features &= ~FEATURE_LIGHTING;
+		else if(!strcmp(arg, "--runtime-features"))
+			specialized = false;
+		else if(!strcmp(arg, "--bench-features"))
+			benchFeatures = true;
+		else if(!strcmp(arg, "--backend")){
+			if(!strcmp(val, "core"))
+				backend = BACKEND_CORE;
+			else if(!strcmp(val, "fixed"))
+				backend = BACKEND_FIXED;
+			else {
+				printf("unknown backend %s\n", val);
+				exit(2);
+			}
+			i++;
+		}
+		else if(!strcmp(arg, "--capture")){
+			for(const char* p = val; *p; ){
+				captureFrames.push_back(atoi(p));
+				while(*p && *p != ',')
+					p++;
+				if(*p == ',')
+					p++;
+			}
+			i++;
+		}
+		else {
+			printf("unknown option %s\n", arg);
+			exit(2);
+		}
+	}
+}
+
+//Mean submit time in ms of frames rendered along the default spiral
+double benchPass(Renderer& renderer, World& world, JobSystem& jobs, FrameArena& arena)
+{
+	Camera camera;
+	ScriptStep spiral = { frames, "spiral", 0, 0, 0 };
+	Point3D eye;
+	long long submit, submitTotal = 0;
+
+	camera.setBoundary(world.getBoundary());
+	renderer.setCamera(&camera);
+	for(int frame = 0; frame < frames; frame++){
+		applyStep(&camera, spiral);
+		arena.reset();
+		eye = camera.getLocation();
+		world.setRegion(&eye, 1, VIEW_DISTANCE);
+		renderer.prepareFrame(&jobs, &arena);
+		submit = nowNanos();
+		renderer.display();
+		submitTotal += nowNanos() - submit;
+		glFinish();
+	}
+
+	return frames > 0 ? submitTotal / 1000000.0 / frames : 0;
+}
+
+//Every feature set with its compiled pass and with the runtime checks,
+//run compiled, runtime, runtime, compiled so warming up favours neither
+void benchAllFeatures(Renderer& renderer, World& world, JobSystem& jobs, FrameArena& arena)
+{
+	double compiled, runtime;
+
+	printf("features                     compiled    runtime  (submit ms, %i frames)\n", 2 * frames);
+	for(int f = FEATURES_ALL; f >= 0; f--){
+		renderer.setFeatures(f, true);
+		compiled = benchPass(renderer, world, jobs, arena);
+		renderer.setFeatures(f, false);
+		runtime = benchPass(renderer, world, jobs, arena);
+		runtime = (runtime + benchPass(renderer, world, jobs, arena)) / 2;
+		renderer.setFeatures(f, true);
+		compiled = (compiled + benchPass(renderer, world, jobs, arena)) / 2;
+		printf("%-8s %-9s %-8s  %10.3f %10.3f  %+.1f%%\n",
+			f & FEATURE_TEXTURED ? "textures" : "-",
+			f & FEATURE_MATERIALS ? "materials" : "-",
+			f & FEATURE_LIGHTING ? "lighting" : "-",
+			compiled, runtime, runtime > 0 ? (compiled - runtime) * 100 / runtime : 0);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	OffscreenContext offscreen;
+	vector<ScriptStep> script;
+	vector<double> frameTimes;
+	vector<double> submitTimes;
+	vector<unsigned char> pixels;
+	char name[256];
+	int step = 0, stepFrame = 0, failures = 0, written = 0;
+	long long start, submit, total = 0, submitTotal = 0;
+	AllocSnapshot frameStart, frameAllocs, steadyAllocs = { 0, 0 };
+	int allocFrames = 0, firstAlloc = -1, steadyFrames = 0, regionFrames = 0, regionChanges;
+	int burstOrb = 0, timersFired = 0;
+	bool playing;
+	double particleTotal = 0, grabTotal = 0;
+	FrameArena arena;
+
+	readArgs(argc, argv);
+	playing = allocWarmup >= 0;
+
+	if(!offscreen.create(w, h, backend == BACKEND_CORE)){
+		printf("unable to create an offscreen GL context\n");
+		return 1;
+	}
+
+	if(scriptFile){
+		if(!readScript(scriptFile, script)){
+			printf("unable to read script %s\n", scriptFile);
+			return 1;
+		}
+	}
+	else {
+		defaultScript(script);
+	}
+
+	JobSystem jobs(workers);
+	Camera camera;
+	Renderer renderer(w, h, backend, features);
+	World world(worldSize - 1);
+	OrbBvh bvh;
+	Rng rng;
+	ParticleSystem particles(playing ? max(particleCount, CHECK_PARTICLES) : particleCount);
+	Session session = { &world, &camera, &rng, 0, orbs };
+	Player player(&camera);
+	GameTick game(&world, &player, &rng, &particles, &jobs, 60);
+	InputQueue input;
+	Point3D eye;
+
+	if(pageFile && !world.setPageFile(pageFile)){
+		printf("unable to open page file %s\n", pageFile);
+		return 1;
+	}
+	camera.setBoundary(worldSize - 1);
+	renderer.setFeatures(features, specialized);
+	renderer.setText(false);
+	renderer.setCamera(&camera);
+	renderer.setWorld(&world);
+	if(particleCount > 0){
+		renderer.setParticles(&particles);
+	}
+	if(loadFile){
+		start = nowNanos();
+		if(!loadCheckpoint(loadFile, session)){
+			printf("unable to load checkpoint %s\n", loadFile);
+			return 1;
+		}
+		printf("restore:    %.3f ms, %i orbs\n", (nowNanos() - start) / 1000000.0, world.getTotal());
+		orbs = world.getTotal();
+	}
+	else {
+		buildWorld(world, rng);
+	}
+	world.setBvh(&bvh);
+	if(spawnRate < 0){
+		spawnRate = allocWarmup >= 0 ? 1 : 0;
+	}
+	if(playing){
+		//every orb spawned, by the frame or by the game's timers
+		game.setRenderer(&renderer);
+		game.setRules(CHECK_ORB_LIFE, CHECK_WAVE_INTERVAL, CHECK_WAVE_SIZE, CHECK_DECAY_INTERVAL);
+		game.reserve(spawnRate * frames + (frames / 60 + 1) * (CHECK_WAVE_SIZE + 1));
+	}
+	else {
+		world.reserve(spawnRate * frames);
+	}
+	if(saveFile){
+		start = nowNanos();
+		if(!saveCheckpoint(saveFile, session)){
+			printf("unable to save checkpoint %s\n", saveFile);
+			return 1;
+		}
+		printf("save:       %.3f ms, %i orbs\n", (nowNanos() - start) / 1000000.0, world.getTotal());
+	}
+	renderer.setScore(0, session.captured, session.released);
+	if(playing){
+		game.start(session.captured, session.released);
+	}
+
+	if(benchFeatures){
+		printf("renderer:   %s\n", offscreen.getRendererName());
+		benchAllFeatures(renderer, world, jobs, arena);
+		return 0;
+	}
+
+	pixels.resize(w * h * 3);
+	frameTimes.reserve(frames);
+	submitTimes.reserve(frames);
+
+	traceThreadName("main");
+	if(traceFile){
+		startTracing();
+	}
+	if(recordPrefix){
+		renderer.getCapture()->record(recordPrefix, recordFormat, 60);
+	}
+
+	for(int frame = 0; frame < frames; frame++){
+		TRACE_ZONE("frame");
+
+		//advance the camera script
+		while(step < (int)script.size() && stepFrame >= script[step].count){
+			step++;
+			stepFrame = 0;
+		}
+		if(step < (int)script.size()){
+			applyStep(&camera, script[step]);
+			stepFrame++;
+		}
+
+		regionChanges = world.getRegionChanges();
+		frameStart = getAllocSnapshot();
+		start = nowNanos();
+		arena.reset();
+		if(playing){
+			TRACE_ZONE("tick");
+			PlayerInput buttons = { 0, 0, 0, 0 };
+
+			scriptInput(input, frame);
+			game.drainInput(input);
+			if(game.held('w')){
+				buttons.buttons |= BUTTON_FORWARD;
+			}
+			game.setInput(buttons);
+			for(int i = 0; i < spawnRate; i++){
+				game.releaseOrb();
+			}
+			game.run();
+			timersFired += game.takeTimersFired();
+		}
+		else {
+			TRACE_ZONE("prepare");
+			for(int i = 0; i < spawnRate; i++){
+				world.spawn(rng);
+			}
+			eye = camera.getLocation();
+			world.setRegion(&eye, 1, VIEW_DISTANCE);
+			renderer.prepareFrame(&jobs, &arena);
+		}
+		if(particleCount > 0){
+			TRACE_ZONE("particles");
+
+			//top the debris up from orbs in turn, then fly it a frame
+			//unless the game's tick already has
+			while(world.size() > 0 && particles.size() + PARTICLE_BURST <= particleCount){
+				burstOrb = (burstOrb + 1) % world.size();
+				particles.burst(world.getOrbs()[burstOrb].pos, PARTICLE_BURST);
+			}
+			if(!playing){
+				particles.update(1 / 60.0f, &jobs);
+			}
+			particleTotal += particles.getUpdateTime();
+		}
+		submit = nowNanos();
+		renderer.display();
+		submitTimes.push_back((nowNanos() - submit) / 1000000.0);
+		grabTotal += renderer.getCapture()->getGrabTime();
+		submitTotal += nowNanos() - submit;
+		{
+			TRACE_ZONE("finish");
+			glFinish();
+		}
+		frameTimes.push_back((nowNanos() - start) / 1000000.0);
+		total += nowNanos() - start;
+
+		//frames past the warmup are steady state
+		frameAllocs = allocsSince(frameStart);
+
+		//about as often as the game does, at 60 fps
+		if(frame % 60 == 59){
+			world.maintain();
+		}
+		if(frame >= allocWarmup){
+			steadyAllocs.count += frameAllocs.count;
+			steadyAllocs.bytes += frameAllocs.bytes;
+			steadyFrames++;
+			if(world.getRegionChanges() != regionChanges){
+				regionFrames++;
+			}
+			else if(frameAllocs.count && allocWarmup >= 0){
+				if(firstAlloc < 0)
+					firstAlloc = frame;
+				allocFrames++;
+			}
+		}
+
+		if(isCaptured(frame)){
+			TRACE_ZONE("capture");
+			offscreen.readPixels(&pixels[0]);
+			sprintf(name, "%s%04i.ppm", outPrefix, frame);
+
+			if(goldenDir){
+				if(!checkGolden(name, &pixels[0]))
+					failures++;
+			}
+			else if(writePPM(name, &pixels[0], w, h)){
+				written++;
+			}
+			else {
+				printf("unable to write %s\n", name);
+			}
+		}
+	}
+
+	if(recordPrefix){
+		renderer.getCapture()->stop();
+		renderer.getCapture()->flush();
+	}
+
+	if(traceFile){
+		stopTracing();
+		if(!writeTrace(traceFile))
+			printf("unable to write trace %s\n", traceFile);
+	}
+
+	sort(frameTimes.begin(), frameTimes.end());
+	sort(submitTimes.begin(), submitTimes.end());
+
+	printf("renderer:   %s\n", offscreen.getRendererName());
+	printf("backend:    %s\n", renderer.getBackend() == BACKEND_CORE ? "core" : "fixed");
+	printf("frames:     %i at %ix%i, %i orbs\n", frames, w, h, world.getTotal());
+	printf("chunks:     %i active (%i orbs), %i resident, %i paged (%.1f KB)\n",
+		world.getActiveChunks(), world.size(), world.getResidentChunks(), world.getPagedChunks(),
+		world.getPagedBytes() / 1024.0);
+	if(frames > 0){
+		printf("mean:       %.3f ms (%.1f fps)\n", total / 1000000.0 / frames, frames * 1e9 / total);
+		printf("p50:        %.3f ms\n", frameTimes[frames / 2]);
+		printf("p95:        %.3f ms\n", frameTimes[frames * 95 / 100]);
+		printf("p99:        %.3f ms\n", frameTimes[frames * 99 / 100]);
+		printf("submit:     %.3f ms mean, %.3f ms p50\n", submitTotal / 1000000.0 / frames, submitTimes[frames / 2]);
+	}
+	if(particleCount > 0 && frames > 0){
+		printf("particles:  %i, %.3f ms mean update\n", particles.size(), particleTotal / frames);
+	}
+	if(recordPrefix && frames > 0){
+		FrameCapture* capture = renderer.getCapture();
+		printf("record:     %i written, %i dropped, %.3f ms grab mean, latency %.1f ms p50 %.1f ms p95\n",
+			capture->getCaptured(), capture->getDropped(), grabTotal / frames,
+			capture->getLatency(50), capture->getLatency(95));
+	}
+	if(steadyFrames > 0){
+		printf("allocs:     %.2f per frame, %.0f bytes per frame, arena peak %.1f KB\n",
+			(double)steadyAllocs.count / steadyFrames, (double)steadyAllocs.bytes / steadyFrames,
+			(playing ? game.getArena() : &arena)->getPeak() / 1024.0);
+	}
+	if(playing){
+		printf("game:       %i caught, %i released, %i escaped, %i timers fired\n",
+			game.getCaptured(), game.getReleased(), game.getEscaped(), timersFired);
+	}
+	if(allocWarmup >= 0){
+		if(allocFrames)
+			printf("alloc check: failed, %i frames allocated, the first was frame %i\n", allocFrames, firstAlloc);
+		else
+			printf("alloc check: passed after %i warmup frames, %i region changes exempt\n", allocWarmup, regionFrames);
+	}
+	if(goldenDir){
+		printf("golden:     %i mismatched\n", failures);
+	}
+	else if(written){
+		printf("written:    %i frames\n", written);
+	}
+
+	return failures || allocFrames ? 1 : 0;
+}
@@ -0,0 +1,352 @@
+/*
+ *	mathbench.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Times the hot paths that run on VecMath against the double precision
+	code they replaced, kept here as the reference: the renderer's view
+	cone cull, the capture sweep, the grid's distance test, camera turns
+	with the view matrix, and matrix products. Each pair runs over the
+	same seeded orbs and the number of orbs they decide differently is
+	reported; single precision may flip an orb sitting right on an edge,
+	anything more than a handful is a bug. Build with -DVECMATH_SCALAR to
+	time the plain C++ fallback instead of the SIMD one.
+
+	usage: mathbench [options]
+		--orbs N		orbs per pass (1000000)
+		--passes N		passes over them (20)
+		--seed S		world seed (1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "Camera.h"
+#include "World.h"
+#include "Rng.h"
+#include "Timer.h"
+using namespace std;
+
+//Settings
+int orbs = 1000000;
+int passes = 20;
+int seed = 1;
+
+//An orb as it was stored before VecMath
+struct OldOrb
+{
+	double x, y, z;
+	unsigned int id;
+	unsigned int pad;
+};
+
+//The camera's old rotation and matrix maths
+struct OldCamera
+{
+	double eye[3], u[3], v[3], n[3];
+	double matrix[16];
+};
+
+//Keeps results alive so the compiler can't drop the loops
+volatile double sink;
+
+void oldTurn(double* a, double* b, double theta)
+{
+	double c = cos(theta), s = sin(theta);
+
+	for(int k = 0; k < 3; k++){
+		double na = a[k] * c + b[k] * s;
+		b[k] = -a[k] * s + b[k] * c;
+		a[k] = na;
+	}
+}
+
+void oldViewMatrix(OldCamera& cam)
+{
+	double* mat = cam.matrix;
+	double* e = cam.eye;
+
+	mat[0]=cam.u[0];	mat[4]=cam.u[1];	mat[8]=cam.u[2];	mat[12]=-(e[0]*cam.u[0] + e[1]*cam.u[1] + e[2]*cam.u[2]);
+	mat[1]=cam.v[0];	mat[5]=cam.v[1];	mat[9]=cam.v[2];	mat[13]=-(e[0]*cam.v[0] + e[1]*cam.v[1] + e[2]*cam.v[2]);
+	mat[2]=cam.n[0];	mat[6]=cam.n[1];	mat[10]=cam.n[2];	mat[14]=-(e[0]*cam.n[0] + e[1]*cam.n[1] + e[2]*cam.n[2]);
+	mat[3]=0;			mat[7]=0;			mat[11]=0;			mat[15]=1.0;
+}
+
+bool oldSweepHits(const OldOrb& p, const double* a, const double* b, double radius)
+{
+	double sx = b[0] - a[0], sy = b[1] - a[1], sz = b[2] - a[2];
+	double xd = p.x - a[0], yd = p.y - a[1], zd = p.z - a[2];
+	double len2 = sx*sx + sy*sy + sz*sz;
+	double t = 0;
+
+	if(len2 > 0){
+		t = (xd*sx + yd*sy + zd*sz) / len2;
+		if(t < 0)
+			t = 0;
+		else if(t > 1)
+			t = 1;
+	}
+	xd -= t*sx;
+	yd -= t*sy;
+	zd -= t*sz;
+
+	return xd*xd + yd*yd + zd*zd < radius*radius;
+}
+
+void report(const char* label, long long oldTime, long long newTime, long long count, int differ)
+{
+	printf("%-10s %8.2f ns  %8.2f ns  %5.2fx", label, (double)oldTime / count, (double)newTime / count,
+		(double)oldTime / newTime);
+	if(differ >= 0)
+		printf("  %i differ", differ);
+	printf("\n");
+}
+
+void readArgs(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++){
+		const char* arg = argv[i];
+		const char* val = i + 1 < argc ? argv[i + 1] : "";
+
+		if(!strcmp(arg, "--orbs"))
+			orbs = atoi(val), i++;
+		else if(!strcmp(arg, "--passes"))
+			passes = atoi(val), i++;
+		else if(!strcmp(arg, "--seed"))
+			seed = atoi(val), i++;
+		else {
+			printf("unknown option %s\n", arg);
+			exit(2);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	vector<OldOrb> oldOrbs;
+	vector<Orb> newOrbs;
+	vector<char> oldFlags, newFlags;
+	World world(39);
+	Rng rng;
+	long long start, oldTime, newTime, total;
+	int differ;
+
+	readArgs(argc, argv);
+	rng.setState(seed);
+	oldOrbs.resize(orbs);
+	newOrbs.resize(orbs);
+	oldFlags.resize(orbs);
+	newFlags.resize(orbs);
+	for(int i = 0; i < orbs; i++){
+		Point3D p = world.spawn(rng);
+		OldOrb o = { p.x, p.y, p.z, (unsigned int)i, 0 };
+		Orb n = { p, (unsigned int)i, 0 };
+
+		oldOrbs[i] = o;
+		newOrbs[i] = n;
+	}
+	total = (long long)orbs * passes;
+
+#if defined(VECMATH_SSE)
+	printf("vecmath:    SSE2\n");
+#elif defined(VECMATH_NEON)
+	printf("vecmath:    NEON\n");
+#else
+	printf("vecmath:    scalar\n");
+#endif
+	printf("%i orbs, %i passes      double     VecMath\n", orbs, passes);
+
+	//the renderer's cull: is the orb inside the cone around the view
+	{
+		double eye[3] = { 3, -2, 30 }, n[3] = { 0.1, 0.2, 0.97 };
+		double len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		double sinA = sin(0.8), cosA = cos(0.8);
+		Point3D eyeV = { 3, -2, 30 };
+		Vector3D nV;
+
+		for(int k = 0; k < 3; k++)
+			n[k] /= len;
+		nV.x = n[0]; nV.y = n[1]; nV.z = n[2]; nV.w = 0;
+
+		start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			for(int i = 0; i < orbs; i++){
+				const OldOrb& p = oldOrbs[i];
+				double dx = p.x - eye[0], dy = p.y - eye[1], dz = p.z - eye[2];
+				double along = -(dx*n[0] + dy*n[1] + dz*n[2]);
+				double perp = sqrt(fabs(dx*dx + dy*dy + dz*dz - along*along));
+				oldFlags[i] = (along > -1 && perp*cosA - along*sinA < 1);
+			}
+		}
+		oldTime = nowNanos() - start;
+
+		//as Renderer::update() does it, four orbs a lane each
+		float sinF = sinA, cosF = cosA;
+		Vec3x4 eye4 = splat(eyeV), n4 = splat(nV);
+		Lanes one = lanesSplat(1), sin4 = lanesSplat(sinF), cos4 = lanesSplat(cosF);
+		start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			int i = 0;
+
+			for(; i + 4 <= orbs; i += 4){
+				const Orb* o = &newOrbs[i];
+				Vec3x4 d = gather(o[0].pos, o[1].pos, o[2].pos, o[3].pos) - eye4;
+				Lanes behind = dot(d, n4);
+				Lanes perp = lanesSqrt(lanesAbs(lanesSub(dot(d, d), lanesMul(behind, behind))));
+				Lanes edge = lanesMulAdd(behind, sin4, lanesMul(perp, cos4));
+				int in = maskBits(maskAnd(lanesLess(behind, one), lanesLess(edge, one)));
+
+				for(int k = 0; k < 4; k++)
+					newFlags[i + k] = in >> k & 1;
+			}
+			for(; i < orbs; i++){
+				Vector3D d = newOrbs[i].pos - eyeV;
+				float along = -dot(d, nV);
+				float perp = sqrtf(fabsf(dot(d, d) - along*along));
+				newFlags[i] = (along > -1 && perp*cosF - along*sinF < 1);
+			}
+		}
+		newTime = nowNanos() - start;
+
+		differ = 0;
+		for(int i = 0; i < orbs; i++)
+			differ += oldFlags[i] != newFlags[i];
+		report("cull", oldTime, newTime, total, differ);
+	}
+
+	//the capture sweep along the player's move
+	{
+		double a[3] = { 1, 2, 3 }, b[3] = { 1.4, 2.3, 2.2 };
+		Point3D aV = { 1, 2, 3 }, bV = { 1.4f, 2.3f, 2.2f };
+		double radius = 12;					//wide enough that some hit
+
+		start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			for(int i = 0; i < orbs; i++)
+				oldFlags[i] = oldSweepHits(oldOrbs[i], a, b, radius);
+		}
+		oldTime = nowNanos() - start;
+
+		start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			int i = 0;
+
+			for(; i + 4 <= orbs; i += 4){
+				int hits = sweepHits4(&newOrbs[i], aV, bV, radius);
+				for(int k = 0; k < 4; k++)
+					newFlags[i + k] = hits >> k & 1;
+			}
+			for(; i < orbs; i++)
+				newFlags[i] = sweepHits(newOrbs[i].pos, aV, bV, radius);
+		}
+		newTime = nowNanos() - start;
+
+		differ = 0;
+		for(int i = 0; i < orbs; i++)
+			differ += oldFlags[i] != newFlags[i];
+		report("sweep", oldTime, newTime, total, differ);
+	}
+
+	//the grid query's distance test
+	{
+		double c[3] = { -5, 7, 11 }, r2 = 20 * 20;
+		Point3D cV = { -5, 7, 11 };
+		float r2F = r2;
+
+		start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			for(int i = 0; i < orbs; i++){
+				const OldOrb& p = oldOrbs[i];
+				double xd = p.x - c[0], yd = p.y - c[1], zd = p.z - c[2];
+				oldFlags[i] = xd*xd + yd*yd + zd*zd <= r2;
+			}
+		}
+		oldTime = nowNanos() - start;
+
+		start = nowNanos();
+		for(int pass = 0; pass < passes; pass++){
+			for(int i = 0; i < orbs; i++)
+				newFlags[i] = distanceSquared(newOrbs[i].pos, cV) <= r2F;
+		}
+		newTime = nowNanos() - start;
+
+		differ = 0;
+		for(int i = 0; i < orbs; i++)
+			differ += oldFlags[i] != newFlags[i];
+		report("distance", oldTime, newTime, total, differ);
+	}
+
+	//a tick's worth of turning, then the view matrix
+	{
+		OldCamera old = { { 0, 0, 35 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0 } };
+		Camera cam;
+		Mat4 view;
+		double sum = 0;
+
+		start = nowNanos();
+		for(int i = 0; i < orbs; i++){
+			oldTurn(old.u, old.n, 0.001);
+			oldTurn(old.v, old.n, 0.0007);
+			oldViewMatrix(old);
+			sum += old.matrix[12];
+		}
+		oldTime = nowNanos() - start;
+
+		start = nowNanos();
+		for(int i = 0; i < orbs; i++){
+			cam.yaw(0.001 / rads);
+			cam.pitch(0.0007 / rads);
+			view = cam.getModelViewMatrix();
+			sum += view.m[12];
+		}
+		newTime = nowNanos() - start;
+		sink = sum;
+
+		report("camera", oldTime, newTime, orbs, -1);
+	}
+
+	//matrix products, as a renderer building model view matrices would
+	{
+		double a[16], b[16], r[16];
+		Mat4 aM = identity(), bM = identity(), rM;
+		double sum = 0;
+
+		for(int k = 0; k < 16; k++){
+			a[k] = aM.m[k] = 1 + k * 0.01f;
+			b[k] = bM.m[k] = 1 - k * 0.01f;
+		}
+
+		start = nowNanos();
+		for(int i = 0; i < orbs; i++){
+			for(int col = 0; col < 4; col++){
+				for(int row = 0; row < 4; row++){
+					double s = 0;
+					for(int k = 0; k < 4; k++)
+						s += a[k*4 + row] * b[col*4 + k];
+					r[col*4 + row] = s;
+				}
+			}
+			a[12] = r[0] * 1e-9;
+			sum += r[15];
+		}
+		oldTime = nowNanos() - start;
+
+		start = nowNanos();
+		for(int i = 0; i < orbs; i++){
+			rM = aM * bM;
+			aM.m[12] = rM.m[0] * 1e-9f;
+			sum += rM.m[15];
+		}
+		newTime = nowNanos() - start;
+		sink = sum;
+
+		report("mat4 mul", oldTime, newTime, orbs, -1);
+	}
+
+	return 0;
+}
@@ -0,0 +1,484 @@
+/*
+ *	server.cpp
+ *
+ *	Attack of the Orbs
+ *	Demo Game
+ *	by Jeremy McCarthy
+
+
+	Dedicated server. Runs the simulation with no window or sound and
+	streams the world to clients over UDP. With --loopback it also runs
+	that many simulated clients in the same process over 127.0.0.1, steps
+	them in lockstep with the server, reports traffic and tick times and
+	checks that every client ends up holding exactly the orbs around it.
+
+	usage: server [options]
+		--port P				port to listen on (7777, 0 for any)
+		--orbs N				orbs the world is kept topped up to (1000)
+		--size S				half the room's edge (40), as the game's worldsize
+		--tickrate T			simulation ticks per second (30)
+		--radius R				interest radius (16)
+		--workers N				job system workers (0 = one per spare core)
+		--seed S				world seed (1)
+		--loopback N			run N simulated clients and exit
+		--ticks T				ticks to run the loopback test for (300)
+		--loss F				fraction of snapshots the clients drop (0)
+		--alloc-check W			fail if any server tick after the first W
+								allocates (the simulated clients don't count,
+								nor do ticks that move chunks in or out of
+								the active region, see World::setRegion)
+		--metrics-port P		serve Prometheus metrics on 127.0.0.1:P
+		--metrics-file F		write the metrics to F as well
+		--metrics-interval S	seconds between metrics file writes (5)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "World.h"
+#include "Server.h"
+#include "Client.h"
+#include "JobSystem.h"
+#include "Rng.h"
+#include "Timer.h"
+#include "AllocStats.h"
+#include "Metrics.h"
+#include "MetricsExporter.h"
+using namespace std;
+
+//Settings
+unsigned short port = SERVER_PORT;
+int orbs = 1000;
+int worldSize = 40;
+int boundary = 39;					//worldSize - 1, how far players can go
+int tickRate = 30;
+double radius = 16;
+int workers = 0;
+int seed = 1;
+int loopback = 0;
+int ticks = 300;
+double loss = 0;
+int allocWarmup = -1;				//no check
+int metricsPort = -1;				//not served
+const char* metricsFile = NULL;
+int metricsInterval = 5;
+
+//the loopback test's settling, after the clients stop: checked this
+//often, for at most this long
+const int SETTLE_CHECK_TICKS = 10;
+const int SETTLE_SECONDS = 60;
+
+//Exported metrics, recorded once per tick
+MetricsRegistry metrics;
+Counter* ticksRun;
+Counter* tickOverruns;
+Counter* bytesSent;
+Counter* bytesReceived;
+Counter* packetsSent;
+Gauge* clientCount;
+Gauge* orbCount;
+Gauge* activeOrbCount;
+Histogram* tickSeconds;
+
+void initMetrics()
+{
+	static const double tickBounds[] = { 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.133 };
+
+	ticksRun = metrics.counter("server_ticks_total", "Simulation ticks run");
+	tickOverruns = metrics.counter("server_tick_overruns_total", "Ticks that finished after the next was due");
+	bytesSent = metrics.counter("server_sent_bytes_total", "Snapshot payload bytes sent");
+	bytesReceived = metrics.counter("server_received_bytes_total", "Input payload bytes received");
+	packetsSent = metrics.counter("server_sent_packets_total", "Snapshot packets sent");
+	clientCount = metrics.gauge("server_clients", "Connected clients");
+	orbCount = metrics.gauge("world_orbs", "Orbs in the world");
+	activeOrbCount = metrics.gauge("world_active_orbs", "Orbs in the chunks around the players");
+	tickSeconds = metrics.histogram("server_tick_seconds", "Time spent in one server tick",
+		tickBounds, sizeof(tickBounds) / sizeof(tickBounds[0]));
+}
+
+//Runs the server for one tick and records it
+void tickServer(Server& server, World& world)
+{
+	long long start = nowNanos();
+	long long sent = server.getBytesSent();
+	long long received = server.getBytesReceived();
+	long long packets = server.getPacketsSent();
+
+	server.tick();
+
+	tickSeconds->observe((nowNanos() - start) * 1e-9);
+	ticksRun->add();
+	bytesSent->add(server.getBytesSent() - sent);
+	bytesReceived->add(server.getBytesReceived() - received);
+	packetsSent->add(server.getPacketsSent() - packets);
+	clientCount->set(server.getClientCount());
+	orbCount->set(world.getTotal());
+	activeOrbCount->set(world.size());
+}
+
+void readArgs(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++){
+		const char* arg = argv[i];
+		const char* val = i + 1 < argc ? argv[i + 1] : "";
+
+		if(!strcmp(arg, "--port"))
+			port = atoi(val), i++;
+		else if(!strcmp(arg, "--orbs"))
+			orbs = atoi(val), i++;
+		else if(!strcmp(arg, "--size"))
+			worldSize = atoi(val), i++;
+		else if(!strcmp(arg, "--tickrate"))
+			tickRate = atoi(val), i++;
+		else if(!strcmp(arg, "--radius"))
+			radius = atof(val), i++;
+		else if(!strcmp(arg, "--workers"))
+			workers = atoi(val), i++;
+		else if(!strcmp(arg, "--seed"))
+			seed = atoi(val), i++;
+		else if(!strcmp(arg, "--loopback"))
+			loopback = atoi(val), i++;
+		else if(!strcmp(arg, "--ticks"))
+			ticks = atoi(val), i++;
+		else if(!strcmp(arg, "--loss"))
+			loss = atof(val), i++;
+		else if(!strcmp(arg, "--alloc-check"))
+			allocWarmup = atoi(val), i++;
+		else if(!strcmp(arg, "--metrics-port"))
+			metricsPort = atoi(val), i++;
+		else if(!strcmp(arg, "--metrics-file"))
+			metricsFile = val, i++;
+		else if(!strcmp(arg, "--metrics-interval"))
+			metricsInterval = atoi(val), i++;
+		else {
+			printf("unknown option %s\n", arg);
+			exit(2);
+		}
+	}
+	if(tickRate < 1){
+		tickRate = 30;
+	}
+	if(worldSize < 2){
+		worldSize = 40;
+	}
+	boundary = worldSize - 1;
+}
+
+//Runs at the tick rate until killed, printing stats every second
+void runDedicated(Server& server, World& world)
+{
+	long long period = 1000000000LL / tickRate;
+	long long nextTick = nowNanos();
+	long long lastSent = 0;
+	long long wait;
+
+	printf("listening on port %i\n", server.getPort());
+
+	while(true){
+		tickServer(server, world);
+
+		if(server.getTick() % tickRate == 0){
+			int clients = server.getClientCount();
+			long long sent = server.getBytesSent();
+
+			printf("clients %3i  tick p50 %.3f ms  p99 %.3f ms  %.0f bytes/client/s\n",
+				clients, server.getTickTime(50), server.getTickTime(99),
+				clients ? (double)(sent - lastSent) / clients : 0.0);
+			lastSent = sent;
+		}
+
+		//fixed tick rate, skip ahead rather than burst if we fall behind
+		nextTick += period;
+		wait = nextTick - nowNanos();
+		if(wait > 0){
+			sleepNanos(wait);
+		}
+		else {
+			tickOverruns->add();
+			if(wait < -period){
+				nextTick = nowNanos();
+			}
+		}
+	}
+}
+
+//A simulated player. It keeps its own copy of the camera's orientation,
+//turned by the same inputs the server applies, so it knows which buttons
+//move it towards the spot it is heading for.
+struct Bot
+{
+	Rng rng;
+	Camera camera;
+	Point3D target;
+};
+
+void pickTarget(Bot* bot)
+{
+	bot->target.x = bot->rng.nextInt(2 * boundary) - boundary;
+	bot->target.y = bot->rng.nextInt(2 * boundary) - boundary;
+	bot->target.z = bot->rng.nextInt(2 * boundary) - boundary;
+}
+
+//Roams from one random spot in the room to the next, looking around as
+//it goes
+void botInput(Bot* bot, const Point3D& pos, PlayerInput& input)
+{
+	Vector3D d = bot->target - pos;
+	Vector3D u, v, n;
+	double along, side, up;
+
+	if(lengthSquared(d) < 25){
+		pickTarget(bot);
+	}
+
+	u = bot->camera.getU();
+	v = bot->camera.getV();
+	n = bot->camera.getN();
+	along = -dot(d, n);				//the camera looks down -N
+	side = dot(d, u);
+	up = dot(d, v);
+
+	input.buttons = 0;
+	if(along > 2)
+		input.buttons |= BUTTON_FORWARD;
+	else if(along < -2)
+		input.buttons |= BUTTON_BACK;
+	if(side > 2)
+		input.buttons |= BUTTON_RIGHT;
+	else if(side < -2)
+		input.buttons |= BUTTON_LEFT;
+	if(up > 2)
+		input.buttons |= BUTTON_UP;
+
+	input.yaw = bot->rng.nextInt(5) - 2.0f;
+	input.pitch = bot->rng.nextInt(5) - 2.0f;
+	input.roll = 0;
+	bot->camera.yaw(input.yaw);
+	bot->camera.pitch(input.pitch);
+}
+
+//True if the client holds exactly the orbs the server would have it hold:
+//everything within the interest radius, nothing beyond the keep radius,
+//at the right quantized positions
+bool checkClient(Server& server, World& world, NetClient& client)
+{
+	const vector<SnapshotOrb>& known = client.getOrbs();
+	NetAddress addr = makeAddress("127.0.0.1", client.getPort());
+	vector<int> near;
+	vector<SnapshotOrb> expected;
+	SnapshotOrb o;
+	Point3D pos;
+	unsigned int j = 0;
+
+	if(!server.getPlayerPosition(addr, pos)){
+		return false;
+	}
+
+	//every orb inside the interest radius must be known...
+	world.query(pos, server.getInterestRadius(), near);
+	for(unsigned int i = 0; i < near.size(); i++){
+		const Orb& orb = world[near[i]];
+		o.id = orb.id;
+		o.x = quantize(orb.pos.x, boundary);
+		o.y = quantize(orb.pos.y, boundary);
+		o.z = quantize(orb.pos.z, boundary);
+		expected.push_back(o);
+	}
+	sort(expected.begin(), expected.end(),
+		[](const SnapshotOrb& a, const SnapshotOrb& b){ return a.id < b.id; });
+
+	for(unsigned int i = 0; i < expected.size(); i++){
+		while(j < known.size() && known[j].id < expected[i].id)
+			j++;
+		if(j == known.size() || known[j].id != expected[i].id ||
+				known[j].x != expected[i].x || known[j].y != expected[i].y || known[j].z != expected[i].z){
+			return false;
+		}
+	}
+
+	//...and everything known must still be there, within the keep radius
+	world.query(pos, server.getKeepRadius(), near);
+	if(known.size() > near.size()){
+		return false;
+	}
+	vector<unsigned int> ids;
+	for(unsigned int i = 0; i < near.size(); i++){
+		ids.push_back(world[near[i]].id);
+	}
+	sort(ids.begin(), ids.end());
+	for(unsigned int i = 0; i < known.size(); i++){
+		if(!binary_search(ids.begin(), ids.end(), known[i].id)){
+			return false;
+		}
+	}
+	return true;
+}
+
+int runLoopback(Server& server, World& world)
+{
+	NetAddress addr = makeAddress("127.0.0.1", server.getPort());
+	vector<NetClient*> clients;
+	vector<Bot*> bots;
+	PlayerInput input;
+	long long upBytes, downBytes, knownTotal = 0;
+	int connected = 0, converged = 0, dropped = 0;
+	int allocTicks = 0, firstAlloc = -1, regionTicks = 0, regionChanges;
+	AllocSnapshot tickStart, tickAllocs, steadyAllocs = { 0, 0 };
+	int settleTicks = 0;
+	double seconds = (double)ticks / tickRate;
+
+	for(int i = 0; i < loopback; i++){
+		NetClient* c = new NetClient(boundary);
+		if(!c->connect(addr)){
+			printf("client %i: unable to open a socket\n", i);
+			return 1;
+		}
+		c->setLoss(loss, seed * 7919 + i);
+		clients.push_back(c);
+		bots.push_back(new Bot);
+		bots[i]->rng.setState(seed * 104729 + i);
+		pickTarget(bots[i]);
+	}
+
+	//the test proper: everyone flies about
+	for(int t = 0; t < ticks; t++){
+		for(int i = 0; i < loopback; i++){
+			botInput(bots[i], clients[i]->getPosition(), input);
+			clients[i]->sendInput(input);
+		}
+		regionChanges = world.getRegionChanges();
+		tickStart = getAllocSnapshot();
+		tickServer(server, world);
+		tickAllocs = allocsSince(tickStart);
+		for(int i = 0; i < loopback; i++){
+			clients[i]->receive();
+		}
+
+		//ticks past the warmup are steady state
+		if(t >= allocWarmup){
+			steadyAllocs.count += tickAllocs.count;
+			steadyAllocs.bytes += tickAllocs.bytes;
+			if(world.getRegionChanges() != regionChanges){
+				regionTicks++;
+			}
+			else if(tickAllocs.count && allocWarmup >= 0){
+				if(firstAlloc < 0)
+					firstAlloc = t;
+				allocTicks++;
+			}
+		}
+	}
+
+	upBytes = downBytes = 0;
+	for(int i = 0; i < loopback; i++){
+		upBytes += clients[i]->getBytesSent();
+		downBytes += clients[i]->getBytesReceived();
+		knownTotal += clients[i]->getOrbs().size();
+		connected += clients[i]->isConnected();
+		dropped += clients[i]->getDropped();
+	}
+
+	printf("clients:      %i (%i connected)\n", loopback, connected);
+	printf("orbs:         %i, %i in the active chunks, interest radius %.1f\n", world.getTotal(), world.size(), radius);
+	printf("ticks:        %i at %i Hz\n", ticks, tickRate);
+	printf("tick time:    p50 %.3f ms  p95 %.3f ms  p99 %.3f ms\n",
+		server.getTickTime(50), server.getTickTime(95), server.getTickTime(99));
+	printf("down:         %.0f bytes/client/s (%.0f with UDP/IP headers), largest packet %i\n",
+		downBytes / seconds / loopback,
+		(downBytes + 28.0 * server.getPacketsSent()) / seconds / loopback,
+		server.getLargestPacket());
+	printf("up:           %.0f bytes/client/s\n", upBytes / seconds / loopback);
+	printf("known orbs:   %.0f per client\n", (double)knownTotal / loopback);
+	if(loss > 0){
+		printf("dropped:      %i snapshots\n", dropped);
+	}
+	if(ticks > allocWarmup){
+		int steady = ticks - (allocWarmup > 0 ? allocWarmup : 0);
+		printf("allocs:       %.2f per tick, %.0f bytes per tick\n",
+			(double)steadyAllocs.count / steady, (double)steadyAllocs.bytes / steady);
+	}
+	if(allocWarmup >= 0){
+		if(allocTicks)
+			printf("alloc check:  failed, %i ticks allocated, the first was tick %i\n", allocTicks, firstAlloc);
+		else
+			printf("alloc check:  passed after %i warmup ticks, %i region changes exempt\n", allocWarmup, regionTicks);
+	}
+
+	//then everyone stops and the network gets reliable; every client
+	//should catch up with what's around it. How long that takes depends
+	//on the biggest backlog of adds, which a dense start makes hundreds
+	//of packets long, so it runs until they all have, up to a limit.
+	for(int i = 0; i < loopback; i++){
+		clients[i]->setLoss(0, 0);
+	}
+	memset(&input, 0, sizeof(input));
+	while(converged < loopback && settleTicks < SETTLE_SECONDS * tickRate){
+		for(int t = 0; t < SETTLE_CHECK_TICKS; t++){
+			for(int i = 0; i < loopback; i++){
+				clients[i]->sendInput(input);
+			}
+			tickServer(server, world);
+			for(int i = 0; i < loopback; i++){
+				clients[i]->receive();
+			}
+		}
+		settleTicks += SETTLE_CHECK_TICKS;
+
+		converged = 0;
+		for(int i = 0; i < loopback; i++){
+			converged += checkClient(server, world, *clients[i]);
+		}
+	}
+
+	for(int i = 0; i < loopback; i++){
+		clients[i]->disconnect();
+		delete clients[i];
+		delete bots[i];
+	}
+	printf("converged:    %i/%i clients after %i ticks\n", converged, loopback, settleTicks);
+
+	return converged == loopback && !allocTicks ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	readArgs(argc, argv);
+
+	JobSystem jobs(workers);
+	World world(boundary);
+	Server server(&world, &jobs, tickRate);
+	MetricsExporter exporter(&metrics);
+	int result;
+
+	server.setSeed(seed);
+	server.setInterestRadius(radius);
+	server.setPopulation(orbs);
+
+	if(!server.open(loopback ? 0 : port)){
+		printf("unable to open port %i\n", port);
+		return 1;
+	}
+
+	initMetrics();
+	if(metricsPort >= 0){
+		if(exporter.listen(metricsPort))
+			printf("metrics on http://127.0.0.1:%i/metrics\n", exporter.getPort());
+		else
+			printf("unable to serve metrics on port %i\n", metricsPort);
+	}
+	if(metricsFile){
+		exporter.setDumpFile(metricsFile, metricsInterval);
+	}
+	exporter.start();
+
+	if(loopback){
+		result = runLoopback(server, world);
+		exporter.stop();
+		return result;
+	}
+	runDedicated(server, world);
+
+	return 0;
+}